@@ -0,0 +1,278 @@
+#include "AssetLoader.h"
+#include "MemoryTracker.h"
+#include "Vfs.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace AssetLoader
+{
+	// Annonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		struct Request
+		{
+			std::string path;
+			Priority priority;
+			ProcessFunction process;
+			FinishFunction finish;
+			std::vector<unsigned char> data;
+			bool succeeded = false;
+		};
+
+		typedef std::unique_ptr<Request> RequestPtr;
+
+		std::vector<std::thread> ioThreads;
+		std::vector<std::thread> workerThreads;
+
+		// One lock for every queue - requests only pass through
+		// each queue once, so it's never held for long
+		std::mutex mutex;
+		std::condition_variable ioWake;
+		std::condition_variable workWake;
+		std::condition_variable doneWake;
+		std::deque<RequestPtr> ioQueue;
+		std::deque<RequestPtr> workQueue;
+		std::vector<RequestPtr> doneQueue;
+		bool quitting = false;
+
+		std::atomic<size_t> pending = 0;
+		std::atomic<size_t> criticalPending = 0;
+
+		bool ReadFile(const std::string& path, std::vector<unsigned char>& data)
+		{
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			if (!file)
+				return false;
+
+			std::streamoff size = file.tellg();
+			file.seekg(0);
+			data.resize(size > 0 ? (size_t)size : 0);
+			return size == 0 || file.read((char*)data.data(), size);
+		}
+
+		// Critical requests go ahead of everything else
+		void Push(std::deque<RequestPtr>& queue, RequestPtr request)
+		{
+			if (request->priority == Priority::Critical)
+				queue.push_front(std::move(request));
+			else
+				queue.push_back(std::move(request));
+		}
+
+		// --------------------------------------------------------
+		// Pops from a queue, sleeping until there's something to
+		// pop.  Returns null once the loader is shutting down.
+		// --------------------------------------------------------
+		RequestPtr Pop(std::deque<RequestPtr>& queue, std::condition_variable& wake)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&]() { return quitting || !queue.empty(); });
+			if (quitting)
+				return 0;
+
+			RequestPtr request = std::move(queue.front());
+			queue.pop_front();
+			return request;
+		}
+
+		// --------------------------------------------------------
+		// Reads the file through the Vfs, or as a real path if no
+		// mount has it, reporting (not failing on) missing ones
+		// --------------------------------------------------------
+		void Read(Request& request)
+		{
+			if (request.path.empty())
+				return;
+
+			if (!Vfs::Read(request.path.c_str(), request.data) &&
+				!ReadFile(request.path, request.data))
+				printf("Asset loader: unable to read %s\n", request.path.c_str());
+		}
+
+		void Process(Request& request)
+		{
+			request.succeeded = !request.process || request.process(request.data);
+
+			// The raw bytes aren't needed past this point
+			std::vector<unsigned char>().swap(request.data);
+		}
+
+		void Complete(Request& request)
+		{
+			if (request.succeeded && request.finish)
+				request.finish();
+
+			pending--;
+			if (request.priority == Priority::Critical)
+				criticalPending--;
+		}
+
+		void IOMain()
+		{
+			MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Loading);
+			while (RequestPtr request = Pop(ioQueue, ioWake))
+			{
+				Read(*request);
+
+				std::lock_guard<std::mutex> lock(mutex);
+				Push(workQueue, std::move(request));
+				workWake.notify_one();
+			}
+		}
+
+		void WorkerMain()
+		{
+			MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Loading);
+			while (RequestPtr request = Pop(workQueue, workWake))
+			{
+				Process(*request);
+
+				std::lock_guard<std::mutex> lock(mutex);
+				doneQueue.push_back(std::move(request));
+				doneWake.notify_all();
+			}
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Starts the loader's threads
+//
+// ioThreads     - Threads that only read files
+// workerThreads - Threads that run process steps
+// --------------------------------------------------------
+void AssetLoader::Initialize(unsigned int ioThreadCount, unsigned int workerThreadCount)
+{
+	// Both stages need threads, or neither gets any
+	if (ioThreadCount == 0 || workerThreadCount == 0)
+		return;
+
+	quitting = false;
+	for (unsigned int i = 0; i < ioThreadCount; i++)
+		ioThreads.emplace_back(IOMain);
+	for (unsigned int i = 0; i < workerThreadCount; i++)
+		workerThreads.emplace_back(WorkerMain);
+}
+
+void AssetLoader::ShutDown()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quitting = true;
+	}
+	ioWake.notify_all();
+	workWake.notify_all();
+
+	for (std::thread& t : ioThreads)
+		t.join();
+	for (std::thread& t : workerThreads)
+		t.join();
+	ioThreads.clear();
+	workerThreads.clear();
+
+	ioQueue.clear();
+	workQueue.clear();
+	doneQueue.clear();
+	pending = 0;
+	criticalPending = 0;
+}
+
+
+// --------------------------------------------------------
+// Queues a load, or runs it right away without threads
+// --------------------------------------------------------
+void AssetLoader::Load(const std::string& path, Priority priority, ProcessFunction process, FinishFunction finish)
+{
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Loading);
+
+	RequestPtr request = std::make_unique<Request>();
+	request->path = path;
+	request->priority = priority;
+	request->process = std::move(process);
+	request->finish = std::move(finish);
+
+	pending++;
+	if (priority == Priority::Critical)
+		criticalPending++;
+
+	if (ioThreads.empty())
+	{
+		Read(*request);
+		Process(*request);
+		Complete(*request);
+		return;
+	}
+
+	// Nothing to read, so skip straight to processing
+	std::lock_guard<std::mutex> lock(mutex);
+	if (path.empty())
+	{
+		Push(workQueue, std::move(request));
+		workWake.notify_one();
+	}
+	else
+	{
+		Push(ioQueue, std::move(request));
+		ioWake.notify_one();
+	}
+}
+
+
+// --------------------------------------------------------
+// Finishes everything that's been processed.  Call once
+// per frame from the main thread.
+// --------------------------------------------------------
+size_t AssetLoader::Update()
+{
+	std::vector<RequestPtr> done;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (doneQueue.empty())
+			return 0;
+		done.swap(doneQueue);
+	}
+
+	// Critical finishes go first, so they're never stuck
+	// behind a pile of background ones
+	for (RequestPtr& request : done)
+		if (request->priority == Priority::Critical)
+			Complete(*request);
+	for (RequestPtr& request : done)
+		if (request->priority != Priority::Critical)
+			Complete(*request);
+
+	return done.size();
+}
+
+
+// --------------------------------------------------------
+// Blocks until every Critical load has finished, finishing
+// Background loads along the way if they're ready first
+// --------------------------------------------------------
+void AssetLoader::WaitForCritical()
+{
+	while (criticalPending > 0)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			doneWake.wait(lock, []() { return !doneQueue.empty() || quitting; });
+			if (quitting)
+				return;
+		}
+		Update();
+	}
+}
+
+size_t AssetLoader::Pending()
+{
+	return pending;
+}
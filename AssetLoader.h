@@ -0,0 +1,77 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Loads assets in parallel, in three stages:
+//
+//  1. Read   - An I/O thread reads the whole file (if any),
+//              so slow reads never hold up CPU work
+//  2. Process - A worker decodes the bytes or builds data
+//              (parsing, generating geometry, compiling)
+//  3. Finish  - The main thread, in Update(), creates GPU
+//              resources and hands them to the game
+//
+// Every load is in flight at once, and each finishes as
+// soon as its own inputs are ready.  Critical loads jump
+// the queues and WaitForCritical() blocks until they're
+// done; Background ones keep streaming in while frames
+// are already being presented.
+//
+// Before Initialize() (or with no threads) loads run
+// start to finish inside Load(), which is the old serial
+// behavior - handy for comparing startup times.
+//
+// Usage:
+//
+//   auto data = std::make_shared<MeshData>();
+//   AssetLoader::Load("mesh.bin", AssetLoader::Priority::Background,
+//       [data](std::vector<unsigned char>& bytes) { return Decode(bytes, *data); },
+//       [data]() { CreateMesh(*data); });
+//   ...
+//   AssetLoader::Update();	// Once per frame
+// --------------------------------------------------------
+namespace AssetLoader
+{
+	enum class Priority
+	{
+		Critical,	// Needed before the first frame
+		Background	// Shows up whenever it's ready
+	};
+
+	// Runs on a worker with the file's bytes (empty if there's
+	// no file).  Returning false skips the finish step.
+	typedef std::function<bool(std::vector<unsigned char>& data)> ProcessFunction;
+
+	// Runs on the main thread
+	typedef std::function<void()> FinishFunction;
+
+	// ioThreads     - Threads that only read files
+	// workerThreads - Threads that run process steps
+	void Initialize(unsigned int ioThreads, unsigned int workerThreads);
+
+	// Waits for running steps, then drops anything unfinished
+	void ShutDown();
+
+	// --------------------------------------------------------
+	// Queues a load
+	//
+	// path     - File to read, or empty to skip reading
+	// priority - Critical loads go to the front of each queue
+	// process  - Decodes/builds on a worker
+	// finish   - Creates resources on the main thread
+	// --------------------------------------------------------
+	void Load(const std::string& path, Priority priority, ProcessFunction process, FinishFunction finish);
+
+	// Runs the finish step of everything processed since the
+	// last call, returning how many finished
+	size_t Update();
+
+	// Pumps Update() until no Critical loads are left
+	void WaitForCritical();
+
+	// Loads queued but not yet finished
+	size_t Pending();
+}
@@ -0,0 +1,505 @@
+#include "AssetPack.h"
+#include "JobSystem.h"
+#include "LzCodec.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+// Annonymous namespace to hold variables
+// only accessible in this file
+namespace
+{
+	uint64_t AlignUp(uint64_t value)
+	{
+		return (value + AssetPackAlignment - 1) & ~(uint64_t)(AssetPackAlignment - 1);
+	}
+
+	// Lower case, forward slashes
+	char NormalizeChar(char c)
+	{
+		if (c == '\\')
+			return '/';
+		if (c >= 'A' && c <= 'Z')
+			return c - 'A' + 'a';
+		return c;
+	}
+
+	// Skips any leading "./"
+	const char* SkipCurrentDirectory(const char* name)
+	{
+		while (name[0] == '.' && (name[1] == '/' || name[1] == '\\'))
+			name += 2;
+		return name;
+	}
+
+	// --------------------------------------------------------
+	// Hashes a name as it would be after normalizing, with the
+	// same FNV-1a as StringId, without building a new string
+	// --------------------------------------------------------
+	uint64_t HashName(const char* name)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (const char* c = SkipCurrentDirectory(name); *c; c++)
+		{
+			hash ^= (unsigned char)NormalizeChar(*c);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// Whether a name normalizes to a (normalized) stored name
+	bool NameEquals(const char* stored, size_t storedLength, const char* name)
+	{
+		name = SkipCurrentDirectory(name);
+		for (size_t i = 0; i < storedLength; i++, name++)
+		{
+			if (*name == 0 || NormalizeChar(*name) != stored[i])
+				return false;
+		}
+		return *name == 0;
+	}
+
+	std::string NormalizeName(const std::string& name)
+	{
+		std::string normalized = SkipCurrentDirectory(name.c_str());
+		for (char& c : normalized)
+			c = NormalizeChar(c);
+		return normalized;
+	}
+
+	bool ReadFile(const std::string& path, std::vector<unsigned char>& data)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file)
+			return false;
+
+		std::streamoff size = file.tellg();
+		file.seekg(0);
+		data.resize(size > 0 ? (size_t)size : 0);
+		return size == 0 || file.read((char*)data.data(), size);
+	}
+
+	// Whether a table lies entirely inside the file
+	bool TableFits(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize)
+	{
+		return offset <= fileSize && count * elementSize <= fileSize - offset;
+	}
+}
+
+
+// --------------------------------------------------------
+// Maps a pack and checks that its tables lie inside it.
+// Entries themselves are checked when they're used.
+//
+// path - Full or relative path of the file
+// --------------------------------------------------------
+bool AssetPack::Open(const std::string& path)
+{
+	Close();
+	if (!file.Open(path))
+		return false;
+
+	const AssetPackHeader* h = (const AssetPackHeader*)file.Data();
+	uint64_t size = file.Size();
+	bool valid = size >= sizeof(AssetPackHeader) &&
+		h->magic == AssetPackMagic &&
+		h->version == AssetPackVersion &&
+		h->fileSize == size &&
+		h->blockSize == AssetPackBlockSize &&
+		h->slotCount > 0 && (h->slotCount & (h->slotCount - 1)) == 0 &&
+		h->entryCount < h->slotCount &&
+		h->entriesOffset % 8 == 0 && h->slotsOffset % 4 == 0 && h->blocksOffset % 8 == 0 &&
+		TableFits(h->entriesOffset, h->entryCount, sizeof(AssetPackEntry), size) &&
+		TableFits(h->slotsOffset, h->slotCount, sizeof(uint32_t), size) &&
+		TableFits(h->blocksOffset, h->blockCount, sizeof(AssetPackBlock), size) &&
+		h->namesOffset <= size;
+	if (!valid)
+	{
+		printf("Asset pack: %s is not a valid version %u pack\n", path.c_str(), AssetPackVersion);
+		file.Close();
+		return false;
+	}
+
+	header = h;
+	return true;
+}
+
+void AssetPack::Close()
+{
+	header = 0;
+	file.Close();
+}
+
+
+// --------------------------------------------------------
+// Looks a name up in the hashed index
+// --------------------------------------------------------
+const AssetPackEntry* AssetPack::Find(const char* name) const
+{
+	if (!header)
+		return 0;
+
+	uint64_t hash = HashName(name);
+	const uint32_t* slots = (const uint32_t*)(file.Data() + header->slotsOffset);
+	const AssetPackEntry* entries = Entries();
+	const char* names = (const char*)file.Data() + header->namesOffset;
+	uint64_t namesSize = file.Size() - header->namesOffset;
+
+	uint32_t mask = header->slotCount - 1;
+	for (uint32_t i = 0, slot = (uint32_t)hash & mask; i < header->slotCount; i++, slot = (slot + 1) & mask)
+	{
+		uint32_t index = slots[slot];
+		if (index == 0)
+			return 0;
+		if (index > header->entryCount)
+			continue;
+
+		const AssetPackEntry& entry = entries[index - 1];
+		if (entry.nameHash == hash &&
+			(uint64_t)entry.nameOffset + entry.nameLength <= namesSize &&
+			NameEquals(names + entry.nameOffset, entry.nameLength, name))
+			return &entry;
+	}
+	return 0;
+}
+
+
+const unsigned char* AssetPack::Map(const char* name, size_t& size) const
+{
+	const AssetPackEntry* entry = Find(name);
+	return entry ? Map(*entry, size) : 0;
+}
+
+const unsigned char* AssetPack::Map(const AssetPackEntry& entry, size_t& size) const
+{
+	if ((entry.flags & AssetPackFlags::Compressed) ||
+		!TableFits(entry.offset, entry.size, 1, file.Size()))
+		return 0;
+
+	size = (size_t)entry.size;
+	return file.Data() + entry.offset;
+}
+
+
+bool AssetPack::Read(const char* name, std::vector<unsigned char>& data) const
+{
+	const AssetPackEntry* entry = Find(name);
+	return entry && Read(*entry, data);
+}
+
+
+bool AssetPack::Read(const AssetPackEntry& entry, std::vector<unsigned char>& data) const
+{
+	uint64_t offset = 0;
+	uint64_t size = 0;
+	return Extent(entry, offset, size) && Decode(entry, file.Data() + offset, data);
+}
+
+
+// --------------------------------------------------------
+// Works out where an entry's data is.  A compressed entry's
+// blocks were written one after another, so they're one
+// range from the first block to the end of the last.
+// --------------------------------------------------------
+bool AssetPack::Extent(const AssetPackEntry& entry, uint64_t& offset, uint64_t& size) const
+{
+	if (!(entry.flags & AssetPackFlags::Compressed))
+	{
+		if (!TableFits(entry.offset, entry.size, 1, file.Size()))
+			return false;
+		offset = entry.offset;
+		size = entry.size;
+		return true;
+	}
+
+	uint64_t blockCount = (entry.size + AssetPackBlockSize - 1) / AssetPackBlockSize;
+	if ((uint64_t)entry.firstBlock + blockCount > header->blockCount)
+		return false;
+
+	offset = 0;
+	size = 0;
+	if (blockCount == 0)
+		return true;
+
+	const AssetPackBlock* blocks = (const AssetPackBlock*)(file.Data() + header->blocksOffset) + entry.firstBlock;
+	const AssetPackBlock& last = blocks[blockCount - 1];
+	if (last.offset < blocks[0].offset ||
+		!TableFits(last.offset, last.compressedSize, 1, file.Size()))
+		return false;
+
+	offset = blocks[0].offset;
+	size = last.offset + last.compressedSize - offset;
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Copies a stored entry, or decompresses a compressed one
+// block by block
+//
+// entry  - An entry of this pack
+// extent - The entry's extent, from the mapping or a read
+// data   - Receives the (uncompressed) contents
+// --------------------------------------------------------
+bool AssetPack::Decode(const AssetPackEntry& entry, const unsigned char* extent, std::vector<unsigned char>& data) const
+{
+	uint64_t offset = 0;
+	uint64_t size = 0;
+	if (!Extent(entry, offset, size))
+		return false;
+
+	if (!(entry.flags & AssetPackFlags::Compressed))
+	{
+		data.assign(extent, extent + size);
+		return true;
+	}
+
+	uint64_t blockCount = (entry.size + AssetPackBlockSize - 1) / AssetPackBlockSize;
+	data.resize((size_t)entry.size);
+	const AssetPackBlock* blocks = (const AssetPackBlock*)(file.Data() + header->blocksOffset) + entry.firstBlock;
+	uint64_t written = 0;
+	for (uint64_t b = 0; b < blockCount; b++)
+	{
+		const AssetPackBlock& block = blocks[b];
+		if (block.size > entry.size - written ||
+			block.offset < offset ||
+			!TableFits(block.offset - offset, block.compressedSize, 1, size))
+			return false;
+
+		const unsigned char* source = extent + (block.offset - offset);
+		unsigned char* destination = data.data() + written;
+		if (block.compressedSize == block.size)
+			memcpy(destination, source, block.size);
+		else if (!LzCodec::Decompress(source, block.compressedSize, destination, block.size))
+			return false;
+
+		written += block.size;
+	}
+	return written == entry.size;
+}
+
+
+std::string AssetPack::EntryName(const AssetPackEntry& entry) const
+{
+	const char* names = (const char*)file.Data() + header->namesOffset;
+	if ((uint64_t)entry.nameOffset + entry.nameLength > file.Size() - header->namesOffset)
+		return std::string();
+	return std::string(names + entry.nameOffset, entry.nameLength);
+}
+
+
+// --------------------------------------------------------
+// Reads every source file and lays out a pack.  Blocks are
+// compressed in parallel, and kept uncompressed when that
+// doesn't save anything.
+//
+// path    - Pack to write (under a temporary name first)
+// sources - Files to put in it
+// --------------------------------------------------------
+bool WriteAssetPack(const std::string& path, const std::vector<AssetPackSource>& sources)
+{
+	struct Block
+	{
+		size_t source;
+		uint64_t start;
+		uint32_t size;
+		std::vector<unsigned char> compressed;
+	};
+
+	std::vector<std::vector<unsigned char>> contents(sources.size());
+	std::vector<std::string> names(sources.size());
+	std::vector<Block> blocks;
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		if (!ReadFile(sources[i].path, contents[i]))
+		{
+			printf("Asset pack: unable to read %s\n", sources[i].path.c_str());
+			return false;
+		}
+
+		names[i] = NormalizeName(sources[i].name);
+		for (size_t j = 0; j < i; j++)
+		{
+			if (names[j] == names[i])
+			{
+				printf("Asset pack: %s is in the pack twice\n", names[i].c_str());
+				return false;
+			}
+		}
+
+		if (!sources[i].compress)
+			continue;
+		for (uint64_t start = 0; start < contents[i].size(); start += AssetPackBlockSize)
+		{
+			uint32_t size = (uint32_t)std::min<uint64_t>(AssetPackBlockSize, contents[i].size() - start);
+			blocks.push_back({ i, start, size, {} });
+		}
+	}
+
+	JobSystem::ParallelFor((unsigned int)blocks.size(), 4, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int b = begin; b < end; b++)
+		{
+			Block& block = blocks[b];
+			const unsigned char* data = contents[block.source].data() + block.start;
+			block.compressed.resize(LzCodec::MaxCompressedSize(block.size));
+			size_t compressedSize = LzCodec::Compress(data, block.size, block.compressed.data(), block.compressed.size());
+			if (compressedSize == 0 || compressedSize >= block.size)
+				block.compressed.assign(data, data + block.size);
+			else
+				block.compressed.resize(compressedSize);
+		}
+	});
+
+	// Index size: a power of two, at most half full
+	uint32_t slotCount = 16;
+	while (slotCount < sources.size() * 2)
+		slotCount *= 2;
+
+	AssetPackHeader header = {};
+	header.magic = AssetPackMagic;
+	header.version = AssetPackVersion;
+	header.entryCount = (uint32_t)sources.size();
+	header.slotCount = slotCount;
+	header.blockCount = (uint32_t)blocks.size();
+	header.blockSize = AssetPackBlockSize;
+	header.entriesOffset = sizeof(AssetPackHeader);
+	header.slotsOffset = header.entriesOffset + sources.size() * sizeof(AssetPackEntry);
+	header.blocksOffset = AlignUp(header.slotsOffset + slotCount * sizeof(uint32_t));
+	header.namesOffset = header.blocksOffset + blocks.size() * sizeof(AssetPackBlock);
+
+	std::vector<AssetPackEntry> entries(sources.size());
+	std::vector<uint32_t> slots(slotCount, 0);
+	std::string nameTable;
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		AssetPackEntry& entry = entries[i];
+		entry.nameHash = HashName(names[i].c_str());
+		entry.size = contents[i].size();
+		entry.nameOffset = (uint32_t)nameTable.size();
+		entry.nameLength = (uint32_t)names[i].size();
+		nameTable += names[i];
+
+		uint32_t slot = (uint32_t)entry.nameHash & (slotCount - 1);
+		while (slots[slot] != 0)
+			slot = (slot + 1) & (slotCount - 1);
+		slots[slot] = (uint32_t)i + 1;
+	}
+
+	// Stored entries first, each aligned, then the blocks
+	uint64_t offset = AlignUp(header.namesOffset + nameTable.size());
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		if (sources[i].compress)
+			continue;
+		entries[i].offset = offset;
+		offset = AlignUp(offset + contents[i].size());
+	}
+
+	std::vector<AssetPackBlock> blockTable(blocks.size());
+	for (size_t b = 0; b < blocks.size(); b++)
+	{
+		AssetPackEntry& entry = entries[blocks[b].source];
+		if (!(entry.flags & AssetPackFlags::Compressed))
+		{
+			entry.flags |= AssetPackFlags::Compressed;
+			entry.firstBlock = (uint32_t)b;
+		}
+
+		blockTable[b] = { offset, (uint32_t)blocks[b].compressed.size(), blocks[b].size };
+		offset += blocks[b].compressed.size();
+	}
+
+	// Empty compressed files have no blocks at all
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		if (sources[i].compress && contents[i].empty())
+		{
+			entries[i].flags |= AssetPackFlags::Compressed;
+			entries[i].firstBlock = (uint32_t)blocks.size();
+		}
+	}
+	header.fileSize = offset;
+
+	std::vector<unsigned char> data((size_t)header.fileSize, 0);
+	memcpy(data.data(), &header, sizeof(header));
+	if (!entries.empty())
+		memcpy(&data[header.entriesOffset], entries.data(), entries.size() * sizeof(AssetPackEntry));
+	memcpy(&data[header.slotsOffset], slots.data(), slots.size() * sizeof(uint32_t));
+	if (!blockTable.empty())
+		memcpy(&data[header.blocksOffset], blockTable.data(), blockTable.size() * sizeof(AssetPackBlock));
+	memcpy(&data[header.namesOffset], nameTable.data(), nameTable.size());
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		if (!sources[i].compress && !contents[i].empty())
+			memcpy(&data[entries[i].offset], contents[i].data(), contents[i].size());
+	}
+	for (size_t b = 0; b < blocks.size(); b++)
+		memcpy(&data[blockTable[b].offset], blocks[b].compressed.data(), blocks[b].compressed.size());
+
+	std::string temp = path + ".tmp";
+	{
+		std::ofstream file(temp, std::ios::binary);
+		if (!file.write((const char*)data.data(), data.size()))
+		{
+			printf("Asset pack: unable to write %s\n", path.c_str());
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temp, path, error);
+	if (error)
+	{
+		printf("Asset pack: unable to write %s\n", path.c_str());
+		std::filesystem::remove(temp, error);
+		return false;
+	}
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Packs the files named on the command line
+//
+// commandLine - The full command line given to the app
+// --------------------------------------------------------
+int AssetPacks::RunPacker(const std::string& commandLine)
+{
+	std::istringstream args(commandLine);
+	std::string arg, output;
+	std::vector<AssetPackSource> sources;
+	bool packing = false;
+	while (args >> arg)
+	{
+		if (arg == "-pack")
+		{
+			packing = args >> output ? true : false;
+			continue;
+		}
+		if (!packing || arg[0] == '-')
+			continue;
+
+		bool isMesh = arg.size() >= 5 && NormalizeName(arg.substr(arg.size() - 5)) == ".mesh";
+		sources.push_back({ arg, arg, !isMesh });
+	}
+
+	if (output.empty() || sources.empty())
+	{
+		printf("Usage: -pack <out.pack> <files...>\n");
+		return 1;
+	}
+
+	// Blocks are compressed on the job system
+	JobSystem::Initialize(0);
+	bool written = WriteAssetPack(output, sources);
+	JobSystem::ShutDown();
+	if (!written)
+		return 1;
+
+	printf("Packed %zu files into %s\n", sources.size(), output.c_str());
+	return 0;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Single-file asset archive (.pack)
+//
+// Layout:
+//
+//   AssetPackHeader
+//   AssetPackEntry[entryCount]
+//   uint32_t slots[slotCount]		Hashed index: entry + 1, or 0
+//   AssetPackBlock[blockCount]		Compressed entries' blocks
+//   char names[]					Entry names, not terminated
+//   data							Stored entries, each aligned
+//									to AssetPackAlignment, and
+//									compressed blocks
+//
+// Names are normalized ('/' separators, lower case, no
+// leading "./") and hashed like StringId, and looked up in
+// an open addressed table - no strings are built to find
+// anything.  Compressed entries are split into blocks of
+// AssetPackBlockSize, each compressed (LzCodec) on its own.
+// Stored entries are used in place from the mapping, which
+// is what meshes want since MeshFile can use them as is.
+//
+// Packs are made with the "-pack" command, e.g.:
+//
+//   D3D11Starter.exe -pack assets.pack VertexShader.cso PixelShader.cso Sunflower.mesh
+// --------------------------------------------------------
+
+const uint32_t AssetPackMagic = 0x4B434150;	// "PACK"
+const uint32_t AssetPackVersion = 1;
+const uint32_t AssetPackBlockSize = 64 * 1024;
+const uint32_t AssetPackAlignment = 64;
+
+struct AssetPackHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t fileSize;
+	uint32_t entryCount;
+	uint32_t slotCount;		// Power of two
+	uint32_t blockCount;
+	uint32_t blockSize;
+
+	// Byte offsets from the start of the file
+	uint64_t entriesOffset;
+	uint64_t slotsOffset;
+	uint64_t blocksOffset;
+	uint64_t namesOffset;
+};
+
+namespace AssetPackFlags
+{
+	const uint32_t Compressed = 1;
+}
+
+struct AssetPackEntry
+{
+	uint64_t nameHash;
+	uint64_t offset;		// Stored entries' data
+	uint64_t size;			// Uncompressed size
+	uint32_t nameOffset;	// Into the name table
+	uint32_t nameLength;
+	uint32_t firstBlock;	// Compressed entries' first block
+	uint32_t flags;			// AssetPackFlags
+};
+
+// A block whose compressed size equals its size was stored
+// as is, since compressing didn't make it any smaller
+struct AssetPackBlock
+{
+	uint64_t offset;
+	uint32_t compressedSize;
+	uint32_t size;
+};
+
+static_assert(sizeof(AssetPackHeader) == 64, "Asset pack header layout changed");
+static_assert(sizeof(AssetPackEntry) == 40, "Asset pack entry layout changed");
+static_assert(sizeof(AssetPackBlock) == 16, "Asset pack block layout changed");
+
+
+// --------------------------------------------------------
+// A memory mapped .pack file.  Every method is const and
+// the mapping is read-only, so any thread can read from an
+// open pack at the same time.
+// --------------------------------------------------------
+class AssetPack
+{
+public:
+	bool Open(const std::string& path);
+	void Close();
+	bool IsOpen() const { return header != 0; }
+
+	// The entry with a name, or null
+	const AssetPackEntry* Find(const char* name) const;
+	bool Contains(const char* name) const { return Find(name) != 0; }
+
+	// --------------------------------------------------------
+	// Points right at a stored entry's data in the mapping.
+	// Returns null for missing and compressed entries.
+	// --------------------------------------------------------
+	const unsigned char* Map(const char* name, size_t& size) const;
+	const unsigned char* Map(const AssetPackEntry& entry, size_t& size) const;
+
+	// Copies (and decompresses, if needed) an entry's data
+	bool Read(const char* name, std::vector<unsigned char>& data) const;
+	bool Read(const AssetPackEntry& entry, std::vector<unsigned char>& data) const;
+
+	// --------------------------------------------------------
+	// The range of the file holding an entry's data: its
+	// stored bytes, or all of its compressed blocks.  For
+	// reading entries with file I/O instead of the mapping.
+	// --------------------------------------------------------
+	bool Extent(const AssetPackEntry& entry, uint64_t& offset, uint64_t& size) const;
+
+	// Decodes an entry from a copy of its extent (see Extent())
+	bool Decode(const AssetPackEntry& entry, const unsigned char* extent, std::vector<unsigned char>& data) const;
+
+	size_t EntryCount() const { return header ? header->entryCount : 0; }
+	const AssetPackEntry* Entries() const { return (const AssetPackEntry*)(file.Data() + header->entriesOffset); }
+	std::string EntryName(const AssetPackEntry& entry) const;
+
+private:
+	MappedFile file;
+	const AssetPackHeader* header = 0;
+};
+
+
+// One file to put in a pack
+struct AssetPackSource
+{
+	std::string name;	// Looked up by this
+	std::string path;	// Read from here
+	bool compress;		// Or store, so it can be mapped
+};
+
+// Builds a pack, compressing blocks on the JobSystem
+bool WriteAssetPack(const std::string& path, const std::vector<AssetPackSource>& sources);
+
+
+// Packs are mounted for the whole app through the Vfs
+namespace AssetPacks
+{
+	// --------------------------------------------------------
+	// Runs "-pack <out.pack> <files...>", returning zero on
+	// success.  Files are named by the path given, and every
+	// file except .mesh files is compressed.
+	// --------------------------------------------------------
+	int RunPacker(const std::string& commandLine);
+}
@@ -0,0 +1,494 @@
+#include "Benchmark.h"
+#include "FrameArena.h"
+#include "Game.h"
+#include "Graphics.h"
+#include "Input.h"
+#include "JobSystem.h"
+#include "MemoryTracker.h"
+#include "Mesh.h"
+#include "MeshStreaming.h"
+#include "PathHelpers.h"
+#include "PipelineCache.h"
+#include "Resources.h"
+#include "ShaderPermutations.h"
+#include "SimdMath.h"
+#include "Vertex.h"
+#include "Vfs.h"
+#include "Window.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+// For the engine math library
+using namespace Math;
+
+// Annonymous namespace to hold variables
+// only accessible in this file
+namespace
+{
+	// Size of the offscreen render target
+	const unsigned int benchmarkWidth = 1280;
+	const unsigned int benchmarkHeight = 720;
+
+	// The default suite, covering few vs. many draws,
+	// small vs. large meshes and unique vs. instanced
+	const Benchmark::SceneDesc defaultScenes[] =
+	{
+		{ "unique_small",		100,	1,		32 },
+		{ "instanced_small",	1,		100,	32 },
+		{ "unique_large",		100,	1,		4096 },
+		{ "instanced_large",	10,		10,		4096 },
+		{ "many_draws",			10,		1000,	8 },
+		{ "heavy_mesh",			1,		1,		1 << 20 },
+	};
+
+	// Everything we measured for one scene
+	struct SceneResult
+	{
+		Benchmark::SceneDesc desc;
+		unsigned int frames;
+		Benchmark::Stats frameMs;
+		double drawsPerSecond;
+		double allocationsPerFrame;
+		double bytesPerFrame;
+		unsigned int framesWithAllocations;		// Only counted when asserting
+		unsigned long long tagAllocations[MemoryTracker::TagCount];
+		bool hasCounters;
+		PerfCounters::Sample counters;	// Totals over all measured frames
+	};
+
+	// --------------------------------------------------------
+	// Creates a flat disc (triangle fan, drawn as a list) with
+	// exactly the requested number of triangles
+	// --------------------------------------------------------
+	MeshHandle CreateDiscMesh(unsigned int triangleCount, unsigned int meshIndex)
+	{
+		const float radius = 0.25f;
+		Float4 color(
+			(meshIndex % 3 == 0) ? 1.0f : 0.25f,
+			(meshIndex % 3 == 1) ? 1.0f : 0.25f,
+			(meshIndex % 3 == 2) ? 1.0f : 0.25f,
+			1.0f);
+
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		vertices.reserve(triangleCount + 1);
+		indices.reserve(triangleCount * 3);
+
+		// Center, then one vertex per triangle around the rim
+		vertices.push_back({ Float3(0.0f, 0.0f, 0.0f), color });
+		for (unsigned int i = 0; i < triangleCount; i++)
+		{
+			float angle = (float(i) / triangleCount) * TwoPi;
+			vertices.push_back({ Float3(cosf(angle) * radius, sinf(angle) * radius, 0.0f), color });
+
+			indices.push_back(0);
+			indices.push_back(1 + i);
+			indices.push_back(1 + (i + 1) % triangleCount);
+		}
+
+		return Resources::CreateMesh("Benchmark Disc", vertices.data(), vertices.size(), indices.data(), indices.size());
+	}
+
+	// --------------------------------------------------------
+	// Builds one scene, runs it for the requested number of
+	// frames and gathers its stats
+	// --------------------------------------------------------
+	SceneResult RunScene(const Benchmark::SceneDesc& desc, unsigned int warmupFrames, unsigned int measuredFrames, bool useCounters, bool assertNoAllocations)
+	{
+		SceneResult result = {};
+		result.desc = desc;
+		result.frames = measuredFrames;
+
+		// A fresh game each time so scenes don't affect each other
+		std::unique_ptr<Game> game = std::make_unique<Game>();
+		game->Initialize();
+
+		std::vector<double> frameMs;
+		{
+			MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Benchmark);
+
+			std::vector<MeshHandle> sceneMeshes;
+			for (unsigned int i = 0; i < desc.uniqueMeshes; i++)
+				sceneMeshes.push_back(CreateDiscMesh(desc.trianglesPerMesh, i));
+			game->LoadScene(sceneMeshes, desc.instancesPerMesh);
+
+			// Reserve up front so recording doesn't count as a frame allocation
+			frameMs.reserve(measuredFrames);
+		}
+
+		double perfSeconds = Benchmark::SecondsPerTick();
+
+		unsigned long long frameAllocations = 0;
+		unsigned long long frameBytes = 0;
+		PerfCounters::Sample counterTotals = {};
+		float deltaTime = 1.0f / 60.0f;
+		float totalTime = 0.0f;
+
+		for (unsigned int frame = 0; frame < warmupFrames + measuredFrames; frame++)
+		{
+			// Warmup is where caches, pools, etc. fill up,
+			// so only steady-state frames must not allocate
+			bool measured = frame >= warmupFrames;
+			MemoryTracker::SetAssertNoAllocations(assertNoAllocations && measured);
+			if (useCounters && measured)
+				PerfCounters::Begin();
+
+			MemoryTracker::BeginFrame();
+			__int64 startTime = Benchmark::Now();
+
+			// Same order as the main game loop
+			Input::Update();
+			game->Update(deltaTime, totalTime);
+			game->Draw(deltaTime, totalTime);
+			Input::EndOfFrame();
+			FrameArena::Reset();
+			Resources::EndFrame();
+
+			__int64 endTime = Benchmark::Now();
+			bool noAllocations = MemoryTracker::EndFrame();
+
+			if (useCounters && measured)
+			{
+				PerfCounters::Sample counters = PerfCounters::End();
+				if (frame == warmupFrames)
+					counterTotals = counters;
+				else
+					counterTotals.Add(counters);
+			}
+
+#if defined(DEBUG) || defined(_DEBUG)
+			Graphics::PrintDebugMessages();
+#endif
+
+			// ImGui requires a positive delta time every frame
+			deltaTime = max((float)((endTime - startTime) * perfSeconds), 0.000001f);
+			totalTime += deltaTime;
+
+			if (!measured)
+				continue;
+
+			const MemoryTracker::Counts& allocations = MemoryTracker::LastFrame();
+			frameMs.push_back((endTime - startTime) * perfSeconds * 1000.0);
+			frameAllocations += allocations.allocations;
+			frameBytes += allocations.bytes;
+			for (unsigned int t = 0; t < MemoryTracker::TagCount; t++)
+				result.tagAllocations[t] += allocations.tagAllocations[t];
+
+			if (!noAllocations)
+				result.framesWithAllocations++;
+		}
+		MemoryTracker::SetAssertNoAllocations(false);
+
+		// Crunch the numbers
+		if (frameMs.empty())
+			return result;
+
+		double drawsPerFrame = (double)desc.uniqueMeshes * desc.instancesPerMesh;
+		result.frameMs = Benchmark::ComputeStats(frameMs);
+		result.drawsPerSecond = drawsPerFrame / (result.frameMs.mean / 1000.0);
+		result.allocationsPerFrame = (double)frameAllocations / frameMs.size();
+		result.bytesPerFrame = (double)frameBytes / frameMs.size();
+		result.hasCounters = useCounters;
+		result.counters = counterTotals;
+		return result;
+	}
+
+	// --------------------------------------------------------
+	// Writes all results as a single JSON document
+	// --------------------------------------------------------
+	bool WriteResults(const std::string& path, const std::vector<SceneResult>& results, unsigned int warmupFrames)
+	{
+		FILE* file = 0;
+		if (fopen_s(&file, path.c_str(), "w") != 0 || !file)
+			return false;
+
+		fprintf(file, "{\n");
+		fprintf(file, "  \"suite\": \"scenes\",\n");
+		fprintf(file, "  \"api\": \"%s\",\n", WideToNarrow(Graphics::APIName()).c_str());
+		fprintf(file, "  \"width\": %u,\n", benchmarkWidth);
+		fprintf(file, "  \"height\": %u,\n", benchmarkHeight);
+		fprintf(file, "  \"warmup_frames\": %u,\n", warmupFrames);
+		fprintf(file, "  \"scenes\": [\n");
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const SceneResult& r = results[i];
+			fprintf(file, "    {\n");
+			fprintf(file, "      \"name\": \"%s\",\n", r.desc.name);
+			fprintf(file, "      \"unique_meshes\": %u,\n", r.desc.uniqueMeshes);
+			fprintf(file, "      \"instances_per_mesh\": %u,\n", r.desc.instancesPerMesh);
+			fprintf(file, "      \"triangles_per_mesh\": %u,\n", r.desc.trianglesPerMesh);
+			fprintf(file, "      \"draws_per_frame\": %llu,\n", (unsigned long long)r.desc.uniqueMeshes * r.desc.instancesPerMesh);
+			fprintf(file, "      \"frames\": %u,\n", r.frames);
+			fprintf(file, "      \"cpu_ms_per_frame\": { \"mean\": %.4f, \"median\": %.4f, \"min\": %.4f, \"max\": %.4f, \"stddev\": %.4f, \"p95\": %.4f },\n",
+				r.frameMs.mean, r.frameMs.median, r.frameMs.min, r.frameMs.max, r.frameMs.stdDev, r.frameMs.p95);
+			fprintf(file, "      \"draws_per_sec\": %.1f,\n", r.drawsPerSecond);
+			fprintf(file, "      \"allocations_per_frame\": %.2f,\n", r.allocationsPerFrame);
+			fprintf(file, "      \"allocations_by_tag\": {");
+			for (unsigned int t = 0; t < MemoryTracker::TagCount; t++)
+				fprintf(file, "%s \"%s\": %llu", t > 0 ? "," : "", MemoryTracker::TagName((MemoryTracker::Tag)t), r.tagAllocations[t]);
+			fprintf(file, " },\n");
+			fprintf(file, "      \"frames_with_allocations\": %u,\n", r.framesWithAllocations);
+			fprintf(file, "      \"bytes_allocated_per_frame\": %.1f%s\n", r.bytesPerFrame, r.hasCounters ? "," : "");
+			if (r.hasCounters)
+			{
+				double draws = (double)r.desc.uniqueMeshes * r.desc.instancesPerMesh * r.frames;
+				fprintf(file, "      %s\n", Benchmark::CountersJson(r.counters, draws, "draw").c_str());
+			}
+			fprintf(file, "    }%s\n", i + 1 < results.size() ? "," : "");
+		}
+		fprintf(file, "  ]\n");
+		fprintf(file, "}\n");
+
+		fclose(file);
+		return true;
+	}
+}
+
+
+// --------------------------------------------------------
+// Entry point from WinMain() - picks which suite to run
+//
+// commandLine - The full command line given to the app
+// --------------------------------------------------------
+int Benchmark::Run(const std::string& commandLine)
+{
+	std::istringstream args(commandLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		if (arg == "-micro")
+			return RunMicro(commandLine);
+	}
+
+	return RunScenes(commandLine);
+}
+
+
+// --------------------------------------------------------
+// Parses the command line, runs every requested scene
+// headless and writes the JSON report
+//
+// commandLine - The full command line given to the app
+// --------------------------------------------------------
+int Benchmark::RunScenes(const std::string& commandLine)
+{
+	std::string outputPath = FixPath("benchmark_results.json");
+	unsigned int warmupFrames = 30;
+	unsigned int measuredFrames = 300;
+	SceneDesc customScene = { "custom", 0, 1, 256 };
+	bool useCounters = CountersRequested(commandLine);
+	bool assertNoAllocations = false;
+
+	// Simple "-option value" parsing
+	std::istringstream args(commandLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		if (arg == "-out") args >> outputPath;
+		else if (arg == "-frames") args >> measuredFrames;
+		else if (arg == "-warmup") args >> warmupFrames;
+		else if (arg == "-meshes") args >> customScene.uniqueMeshes;
+		else if (arg == "-instances") args >> customScene.instancesPerMesh;
+		else if (arg == "-tris") args >> customScene.trianglesPerMesh;
+		else if (arg == "-assert-no-alloc") assertNoAllocations = true;
+	}
+
+	std::vector<SceneDesc> scenes;
+	if (customScene.uniqueMeshes > 0)
+		scenes.push_back(customScene);
+	else
+		scenes.assign(std::begin(defaultScenes), std::end(defaultScenes));
+
+	HRESULT hr = StartHeadless();
+	if (FAILED(hr))
+		return hr;
+
+	if (useCounters && !PerfCounters::Initialize())
+		printf("Hardware performance counters are unavailable on this system\n");
+
+	std::vector<SceneResult> results;
+	unsigned int failedScenes = 0;
+	for (const SceneDesc& scene : scenes)
+	{
+		results.push_back(RunScene(scene, warmupFrames, measuredFrames, useCounters, assertNoAllocations));
+
+		const SceneResult& r = results.back();
+		printf("%-20s %8.3f ms/frame  %12.0f draws/sec  %8.1f allocs/frame",
+			r.desc.name, r.frameMs.mean, r.drawsPerSecond, r.allocationsPerFrame);
+		if (r.hasCounters && r.counters.valid[PerfCounters::Cycles])
+			printf("  %5.2f IPC", r.counters.IPC());
+		printf("\n");
+
+		// Point at whoever allocated during steady state
+		if (r.framesWithAllocations > 0)
+		{
+			failedScenes++;
+			printf("  FAILED: %u of %u steady-state frames allocated:", r.framesWithAllocations, r.frames);
+			for (unsigned int t = 0; t < MemoryTracker::TagCount; t++)
+				if (r.tagAllocations[t] > 0)
+					printf(" %s=%llu", MemoryTracker::TagName((MemoryTracker::Tag)t), r.tagAllocations[t]);
+			printf("\n");
+		}
+	}
+
+	bool written = WriteResults(outputPath, results, warmupFrames);
+	if (written)
+		printf("Benchmark results written to %s\n", outputPath.c_str());
+
+	StopHeadless();
+	if (!written)
+		return 1;
+	return failedScenes > 0 ? 3 : 0;
+}
+
+
+// --------------------------------------------------------
+// Sets up the window-less graphics API and input system
+// that every suite runs on.  Only call this once.
+// --------------------------------------------------------
+HRESULT Benchmark::StartHeadless()
+{
+	// No visible window - render offscreen
+	HRESULT hr = Window::CreateHeadless(benchmarkWidth, benchmarkHeight);
+	if (FAILED(hr))
+		return hr;
+
+	hr = Graphics::Initialize(Window::Width(), Window::Height(), Window::Handle(), false);
+	if (FAILED(hr))
+		return hr;
+
+	Input::Initialize(Window::Handle());
+	FrameArena::Initialize(4 * 1024 * 1024, true);
+	JobSystem::Initialize(0);
+	Vfs::MountDirectory("", GetExePath());
+	ShaderPermutations::Initialize(".", FixPath("ShaderCache"));
+	return S_OK;
+}
+
+
+// --------------------------------------------------------
+// Shuts down everything StartHeadless() set up
+// --------------------------------------------------------
+void Benchmark::StopHeadless()
+{
+	PerfCounters::ShutDown();
+	JobSystem::ShutDown();
+	FrameArena::ShutDown();
+	PipelineCache::ShutDown();
+	MeshStreaming::ShutDown();
+	Resources::ShutDown();
+	Vfs::UnmountAll();
+	Input::ShutDown();
+	Graphics::ShutDown();
+}
+
+
+// --------------------------------------------------------
+// Summarizes a set of samples (mean, median, spread, etc.)
+//
+// samples - Timing samples, in whatever unit the caller likes
+// --------------------------------------------------------
+Benchmark::Stats Benchmark::ComputeStats(std::vector<double> samples)
+{
+	Stats stats = {};
+	if (samples.empty())
+		return stats;
+
+	std::sort(samples.begin(), samples.end());
+
+	double total = 0.0;
+	for (double s : samples)
+		total += s;
+	stats.mean = total / samples.size();
+
+	double variance = 0.0;
+	for (double s : samples)
+		variance += (s - stats.mean) * (s - stats.mean);
+	stats.stdDev = sqrt(variance / samples.size());
+
+	stats.median = samples[samples.size() / 2];
+	stats.min = samples.front();
+	stats.max = samples.back();
+	stats.p95 = samples[min(samples.size() - 1, samples.size() * 95 / 100)];
+	return stats;
+}
+
+
+// --------------------------------------------------------
+// High resolution timing, same source as the game loop
+// --------------------------------------------------------
+double Benchmark::SecondsPerTick()
+{
+	LARGE_INTEGER perfFreq{};
+	QueryPerformanceFrequency(&perfFreq);
+	return 1.0 / (double)perfFreq.QuadPart;
+}
+
+__int64 Benchmark::Now()
+{
+	__int64 time = 0;
+	QueryPerformanceCounter((LARGE_INTEGER*)&time);
+	return time;
+}
+
+
+// --------------------------------------------------------
+// Running totals of heap allocations since startup
+// --------------------------------------------------------
+unsigned long long Benchmark::AllocationCount() { return MemoryTracker::Totals().allocations; }
+unsigned long long Benchmark::AllocationBytes() { return MemoryTracker::Totals().bytes; }
+
+
+// --------------------------------------------------------
+// Was "-counters" given on the command line?
+// --------------------------------------------------------
+bool Benchmark::CountersRequested(const std::string& commandLine)
+{
+	std::istringstream args(commandLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		if (arg == "-counters")
+			return true;
+	}
+	return false;
+}
+
+
+// --------------------------------------------------------
+// Formats hardware counter totals as a JSON "counters"
+// member, normalized per unit of work (draws, ops, etc.)
+// so results are comparable between runs of different
+// lengths.  Missing counters are written as null.
+//
+// total    - Counter totals over the whole measurement
+// units    - How many units of work those totals cover
+// unitName - Used to build the key names ("cycles_per_draw")
+// --------------------------------------------------------
+std::string Benchmark::CountersJson(const PerfCounters::Sample& total, double units, const char* unitName)
+{
+	std::ostringstream json;
+	json << "\"counters\": { ";
+
+	if (total.valid[PerfCounters::Cycles] && total.valid[PerfCounters::Instructions])
+		json << "\"ipc\": " << total.IPC();
+	else
+		json << "\"ipc\": null";
+
+	for (int i = 0; i < PerfCounters::CounterCount; i++)
+	{
+		json << ", \"" << PerfCounters::Name((PerfCounters::Counter)i) << "_per_" << unitName << "\": ";
+		if (total.valid[i] && units > 0.0)
+			json << (double)total.values[i] / units;
+		else
+			json << "null";
+	}
+
+	json << " }";
+	return json.str();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <vector>
+
+#include "PerfCounters.h"
+
+// --------------------------------------------------------
+// Headless benchmark suite
+//
+// Builds synthetic stress scenes and runs them through the
+// full Game update/draw path without a visible window,
+// then reports the results as JSON.  Launch the executable
+// with "-benchmark" to run it instead of the game, e.g.:
+//
+//   D3D11Starter.exe -benchmark -out results.json
+//   D3D11Starter.exe -benchmark -meshes 50 -instances 20 -tris 512
+//   D3D11Starter.exe -benchmark -micro -baseline old.json -threshold 10
+//
+// Options:
+//   -out <path>       Where to write the JSON results
+//   -frames <n>       Measured frames per scene
+//   -warmup <n>       Unmeasured frames before measuring
+//   -meshes <n>       \
+//   -instances <n>     > Run only this one custom scene
+//   -tris <n>         /
+//   -assert-no-alloc  Fail (exit code 3) if any measured frame
+//                     allocates from the heap
+//   -micro            Run the microbenchmarks instead of scenes
+//   -samples <n>      Measured samples per microbenchmark
+//   -baseline <path>  Earlier microbenchmark JSON to compare against
+//   -threshold <pct>  Allowed median slowdown before failing
+//   -counters         Also capture hardware performance counters
+//                     (cycles, IPC, cache/branch/TLB misses; Linux)
+// --------------------------------------------------------
+namespace Benchmark
+{
+	// Parameters for one synthetic scene
+	struct SceneDesc
+	{
+		const char* name;
+		unsigned int uniqueMeshes;		// How many distinct meshes (and GPU buffers)
+		unsigned int instancesPerMesh;	// How many times each mesh is drawn per frame
+		unsigned int trianglesPerMesh;	// Triangle count of every mesh
+	};
+
+	// Summary of a set of timing samples
+	struct Stats
+	{
+		double mean;
+		double median;
+		double min;
+		double max;
+		double stdDev;
+		double p95;
+	};
+
+	// Runs the suite, returning zero on success
+	int Run(const std::string& commandLine);
+	int RunScenes(const std::string& commandLine);
+	int RunMicro(const std::string& commandLine);
+
+	// Shared helpers for the individual suites
+	HRESULT StartHeadless();
+	void StopHeadless();
+	Stats ComputeStats(std::vector<double> samples);
+	double SecondsPerTick();
+	__int64 Now();
+	unsigned long long AllocationCount();
+	unsigned long long AllocationBytes();
+	bool CountersRequested(const std::string& commandLine);
+	std::string CountersJson(const PerfCounters::Sample& total, double units, const char* unitName);
+}
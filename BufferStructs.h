@@ -1,8 +1,20 @@
 #pragma once
-#include <DirectXMath.h>
+#include "SimdMath.h"
+#include "ConstantBuffer.h"
 
 struct VertexShaderData
 {
-	DirectX::XMFLOAT4 colorTint;
-	DirectX::XMFLOAT3 offset;
+	Math::Float4x4 world;		// Transposed, so the shader's column-major packing reads it back as is for mul(v, world)
+	Math::Float4 colorTint;
+	Math::Float3 offset;
 };
+
+// Mirrors VertexShader.hlsl's ExternalData cbuffer, checked
+// against the reflected layout when the shader is loaded
+constexpr std::array<ConstantBufferField, 3> VertexShaderDataFields =
+{
+	ShaderConstant<decltype(VertexShaderData::world)>("world", offsetof(VertexShaderData, world)),
+	ShaderConstant<decltype(VertexShaderData::colorTint)>("colorTint", offsetof(VertexShaderData, colorTint)),
+	ShaderConstant<decltype(VertexShaderData::offset)>("offset", offsetof(VertexShaderData, offset)),
+};
+static_assert(FollowsHlslPacking(VertexShaderDataFields), "VertexShaderData doesn't follow HLSL packing rules");
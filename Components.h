@@ -0,0 +1,46 @@
+#pragma once
+
+#include "MeshStreaming.h"
+#include "Resources.h"
+#include "SimdMath.h"
+#include "TransformSystem.h"
+
+// --------------------------------------------------------
+// Per-object components stored in the EntityWorld.  These
+// are plain data, copied around with memcpy - keep them
+// trivially copyable (no constructors, pointers that own
+// memory, etc.)
+// --------------------------------------------------------
+
+// What to draw
+struct MeshComponent
+{
+	MeshHandle mesh;
+};
+
+// What to draw, for meshes whose LODs are streamed in and
+// out (see MeshStreaming) - drawn instead of a MeshComponent
+struct StreamedMeshComponent
+{
+	StreamedMeshId mesh;
+};
+
+// Multiplied with the global tint from the UI
+struct TintComponent
+{
+	Math::Float4 color;
+};
+
+// Where to draw it (see TransformSystem)
+struct TransformComponent
+{
+	TransformId transform;
+};
+
+// World space bounding sphere, refreshed from the
+// mesh's local bounds whenever the transform updates
+struct BoundsComponent
+{
+	Math::Float3 center;
+	float radius;
+};
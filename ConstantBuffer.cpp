@@ -0,0 +1,183 @@
+#include "ConstantBuffer.h"
+#include "Graphics.h"
+#include "MemoryTracker.h"
+
+#include <d3dcompiler.h>
+#include <cstdio>
+#include <cstring>
+
+#pragma comment(lib, "d3dcompiler.lib")
+
+
+// --------------------------------------------------------
+// Reflection
+// --------------------------------------------------------
+const ConstantBufferLayout::Variable* ConstantBufferLayout::Find(StringId variable) const
+{
+	// Buffers only hold a handful of variables
+	for (const Variable& v : variables)
+	{
+		if (v.name == variable)
+			return &v;
+	}
+	return 0;
+}
+
+bool ConstantBufferLayout::Validate(const ConstantBufferField* fields, size_t count, size_t structSize) const
+{
+	bool valid = true;
+	for (size_t i = 0; i < count; i++)
+	{
+		const ConstantBufferField& field = fields[i];
+		const Variable* v = Find(StringId(field.name));
+		if (!v)
+		{
+			printf("Constant buffer %s: no variable named %s\n", name.GetString(), field.name);
+			valid = false;
+			continue;
+		}
+
+		if (v->offset != field.offset || v->size != field.size)
+		{
+			printf("Constant buffer %s: %s is %u bytes at offset %u in HLSL, but %u bytes at offset %u in C++\n",
+				name.GetString(), field.name, v->size, v->offset, field.size, field.offset);
+			valid = false;
+		}
+	}
+
+	if (structSize > size)
+	{
+		printf("Constant buffer %s: C++ struct is %zu bytes, buffer is %u\n", name.GetString(), structSize, size);
+		valid = false;
+	}
+
+	return valid;
+}
+
+
+// --------------------------------------------------------
+// Reads a cbuffer's size, register and variables
+//
+// shaderCode - Compiled shader byte code
+// shaderSize - Size of the byte code
+// bufferName - Name of the cbuffer in HLSL
+// layout     - Receives the layout
+// --------------------------------------------------------
+bool ReflectConstantBuffer(const void* shaderCode, size_t shaderSize, const char* bufferName, ConstantBufferLayout& layout)
+{
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Shaders);
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> reflection;
+	if (FAILED(D3DReflect(shaderCode, shaderSize, IID_PPV_ARGS(reflection.GetAddressOf()))))
+		return false;
+
+	// Returns a "null" object rather than null when missing
+	ID3D11ShaderReflectionConstantBuffer* buffer = reflection->GetConstantBufferByName(bufferName);
+	D3D11_SHADER_BUFFER_DESC bufferDesc;
+	if (FAILED(buffer->GetDesc(&bufferDesc)))
+	{
+		printf("Constant buffer %s: not found in shader\n", bufferName);
+		return false;
+	}
+
+	D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+	if (FAILED(reflection->GetResourceBindingDescByName(bufferName, &bindDesc)))
+		return false;
+
+	layout.name = StringId::Intern(bufferName);
+	layout.slot = bindDesc.BindPoint;
+	layout.size = bufferDesc.Size;
+	layout.variables.clear();
+	for (UINT i = 0; i < bufferDesc.Variables; i++)
+	{
+		D3D11_SHADER_VARIABLE_DESC variableDesc;
+		buffer->GetVariableByIndex(i)->GetDesc(&variableDesc);
+
+		ConstantBufferLayout::Variable v;
+		v.name = StringId::Intern(variableDesc.Name);
+		v.offset = variableDesc.StartOffset;
+		v.size = variableDesc.Size;
+		layout.variables.push_back(v);
+	}
+
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Creates the GPU buffer and a zeroed shadow copy
+// --------------------------------------------------------
+bool ConstantBuffer::Create(const ConstantBufferLayout& bufferLayout)
+{
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Graphics);
+
+	layout = bufferLayout;
+	shadow.assign(layout.size, 0);
+	dirty = true;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.ByteWidth = layout.size;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+
+	buffer.Reset();
+	return SUCCEEDED(Graphics::Device->CreateBuffer(&desc, 0, buffer.GetAddressOf()));
+}
+
+
+// --------------------------------------------------------
+// Writes one variable into the shadow copy
+//
+// variable - Name of the cbuffer variable
+// data     - New value
+// size     - Bytes in the value (at most the variable's size)
+// --------------------------------------------------------
+bool ConstantBuffer::SetRaw(StringId variable, const void* data, size_t size)
+{
+	const ConstantBufferLayout::Variable* v = layout.Find(variable);
+	if (!v || size > v->size)
+		return false;
+
+	Write(v->offset, data, size);
+	return true;
+}
+
+void ConstantBuffer::SetData(const void* data, size_t size)
+{
+	Write(0, data, size < shadow.size() ? size : shadow.size());
+}
+
+void ConstantBuffer::Write(size_t offset, const void* data, size_t size)
+{
+	// Skip unchanged values so clean buffers stay clean
+	if (memcmp(&shadow[offset], data, size) == 0)
+		return;
+
+	memcpy(&shadow[offset], data, size);
+	dirty = true;
+}
+
+
+// --------------------------------------------------------
+// Sends the shadow copy to the GPU, if it changed
+// --------------------------------------------------------
+bool ConstantBuffer::Upload()
+{
+	if (!dirty || !buffer)
+		return false;
+
+	Graphics::FillDynamicBuffer(buffer.Get(), shadow.data(), shadow.size());
+	dirty = false;
+	return true;
+}
+
+void ConstantBuffer::BindVS() const
+{
+	Graphics::Context->VSSetConstantBuffers(layout.slot, 1, buffer.GetAddressOf());
+}
+
+void ConstantBuffer::BindPS() const
+{
+	Graphics::Context->PSSetConstantBuffers(layout.slot, 1, buffer.GetAddressOf());
+}
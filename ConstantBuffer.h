@@ -0,0 +1,157 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#if defined(_WIN32)
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <string>
+#include <vector>
+
+#include "StringId.h"
+#endif
+
+// --------------------------------------------------------
+// One member of a C++ struct that mirrors an HLSL cbuffer,
+// used to check the two agree
+//
+// T      - C++ type of the member (use decltype)
+// name   - Name of the matching variable in the cbuffer
+// offset - offsetof() the member in its struct
+// --------------------------------------------------------
+struct ConstantBufferField
+{
+	const char* name;
+	unsigned int offset;
+	unsigned int size;
+};
+
+template<typename T>
+constexpr ConstantBufferField ShaderConstant(const char* name, size_t offset)
+{
+	return { name, (unsigned int)offset, (unsigned int)sizeof(T) };
+}
+
+// Constant buffers are allocated in whole 16-byte registers
+template<typename T>
+constexpr unsigned int ConstantBufferSize()
+{
+	return (unsigned int)((sizeof(T) + 15) / 16 * 16);
+}
+
+// --------------------------------------------------------
+// Checks fields against HLSL's cbuffer packing rules, so
+// mistakes show up in a static_assert: fields are in order,
+// 4-byte aligned, and either fit inside one 16-byte
+// register or (matrices, arrays) start on a register
+// --------------------------------------------------------
+template<size_t N>
+constexpr bool FollowsHlslPacking(const std::array<ConstantBufferField, N>& fields)
+{
+	unsigned int end = 0;
+	for (const ConstantBufferField& field : fields)
+	{
+		if (field.offset < end || field.offset % 4 != 0)
+			return false;
+
+		bool fitsInRegister = field.offset % 16 + field.size <= 16;
+		if (!fitsInRegister && field.offset % 16 != 0)
+			return false;
+
+		end = field.offset + field.size;
+	}
+	return true;
+}
+
+
+#if defined(_WIN32)
+// --------------------------------------------------------
+// A cbuffer's layout, as the shader compiler packed it
+// --------------------------------------------------------
+struct ConstantBufferLayout
+{
+	struct Variable
+	{
+		StringId name;
+		unsigned int offset;
+		unsigned int size;
+	};
+
+	StringId name;
+	unsigned int slot = 0;		// Register the buffer is bound to (b#)
+	unsigned int size = 0;		// Bytes, already a multiple of 16
+	std::vector<Variable> variables;
+
+	// Null if the buffer has no such variable
+	const Variable* Find(StringId variable) const;
+
+	// --------------------------------------------------------
+	// Compares a mirroring C++ struct with this layout,
+	// printing every mismatch.  Fails if a field is missing
+	// or has a different offset or size, or if the struct is
+	// bigger than the buffer.
+	// --------------------------------------------------------
+	bool Validate(const ConstantBufferField* fields, size_t count, size_t structSize) const;
+
+	template<size_t N>
+	bool Validate(const std::array<ConstantBufferField, N>& fields, size_t structSize) const
+	{
+		return Validate(fields.data(), N, structSize);
+	}
+};
+
+// Reads a named cbuffer's layout from compiled shader code
+bool ReflectConstantBuffer(const void* shaderCode, size_t shaderSize, const char* bufferName, ConstantBufferLayout& layout);
+
+
+// --------------------------------------------------------
+// A dynamic constant buffer with a CPU-side shadow copy
+//
+// Setters write individual variables (found by name in the
+// reflected layout) into the shadow copy, and only mark it
+// dirty if the bytes actually changed.  Upload() copies
+// the shadow copy to the GPU, and does nothing if it's
+// still clean.
+//
+// Usage:
+//
+//   ConstantBufferLayout layout;
+//   ReflectConstantBuffer(code, size, "ExternalData", layout);
+//   buffer.Create(layout);
+//   buffer.Set(StringId("colorTint"), tint);
+//   buffer.Upload();
+//   buffer.BindVS();
+// --------------------------------------------------------
+class ConstantBuffer
+{
+public:
+	bool Create(const ConstantBufferLayout& layout);
+
+	// False if there's no such variable or the value is too big
+	template<typename T>
+	bool Set(StringId variable, const T& value) { return SetRaw(variable, &value, sizeof(T)); }
+	bool SetRaw(StringId variable, const void* data, size_t size);
+
+	// Overwrites the start of the buffer (a whole mirrored struct)
+	void SetData(const void* data, size_t size);
+
+	// Returns whether anything was actually sent to the GPU
+	bool Upload();
+
+	void BindVS() const;
+	void BindPS() const;
+
+	ID3D11Buffer* GetBuffer() const { return buffer.Get(); }
+	const ConstantBufferLayout& GetLayout() const { return layout; }
+	bool IsDirty() const { return dirty; }
+
+private:
+	ConstantBufferLayout layout;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	std::vector<unsigned char> shadow;
+	bool dirty = false;
+
+	void Write(size_t offset, const void* data, size_t size);
+};
+#endif
@@ -0,0 +1,428 @@
+#include "EntityWorld.h"
+#include "MemoryTracker.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Annonymous namespace to hold variables
+// only accessible in this file
+namespace
+{
+	ComponentRegistry::Info componentInfo[MaxComponentTypes] = {};
+	unsigned int componentCount = 0;
+	std::mutex registryMutex;
+
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+
+// --------------------------------------------------------
+// Component type registration
+// --------------------------------------------------------
+ComponentId ComponentRegistry::Register(size_t size, size_t alignment)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	// There's no id left to give out, and sharing one would
+	// have types of different sizes memcpy'd over each other
+	if (componentCount >= MaxComponentTypes)
+	{
+		printf("Too many component types (max %u)\n", MaxComponentTypes);
+		fflush(stdout);
+		std::abort();
+	}
+
+	componentInfo[componentCount] = { size, alignment };
+	return componentCount++;
+}
+
+const ComponentRegistry::Info& ComponentRegistry::Get(ComponentId id) { return componentInfo[id]; }
+
+
+EntityWorld::~EntityWorld()
+{
+	Clear();
+}
+
+
+// --------------------------------------------------------
+// Destroys every entity and frees every chunk
+// --------------------------------------------------------
+void EntityWorld::Clear()
+{
+	for (std::unique_ptr<Archetype>& archetype : archetypes)
+		for (Chunk& chunk : archetype->chunks)
+			MemoryTracker::Free(chunk.data);
+
+	archetypes.clear();
+	archetypeLookup.clear();
+	records.clear();
+	freeRecords.clear();
+	matchingChunks.clear();
+	liveEntities = 0;
+}
+
+
+// --------------------------------------------------------
+// Finds the archetype for a set of components, laying out
+// a new one if this is the first entity with that set
+// --------------------------------------------------------
+uint32_t EntityWorld::FindOrCreateArchetype(ComponentMask mask)
+{
+	auto it = archetypeLookup.find(mask);
+	if (it != archetypeLookup.end())
+		return it->second;
+
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Entities);
+
+	std::unique_ptr<Archetype> archetype = std::make_unique<Archetype>();
+	archetype->mask = mask;
+	memset(archetype->columnOffsets, 0, sizeof(archetype->columnOffsets));
+
+	size_t bytesPerEntity = sizeof(Entity);
+	for (ComponentId id = 0; id < MaxComponentTypes; id++)
+	{
+		if (mask & (ComponentMask(1) << id))
+		{
+			archetype->components.push_back(id);
+			bytesPerEntity += ComponentRegistry::Get(id).size;
+		}
+	}
+
+	// Fit as many entities as we can, allowing
+	// for padding to align each array
+	unsigned int capacity = (unsigned int)(ChunkSize / bytesPerEntity);
+	while (capacity > 1)
+	{
+		size_t offset = AlignUp(sizeof(Entity) * capacity, 16);
+		for (ComponentId id : archetype->components)
+		{
+			const ComponentRegistry::Info& info = ComponentRegistry::Get(id);
+			offset = AlignUp(offset, info.alignment);
+			archetype->columnOffsets[id] = offset;
+			offset += info.size * capacity;
+		}
+
+		if (offset <= ChunkSize)
+			break;
+		capacity--;
+	}
+	archetype->capacity = capacity;
+
+	uint32_t index = (uint32_t)archetypes.size();
+	archetypes.push_back(std::move(archetype));
+	archetypeLookup[mask] = index;
+	return index;
+}
+
+
+// --------------------------------------------------------
+// Returns the entity's record, or null if it's stale
+// --------------------------------------------------------
+const EntityWorld::EntityRecord* EntityWorld::FindRecord(Entity entity) const
+{
+	uint32_t index = entity.Index();
+	if (entity.IsNull() || index >= records.size() || records[index].generation != entity.Generation())
+		return 0;
+
+	return &records[index];
+}
+
+bool EntityWorld::IsAlive(Entity entity) const { return FindRecord(entity) != 0; }
+
+
+// --------------------------------------------------------
+// Claims the next free row at the end of an archetype,
+// starting a new chunk if the last one is full
+// --------------------------------------------------------
+void EntityWorld::AllocateRow(uint32_t archetypeIndex, uint32_t& chunkIndex, uint32_t& row)
+{
+	Archetype& archetype = *archetypes[archetypeIndex];
+	if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.capacity)
+	{
+		MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Entities);
+		Chunk chunk = {};
+		chunk.data = (unsigned char*)MemoryTracker::Allocate(ChunkSize, 64, MemoryTracker::Tag::Entities);
+		archetype.chunks.push_back(chunk);
+	}
+
+	chunkIndex = (uint32_t)archetype.chunks.size() - 1;
+	row = archetype.chunks.back().count++;
+}
+
+
+// --------------------------------------------------------
+// Removes a row by moving the archetype's very last entity
+// into it, which keeps every chunk but the last one full
+// --------------------------------------------------------
+void EntityWorld::RemoveRow(uint32_t archetypeIndex, uint32_t chunkIndex, uint32_t row)
+{
+	Archetype& archetype = *archetypes[archetypeIndex];
+	Chunk& chunk = archetype.chunks[chunkIndex];
+	Chunk& lastChunk = archetype.chunks.back();
+	uint32_t lastRow = lastChunk.count - 1;
+
+	if (&chunk != &lastChunk || row != lastRow)
+	{
+		Entity moved = ((Entity*)lastChunk.data)[lastRow];
+		((Entity*)chunk.data)[row] = moved;
+		for (ComponentId id : archetype.components)
+		{
+			size_t size = ComponentRegistry::Get(id).size;
+			memcpy(
+				chunk.data + archetype.columnOffsets[id] + size * row,
+				lastChunk.data + archetype.columnOffsets[id] + size * lastRow,
+				size);
+		}
+
+		EntityRecord& record = records[moved.Index()];
+		record.chunk = chunkIndex;
+		record.row = row;
+	}
+
+	lastChunk.count--;
+	if (lastChunk.count == 0)
+	{
+		MemoryTracker::Free(lastChunk.data);
+		archetype.chunks.pop_back();
+	}
+}
+
+
+// --------------------------------------------------------
+// Creates an entity with uninitialized components
+//
+// mask - Bit per component type the entity should have
+// --------------------------------------------------------
+Entity EntityWorld::CreateWithMask(ComponentMask mask)
+{
+	uint32_t index = 0;
+	if (!freeRecords.empty())
+	{
+		index = freeRecords.back();
+		freeRecords.pop_back();
+	}
+	else
+	{
+		MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Entities);
+
+		// Index zero stays unused so null handles never resolve
+		if (records.empty())
+			records.push_back({ 0, 0, 0, 0 });
+		if (records.size() > Entity::IndexMask)
+			return {};
+
+		index = (uint32_t)records.size();
+		records.push_back({ 0, 0, 0, 1 });
+	}
+
+	EntityRecord& record = records[index];
+	record.archetype = FindOrCreateArchetype(mask);
+	AllocateRow(record.archetype, record.chunk, record.row);
+
+	Entity entity;
+	entity.value = (record.generation << Entity::IndexBits) | index;
+
+	Chunk& chunk = archetypes[record.archetype]->chunks[record.chunk];
+	((Entity*)chunk.data)[record.row] = entity;
+
+	liveEntities++;
+	return entity;
+}
+
+
+// --------------------------------------------------------
+// Removes an entity and all of its components
+// --------------------------------------------------------
+void EntityWorld::Destroy(Entity entity)
+{
+	if (!FindRecord(entity))
+		return;
+
+	EntityRecord& record = records[entity.Index()];
+	RemoveRow(record.archetype, record.chunk, record.row);
+
+	// Stale out old handles, skipping generation zero
+	uint32_t generation = (record.generation + 1) & Entity::GenerationMask;
+	record.generation = generation == 0 ? 1 : generation;
+	freeRecords.push_back(entity.Index());
+	liveEntities--;
+}
+
+
+// --------------------------------------------------------
+// Untyped component access
+// --------------------------------------------------------
+void* EntityWorld::GetRaw(Entity entity, ComponentId component)
+{
+	const EntityRecord* record = FindRecord(entity);
+	if (!record)
+		return 0;
+
+	Archetype& archetype = *archetypes[record->archetype];
+	if (!(archetype.mask & (ComponentMask(1) << component)))
+		return 0;
+
+	Chunk& chunk = archetype.chunks[record->chunk];
+	return chunk.data + archetype.columnOffsets[component] + ComponentRegistry::Get(component).size * record->row;
+}
+
+bool EntityWorld::HasRaw(Entity entity, ComponentId component) const
+{
+	const EntityRecord* record = FindRecord(entity);
+	return record && (archetypes[record->archetype]->mask & (ComponentMask(1) << component));
+}
+
+
+// --------------------------------------------------------
+// Moves an entity to the archetype for a new component set,
+// carrying over every component the two have in common
+// --------------------------------------------------------
+void EntityWorld::MoveToArchetype(Entity entity, ComponentMask newMask)
+{
+	EntityRecord& record = records[entity.Index()];
+	uint32_t oldArchetypeIndex = record.archetype;
+	uint32_t oldChunkIndex = record.chunk;
+	uint32_t oldRow = record.row;
+
+	uint32_t newArchetypeIndex = FindOrCreateArchetype(newMask);
+	uint32_t newChunkIndex = 0;
+	uint32_t newRow = 0;
+	AllocateRow(newArchetypeIndex, newChunkIndex, newRow);
+
+	// Look these up after AllocateRow(), which may have
+	// grown the archetype list or chunk vectors
+	Archetype& oldArchetype = *archetypes[oldArchetypeIndex];
+	Archetype& newArchetype = *archetypes[newArchetypeIndex];
+	Chunk& oldChunk = oldArchetype.chunks[oldChunkIndex];
+	Chunk& newChunk = newArchetype.chunks[newChunkIndex];
+
+	((Entity*)newChunk.data)[newRow] = entity;
+	for (ComponentId id : newArchetype.components)
+	{
+		if (!(oldArchetype.mask & (ComponentMask(1) << id)))
+			continue;
+
+		size_t size = ComponentRegistry::Get(id).size;
+		memcpy(
+			newChunk.data + newArchetype.columnOffsets[id] + size * newRow,
+			oldChunk.data + oldArchetype.columnOffsets[id] + size * oldRow,
+			size);
+	}
+
+	RemoveRow(oldArchetypeIndex, oldChunkIndex, oldRow);
+	record.archetype = newArchetypeIndex;
+	record.chunk = newChunkIndex;
+	record.row = newRow;
+}
+
+
+// --------------------------------------------------------
+// Adds a component (contents uninitialized) and returns its
+// storage, or returns the existing one if already present
+// --------------------------------------------------------
+void* EntityWorld::AddRaw(Entity entity, ComponentId component)
+{
+	const EntityRecord* record = FindRecord(entity);
+	if (!record)
+		return 0;
+
+	ComponentMask mask = archetypes[record->archetype]->mask;
+	if (!(mask & (ComponentMask(1) << component)))
+		MoveToArchetype(entity, mask | (ComponentMask(1) << component));
+
+	return GetRaw(entity, component);
+}
+
+void EntityWorld::RemoveRaw(Entity entity, ComponentId component)
+{
+	const EntityRecord* record = FindRecord(entity);
+	if (!record)
+		return;
+
+	ComponentMask mask = archetypes[record->archetype]->mask;
+	if (mask & (ComponentMask(1) << component))
+		MoveToArchetype(entity, mask & ~(ComponentMask(1) << component));
+}
+
+
+// --------------------------------------------------------
+// Collects every chunk with the required components, for
+// handing out to the job system
+// --------------------------------------------------------
+void EntityWorld::GatherChunks(ComponentMask required)
+{
+	matchingChunks.clear();
+	for (std::unique_ptr<Archetype>& archetype : archetypes)
+	{
+		if ((archetype->mask & required) != required)
+			continue;
+
+		for (Chunk& chunk : archetype->chunks)
+			matchingChunks.push_back({ archetype.get(), &chunk });
+	}
+}
+
+
+// --------------------------------------------------------
+// Command buffers
+// --------------------------------------------------------
+void CommandBuffer::Record(Op op, Entity entity, ComponentId component, const void* source, size_t size)
+{
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Entities);
+
+	size_t offset = AlignUp(data.size(), 16);
+	data.resize(offset + size);
+	memcpy(data.data() + offset, source, size);
+	commands.push_back({ op, entity, component, 0, offset });
+}
+
+void CommandBuffer::Destroy(Entity entity)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	commands.push_back({ Op::Destroy, entity, 0, 0, 0 });
+}
+
+
+// --------------------------------------------------------
+// Applies every recorded change to the world, in order
+// --------------------------------------------------------
+void CommandBuffer::Playback(EntityWorld& world)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Entity created;
+	for (const Command& command : commands)
+	{
+		switch (command.op)
+		{
+		case Op::Create:
+			created = world.CreateWithMask(command.mask);
+			break;
+
+		case Op::SetCreated:
+			if (void* storage = world.GetRaw(created, command.component))
+				memcpy(storage, data.data() + command.dataOffset, ComponentRegistry::Get(command.component).size);
+			break;
+
+		case Op::Destroy:
+			world.Destroy(command.entity);
+			break;
+
+		case Op::Add:
+			if (void* storage = world.AddRaw(command.entity, command.component))
+				memcpy(storage, data.data() + command.dataOffset, ComponentRegistry::Get(command.component).size);
+			break;
+
+		case Op::Remove:
+			world.RemoveRaw(command.entity, command.component);
+			break;
+		}
+	}
+
+	commands.clear();
+	data.clear();
+}
@@ -0,0 +1,310 @@
+#pragma once
+
+#include "JobSystem.h"
+#include "ResourcePool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Entities share the pool's 32-bit generational handle layout
+struct EntityTag;
+using Entity = Handle<EntityTag>;
+
+typedef unsigned int ComponentId;
+typedef uint64_t ComponentMask;
+const unsigned int MaxComponentTypes = 64;
+
+// --------------------------------------------------------
+// Every component type gets a small id the first time it's
+// used, along with the size and alignment needed to lay it
+// out in chunks.  Components are moved with memcpy, so they
+// must be trivially copyable.  Using more than
+// MaxComponentTypes types aborts.
+// --------------------------------------------------------
+namespace ComponentRegistry
+{
+	struct Info
+	{
+		size_t size;
+		size_t alignment;
+	};
+
+	ComponentId Register(size_t size, size_t alignment);
+	const Info& Get(ComponentId id);
+}
+
+template<typename T>
+ComponentId ComponentType()
+{
+	static_assert(std::is_trivially_copyable_v<T>, "Components are moved with memcpy");
+	static const ComponentId id = ComponentRegistry::Register(sizeof(T), alignof(T));
+	return id;
+}
+
+template<typename... Ts>
+ComponentMask ComponentMaskOf()
+{
+	return ((ComponentMask(1) << ComponentType<Ts>()) | ... | ComponentMask(0));
+}
+
+
+// --------------------------------------------------------
+// Archetype-based entity/component storage
+//
+// Entities with exactly the same set of components share an
+// archetype, which stores them in 16 KB chunks.  Inside a
+// chunk each component type has its own contiguous array
+// (plus one for the entity handles), so iterating a few
+// components over many entities streams through memory.
+// Chunks stay packed: removing an entity moves the
+// archetype's last entity into its place.
+//
+// Adding or removing components moves the entity to a
+// different archetype.  Structural changes (create, destroy,
+// add, remove) must not happen while iterating - record
+// them in a CommandBuffer and play it back afterwards.
+//
+// Usage:
+//
+//   Entity e = world.Create(MeshComponent{ mesh }, TintComponent{ tint });
+//   world.ForEach<MeshComponent, TintComponent>(
+//       [&](Entity e, MeshComponent& m, TintComponent& t) { ... });
+//   world.ParallelForEach<TintComponent>(
+//       [&](Entity e, TintComponent& t) { ... });
+// --------------------------------------------------------
+class EntityWorld
+{
+public:
+	static const size_t ChunkSize = 16 * 1024;
+
+	EntityWorld() = default;
+	~EntityWorld();
+	EntityWorld(const EntityWorld&) = delete;
+	EntityWorld& operator=(const EntityWorld&) = delete;
+
+	// Creates an entity with the given components
+	template<typename... Ts>
+	Entity Create(const Ts&... components)
+	{
+		Entity entity = CreateWithMask(ComponentMaskOf<Ts...>());
+		if (!entity.IsNull())
+			((*(Ts*)GetRaw(entity, ComponentType<Ts>()) = components), ...);
+		return entity;
+	}
+
+	void Destroy(Entity entity);
+	bool IsAlive(Entity entity) const;
+	void Clear();
+
+	// Null if the entity is dead or lacks the component
+	template<typename T>
+	T* Get(Entity entity) { return (T*)GetRaw(entity, ComponentType<T>()); }
+
+	template<typename T>
+	bool Has(Entity entity) const { return HasRaw(entity, ComponentType<T>()); }
+
+	// Adds (or overwrites) a component
+	template<typename T>
+	void Add(Entity entity, const T& component)
+	{
+		if (void* storage = AddRaw(entity, ComponentType<T>()))
+			*(T*)storage = component;
+	}
+
+	template<typename T>
+	void Remove(Entity entity) { RemoveRaw(entity, ComponentType<T>()); }
+
+	// --------------------------------------------------------
+	// Calls fn(count, entities, Ts* arrays...) once for every
+	// chunk holding all of the requested components
+	// --------------------------------------------------------
+	template<typename... Ts, typename Fn>
+	void ForEachChunk(Fn fn)
+	{
+		ComponentMask required = ComponentMaskOf<Ts...>();
+		for (std::unique_ptr<Archetype>& archetype : archetypes)
+		{
+			if ((archetype->mask & required) != required)
+				continue;
+
+			for (Chunk& chunk : archetype->chunks)
+				fn(chunk.count, (const Entity*)chunk.data, Column<Ts>(*archetype, chunk)...);
+		}
+	}
+
+	// Calls fn(entity, Ts&...) for every matching entity
+	template<typename... Ts, typename Fn>
+	void ForEach(Fn fn)
+	{
+		ForEachChunk<Ts...>([&](unsigned int count, const Entity* entities, Ts*... columns)
+			{
+				for (unsigned int i = 0; i < count; i++)
+					fn(entities[i], columns[i]...);
+			});
+	}
+
+	// --------------------------------------------------------
+	// Like ForEach(), but chunks are spread over the job
+	// system.  fn runs on several threads at once, so it may
+	// only touch the entity it's given (or use atomics).
+	// --------------------------------------------------------
+	template<typename... Ts, typename Fn>
+	void ParallelForEach(Fn fn)
+	{
+		ComponentMask required = ComponentMaskOf<Ts...>();
+		GatherChunks(required);
+
+		JobSystem::ParallelFor((unsigned int)matchingChunks.size(), 1,
+			[&](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int c = begin; c < end; c++)
+				{
+					Archetype& archetype = *matchingChunks[c].archetype;
+					Chunk& chunk = *matchingChunks[c].chunk;
+					const Entity* entities = (const Entity*)chunk.data;
+					RunChunk<Ts...>(fn, chunk.count, entities, Column<Ts>(archetype, chunk)...);
+				}
+			});
+	}
+
+	size_t Count() const { return liveEntities; }
+	size_t ArchetypeCount() const { return archetypes.size(); }
+
+	// Untyped access, used by CommandBuffer playback
+	Entity CreateWithMask(ComponentMask mask);
+	void* GetRaw(Entity entity, ComponentId component);
+	bool HasRaw(Entity entity, ComponentId component) const;
+	void* AddRaw(Entity entity, ComponentId component);
+	void RemoveRaw(Entity entity, ComponentId component);
+
+private:
+	struct Chunk
+	{
+		unsigned char* data;
+		unsigned int count;
+	};
+
+	struct Archetype
+	{
+		ComponentMask mask;
+		unsigned int capacity;					// Entities per chunk
+		size_t columnOffsets[MaxComponentTypes];	// Byte offset of each component's array
+		std::vector<ComponentId> components;
+		std::vector<Chunk> chunks;
+	};
+
+	struct EntityRecord
+	{
+		uint32_t archetype;
+		uint32_t chunk;
+		uint32_t row;
+		uint32_t generation;
+	};
+
+	struct ChunkRef
+	{
+		Archetype* archetype;
+		Chunk* chunk;
+	};
+
+	template<typename T>
+	static T* Column(Archetype& archetype, Chunk& chunk)
+	{
+		return (T*)(chunk.data + archetype.columnOffsets[ComponentType<T>()]);
+	}
+
+	template<typename... Ts, typename Fn>
+	static void RunChunk(Fn& fn, unsigned int count, const Entity* entities, Ts*... columns)
+	{
+		for (unsigned int i = 0; i < count; i++)
+			fn(entities[i], columns[i]...);
+	}
+
+	std::vector<std::unique_ptr<Archetype>> archetypes;
+	std::unordered_map<ComponentMask, uint32_t> archetypeLookup;
+
+	std::vector<EntityRecord> records;
+	std::vector<uint32_t> freeRecords;
+	size_t liveEntities = 0;
+
+	// Reused between ParallelForEach() calls
+	std::vector<ChunkRef> matchingChunks;
+
+	uint32_t FindOrCreateArchetype(ComponentMask mask);
+	const EntityRecord* FindRecord(Entity entity) const;
+	void AllocateRow(uint32_t archetypeIndex, uint32_t& chunkIndex, uint32_t& row);
+	void RemoveRow(uint32_t archetypeIndex, uint32_t chunkIndex, uint32_t row);
+	void MoveToArchetype(Entity entity, ComponentMask newMask);
+	void GatherChunks(ComponentMask required);
+};
+
+
+// --------------------------------------------------------
+// Records structural changes to apply later, so systems can
+// create/destroy entities and add/remove components while
+// iterating (including from ParallelForEach() workers).
+//
+// Entities created through a command buffer don't exist
+// until Playback(), so their handles aren't returned.
+// --------------------------------------------------------
+class CommandBuffer
+{
+public:
+	template<typename... Ts>
+	void Create(const Ts&... components)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		commands.push_back({ Op::Create, Entity(), 0, ComponentMaskOf<Ts...>(), 0 });
+		(Record(Op::SetCreated, Entity(), ComponentType<Ts>(), &components, sizeof(Ts)), ...);
+	}
+
+	template<typename T>
+	void Add(Entity entity, const T& component)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Record(Op::Add, entity, ComponentType<T>(), &component, sizeof(T));
+	}
+
+	template<typename T>
+	void Remove(Entity entity)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		commands.push_back({ Op::Remove, entity, ComponentType<T>(), 0, 0 });
+	}
+
+	void Destroy(Entity entity);
+
+	// Applies everything in recorded order, then empties the buffer
+	void Playback(EntityWorld& world);
+	bool IsEmpty() const { return commands.empty(); }
+
+private:
+	enum class Op : unsigned char
+	{
+		Create,
+		SetCreated,		// Component for the last Create
+		Destroy,
+		Add,
+		Remove
+	};
+
+	struct Command
+	{
+		Op op;
+		Entity entity;
+		ComponentId component;
+		ComponentMask mask;
+		size_t dataOffset;
+	};
+
+	std::mutex mutex;
+	std::vector<Command> commands;
+	std::vector<unsigned char> data;
+
+	void Record(Op op, Entity entity, ComponentId component, const void* source, size_t size);
+};
@@ -0,0 +1,223 @@
+#include "FileWatcher.h"
+
+#include <cstdio>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include "PathHelpers.h"
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#if defined(_WIN32)
+struct FileWatcher::Platform
+{
+	HANDLE directory = INVALID_HANDLE_VALUE;
+	OVERLAPPED overlapped = {};
+
+	// ReadDirectoryChangesW needs DWORD-aligned storage
+	DWORD buffer[4096];
+
+	// Queues up the next batch of change notifications
+	bool Read()
+	{
+		return ReadDirectoryChangesW(
+			directory,
+			buffer,
+			sizeof(buffer),
+			FALSE,
+			FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME,
+			0,
+			&overlapped,
+			0) != 0;
+	}
+};
+#elif defined(__linux__)
+struct FileWatcher::Platform
+{
+	int inotify = -1;
+
+	// Room for plenty of events, aligned like inotify_event
+	alignas(inotify_event) char buffer[16384];
+};
+#else
+struct FileWatcher::Platform {};
+#endif
+
+
+FileWatcher::FileWatcher() = default;
+
+FileWatcher::~FileWatcher()
+{
+	Stop();
+}
+
+
+// --------------------------------------------------------
+// Begins watching a directory, replacing any earlier one
+//
+// directory - Directory to watch, relative or absolute
+// --------------------------------------------------------
+bool FileWatcher::Start(const std::string& watchDirectory)
+{
+	Stop();
+	std::unique_ptr<Platform> p = std::make_unique<Platform>();
+
+#if defined(_WIN32)
+	p->directory = CreateFileW(
+		NarrowToWide(watchDirectory).c_str(),
+		FILE_LIST_DIRECTORY,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		0,
+		OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+		0);
+	if (p->directory == INVALID_HANDLE_VALUE)
+	{
+		printf("File watcher: unable to open %s\n", watchDirectory.c_str());
+		return false;
+	}
+
+	p->overlapped.hEvent = CreateEventW(0, TRUE, FALSE, 0);
+	if (!p->overlapped.hEvent || !p->Read())
+	{
+		printf("File watcher: unable to watch %s\n", watchDirectory.c_str());
+		if (p->overlapped.hEvent)
+			CloseHandle(p->overlapped.hEvent);
+		CloseHandle(p->directory);
+		return false;
+	}
+#elif defined(__linux__)
+	p->inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (p->inotify < 0)
+		return false;
+
+	// Close-after-write catches in-place saves, moved-to catches
+	// editors and compilers that write a temp file and rename it
+	if (inotify_add_watch(p->inotify, watchDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		printf("File watcher: unable to watch %s\n", watchDirectory.c_str());
+		close(p->inotify);
+		return false;
+	}
+#else
+	printf("File watcher: not supported on this platform\n");
+	return false;
+#endif
+
+	platform = std::move(p);
+	directory = watchDirectory;
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Stops watching and forgets any unreported changes
+// --------------------------------------------------------
+void FileWatcher::Stop()
+{
+	if (!platform)
+		return;
+
+#if defined(_WIN32)
+	// The pending read has to finish before its buffer goes away
+	DWORD bytes = 0;
+	CancelIoEx(platform->directory, &platform->overlapped);
+	GetOverlappedResult(platform->directory, &platform->overlapped, &bytes, TRUE);
+	CloseHandle(platform->overlapped.hEvent);
+	CloseHandle(platform->directory);
+#elif defined(__linux__)
+	close(platform->inotify);
+#endif
+
+	platform.reset();
+	directory.clear();
+	pending.clear();
+}
+
+bool FileWatcher::IsWatching() const
+{
+	return platform != 0;
+}
+
+
+// --------------------------------------------------------
+// Moves everything the OS has reported into pending,
+// without waiting for anything new
+// --------------------------------------------------------
+void FileWatcher::ReadEvents()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+#if defined(_WIN32)
+	while (true)
+	{
+		DWORD bytes = 0;
+		if (!GetOverlappedResult(platform->directory, &platform->overlapped, &bytes, FALSE))
+			return;	// Still waiting (ERROR_IO_INCOMPLETE) or the directory went away
+
+		// Zero bytes means the buffer overflowed and events were lost
+		const unsigned char* next = bytes ? (const unsigned char*)platform->buffer : 0;
+		while (next)
+		{
+			const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)next;
+			if (info->Action != FILE_ACTION_REMOVED && info->Action != FILE_ACTION_RENAMED_OLD_NAME)
+			{
+				std::wstring name(info->FileName, info->FileNameLength / sizeof(wchar_t));
+				pending[WideToNarrow(name)] = now;
+			}
+			next = info->NextEntryOffset ? next + info->NextEntryOffset : 0;
+		}
+
+		ResetEvent(platform->overlapped.hEvent);
+		if (!platform->Read())
+			return;
+	}
+#elif defined(__linux__)
+	while (true)
+	{
+		ssize_t bytes = read(platform->inotify, platform->buffer, sizeof(platform->buffer));
+		if (bytes <= 0)
+			return;	// EAGAIN once the queue is empty
+
+		for (ssize_t offset = 0; offset < bytes;)
+		{
+			const inotify_event* e = (const inotify_event*)(platform->buffer + offset);
+			if (e->len > 0)
+				pending[e->name] = now;
+			offset += sizeof(inotify_event) + e->len;
+		}
+	}
+#endif
+}
+
+
+// --------------------------------------------------------
+// Reports files whose changes have settled
+//
+// changedFiles       - Receives file names
+// settleMilliseconds - How long a file must go unchanged
+// --------------------------------------------------------
+void FileWatcher::Poll(std::vector<std::string>& changedFiles, unsigned int settleMilliseconds)
+{
+	if (!platform)
+		return;
+
+	ReadEvents();
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	std::chrono::milliseconds settle(settleMilliseconds);
+	for (auto it = pending.begin(); it != pending.end();)
+	{
+		if (now - it->second < settle)
+		{
+			++it;
+			continue;
+		}
+
+		changedFiles.push_back(it->first);
+		it = pending.erase(it);
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// --------------------------------------------------------
+// Reports files that change in one directory (not its
+// subdirectories)
+//
+// Uses ReadDirectoryChangesW on Windows and inotify on
+// Linux.  There's no thread of its own: Poll() collects
+// whatever the OS has queued up without blocking, so the
+// owner decides which thread does the watching.
+//
+// Saving a file usually raises several events (truncate,
+// write, rename), so a file is only reported once it has
+// been quiet for a little while - by then the writer is
+// done and the file is safe to read.
+//
+// Usage:
+//
+//   FileWatcher watcher;
+//   watcher.Start("Shaders");
+//   ...
+//   std::vector<std::string> changed;
+//   watcher.Poll(changed);
+// --------------------------------------------------------
+class FileWatcher
+{
+public:
+	FileWatcher();
+	~FileWatcher();
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	bool Start(const std::string& directory);
+	void Stop();
+	bool IsWatching() const;
+
+	const std::string& GetDirectory() const { return directory; }
+
+	// --------------------------------------------------------
+	// Appends the names (relative to the directory) of files
+	// that changed and have since been quiet for at least
+	// settleMilliseconds.  Each change is reported once.
+	// --------------------------------------------------------
+	void Poll(std::vector<std::string>& changedFiles, unsigned int settleMilliseconds = 100);
+
+private:
+	// OS handles and read buffers
+	struct Platform;
+	std::unique_ptr<Platform> platform;
+
+	std::string directory;
+
+	// Changed files waiting to settle, with their latest change
+	std::unordered_map<std::string, std::chrono::steady_clock::time_point> pending;
+
+	void ReadEvents();
+};
@@ -0,0 +1,396 @@
+#include "FlightRecorder.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace FlightRecorder
+{
+	// Annonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		enum class EventType : unsigned char
+		{
+			Zone,		// Has a start and end time
+			Instant,	// Happened at a single point in time
+			Value		// A named number (frame time, etc.)
+		};
+
+		// One recorded event - plain data so writing
+		// an event never allocates
+		struct Event
+		{
+			const char* name;
+			long long startTime;
+			long long endTime;
+			double value;
+			unsigned long long frame;
+			unsigned int thread;
+			EventType type;
+		};
+
+		// A slot in the ring.  The sequence is the write index
+		// plus one once the event is complete, and 0 while it's
+		// being written, so a reader can tell when it copied a
+		// slot that was overwritten underneath it.
+		struct Slot
+		{
+			std::atomic<unsigned long long> sequence;
+			Event event;
+		};
+
+		bool initialized = false;
+
+		// The ring itself
+		std::unique_ptr<Slot[]> slots;
+		unsigned long long capacityMask = 0;
+		std::atomic<unsigned long long> writeIndex = 0;
+
+		// Dumps copy the ring here first, so the file is written
+		// from a stable copy while recording carries on
+		std::unique_ptr<Event[]> snapshot;
+		unsigned long long snapshotCount = 0;
+		std::mutex snapshotMutex;
+
+		// Frame tracking
+		std::atomic<unsigned long long> frameIndex = 0;
+		long long frameStartTime = 0;
+		long long recorderStartTime = 0;
+
+		// Hitch detection
+		float hitchThresholdMs = 50.0f;
+		unsigned int framesAfterHitch = 30;
+		std::string dumpPrefix;
+		bool dumpPending = false;
+		unsigned int framesUntilDump = 0;
+		unsigned long long hitchFrame = 0;
+
+		// Hitch dumps are written on their own thread, to a path
+		// formatted into a fixed buffer
+		std::thread dumpThread;
+		std::condition_variable dumpWake;
+		bool dumpRequested = false;		// Guarded by snapshotMutex
+		bool dumpThreadRunning = false;
+		char dumpPath[512] = {};
+
+		// Small, stable per-thread ids for the trace viewer
+		std::atomic<unsigned int> nextThreadId = 0;
+		thread_local unsigned int threadId = nextThreadId++;
+
+		// --------------------------------------------------------
+		// Claims the next slot in the ring, overwriting the oldest
+		// --------------------------------------------------------
+		void Write(EventType type, const char* name, long long startTime, long long endTime, double value)
+		{
+			if (!initialized)
+				return;
+
+			unsigned long long index = writeIndex.fetch_add(1, std::memory_order_relaxed);
+			Slot& slot = slots[index & capacityMask];
+			slot.sequence.store(0, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			Event& e = slot.event;
+			e.name = name;
+			e.startTime = startTime;
+			e.endTime = endTime;
+			e.value = value;
+			e.frame = frameIndex.load(std::memory_order_relaxed);
+			e.thread = threadId;
+			e.type = type;
+
+			slot.sequence.store(index + 1, std::memory_order_release);
+		}
+
+		// Recorder time is in nanoseconds, trace time in microseconds
+		double ToMicroseconds(long long time) { return (time - recorderStartTime) / 1000.0; }
+
+
+		// --------------------------------------------------------
+		// Copies every complete event still in the ring into the
+		// snapshot, oldest first.  Slots being written (or
+		// rewritten) while we copy are skipped rather than torn.
+		// Call with snapshotMutex held.
+		// --------------------------------------------------------
+		void TakeSnapshot()
+		{
+			unsigned long long end = writeIndex.load(std::memory_order_acquire);
+			unsigned long long count = end < capacityMask + 1 ? end : capacityMask + 1;
+
+			snapshotCount = 0;
+			for (unsigned long long i = end - count; i < end; i++)
+			{
+				Slot& slot = slots[i & capacityMask];
+				if (slot.sequence.load(std::memory_order_acquire) != i + 1)
+					continue;
+
+				Event copy = slot.event;
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (slot.sequence.load(std::memory_order_relaxed) != i + 1)
+					continue;
+
+				snapshot[snapshotCount++] = copy;
+			}
+		}
+
+
+		// --------------------------------------------------------
+		// Writes the snapshot as Chrome trace JSON.  Call with
+		// snapshotMutex held.
+		// --------------------------------------------------------
+		bool WriteSnapshot(const char* path)
+		{
+			FILE* file = fopen(path, "w");
+			if (!file)
+				return false;
+
+			fprintf(file, "{\"traceEvents\":[\n");
+			for (unsigned long long i = 0; i < snapshotCount; i++)
+			{
+				const Event& e = snapshot[i];
+				fprintf(file, "%s{\"name\":\"%s\",\"pid\":0,\"tid\":%u,\"ts\":%.3f",
+					i == 0 ? "" : ",\n", e.name ? e.name : "", e.thread, ToMicroseconds(e.startTime));
+
+				switch (e.type)
+				{
+				case EventType::Zone:
+					fprintf(file, ",\"ph\":\"X\",\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+						(e.endTime - e.startTime) / 1000.0, e.frame);
+					break;
+
+				case EventType::Instant:
+					fprintf(file, ",\"ph\":\"i\",\"s\":\"g\",\"args\":{\"frame\":%llu,\"value\":%g}}", e.frame, e.value);
+					break;
+
+				case EventType::Value:
+					fprintf(file, ",\"ph\":\"C\",\"args\":{\"value\":%g}}", e.value);
+					break;
+				}
+			}
+			fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+			bool written = !ferror(file);
+			return fclose(file) == 0 && written;
+		}
+
+
+		// --------------------------------------------------------
+		// Writes each requested hitch dump from the snapshot the
+		// main thread took for it
+		// --------------------------------------------------------
+		void DumpThreadMain()
+		{
+			std::unique_lock<std::mutex> lock(snapshotMutex);
+			while (true)
+			{
+				dumpWake.wait(lock, []() { return dumpRequested || !dumpThreadRunning; });
+				if (dumpRequested)
+				{
+					WriteSnapshot(dumpPath);
+					dumpRequested = false;
+				}
+				else if (!dumpThreadRunning)
+				{
+					return;
+				}
+			}
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Allocates the ring (and the snapshot dumps are written
+// from) and starts the dump thread.  These are the only
+// allocations the recorder makes while recording.
+//
+// capacity          - Max events kept (rounded up to a power of two)
+// thresholdMs       - Frames longer than this trigger a dump
+// framesAfter       - Frames to keep recording before dumping
+// dumpPathPrefix    - Dumps go to <prefix>hitch_<frame>.json
+// --------------------------------------------------------
+void FlightRecorder::Initialize(
+	unsigned int capacity,
+	float thresholdMs,
+	unsigned int framesAfter,
+	const char* dumpPathPrefix)
+{
+	if (initialized)
+		return;
+
+	// Power of two so wrapping is just a mask
+	unsigned long long size = 1;
+	while (size < capacity)
+		size <<= 1;
+
+	slots = std::make_unique<Slot[]>(size);
+	snapshot = std::make_unique<Event[]>(size);
+	capacityMask = size - 1;
+	writeIndex = 0;
+	frameIndex = 0;
+
+	hitchThresholdMs = thresholdMs;
+	framesAfterHitch = framesAfter;
+	dumpPrefix = dumpPathPrefix;
+	dumpPending = false;
+
+	recorderStartTime = Now();
+	frameStartTime = recorderStartTime;
+
+	dumpRequested = false;
+	dumpThreadRunning = true;
+	dumpThread = std::thread(DumpThreadMain);
+	initialized = true;
+}
+
+
+// --------------------------------------------------------
+// Finishes any dump being written, then frees the ring.
+// Anything recorded is lost.
+// --------------------------------------------------------
+void FlightRecorder::ShutDown()
+{
+	if (!initialized)
+		return;
+
+	initialized = false;
+	{
+		std::lock_guard<std::mutex> lock(snapshotMutex);
+		dumpThreadRunning = false;
+	}
+	dumpWake.notify_one();
+	dumpThread.join();
+
+	slots.reset();
+	snapshot.reset();
+}
+
+void FlightRecorder::SetHitchThreshold(float milliseconds) { hitchThresholdMs = milliseconds; }
+float FlightRecorder::GetHitchThreshold() { return hitchThresholdMs; }
+
+
+// --------------------------------------------------------
+// Current time in nanoseconds, for use with RecordZone()
+// --------------------------------------------------------
+long long FlightRecorder::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// --------------------------------------------------------
+// Marks the start of a frame
+// --------------------------------------------------------
+void FlightRecorder::BeginFrame()
+{
+	frameStartTime = Now();
+}
+
+
+// --------------------------------------------------------
+// Marks the end of a frame, records its stats and handles
+// hitch detection.  When a hitch is found we keep going for
+// a few more frames so the dump shows what happened around
+// it, not just before it.  Then the ring is copied and the
+// dump thread writes the file, so this frame only pays for
+// the copy.
+// --------------------------------------------------------
+void FlightRecorder::EndFrame()
+{
+	if (!initialized)
+		return;
+
+	long long frameEndTime = Now();
+	double frameMs = (frameEndTime - frameStartTime) / 1000000.0;
+	Write(EventType::Zone, "Frame", frameStartTime, frameEndTime, 0.0);
+	Write(EventType::Value, "Frame ms", frameEndTime, frameEndTime, frameMs);
+
+	// Only one dump at a time, so a burst of hitches
+	// doesn't write a burst of nearly identical files
+	if (!dumpPending && frameMs > hitchThresholdMs)
+	{
+		Write(EventType::Instant, "Hitch", frameEndTime, frameEndTime, frameMs);
+		dumpPending = true;
+		framesUntilDump = framesAfterHitch;
+		hitchFrame = frameIndex;
+	}
+	else if (dumpPending)
+	{
+		if (framesUntilDump == 0)
+		{
+			// If the last dump is still being written, this one
+			// waits for a later frame rather than this one waiting
+			std::unique_lock<std::mutex> lock(snapshotMutex, std::try_to_lock);
+			if (lock.owns_lock() && !dumpRequested)
+			{
+				TakeSnapshot();
+				snprintf(dumpPath, sizeof(dumpPath), "%shitch_%llu.json", dumpPrefix.c_str(), hitchFrame);
+				dumpRequested = true;
+				dumpPending = false;
+				lock.unlock();
+				dumpWake.notify_one();
+			}
+		}
+		else
+		{
+			framesUntilDump--;
+		}
+	}
+
+	frameIndex++;
+}
+
+
+// --------------------------------------------------------
+// Records a zone that ran from startTime to endTime
+// (both from Now()) on the calling thread
+// --------------------------------------------------------
+void FlightRecorder::RecordZone(const char* name, long long startTime, long long endTime)
+{
+	Write(EventType::Zone, name, startTime, endTime, 0.0);
+}
+
+
+// --------------------------------------------------------
+// Records that something happened right now
+// --------------------------------------------------------
+void FlightRecorder::RecordEvent(const char* name)
+{
+	long long time = Now();
+	Write(EventType::Instant, name, time, time, 0.0);
+}
+
+
+// --------------------------------------------------------
+// Records a named number right now (shows up as a graph)
+// --------------------------------------------------------
+void FlightRecorder::RecordValue(const char* name, double value)
+{
+	long long time = Now();
+	Write(EventType::Value, name, time, time, value);
+}
+
+
+// --------------------------------------------------------
+// Writes every event still in the ring to a trace file,
+// right away on the calling thread.  Events being written
+// while the ring is copied are left out.
+//
+// path - Where to write the Chrome trace JSON
+// --------------------------------------------------------
+bool FlightRecorder::Dump(const char* path)
+{
+	if (!initialized)
+		return false;
+
+	std::lock_guard<std::mutex> lock(snapshotMutex);
+	TakeSnapshot();
+	return WriteSnapshot(path);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+// --------------------------------------------------------
+// Always-on flight recorder
+//
+// Continuously records profiler zones, per-frame stats and
+// engine events into a fixed-size ring buffer (no heap
+// allocation after Initialize()), so the last few seconds
+// are always available.  When a frame takes longer than
+// the hitch threshold, the recorder waits a few more frames
+// and then dumps the whole ring to disk in Chrome's trace
+// event format (open it in chrome://tracing or Perfetto).
+// The ring is copied to a snapshot allocated up front, and
+// a background thread writes the file.
+//
+// Usage:
+//
+//   FlightRecorder::BeginFrame();
+//   {
+//       FLIGHT_ZONE("Game::Update");
+//       ...
+//   }
+//   FlightRecorder::RecordEvent("Window resized");
+//   FlightRecorder::EndFrame();
+//
+// Names must be string literals (or otherwise outlive the
+// recorder), since only the pointer is stored.
+// --------------------------------------------------------
+namespace FlightRecorder
+{
+	// Sets up the ring buffer and hitch detection
+	//
+	// capacity          - Max events kept (rounded up to a power of two)
+	// thresholdMs       - Frames longer than this trigger a dump
+	// framesAfter       - Frames to keep recording before dumping
+	// dumpPathPrefix    - Dumps go to <prefix>hitch_<frame>.json
+	void Initialize(
+		unsigned int capacity,
+		float thresholdMs,
+		unsigned int framesAfter,
+		const char* dumpPathPrefix);
+	void ShutDown();
+
+	void SetHitchThreshold(float milliseconds);
+	float GetHitchThreshold();
+
+	// Frame boundaries, called once each per frame
+	void BeginFrame();
+	void EndFrame();
+
+	// Recording (all are no-ops before Initialize())
+	long long Now();
+	void RecordZone(const char* name, long long startTime, long long endTime);
+	void RecordEvent(const char* name);
+	void RecordValue(const char* name, double value);
+
+	// Writes the current ring contents right away, on the
+	// calling thread
+	bool Dump(const char* path);
+
+	// Records the lifetime of a scope as a zone
+	class ScopedZone
+	{
+	public:
+		ScopedZone(const char* name) : name(name), startTime(Now()) {}
+		~ScopedZone() { RecordZone(name, startTime, Now()); }
+
+	private:
+		const char* name;
+		long long startTime;
+	};
+}
+
+// Helpers for making uniquely-named zone variables
+#define FLIGHT_CONCAT_INNER(a, b) a##b
+#define FLIGHT_CONCAT(a, b) FLIGHT_CONCAT_INNER(a, b)
+#define FLIGHT_ZONE(name) FlightRecorder::ScopedZone FLIGHT_CONCAT(flightZone, __LINE__)(name)
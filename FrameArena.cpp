@@ -0,0 +1,293 @@
+#include "FrameArena.h"
+#include "MemoryTracker.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace FrameArena
+{
+	// Annonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		// One thread's bump allocator
+		struct ThreadArena
+		{
+			unsigned char* base;
+			size_t capacity;
+			size_t offset;
+			size_t peak;
+		};
+
+		// Heap blocks handed out after an arena fills up,
+		// chained together so Reset() can free them
+		struct OverflowBlock
+		{
+			OverflowBlock* next;
+		};
+
+		// Arenas live in a fixed table so creating
+		// one never touches the heap
+		const unsigned int MaxThreads = 64;
+		ThreadArena arenas[MaxThreads] = {};
+		std::atomic<unsigned int> arenaCount = 0;
+
+		// Bumped on ShutDown() so threads know their
+		// cached arena pointer is no longer valid
+		std::atomic<unsigned int> generation = 1;
+		thread_local ThreadArena* threadArena = 0;
+		thread_local unsigned int threadGeneration = 0;
+
+		bool initialized = false;
+		size_t arenaSize = 0;
+		bool wantHugePages = false;
+		bool gotHugePages = false;
+
+		std::mutex overflowMutex;
+		OverflowBlock* overflowBlocks = 0;
+		std::atomic<unsigned long long> overflowAllocations = 0;
+
+		// --------------------------------------------------------
+		// Gets memory straight from the OS, trying large pages
+		// first if asked (fewer TLB misses on big arenas)
+		// --------------------------------------------------------
+		unsigned char* ReservePages(size_t& size, bool hugePages, bool& usedHugePages)
+		{
+			usedHugePages = false;
+
+#if defined(_WIN32)
+			// Large pages need the "Lock pages in memory" privilege,
+			// so expect this to fail on most machines
+			SIZE_T largePage = GetLargePageMinimum();
+			if (hugePages && largePage > 0)
+			{
+				SIZE_T largeSize = (size + largePage - 1) / largePage * largePage;
+				void* memory = VirtualAlloc(0, largeSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+				if (memory)
+				{
+					size = largeSize;
+					usedHugePages = true;
+					return (unsigned char*)memory;
+				}
+			}
+
+			return (unsigned char*)VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+			// Explicit huge pages need them reserved by the admin
+			// (vm.nr_hugepages), otherwise ask for transparent ones
+			const size_t hugePage = 2 * 1024 * 1024;
+			if (hugePages)
+			{
+				size_t hugeSize = (size + hugePage - 1) / hugePage * hugePage;
+#if defined(MAP_HUGETLB)
+				void* memory = mmap(0, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+				if (memory != MAP_FAILED)
+				{
+					size = hugeSize;
+					usedHugePages = true;
+					return (unsigned char*)memory;
+				}
+#endif
+				size = hugeSize;
+			}
+
+			void* memory = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (memory == MAP_FAILED)
+				return 0;
+
+#if defined(MADV_HUGEPAGE)
+			if (hugePages)
+				usedHugePages = madvise(memory, size, MADV_HUGEPAGE) == 0;
+#endif
+			return (unsigned char*)memory;
+#endif
+		}
+
+		void ReleasePages(unsigned char* memory, size_t size)
+		{
+#if defined(_WIN32)
+			(void)size;
+			VirtualFree(memory, 0, MEM_RELEASE);
+#else
+			munmap(memory, size);
+#endif
+		}
+
+		// --------------------------------------------------------
+		// Sets up the calling thread's arena, or returns null if
+		// we're out of slots (the caller falls back to the heap)
+		// --------------------------------------------------------
+		ThreadArena* CreateThreadArena()
+		{
+			unsigned int index = arenaCount.fetch_add(1);
+			if (index >= MaxThreads)
+				return 0;
+
+			ThreadArena& arena = arenas[index];
+			size_t size = arenaSize;
+			bool usedHugePages = false;
+			arena.base = ReservePages(size, wantHugePages, usedHugePages);
+			arena.capacity = arena.base ? size : 0;
+			arena.offset = 0;
+			arena.peak = 0;
+			if (usedHugePages)
+				gotHugePages = true;
+
+			threadArena = &arena;
+			threadGeneration = generation;
+			return &arena;
+		}
+
+		// --------------------------------------------------------
+		// Heap fallback for when an arena is full
+		// --------------------------------------------------------
+		void* OverflowAllocate(size_t size, size_t alignment)
+		{
+			// Keep the user's pointer aligned past our header
+			size_t headerSize = (sizeof(OverflowBlock) + alignment - 1) / alignment * alignment;
+			OverflowBlock* block = (OverflowBlock*)MemoryTracker::Allocate(headerSize + size, alignment, MemoryTracker::Tag::FrameArena);
+			if (!block)
+				return 0;
+
+			{
+				std::lock_guard<std::mutex> lock(overflowMutex);
+				block->next = overflowBlocks;
+				overflowBlocks = block;
+			}
+
+			overflowAllocations++;
+			return (unsigned char*)block + headerSize;
+		}
+
+		void FreeOverflow()
+		{
+			std::lock_guard<std::mutex> lock(overflowMutex);
+			while (overflowBlocks)
+			{
+				OverflowBlock* next = overflowBlocks->next;
+				MemoryTracker::Free(overflowBlocks);
+				overflowBlocks = next;
+			}
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Sets arena options.  Arenas themselves are created lazily
+// the first time each thread allocates.
+//
+// bytesPerThread - Size of each thread's arena
+// useHugePages   - Try to back arenas with large/huge pages
+// --------------------------------------------------------
+void FrameArena::Initialize(size_t bytesPerThread, bool useHugePages)
+{
+	if (initialized)
+		return;
+
+	arenaSize = bytesPerThread;
+	wantHugePages = useHugePages;
+	gotHugePages = false;
+	initialized = true;
+}
+
+
+// --------------------------------------------------------
+// Returns all arena memory to the OS
+// --------------------------------------------------------
+void FrameArena::ShutDown()
+{
+	if (!initialized)
+		return;
+
+	unsigned int count = arenaCount < MaxThreads ? (unsigned int)arenaCount : MaxThreads;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (arenas[i].base)
+			ReleasePages(arenas[i].base, arenas[i].capacity);
+		arenas[i] = {};
+	}
+
+	FreeOverflow();
+	arenaCount = 0;
+	generation++;
+	initialized = false;
+}
+
+
+// --------------------------------------------------------
+// Bump-allocates from the calling thread's arena
+//
+// size      - Bytes needed
+// alignment - Must be a power of two
+// --------------------------------------------------------
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	ThreadArena* arena = threadArena;
+	if (threadGeneration != generation)
+		arena = initialized ? CreateThreadArena() : 0;
+
+	if (arena && arena->base)
+	{
+		uintptr_t base = (uintptr_t)arena->base;
+		uintptr_t start = (base + arena->offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		size_t end = (size_t)(start - base) + size;
+		if (end <= arena->capacity)
+		{
+			arena->offset = end;
+			if (end > arena->peak)
+				arena->peak = end;
+			return (void*)start;
+		}
+	}
+
+	return OverflowAllocate(size, alignment);
+}
+
+
+// --------------------------------------------------------
+// Rewinds every thread's arena and frees any overflow.
+// Call once per frame, after Input::EndOfFrame(), while
+// no other thread is using the arenas.
+// --------------------------------------------------------
+void FrameArena::Reset()
+{
+	unsigned int count = arenaCount < MaxThreads ? (unsigned int)arenaCount : MaxThreads;
+	for (unsigned int i = 0; i < count; i++)
+		arenas[i].offset = 0;
+
+	FreeOverflow();
+}
+
+
+// --------------------------------------------------------
+// Stats
+// --------------------------------------------------------
+size_t FrameArena::BytesUsedThisFrame()
+{
+	if (threadGeneration != generation || !threadArena)
+		return 0;
+
+	return threadArena->offset;
+}
+
+size_t FrameArena::PeakBytesUsed()
+{
+	size_t peak = 0;
+	unsigned int count = arenaCount < MaxThreads ? (unsigned int)arenaCount : MaxThreads;
+	for (unsigned int i = 0; i < count; i++)
+		if (arenas[i].peak > peak)
+			peak = arenas[i].peak;
+
+	return peak;
+}
+
+unsigned long long FrameArena::OverflowAllocations() { return overflowAllocations; }
+bool FrameArena::UsingHugePages() { return gotHugePages; }
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// --------------------------------------------------------
+// Per-frame linear (bump) allocator for transient data
+//
+// Each thread gets its own fixed-size arena the first time
+// it allocates, so allocating is just an aligned pointer
+// bump with no locking.  Nothing is freed individually;
+// Reset() rewinds every thread's arena at the end of the
+// frame (after Input::EndOfFrame()), so anything allocated
+// here must not be used past the frame it was made in.
+//
+// Reset() must only be called while no other thread is
+// allocating from an arena (i.e. between frames).
+//
+// If a thread runs out of space, further allocations fall
+// back to the (tracked) heap until the next Reset().
+//
+// Usage:
+//
+//   Packet* packets = FrameArena::AllocateArray<Packet>(count);
+//   FrameArena::Vector<unsigned int> visible;
+// --------------------------------------------------------
+namespace FrameArena
+{
+	// bytesPerThread - Size of each thread's arena
+	// useHugePages   - Try to back arenas with large/huge pages
+	//                  (falls back to normal pages if the OS says no)
+	void Initialize(size_t bytesPerThread, bool useHugePages);
+	void ShutDown();
+
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+	void Reset();
+
+	// Stats
+	size_t BytesUsedThisFrame();	// Calling thread only
+	size_t PeakBytesUsed();			// Any thread, any frame
+	unsigned long long OverflowAllocations();
+	bool UsingHugePages();
+
+	// Uninitialized storage for count objects of type T
+	template<typename T>
+	T* AllocateArray(size_t count)
+	{
+		return (T*)Allocate(sizeof(T) * count, alignof(T));
+	}
+
+	// --------------------------------------------------------
+	// STL-compatible allocator adapter, so standard
+	// containers can keep their storage in the arena
+	// --------------------------------------------------------
+	template<typename T>
+	class Allocator
+	{
+	public:
+		using value_type = T;
+
+		Allocator() noexcept = default;
+		template<typename U> Allocator(const Allocator<U>&) noexcept {}
+
+		T* allocate(size_t count) { return AllocateArray<T>(count); }
+		void deallocate(T*, size_t) noexcept {} // Freed by Reset()
+
+		template<typename U> bool operator==(const Allocator<U>&) const noexcept { return true; }
+		template<typename U> bool operator!=(const Allocator<U>&) const noexcept { return false; }
+	};
+
+	template<typename T>
+	using Vector = std::vector<T, Allocator<T>>;
+}
@@ -7,8 +7,16 @@
 #include "Memory"
 #include "Mesh.h"
 #include "BufferStructs.h"
-
-#include <DirectXMath.h>
+#include "FlightRecorder.h"
+#include "MemoryTracker.h"
+#include "TransformKernels.h"
+#include "TransformSystem.h"
+#include "Components.h"
+#include "SimdMath.h"
+#include "AssetLoader.h"
+#include "MeshStreaming.h"
+#include "ShaderHotReload.h"
+#include "Vfs.h"
 
 // This code assumes files are in "ImGui" subfolder!
 // Adjust as necessary for your own folder structure and project setup
@@ -16,23 +24,28 @@
 #include "ImGui/imgui_impl_dx11.h"
 #include "ImGui/imgui_impl_win32.h"
 
-// Needed for a helper function to load pre-compiled shader files
-#pragma comment(lib, "d3dcompiler.lib")
-#include <d3dcompiler.h>
-
-// For the DirectX Math library
-using namespace DirectX;
+// For the engine math library
+using namespace Math;
 
 // Variables for UI
 int number = 0;
-XMFLOAT4 color(1.0f, 0.0f, 0.5f, 1.0f);
+Float4 color(1.0f, 0.0f, 0.5f, 1.0f);
 bool isVisable = true;
 
+// How far (in pixels) a streamed mesh's LOD may move its
+// vertices before a finer LOD is drawn instead
+float streamingPixelError = 1.0f;
+
 // Shader color variable for UI access
 //std::unique_ptr<int> number = std::make_unique<int>(0);
 VertexShaderData vsData = {};
-//vsData.colorTint = XMFLOAT4(0.0f, 1.0f, 1.0f, 1.0f);
-//vsData.offset = XMFLOAT3(0.25f, 0.0f, 0.0f);
+//vsData.colorTint = Float4(0.0f, 1.0f, 1.0f, 1.0f);
+//vsData.offset = Float3(0.25f, 0.0f, 0.0f);
+
+// Variables in the vertex shader's ExternalData cbuffer
+constexpr StringId worldId("world");
+constexpr StringId colorTintId("colorTint");
+constexpr StringId offsetId("offset");
 
 
 // --------------------------------------------------------
@@ -42,9 +55,14 @@ VertexShaderData vsData = {};
 void Game::Initialize()
 {
 	// Initialize ImGui itself & platform/renderer backends
+	//  - Route its allocations through the memory tracker first
 	IMGUI_CHECKVERSION();
+	ImGui::SetAllocatorFunctions(
+		[](size_t size, void*) { return MemoryTracker::Allocate(size, 0, MemoryTracker::Tag::UI); },
+		[](void* memory, void*) { MemoryTracker::Free(memory); });
 	ImGui::CreateContext();
-	ImGui_ImplWin32_Init(Window::Handle());
+	if (!Graphics::IsHeadless())
+		ImGui_ImplWin32_Init(Window::Handle());
 	ImGui_ImplDX11_Init(Graphics::Device.Get(), Graphics::Context.Get());
 	// Pick a style (uncomment one of these 3)
 	ImGui::StyleColorsDark();
@@ -54,61 +72,30 @@ void Game::Initialize()
 	// Helper methods for loading shaders, creating some basic
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
+	//  - Both only queue work on the asset loader, so shaders
+	//    and meshes are built at the same time
+	//  - Only the shaders are waited for; meshes appear as
+	//    they finish, possibly after the first frame
 	LoadShaders();
 	CreateGeometry();
+	AssetLoader::WaitForCritical();
 
 	// Set initial graphics API state
 	//  - These settings persist until we change them
-	//  - Some of these, like the primitive topology & input layout, probably won't change
-	//  - Others, like setting shaders, will need to be moved elsewhere later
-	{
-		// Tell the input assembler (IA) stage of the pipeline what kind of
-		// geometric primitives (points, lines or triangles) we want to draw.  
-		// Essentially: "What kind of shape should the GPU draw with our vertices?"
-		Graphics::Context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-		// Ensure the pipeline knows how to interpret all the numbers stored in
-		// the vertex buffer. For this course, all of your vertices will probably
-		// have the same layout, so we can just set this once at startup.
-		Graphics::Context->IASetInputLayout(inputLayout.Get());
-
-		// Set the active vertex and pixel shaders
-		//  - Once you start applying different shaders to different objects,
-		//    these calls will need to happen multiple times per frame
-		Graphics::Context->VSSetShader(vertexShader.Get(), 0, 0);
-		Graphics::Context->PSSetShader(pixelShader.Get(), 0, 0);
-	}
+	//  - The pipeline covers the primitive topology, input layout,
+	//    shaders and fixed-function states in one call
+	//  - Once you start applying different pipelines to different
+	//    objects, this will need to happen multiple times per frame
+	if (pipeline)
+		pipeline->Bind(Graphics::Context.Get());
 
 	// Create a CONSTANT BUFFER to hold data on the GPU for shaders
-	// and bind it to the first vertex shader constant buffer register
-	{
-		// Calculate the size of our struct as a multiple of 16
-		unsigned int size = sizeof(VertexShaderData);
-		size = (size + 15) / 16 * 16;
-
-		// Describe the constant buffer and create it
-		D3D11_BUFFER_DESC cbDesc = {};
-		cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		cbDesc.ByteWidth = size;
-		cbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-		cbDesc.Usage = D3D11_USAGE_DYNAMIC;
-		cbDesc.MiscFlags = 0;
-		cbDesc.StructureByteStride = 0;
-		Graphics::Device->CreateBuffer(&cbDesc, 0, vsConstantBuffer.GetAddressOf());
-
-		// Activate the constant buffer, ensuring it is 
-		// bound to the correct slot (register)
-		//  - This should match what our shader expects!
-		//  - Your C++ and your shaders have to start matching up!
-		Graphics::Context->VSSetConstantBuffers(
-			0,		// Which slot (register) to bind the buffer to?
-			1,		// How many are we activating?  Can set more than one at a time, if we need
-			vsConstantBuffer.GetAddressOf());	// Array of constant buffers or the address of just one (same thing in C++)
-
-		// Gives a Beginning value
-		vsData.colorTint = XMFLOAT4(1.0f, 0.20f, 0.25f, 0.50f);
-		vsData.offset = XMFLOAT3(0.75f, 0.0f, 0.0f);
-	}
+	// and bind it to the register the vertex shader expects
+	CreateConstantBuffers();
+
+	// Gives a Beginning value
+	vsData.colorTint = Float4(1.0f, 0.20f, 0.25f, 0.50f);
+	vsData.offset = Float3(0.75f, 0.0f, 0.0f);
 }
 
 
@@ -120,171 +107,355 @@ void Game::Initialize()
 // --------------------------------------------------------
 Game::~Game()
 {
+	// Meshes are destroyed once the GPU is done with them
+	for (MeshHandle m : meshes)
+		Resources::Meshes().Release(m);
+
 	// ImGui clean up
 	ImGui_ImplDX11_Shutdown();
-	ImGui_ImplWin32_Shutdown();
+	if (!Graphics::IsHeadless())
+		ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
 }
 
 
 // --------------------------------------------------------
-// Loads shaders from compiled shader object (.cso) files
-// and also created the Input Layout that describes our 
-// vertex data to the rendering pipeline. 
-// - Input Layout creation is done here because it must 
-//    be verified against vertex shader byte code
-// - We'll have that byte code already loaded below
+// Gets the pipeline (shaders, input layout and states) we
+// draw with from the pipeline cache
+// - The cache compiles (or loads cached) shader permutations
+//    and creates the input layout, verifying it against
+//    the vertex shader's byte code
+// - If it was prewarmed at startup, nothing is created here
+// - This happens on an asset loader worker, and is critical:
+//    nothing can be drawn until it's done
 // --------------------------------------------------------
 void Game::LoadShaders()
 {
-	// BLOBs (or Binary Large OBjects) for reading raw data from external files
-	// - This is a simplified way of handling big chunks of external data
-	// - Literally just a big array of bytes read from a file
-	ID3DBlob* pixelShaderBlob;
-	ID3DBlob* vertexShaderBlob;
-
-	// Loading shaders
-	//  - Visual Studio will compile our shaders at build time
-	//  - They are saved as .cso (Compiled Shader Object) files
-	//  - We need to load them when the application starts
-	{
-		// Read our compiled shader code files into blobs
-		// - Essentially just "open the file and plop its contents here"
-		// - Uses the custom FixPath() helper from Helpers.h to ensure relative paths
-		// - Note the "L" before the string - this tells the compiler the string uses wide characters
-		D3DReadFileToBlob(FixPath(L"PixelShader.cso").c_str(), &pixelShaderBlob);
-		D3DReadFileToBlob(FixPath(L"VertexShader.cso").c_str(), &vertexShaderBlob);
-
-		// Create the actual Direct3D shaders on the GPU
-		Graphics::Device->CreatePixelShader(
-			pixelShaderBlob->GetBufferPointer(),	// Pointer to blob's contents
-			pixelShaderBlob->GetBufferSize(),		// How big is that data?
-			0,										// No classes in this shader
-			pixelShader.GetAddressOf());			// Address of the ID3D11PixelShader pointer
-
-		Graphics::Device->CreateVertexShader(
-			vertexShaderBlob->GetBufferPointer(),	// Get a pointer to the blob's contents
-			vertexShaderBlob->GetBufferSize(),		// How big is that data?
-			0,										// No classes in this shader
-			vertexShader.GetAddressOf());			// The address of the ID3D11VertexShader pointer
-	}
+	std::shared_ptr<const PipelineState*> result = std::make_shared<const PipelineState*>(nullptr);
+	AssetLoader::Load("", AssetLoader::Priority::Critical,
+		[result](std::vector<unsigned char>&)
+		{
+			MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Shaders);
+
+			// The shaders are uber-shaders: the features pick which
+			// permutation gets compiled (or loaded from the disk cache)
+			PipelineDesc desc;
+			desc.vertexShader = L"VertexShader.hlsl";
+			desc.pixelShader = L"PixelShader.hlsl";
+			desc.features = ShaderFeature::VertexColor | ShaderFeature::Tint;
+			desc.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+			// The element array is generated at compile time from Vertex
+			// (see VertexLayout in Vertex.h), so it can't drift out of sync
+			desc.SetVertexFormat(VertexLayout);
+
+			*result = PipelineCache::Get(desc);
+
+			// Without the .hlsl sources (running the .exe on its own),
+			// fall back to the precompiled default permutation
+			if (!*result)
+			{
+				desc.vertexShader = L"VertexShader.cso";
+				desc.pixelShader = L"PixelShader.cso";
+				*result = PipelineCache::Get(desc);
+			}
+			return *result != 0;
+		},
+		[this, result]() { pipeline = *result; });
+
+	// Edits to either shader are recompiled and swapped in
+	// while the game runs (see OnShadersReloaded)
+	ShaderHotReload::Watch("VertexShader.cso", "VertexShader.hlsl", "vs_5_0");
+	ShaderHotReload::Watch("PixelShader.cso", "PixelShader.hlsl", "ps_5_0");
+}
+
 
-	// Create an input layout 
-	//  - This describes the layout of data sent to a vertex shader
-	//  - In other words, it describes how to interpret data (numbers) in a vertex buffer
-	//  - Doing this NOW because it requires a vertex shader's byte code to verify against!
-	//  - Luckily, we already have that loaded (the vertex shader blob above)
+// --------------------------------------------------------
+// Creates the constant buffers our shaders read from
+//  - The layout (size, register, variable offsets) comes from
+//    reflecting the compiled shader, and VertexShaderData is
+//    checked against it so C++ and HLSL can't silently drift
+// --------------------------------------------------------
+void Game::CreateConstantBuffers()
+{
+	ConstantBufferLayout layout;
+	if (pipeline && ReflectConstantBuffer(
+		pipeline->vertexShaderCode->GetBufferPointer(),
+		pipeline->vertexShaderCode->GetBufferSize(),
+		"ExternalData",
+		layout))
 	{
-		D3D11_INPUT_ELEMENT_DESC inputElements[2] = {};
-
-		// Set up the first element - a position, which is 3 float values
-		inputElements[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;				// Most formats are described as color channels; really it just means "Three 32-bit floats"
-		inputElements[0].SemanticName = "POSITION";							// This is "POSITION" - needs to match the semantics in our vertex shader input!
-		inputElements[0].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;	// How far into the vertex is this?  Assume it's after the previous element
-
-		// Set up the second element - a color, which is 4 more float values
-		inputElements[1].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;			// 4x 32-bit floats
-		inputElements[1].SemanticName = "COLOR";							// Match our vertex shader input!
-		inputElements[1].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;	// After the previous element
-
-		// Create the input layout, verifying our description against actual shader code
-		Graphics::Device->CreateInputLayout(
-			inputElements,							// An array of descriptions
-			2,										// How many elements in that array?
-			vertexShaderBlob->GetBufferPointer(),	// Pointer to the code of a shader that uses this layout
-			vertexShaderBlob->GetBufferSize(),		// Size of the shader code that uses this layout
-			inputLayout.GetAddressOf());			// Address of the resulting ID3D11InputLayout pointer
+		layout.Validate(VertexShaderDataFields, sizeof(VertexShaderData));
+		vsConstants.Create(layout);
+		vsConstants.BindVS();
 	}
 }
 
 
+// --------------------------------------------------------
+// Called between frames after hot reloading swapped new
+// shaders into our pipeline.  The shaders' constant buffer
+// layouts may have changed, so those are rebuilt too.
+// --------------------------------------------------------
+void Game::OnShadersReloaded()
+{
+	if (pipeline)
+		pipeline->Bind(Graphics::Context.Get());
+	CreateConstantBuffers();
+}
+
+
 // --------------------------------------------------------
 // Creates the geometry we're going to draw
+// - Each mesh's vertices are built on an asset loader worker,
+//    and the mesh shows up in the scene as soon as it's done,
+//    even if that's after the first frame
 // --------------------------------------------------------
 void Game::CreateGeometry()
 {
-	// Create some temporary variables to represent colors
-	// - Not necessary, just makes things more readable
-	XMFLOAT4 red = XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f);
-	XMFLOAT4 green = XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f);
-	XMFLOAT4 blue = XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f);
-
 	// === Mesh 1 ===
-	Vertex verts1[] =
-	{
-		{ XMFLOAT3(+0.0f, +0.5f, +0.0f), red },
-		{ XMFLOAT3(+0.5f, -0.5f, +0.0f), blue },
-		{ XMFLOAT3(-0.5f, -0.5f, +0.0f), green },
-	};
-	unsigned int indices1[] = { 0, 1, 2 };
+	QueueMesh("Triangle", [](MeshData& mesh)	// heavily reference the triangle code
+		{
+			// Create some temporary variables to represent colors
+			// - Not necessary, just makes things more readable
+			Float4 red = Float4(1.0f, 0.0f, 0.0f, 1.0f);
+			Float4 green = Float4(0.0f, 1.0f, 0.0f, 1.0f);
+			Float4 blue = Float4(0.0f, 0.0f, 1.0f, 1.0f);
+
+			mesh.vertices =
+			{
+				{ Float3(+0.0f, +0.5f, +0.0f), red },
+				{ Float3(+0.5f, -0.5f, +0.0f), blue },
+				{ Float3(-0.5f, -0.5f, +0.0f), green },
+			};
+			mesh.indices = { 0, 1, 2 };
+		});
 
 	// Rhombus
-	XMFLOAT4 orange = XMFLOAT4(1.0f, 0.65f, 0.0f, 1.0f);  // Orange color
-	XMFLOAT4 pink = XMFLOAT4(1.0f, 0.0f, 1.0f, 1.0f);     // Pink color
+	QueueMesh("Rhombus", [](MeshData& mesh)
+		{
+			Float4 orange = Float4(1.0f, 0.65f, 0.0f, 1.0f);  // Orange color
+			Float4 pink = Float4(1.0f, 0.0f, 1.0f, 1.0f);     // Pink color
+
+			mesh.vertices =
+			{
+				{ Float3(-0.5f, 0.0f, 0.0f), orange },  // Left vertex
+				{ Float3(0.0f, 0.5f, 0.0f), pink },     // Top vertex
+				{ Float3(0.5f, 0.0f, 0.0f), orange },   // Right vertex
+				{ Float3(0.0f, -0.5f, 0.0f), pink }     // Bottom vertex
+			};
+			mesh.indices =
+			{
+				0, 1, 2,  // First triangle
+				0, 2, 3   // Second triangle
+			};
+		});
 
-	Vertex verts2[] =
-	{
-		{ XMFLOAT3(-0.5f, 0.0f, 0.0f), orange },  // Left vertex
-		{ XMFLOAT3(0.0f, 0.5f, 0.0f), pink },     // Top vertex
-		{ XMFLOAT3(0.5f, 0.0f, 0.0f), orange },   // Right vertex
-		{ XMFLOAT3(0.0f, -0.5f, 0.0f), pink }     // Bottom vertex
-	};
-	unsigned int indices2[] =
-	{
-		0, 1, 2,  // First triangle
-		0, 2, 3   // Second triangle
-	};
+	// SUNFLOWER Mesh
+	QueueMesh("Sunflower Petals", [](MeshData& mesh)
+		{
+			// Create some yellow for the sunflower
+			Float4 yellow = Float4(1.0f, 1.0f, 0.0f, 1.0f); // Petals color
+
+			// Petals varibles
+			const int petalCount = 20;
+			const float petalLength = 0.2f;
+			const float radius = 0.5f;
+
+			for (int i = 0; i < petalCount; i++)
+			{
+				float angle = (float(i) / petalCount) * TwoPi;
+				float nextAngle = (float(i + 1) / petalCount) * TwoPi;
+
+				// Define the base and tip of each petal
+				float baseX1 = cosf(angle) * radius;
+				float baseY1 = sinf(angle) * radius;
+				float baseX2 = cosf(nextAngle) * radius;
+				float baseY2 = sinf(nextAngle) * radius;
+				float tipX = cosf((angle + nextAngle) / 2) * (radius + petalLength);
+				float tipY = sinf((angle + nextAngle) / 2) * (radius + petalLength);
+
+				// Adding vertices for the petal
+				mesh.vertices.push_back({ Float3(baseX1, baseY1, 0.0f), yellow });
+				mesh.vertices.push_back({ Float3(baseX2, baseY2, 0.0f), yellow });
+				mesh.vertices.push_back({ Float3(tipX, tipY, 0.0f), yellow });
+
+				// Indices for petal triangle
+				unsigned int startIdx = i * 3;
+				mesh.indices.push_back(startIdx);
+				mesh.indices.push_back(startIdx + 1);
+				mesh.indices.push_back(startIdx + 2);
+			}
+		});
+
+	// A detailed mesh, if one was converted (see MeshConverter)
+	// next to the .exe or packed, streamed in LOD by LOD
+	if (Vfs::Exists("Sunflower.mesh"))
+		AddStreamedMesh("Sunflower", "Sunflower.mesh");
+}
 
 
-	// SUNFLOWER Mesh
-	// Create some yellow for the sunflower
-	XMFLOAT4 yellow = XMFLOAT4(1.0f, 1.0f, 0.0f, 1.0f); // Petals color
+// --------------------------------------------------------
+// Builds a mesh's data on a loader worker, then creates the
+// mesh (and its objects) back on the main thread
+//
+// name  - Mesh name, which must outlive the load
+// build - Fills in vertices and indices
+// --------------------------------------------------------
+void Game::QueueMesh(const char* name, void (*build)(MeshData&))
+{
+	std::shared_ptr<MeshData> data = std::make_shared<MeshData>();
+	AssetLoader::Load("", AssetLoader::Priority::Background,
+		[data, build](std::vector<unsigned char>&)
+		{
+			MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Geometry);
+			build(*data);
+			return true;
+		},
+		[this, name, data]()
+		{
+			MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Geometry);
+			AddMesh(Resources::CreateMesh(name, data->vertices.data(), data->vertices.size(), data->indices.data(), data->indices.size()));
+		});
+}
+
+
+// --------------------------------------------------------
+// Adds a mesh to the scene, along with an entity for each
+// of its instances
+// --------------------------------------------------------
+void Game::AddMesh(MeshHandle mesh)
+{
+	meshes.push_back(mesh);
+	CreateObjects(mesh);
+	transforms.UpdateWorldMatrices();
+	UpdateBounds();
+}
 
-	// Petals varibles
-	const int petalCount = 20;
-	const float petalLength = 0.2f;
-	const float radius = 0.5f;
 
-	std::vector<Vertex> petalVertices;
-	std::vector<unsigned int> petalIndices;
+// --------------------------------------------------------
+// Adds a mesh whose LODs are streamed to the scene, along
+// with an entity for each of its instances.  They aren't
+// drawn until one of its LODs is resident.
+// --------------------------------------------------------
+void Game::AddStreamedMesh(const char* name, const char* path)
+{
+	StreamedMeshId mesh = MeshStreaming::Register(name, path);
+	if (!mesh)
+		return;
+
+	streamedMeshes.push_back(mesh);
+	CreateStreamedObjects(mesh);
+	transforms.UpdateWorldMatrices();
+	UpdateBounds();
+}
 
-	for (int i = 0; i < petalCount; i++)
+
+// --------------------------------------------------------
+// Makes an entity for every drawn object (each instance of
+// each mesh), all starting at the origin with no tint
+// --------------------------------------------------------
+void Game::CreateObjects()
+{
+	size_t objectCount = (meshes.size() + streamedMeshes.size()) * instancesPerMesh;
+
+	world.Clear();
+	transforms.Clear();
+	transforms.Reserve(objectCount);
+	objectEntities.clear();
+	objectEntities.reserve(objectCount);
+	for (MeshHandle mesh : meshes)
+		CreateObjects(mesh);
+	for (StreamedMeshId mesh : streamedMeshes)
+		CreateStreamedObjects(mesh);
+
+	transforms.UpdateWorldMatrices();
+	UpdateBounds();
+}
+
+// Just the entities for one mesh's instances
+void Game::CreateObjects(MeshHandle mesh)
+{
+	for (unsigned int i = 0; i < instancesPerMesh; i++)
 	{
-		float angle = (float(i) / petalCount) * XM_2PI;
-		float nextAngle = (float(i + 1) / petalCount) * XM_2PI;
-
-		// Define the base and tip of each petal
-		float baseX1 = cosf(angle) * radius;
-		float baseY1 = sinf(angle) * radius;
-		float baseX2 = cosf(nextAngle) * radius;
-		float baseY2 = sinf(nextAngle) * radius;
-		float tipX = cosf((angle + nextAngle) / 2) * (radius + petalLength);
-		float tipY = sinf((angle + nextAngle) / 2) * (radius + petalLength);
-
-		// Adding vertices for the petal
-		petalVertices.push_back({ XMFLOAT3(baseX1, baseY1, 0.0f), yellow });
-		petalVertices.push_back({ XMFLOAT3(baseX2, baseY2, 0.0f), yellow });
-		petalVertices.push_back({ XMFLOAT3(tipX, tipY, 0.0f), yellow });
-
-		// Indices for petal triangle
-		unsigned int startIdx = i * 3;
-		petalIndices.push_back(startIdx);
-		petalIndices.push_back(startIdx + 1);
-		petalIndices.push_back(startIdx + 2);
+		objectEntities.push_back(world.Create(
+			MeshComponent{ mesh },
+			TintComponent{ Float4(1, 1, 1, 1) },
+			TransformComponent{ transforms.Create() },
+			BoundsComponent{}));
 	}
+}
 
-	// Create meshes and add to vector
-	// - The ARRAYSIZE macro returns the size of a locally-defined array
-	std::shared_ptr<Mesh> mesh1 = std::make_shared<Mesh>("Triangle", verts1, ARRAYSIZE(verts1), indices1, ARRAYSIZE(indices1)); // heavily reference the triangle code
-	std::shared_ptr<Mesh> rhombus = std::make_shared<Mesh>("Rhombus", verts2, ARRAYSIZE(verts2), indices2, ARRAYSIZE(indices2));
-	std::shared_ptr<Mesh> petalMesh = std::make_shared<Mesh>("Sunflower Petals", petalVertices.data(), petalVertices.size(), petalIndices.data(), petalIndices.size());
+// Streamed ones aren't in objectEntities, which is only
+// for the UI's list of meshes
+void Game::CreateStreamedObjects(StreamedMeshId mesh)
+{
+	for (unsigned int i = 0; i < instancesPerMesh; i++)
+	{
+		world.Create(
+			StreamedMeshComponent{ mesh },
+			TintComponent{ Float4(1, 1, 1, 1) },
+			TransformComponent{ transforms.Create() },
+			BoundsComponent{});
+	}
+}
+
+
+// --------------------------------------------------------
+// Moves world space bounds along with any transforms
+// rebuilt by the last UpdateWorldMatrices()
+// --------------------------------------------------------
+void Game::UpdateBounds()
+{
+	if (transforms.LastUpdateCount() == 0)
+		return;
 
+	// Largest axis scale grows the radius
+	auto transformBounds = [&](TransformId transform, Float3 center, float radius, BoundsComponent& bounds)
+	{
+		Matrix matrix = Load(transforms.GetWorldMatrix(transform));
+		float scale = GetX(Max(
+			Length3(matrix.r[0]),
+			Max(Length3(matrix.r[1]), Length3(matrix.r[2]))));
 
-	meshes.push_back(mesh1);
-	meshes.push_back(rhombus);
-	meshes.push_back(petalMesh);
+		Store(bounds.center, TransformPoint(Load(center), matrix));
+		bounds.radius = radius * scale;
+	};
 
-	
+	ResourcePool<Mesh>& meshPool = Resources::Meshes();
+	world.ParallelForEach<MeshComponent, TransformComponent, BoundsComponent>(
+		[&](Entity, MeshComponent& mc, TransformComponent& tc, BoundsComponent& bounds)
+		{
+			Mesh* mesh = meshPool.Get(mc.mesh);
+			if (mesh && transforms.WasUpdated(tc.transform))
+				transformBounds(tc.transform, mesh->GetBoundsCenter(), mesh->GetBoundsRadius(), bounds);
+		});
+
+	// Streamed meshes' bounds come from their files, so they're
+	// known before any LOD is resident
+	world.ParallelForEach<StreamedMeshComponent, TransformComponent, BoundsComponent>(
+		[&](Entity, StreamedMeshComponent& sc, TransformComponent& tc, BoundsComponent& bounds)
+		{
+			if (transforms.WasUpdated(tc.transform))
+				transformBounds(tc.transform, MeshStreaming::GetBoundsCenter(sc.mesh), MeshStreaming::GetBoundsRadius(sc.mesh), bounds);
+		});
+}
+
+
+// --------------------------------------------------------
+// Replaces the current geometry with a different set of
+// meshes, each drawn several times per frame
+//  - Used by the benchmark to build synthetic stress scenes
+// --------------------------------------------------------
+void Game::LoadScene(const std::vector<MeshHandle>& sceneMeshes, unsigned int instancesPerMesh)
+{
+	for (MeshHandle m : meshes)
+		Resources::Meshes().Release(m);
+
+	meshes = sceneMeshes;
+	streamedMeshes.clear();
+	this->instancesPerMesh = instancesPerMesh;
+	CreateObjects();
 }
 
 
@@ -301,8 +472,15 @@ void Game::OnResize()
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
+	FLIGHT_ZONE("Game::Update");
+
 	UpdateUI(deltaTime);
 	BuildUI();
+
+	// Rebuild world matrices (and bounds) for anything that moved
+	transforms.UpdateWorldMatrices();
+	UpdateBounds();
+
 	// Example input checking: Quit if the escape key is pressed
 	if (Input::KeyDown(VK_ESCAPE))
 		Window::Quit();
@@ -314,6 +492,8 @@ void Game::Update(float deltaTime, float totalTime)
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
+	FLIGHT_ZONE("Game::Draw");
+
 	// Frame START
 	// - These things should happen ONCE PER FRAME
 	// - At the beginning of Game::Draw() before drawing *anything*
@@ -332,32 +512,101 @@ void Game::Draw(float deltaTime, float totalTime)
 	// Loop through the game entities and draw each one
 	// - Note: A constant buffer has already been bound to
 	//   the vertex shader stage of the pipeline (see Init above)
-		for (auto& m : meshes)
+		ResourcePool<Mesh>& meshPool = Resources::Meshes();
+		Vector globalTint = Load(vsData.colorTint);
+		vsConstants.Set(offsetId, vsData.offset);
+
+		// Each chunk's world-view-projection matrices are made in
+		// one batch by the transform kernels, already transposed
+		// for HLSL.  There's no camera yet, so the view and
+		// projection are identity and the shader's "world" is
+		// the whole transform to clip space.
+		Float4x4 view;
+		Float4x4 projection;
+		Store(view, Identity());
+		Store(projection, Identity());
+		auto prepareChunk = [&](const TransformComponent* tcs, unsigned int count)
 		{
-			//vsData.colorTint = XMFLOAT4(1.0f, 0.20f, 0.25f, 0.50f);
-			//vsData.offset = XMFLOAT3(0.75f, 0.0f, 0.00f);
-
-			D3D11_MAPPED_SUBRESOURCE mappedBuffer = {};
-			Graphics::Context->Map(vsConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedBuffer);
-			memcpy(mappedBuffer.pData, &vsData, sizeof(vsData));
-			Graphics::Context->Unmap(vsConstantBuffer.Get(), 0);
+			if (chunkWorlds.size() < count)
+			{
+				MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Transforms);
+				chunkWorlds.resize(count);
+				chunkMatrices.resize(count);
+			}
+
+			for (unsigned int i = 0; i < count; i++)
+				chunkWorlds[i] = transforms.GetWorldMatrix(tcs[i].transform);
+			TransformKernels::WorldViewProjection(chunkWorlds.data(), view, projection, chunkMatrices.data(), count, true);
+		};
+
+		auto drawObject = [&](Mesh* m, const TintComponent& tint, const Float4x4& matrix)
+		{
+			// Only variables that actually changed mark the
+			// buffer dirty, and clean buffers aren't re-uploaded
+			Float4 tintData;
+			Store(tintData, Multiply(globalTint, Load(tint.color)));
+			vsConstants.Set(worldId, matrix);
+			vsConstants.Set(colorTintId, tintData);
+			vsConstants.Upload();
 
 			m->DrawBuff();
-		}
+		};
+
+		world.ForEachChunk<MeshComponent, TintComponent, TransformComponent>(
+			[&](unsigned int count, const Entity*, MeshComponent* mcs, TintComponent* tints, TransformComponent* tcs)
+			{
+				prepareChunk(tcs, count);
+				for (unsigned int i = 0; i < count; i++)
+				{
+					if (Mesh* m = meshPool.Get(mcs[i].mesh))
+						drawObject(m, tints[i], chunkMatrices[i]);
+				}
+			});
+
+		// Streamed meshes draw whichever LOD is resident and
+		// closest to the one they want.  There's no camera yet,
+		// so the world is in clip space and a pixel is 2 / height
+		// units across, which the object's scale shrinks in its
+		// mesh's own units.
+		float pixelSize = 2.0f / (float)(Window::Height() > 0 ? Window::Height() : 1);
+		world.ForEachChunk<StreamedMeshComponent, TintComponent, TransformComponent, BoundsComponent>(
+			[&](unsigned int count, const Entity*, StreamedMeshComponent* scs, TintComponent* tints, TransformComponent* tcs, BoundsComponent* bounds)
+			{
+				prepareChunk(tcs, count);
+				for (unsigned int i = 0; i < count; i++)
+				{
+					float meshRadius = MeshStreaming::GetBoundsRadius(scs[i].mesh);
+					float scale = meshRadius > 0.0f && bounds[i].radius > 0.0f ? bounds[i].radius / meshRadius : 1.0f;
+					float maxError = streamingPixelError * pixelSize / scale;
+
+					if (Mesh* m = meshPool.Get(MeshStreaming::Use(scs[i].mesh, maxError)))
+						drawObject(m, tints[i], chunkMatrices[i]);
+				}
+			});
 	}
 
 	// Frame END
 	// - These should happen exactly ONCE PER FRAME
 	// - At the very end of the frame (after drawing *everything*)
 	{
+		FLIGHT_ZONE("Game::Draw - UI and Present");
 		ImGui::Render(); // Turns this frame’s UI into renderable triangles
 		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData()); // Draws it to the screen
 
 		// Present at the end of the frame
-		bool vsync = Graphics::VsyncState();
-		Graphics::SwapChain->Present(
-			vsync ? 1 : 0,
-			vsync ? 0 : DXGI_PRESENT_ALLOW_TEARING);
+		//  - Nothing to present when headless, but we still
+		//    want the GPU to actually get this frame's work
+		if (Graphics::IsHeadless())
+		{
+			Graphics::Context->Flush();
+		}
+		else
+		{
+			bool vsync = Graphics::VsyncState();
+			Graphics::SwapChain->Present(
+				vsync ? 1 : 0,
+				vsync ? 0 : DXGI_PRESENT_ALLOW_TEARING);
+		}
 
 		// Re-bind back buffer and depth buffer after presenting
 		Graphics::Context->OMSetRenderTargets(
@@ -381,7 +630,8 @@ void Game::UpdateUI(float deltaTime)
 
 	// Reset the frame
 	ImGui_ImplDX11_NewFrame();
-	ImGui_ImplWin32_NewFrame();
+	if (!Graphics::IsHeadless())
+		ImGui_ImplWin32_NewFrame();
 	ImGui::NewFrame();
 
 	// Determine new input capture
@@ -422,25 +672,48 @@ void Game::BuildUI()
 	// Displays W X H to UI
 	ImGui::Text("Window Resolution: %dx%d", Window::Width(), Window::Height());
 
+	// Heap usage last frame - steady state should be zero
+	const MemoryTracker::Counts& allocations = MemoryTracker::LastFrame();
+	ImGui::Text("Allocations Last Frame: %llu (%llu bytes)", allocations.allocations, allocations.bytes);
+
 	// Toggles visability of Demo on click
 	if (ImGui::Button("Toggle ImGui Demo"))
 	{
 		isVisable = !isVisable;
 	}
 
+	// Frames slower than this get dumped by the flight recorder
+	float hitchThreshold = FlightRecorder::GetHitchThreshold();
+	if (ImGui::SliderFloat("Hitch Threshold (ms)", &hitchThreshold, 5.0f, 500.0f))
+		FlightRecorder::SetHitchThreshold(hitchThreshold);
+
 	// Color editor for the background
 	ImGui::ColorEdit4("Background Color", &color.x);
 	int totalVertex = 0;
 	int totalTri = 0;
 
 	// Goes through each mesh and displays it's information
-	for (auto& m : meshes)
+	for (size_t meshIndex = 0; meshIndex < meshes.size(); meshIndex++)
 	{
+		Mesh* m = Resources::Meshes().Get(meshes[meshIndex]);
+		if (!m)
+			continue;
+
 		//ImGui::Text("Mesh: %d", m->GetName(), m->GetIndexCount());
-		ImGui::Text(m->GetName());
+		ImGui::Text("%s", m->GetName());
 		ImGui::Text("	Tri Count: %d", m->GetIndexCount() / 3);
 		ImGui::Text("	Vertex Count: %d", m->GetVertexCount());
 
+		// Move and tint the mesh's first instance
+		Entity entity = objectEntities[meshIndex * instancesPerMesh];
+		TransformId transform = world.Get<TransformComponent>(entity)->transform;
+		Float3 position = transforms.GetPosition(transform);
+		ImGui::PushID((int)meshIndex);
+		if (ImGui::DragFloat3("	Position", &position.x, 0.01f))
+			transforms.SetPosition(transform, position);
+		ImGui::ColorEdit4("	Tint", &world.Get<TintComponent>(entity)->color.x);
+		ImGui::PopID();
+
 		totalTri += m->GetIndexCount() / 3;
 		totalVertex += m->GetVertexCount();
 	}
@@ -449,6 +722,17 @@ void Game::BuildUI()
 	ImGui::Text("TOTAL Tri: %d", totalTri);
 	ImGui::Text("TOTAL Vertex: %d", totalVertex);
 
+	// Streamed meshes' video memory, and how detailed they get
+	const float megabyte = 1024.0f * 1024.0f;
+	ImGui::Text("Streamed Meshes: %zu (%.1f MB resident, %.1f MB loading)",
+		streamedMeshes.size(),
+		MeshStreaming::ResidentBytes() / megabyte,
+		MeshStreaming::LoadingBytes() / megabyte);
+	float budget = MeshStreaming::Budget() / megabyte;
+	if (ImGui::SliderFloat("Streaming Budget (MB)", &budget, 1.0f, 1024.0f))
+		MeshStreaming::SetBudget((uint64_t)(budget * megabyte));
+	ImGui::SliderFloat("LOD Pixel Error", &streamingPixelError, 0.25f, 16.0f);
+
 	// RGBA sliders
 	ImGui::SliderFloat("Red", &vsData.colorTint.x, 0.0f, 1.0f);
 	ImGui::SliderFloat("Green", &vsData.colorTint.y, 0.0f, 1.0f);
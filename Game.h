@@ -2,8 +2,12 @@
 
 #include <d3d11.h>
 #include <wrl/client.h>
-#include "Mesh.h"
-#include <memory>
+#include "PipelineCache.h"
+#include "ConstantBuffer.h"
+#include "Resources.h"
+#include "Components.h"
+#include "EntityWorld.h"
+#include "TransformSystem.h"
 #include <vector>
 
 class Game
@@ -21,11 +25,33 @@ public:
 	void Draw(float deltaTime, float totalTime);
 	void OnResize();
 
+	// Rebinds everything that depends on the shaders
+	void OnShadersReloaded();
+
+	// Swaps in a different set of meshes (benchmark scenes, etc.)
+	// The game takes over the meshes and releases them when done
+	void LoadScene(const std::vector<MeshHandle>& sceneMeshes, unsigned int instancesPerMesh);
+
 private:
 
 	// Initialization helper methods - feel free to customize, combine, remove, etc.
 	void LoadShaders();
+	void CreateConstantBuffers();
 	void CreateGeometry();
+	void CreateObjects();
+	void CreateObjects(MeshHandle mesh);
+	void CreateStreamedObjects(StreamedMeshId mesh);
+
+	// Geometry built off the main thread, then made into a mesh
+	struct MeshData
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+	};
+	void QueueMesh(const char* name, void (*build)(MeshData&));
+	void AddMesh(MeshHandle mesh);
+	void AddStreamedMesh(const char* name, const char* path);
+	void UpdateBounds();
 	void UpdateUI(float deltaTime);
 	void BuildUI();
 
@@ -38,13 +64,29 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
 
-	Microsoft::WRL::ComPtr<ID3D11Buffer> vsConstantBuffer;
+	// Vertex shader's ExternalData, laid out by reflection
+	ConstantBuffer vsConstants;
+
+	// Shaders, input layout and states, owned by the PipelineCache
+	const PipelineState* pipeline = 0;
+
+	// Meshes live in Resources::Meshes() - we just hold handles
+	std::vector<MeshHandle> meshes;
+	unsigned int instancesPerMesh = 1;
+
+	// Meshes whose LODs MeshStreaming keeps resident as needed
+	std::vector<StreamedMeshId> streamedMeshes;
 
-	// Shaders and shader-related constructs
-	Microsoft::WRL::ComPtr<ID3D11PixelShader> pixelShader;
-	Microsoft::WRL::ComPtr<ID3D11VertexShader> vertexShader;
-	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+	// Every drawn object is an entity with mesh, tint, transform
+	// and bounds components.  objectEntities is indexed by
+	// mesh index * instancesPerMesh + instance, for the UI.
+	EntityWorld world;
+	TransformSystem transforms;
+	std::vector<Entity> objectEntities;
 
-	std::vector<std::shared_ptr<Mesh>> meshes;
+	// Draw() scratch, one chunk's worth: world matrices, then
+	// the batched world-view-projection matrices made from them
+	std::vector<Math::Float4x4> chunkWorlds;
+	std::vector<Math::Float4x4> chunkMatrices;
 };
 
@@ -0,0 +1,240 @@
+#include "GpuUpload.h"
+#include "Graphics.h"
+#include "MemoryTracker.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+// Annonymous namespace to hold variables
+// only accessible in this file
+namespace
+{
+	// Every copy starts on this boundary in its segment
+	const size_t CopyAlignment = 16;
+
+	// A buffer waiting for its bytes in a segment
+	struct PendingCopy
+	{
+		Microsoft::WRL::ComPtr<ID3D11Buffer> destination;
+		UINT offset;
+		UINT size;
+	};
+
+	struct Segment
+	{
+		Microsoft::WRL::ComPtr<ID3D11Buffer> staging;
+		Microsoft::WRL::ComPtr<ID3D11Query> fence;	// Ended after its copies
+		unsigned char* data;		// While mapped
+		bool inFlight;				// Unmapped, waiting on its fence
+		size_t used;
+		unsigned int writers;		// Copies into it still going
+		uint64_t firstTicket;		// Of the copies in it
+		std::vector<PendingCopy> copies;
+	};
+
+	std::mutex ringMutex;
+	std::vector<Segment> segments;
+	size_t ringSegmentSize = 0;
+	unsigned int current = 0;		// Segment new copies go into
+	uint64_t nextTicket = 1;
+	std::atomic<uint64_t> submittedTicket = 0;
+
+
+	// --------------------------------------------------------
+	// Finds room for a copy, in the current segment or else
+	// the next one if the GPU is done with it.  Call with the
+	// ring locked.  Returns false if there's no room.
+	// --------------------------------------------------------
+	bool Reserve(size_t size, unsigned int& segment, size_t& offset, uint64_t& ticket)
+	{
+		if (segments.empty() || size > ringSegmentSize)
+			return false;
+
+		Segment* s = &segments[current];
+		if (s->inFlight || s->used + size > ringSegmentSize)
+		{
+			unsigned int next = (current + 1) % (unsigned int)segments.size();
+			if (segments[next].inFlight || segments[next].used > 0)
+				return false;
+
+			current = next;
+			s = &segments[current];
+		}
+
+		if (s->used == 0)
+			s->firstTicket = nextTicket;
+
+		offset = s->used;
+		s->used = (offset + size + CopyAlignment - 1) / CopyAlignment * CopyAlignment;
+		s->writers++;
+		segment = current;
+		ticket = nextTicket++;
+		return true;
+	}
+
+	void ReleaseRing()
+	{
+		for (Segment& s : segments)
+		{
+			if (s.data)
+				Graphics::Context->Unmap(s.staging.Get(), 0);
+		}
+		segments.clear();
+		current = 0;
+	}
+}
+
+
+void GpuUpload::Initialize(size_t segmentSize, unsigned int segmentCount)
+{
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Graphics);
+	std::lock_guard<std::mutex> lock(ringMutex);
+	ReleaseRing();
+	ringSegmentSize = segmentSize;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = (UINT)segmentSize;
+	desc.Usage = D3D11_USAGE_STAGING;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	D3D11_QUERY_DESC fenceDesc = {};
+	fenceDesc.Query = D3D11_QUERY_EVENT;
+
+	for (unsigned int i = 0; i < segmentCount; i++)
+	{
+		Segment s = {};
+		D3D11_MAPPED_SUBRESOURCE mapped = {};
+		if (FAILED(Graphics::Device->CreateBuffer(&desc, 0, s.staging.GetAddressOf())) ||
+			FAILED(Graphics::Device->CreateQuery(&fenceDesc, s.fence.GetAddressOf())) ||
+			FAILED(Graphics::Context->Map(s.staging.Get(), 0, D3D11_MAP_WRITE, 0, &mapped)))
+		{
+			printf("GpuUpload: Couldn't create the upload ring - buffers get initial data instead\n");
+			ReleaseRing();
+			return;
+		}
+
+		s.data = (unsigned char*)mapped.pData;
+		segments.push_back(std::move(s));
+	}
+}
+
+void GpuUpload::ShutDown()
+{
+	std::lock_guard<std::mutex> lock(ringMutex);
+	ReleaseRing();
+}
+
+
+// --------------------------------------------------------
+// Only the bookkeeping happens under the lock: the copy into
+// the ring and creating the buffer don't, so uploads from
+// several threads overlap
+// --------------------------------------------------------
+HRESULT GpuUpload::CreateBuffer(const D3D11_BUFFER_DESC& desc, const void* data, ID3D11Buffer** buffer, uint64_t& ticket)
+{
+	ticket = 0;
+	unsigned int segment = 0;
+	size_t offset = 0;
+	unsigned char* staged = 0;
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+		if (Reserve(desc.ByteWidth, segment, offset, ticket))
+			staged = segments[segment].data + offset;
+	}
+
+	if (!staged)
+	{
+		D3D11_SUBRESOURCE_DATA initialData = {};
+		initialData.pSysMem = data;
+		return Graphics::Device->CreateBuffer(&desc, &initialData, buffer);
+	}
+
+	memcpy(staged, data, desc.ByteWidth);
+
+	D3D11_BUFFER_DESC defaultDesc = desc;
+	defaultDesc.Usage = D3D11_USAGE_DEFAULT;
+	defaultDesc.CPUAccessFlags = 0;
+	HRESULT hr = Graphics::Device->CreateBuffer(&defaultDesc, 0, buffer);
+
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Graphics);
+	std::lock_guard<std::mutex> lock(ringMutex);
+	Segment& s = segments[segment];
+	if (SUCCEEDED(hr))
+		s.copies.push_back({ *buffer, (UINT)offset, desc.ByteWidth });
+	s.writers--;
+	return hr;
+}
+
+bool GpuUpload::IsSubmitted(uint64_t ticket)
+{
+	return ticket <= submittedTicket.load(std::memory_order_acquire);
+}
+
+
+// --------------------------------------------------------
+// Segments are flushed oldest first, stopping at one that a
+// copy is still being written into.  Tickets only grow from
+// one segment to the next, so everything before that
+// segment's first ticket has been issued.
+// --------------------------------------------------------
+void GpuUpload::Flush()
+{
+	std::lock_guard<std::mutex> lock(ringMutex);
+	if (segments.empty())
+		return;
+
+	uint64_t submitted = nextTicket - 1;
+	unsigned int count = (unsigned int)segments.size();
+	for (unsigned int i = 1; i <= count; i++)
+	{
+		Segment& s = segments[(current + i) % count];
+		if (s.inFlight || s.used == 0)
+			continue;
+
+		if (s.writers > 0)
+		{
+			submitted = s.firstTicket - 1;
+			break;
+		}
+
+		Graphics::Context->Unmap(s.staging.Get(), 0);
+		s.data = 0;
+		for (const PendingCopy& copy : s.copies)
+		{
+			D3D11_BOX box = { copy.offset, 0, 0, copy.offset + copy.size, 1, 1 };
+			Graphics::Context->CopySubresourceRegion(copy.destination.Get(), 0, 0, 0, 0, s.staging.Get(), 0, &box);
+		}
+		s.copies.clear();
+		Graphics::Context->End(s.fence.Get());
+		s.inFlight = true;
+	}
+	submittedTicket.store(submitted, std::memory_order_release);
+
+	// Take back segments the GPU has copied out of.  Their
+	// fences were ended at least a frame ago (or just now),
+	// so checking doesn't flush the context.
+	for (Segment& s : segments)
+	{
+		if (!s.inFlight || Graphics::Context->GetData(s.fence.Get(), 0, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			continue;
+
+		D3D11_MAPPED_SUBRESOURCE mapped = {};
+		if (SUCCEEDED(Graphics::Context->Map(s.staging.Get(), 0, D3D11_MAP_WRITE, 0, &mapped)))
+		{
+			s.data = (unsigned char*)mapped.pData;
+			s.inFlight = false;
+			s.used = 0;
+		}
+	}
+}
+
+size_t GpuUpload::PendingBytes()
+{
+	std::lock_guard<std::mutex> lock(ringMutex);
+	size_t bytes = 0;
+	for (const Segment& s : segments)
+		bytes += s.used;
+	return bytes;
+}
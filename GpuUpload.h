@@ -0,0 +1,81 @@
+#pragma once
+
+#include <d3d11.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// --------------------------------------------------------
+// Staged uploads of static buffer data, through a ring of
+// persistently mapped STAGING buffers
+//
+// Creating a buffer with initial data makes the driver copy
+// (and often wait) right there on the calling thread.  Here
+// the data is copied into the ring instead, from any thread,
+// and the buffer is created empty in DEFAULT memory.  Once
+// a frame, Flush() on the render thread batches every
+// finished copy into CopySubresourceRegion() calls.
+//
+// The ring is split into segments, each its own STAGING
+// buffer - D3D11 can't write one while the GPU copies from
+// it.  Copies fill the current segment, then move on to
+// the next.  Flushing unmaps the segments with copies in
+// them and ends an event query after their copies; once
+// the GPU gets past it, the segment is mapped again and can
+// be reused.
+//
+// An upload that doesn't fit in the ring (or comes before
+// Initialize()) just creates the buffer with initial data.
+//
+// Usage:
+//
+//   GpuUpload::Initialize(8 * 1024 * 1024, 4);
+//   uint64_t ticket;
+//   GpuUpload::CreateBuffer(desc, vertices, buffer.GetAddressOf(), ticket);	// Any thread
+//   ...
+//   GpuUpload::Flush();	// Render thread, once per frame before drawing
+//   if (GpuUpload::IsSubmitted(ticket))
+//       draw with the buffer
+// --------------------------------------------------------
+namespace GpuUpload
+{
+	// --------------------------------------------------------
+	// Creates and maps the ring's STAGING buffers.  Call on the
+	// render thread.
+	//
+	// segmentSize  - Bytes per segment, which is also the
+	//                largest upload that goes through the ring
+	// segmentCount - How many segments make up the ring
+	// --------------------------------------------------------
+	void Initialize(size_t segmentSize, unsigned int segmentCount);
+
+	// Unmaps and releases the ring, once nothing is creating
+	// buffers anymore.  Copies never flushed are dropped.
+	void ShutDown();
+
+	// --------------------------------------------------------
+	// Creates a buffer filled with data, from any thread
+	//
+	// desc   - As if creating it with initial data (the usage
+	//          becomes DEFAULT if it goes through the ring)
+	// data   - desc.ByteWidth bytes, copied before returning
+	// buffer - Gets the new buffer
+	// ticket - For IsSubmitted(), or 0 if the buffer was made
+	//          with initial data and can be used right away
+	// --------------------------------------------------------
+	HRESULT CreateBuffer(const D3D11_BUFFER_DESC& desc, const void* data, ID3D11Buffer** buffer, uint64_t& ticket);
+
+	// Whether a buffer's copy has been issued to the immediate
+	// context, so anything drawn after it sees the data
+	bool IsSubmitted(uint64_t ticket);
+
+	// --------------------------------------------------------
+	// Issues every finished copy, and takes back segments the
+	// GPU has finished copying from.  Once per frame on the
+	// render thread, before anything is drawn.
+	// --------------------------------------------------------
+	void Flush();
+
+	// Ring bytes holding copies not yet flushed, or in flight
+	size_t PendingBytes();
+}
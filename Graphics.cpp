@@ -1,5 +1,7 @@
 #include "Graphics.h"
+#include "MemoryTracker.h"
 #include <dxgi1_6.h>
+#include <vector>
 
 // Tell the drivers to use high-performance GPU in multi-GPU systems (like laptops)
 extern "C"
@@ -17,16 +19,22 @@ namespace Graphics
 		bool apiInitialized = false;
 		bool supportsTearing = false;
 		bool vsyncDesired = false;
+		bool headless = false;
 		BOOL isFullscreen = false;
 
 		D3D_FEATURE_LEVEL featureLevel;
 
 		Microsoft::WRL::ComPtr<ID3D11InfoQueue> InfoQueue;
+
+		// Reused between debug messages so printing
+		// doesn't allocate once it's big enough
+		std::vector<unsigned char> messageBuffer;
 	}
 }
 
 // Getters
 bool Graphics::VsyncState() { return vsyncDesired || !supportsTearing || isFullscreen; }
+bool Graphics::IsHeadless() { return headless; }
 std::wstring Graphics::APIName() 
 { 
 	switch (featureLevel)
@@ -44,7 +52,8 @@ std::wstring Graphics::APIName()
 // 
 // windowWidth     - Width of the window (and our viewport)
 // windowHeight    - Height of the window (and our viewport)
-// windowHandle    - OS-level handle of the window
+// windowHandle    - OS-level handle of the window, or null to
+//                   run headless (no swap chain, offscreen target)
 // vsyncIfPossible - Sync to the monitor's refresh rate if available?
 // --------------------------------------------------------
 HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight, HWND windowHandle, bool vsyncIfPossible)
@@ -106,21 +115,43 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 	// Result variable for below function calls
 	HRESULT hr = S_OK;
 
-	// Attempt to initialize DirectX
-	hr = D3D11CreateDeviceAndSwapChain(
-		0,							// Video adapter (physical GPU) to use, or null for default
-		D3D_DRIVER_TYPE_HARDWARE,	// We want to use the hardware (GPU)
-		0,							// Used when doing software rendering
-		deviceFlags,				// Any special options
-		0,							// Optional array of possible versions we want as fallbacks
-		0,							// The number of fallbacks in the above param
-		D3D11_SDK_VERSION,			// Current version of the SDK
-		&swapDesc,					// Address of swap chain options
-		SwapChain.GetAddressOf(),	// Pointer to our Swap Chain pointer
-		Device.GetAddressOf(),		// Pointer to our Device pointer
-		&featureLevel,				// Retrieve exact API feature level in use
-		Context.GetAddressOf());	// Pointer to our Device Context pointer
-	if (FAILED(hr)) return hr;
+	// Without a window there is nothing to present to, so just
+	// create the device and context.  ResizeBuffers() will make
+	// an offscreen texture to stand in for the back buffer.
+	headless = (windowHandle == 0);
+	if (headless)
+	{
+		hr = D3D11CreateDevice(
+			0,							// Default adapter
+			D3D_DRIVER_TYPE_HARDWARE,	// Still want the real GPU
+			0,							// Used when doing software rendering
+			deviceFlags,				// Any special options
+			0,							// No fallback versions
+			0,							// The number of fallbacks in the above param
+			D3D11_SDK_VERSION,			// Current version of the SDK
+			Device.GetAddressOf(),		// Pointer to our Device pointer
+			&featureLevel,				// Retrieve exact API feature level in use
+			Context.GetAddressOf());	// Pointer to our Device Context pointer
+		if (FAILED(hr)) return hr;
+	}
+	else
+	{
+		// Attempt to initialize DirectX
+		hr = D3D11CreateDeviceAndSwapChain(
+			0,							// Video adapter (physical GPU) to use, or null for default
+			D3D_DRIVER_TYPE_HARDWARE,	// We want to use the hardware (GPU)
+			0,							// Used when doing software rendering
+			deviceFlags,				// Any special options
+			0,							// Optional array of possible versions we want as fallbacks
+			0,							// The number of fallbacks in the above param
+			D3D11_SDK_VERSION,			// Current version of the SDK
+			&swapDesc,					// Address of swap chain options
+			SwapChain.GetAddressOf(),	// Pointer to our Swap Chain pointer
+			Device.GetAddressOf(),		// Pointer to our Device pointer
+			&featureLevel,				// Retrieve exact API feature level in use
+			Context.GetAddressOf());	// Pointer to our Device Context pointer
+		if (FAILED(hr)) return hr;
+	}
 
 	// We're set up
 	apiInitialized = true;
@@ -175,20 +206,38 @@ void Graphics::ResizeBuffers(unsigned int width, unsigned int height)
 	BackBufferRTV.Reset();
 	DepthBufferDSV.Reset();
 
-	// Resize the swap chain buffers
-	SwapChain->ResizeBuffers(
-		2, 
-		width, 
-		height, 
-		DXGI_FORMAT_R8G8B8A8_UNORM, 
-		supportsTearing ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0);
-
-	// Grab the references to the first buffer
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> backBufferTexture;
-	SwapChain->GetBuffer(
-		0,
-		__uuidof(ID3D11Texture2D),
-		(void**)backBufferTexture.GetAddressOf());
+	if (SwapChain)
+	{
+		// Resize the swap chain buffers
+		SwapChain->ResizeBuffers(
+			2, 
+			width, 
+			height, 
+			DXGI_FORMAT_R8G8B8A8_UNORM, 
+			supportsTearing ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0);
+
+		// Grab the references to the first buffer
+		SwapChain->GetBuffer(
+			0,
+			__uuidof(ID3D11Texture2D),
+			(void**)backBufferTexture.GetAddressOf());
+	}
+	else
+	{
+		// Headless, so make our own texture that matches
+		// what the swap chain would have given us
+		D3D11_TEXTURE2D_DESC backBufferDesc = {};
+		backBufferDesc.Width = width;
+		backBufferDesc.Height = height;
+		backBufferDesc.MipLevels = 1;
+		backBufferDesc.ArraySize = 1;
+		backBufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		backBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		backBufferDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+		backBufferDesc.SampleDesc.Count = 1;
+		Device->CreateTexture2D(&backBufferDesc, 0, backBufferTexture.GetAddressOf());
+	}
 
 	// Now that we have the texture, create a render target view
 	// for the back buffer so we can render into it.
@@ -239,7 +288,27 @@ void Graphics::ResizeBuffers(unsigned int width, unsigned int height)
 	Context->RSSetViewports(1, &viewport);
 
 	// Are we in a fullscreen state?
-	SwapChain->GetFullscreenState(&isFullscreen, 0);
+	if (SwapChain)
+		SwapChain->GetFullscreenState(&isFullscreen, 0);
+}
+
+
+// --------------------------------------------------------
+// Overwrites the contents of a DYNAMIC buffer (like a
+// constant buffer) with new data from the CPU
+//
+// buffer - A buffer created with D3D11_USAGE_DYNAMIC and
+//          D3D11_CPU_ACCESS_WRITE
+// data   - The data to copy into the buffer
+// size   - How many bytes to copy
+// --------------------------------------------------------
+void Graphics::FillDynamicBuffer(ID3D11Buffer* buffer, const void* data, size_t size)
+{
+	// Discard the old contents so we never wait on the GPU
+	D3D11_MAPPED_SUBRESOURCE mappedBuffer = {};
+	Context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedBuffer);
+	memcpy(mappedBuffer.pData, data, size);
+	Context->Unmap(buffer, 0);
 }
 
 
@@ -257,6 +326,8 @@ void Graphics::PrintDebugMessages()
 	if (messageCount == 0)
 		return;
 
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Graphics);
+
 	// Loop and print messages
 	for (UINT64 i = 0; i < messageCount; i++)
 	{
@@ -264,12 +335,15 @@ void Graphics::PrintDebugMessages()
 		size_t messageSize = 0;
 		InfoQueue->GetMessage(i, 0, &messageSize);
 
-		// Reserve space for this message
-		D3D11_MESSAGE* message = (D3D11_MESSAGE*)malloc(messageSize);
-		InfoQueue->GetMessage(i, message, &messageSize);
+		// Make sure there's space for this message
+		if (messageBuffer.size() < messageSize)
+			messageBuffer.resize(messageSize);
+
+		D3D11_MESSAGE* message = (D3D11_MESSAGE*)messageBuffer.data();
+		HRESULT hr = InfoQueue->GetMessage(i, message, &messageSize);
 		
-		// Print and clean up memory
-		if (message)
+		// Print the message
+		if (SUCCEEDED(hr))
 		{
 			// Color code based on severity
 			switch (message->Severity)
@@ -287,7 +361,6 @@ void Graphics::PrintDebugMessages()
 			}
 
 			printf("%s\n\n", message->pDescription);
-			free(message);
 
 			// Reset color
 			printf("\x1B[0m");
@@ -25,6 +25,7 @@ namespace Graphics
 
 	// Getters
 	bool VsyncState();
+	bool IsHeadless();
 	std::wstring APIName();
 
 	// General functions
@@ -32,6 +33,9 @@ namespace Graphics
 	void ShutDown();
 	void ResizeBuffers(unsigned int width, unsigned int height);
 
+	// Resource helpers
+	void FillDynamicBuffer(ID3D11Buffer* buffer, const void* data, size_t size);
+
 	// Debug Layer
 	void PrintDebugMessages();
 }
\ No newline at end of file
@@ -0,0 +1,966 @@
+#include "IoScheduler.h"
+#include "AssetPack.h"
+#include "MemoryTracker.h"
+#include "Vfs.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include "PathHelpers.h"
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace IoScheduler
+{
+	// Annonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		// Reads are coalesced across gaps this small, and up to
+		// this size, so merging never reads much that's unwanted
+		const uint64_t MaxCoalescedGap = 64 * 1024;
+		const uint64_t MaxCoalescedSize = 1024 * 1024;
+
+		// Largest single read call
+		const uint64_t MaxReadSize = 1 << 30;
+
+		// Threads that decompress finished reads and run their
+		// completions, so none of that lands on the main thread
+		const unsigned int DecodeThreadCount = 2;
+
+#if defined(_WIN32)
+		typedef HANDLE FileHandle;
+		const FileHandle InvalidFile = INVALID_HANDLE_VALUE;
+#else
+		typedef int FileHandle;
+		const FileHandle InvalidFile = -1;
+#endif
+
+		enum class Mode
+		{
+			Inline,
+			Threads,
+			Ring
+		};
+
+		struct Request
+		{
+			uint64_t ticket;
+			Priority priority;
+			double deadline;			// Steady clock seconds
+			CompletionFunction done;
+			Vfs::FileLocation location;
+
+			// Compressed pack entries are decoded whole, and then
+			// cut down to the range ReadRange() asked for.  Other
+			// ranges are read on their own (the location's range).
+			bool decode = false;
+			uint64_t rangeOffset = 0;
+			uint64_t rangeSize = Vfs::WholeFile;
+
+			// Filled in once read: the bytes (or the pack entry's
+			// extent) are in the buffer, shared with any requests
+			// coalesced with this one
+			std::shared_ptr<std::vector<unsigned char>> buffer;
+			uint64_t bufferOffset = 0;
+			std::vector<unsigned char> data;
+			bool succeeded = false;
+		};
+
+		typedef std::unique_ptr<Request> RequestPtr;
+
+		// One read of a file, for one or more requests
+		struct Batch
+		{
+			const char* path;
+			bool packFile = false;		// Kept open, unlike loose files
+			FileHandle file = InvalidFile;
+			bool ownsFile = false;		// Loose files are closed after
+			uint64_t offset = 0;
+			uint64_t size = 0;
+			uint64_t read = 0;
+			std::shared_ptr<std::vector<unsigned char>> buffer;
+			std::vector<RequestPtr> requests;
+		};
+
+		Mode mode = Mode::Inline;
+		unsigned int inFlightLimit = 0;
+		std::vector<std::thread> threads;
+		std::vector<std::thread> decodeThreads;
+
+		// Guards the queues and counts
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable decodeWake;
+		std::vector<RequestPtr> queue;
+		std::vector<RequestPtr> ready;		// Read, waiting for their completions
+		size_t finished = 0;				// Completions run since the last Update()
+		unsigned int inFlight = 0;
+		bool quitting = false;
+		uint64_t nextTicket = 1;
+		std::atomic<size_t> pending = 0;
+
+		// Packs stay open, since they're read over and over.
+		// Keyed by the Vfs's (interned) path pointer.
+		struct OpenPack
+		{
+			const char* key;
+			std::string path;
+			FileHandle file;
+		};
+		std::mutex packsMutex;
+		std::vector<OpenPack> openPacks;
+
+		double Now()
+		{
+			return std::chrono::duration<double>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+#if defined(_WIN32)
+		FileHandle OpenFile(const char* path)
+		{
+			return CreateFileW(
+				NarrowToWide(path).c_str(),
+				GENERIC_READ,
+				FILE_SHARE_READ,
+				0,
+				OPEN_EXISTING,
+				FILE_ATTRIBUTE_NORMAL,
+				0);
+		}
+
+		void CloseFile(FileHandle file)
+		{
+			CloseHandle(file);
+		}
+
+		bool FileSize(FileHandle file, uint64_t& size)
+		{
+			LARGE_INTEGER fileSize = {};
+			if (!GetFileSizeEx(file, &fileSize))
+				return false;
+			size = (uint64_t)fileSize.QuadPart;
+			return true;
+		}
+
+		// Reads at an offset, without touching the file pointer
+		// other threads are using
+		bool ReadAt(FileHandle file, uint64_t offset, unsigned char* data, uint64_t size)
+		{
+			for (uint64_t done = 0; done < size; )
+			{
+				uint64_t remaining = size - done;
+				DWORD chunk = (DWORD)(remaining < MaxReadSize ? remaining : MaxReadSize);
+				OVERLAPPED overlapped = {};
+				overlapped.Offset = (DWORD)(offset + done);
+				overlapped.OffsetHigh = (DWORD)((offset + done) >> 32);
+				DWORD bytes = 0;
+				if (!ReadFile(file, data + done, chunk, &bytes, &overlapped) || bytes == 0)
+					return false;
+				done += bytes;
+			}
+			return true;
+		}
+#else
+		FileHandle OpenFile(const char* path)
+		{
+			return open(path, O_RDONLY | O_CLOEXEC);
+		}
+
+		void CloseFile(FileHandle file)
+		{
+			close(file);
+		}
+
+		bool FileSize(FileHandle file, uint64_t& size)
+		{
+			struct stat info;
+			if (fstat(file, &info) != 0)
+				return false;
+			size = (uint64_t)info.st_size;
+			return true;
+		}
+
+		bool ReadAt(FileHandle file, uint64_t offset, unsigned char* data, uint64_t size)
+		{
+			for (uint64_t done = 0; done < size; )
+			{
+				uint64_t remaining = size - done;
+				ssize_t bytes = pread(file, data + done, (size_t)(remaining < MaxReadSize ? remaining : MaxReadSize), (off_t)(offset + done));
+				if (bytes <= 0)
+					return false;
+				done += (uint64_t)bytes;
+			}
+			return true;
+		}
+#endif
+
+		FileHandle OpenPackFile(const char* path)
+		{
+			std::lock_guard<std::mutex> lock(packsMutex);
+			for (const OpenPack& pack : openPacks)
+			{
+				if (pack.key == path && pack.path == path)
+					return pack.file;
+			}
+
+			FileHandle file = OpenFile(path);
+			if (file != InvalidFile)
+				openPacks.push_back({ path, path, file });
+			return file;
+		}
+
+		// --------------------------------------------------------
+		// Orders requests: overdue first, then by priority, then
+		// by deadline
+		// --------------------------------------------------------
+		bool MoreUrgent(const Request& a, const Request& b, double now)
+		{
+			bool aLate = a.deadline <= now;
+			bool bLate = b.deadline <= now;
+			if (aLate != bLate)
+				return aLate;
+			if (a.priority != b.priority)
+				return a.priority < b.priority;
+			return a.deadline < b.deadline;
+		}
+
+		bool SameFile(const char* a, const char* b)
+		{
+			return a == b || strcmp(a, b) == 0;
+		}
+
+		RequestPtr Take(std::vector<RequestPtr>& requests, size_t index)
+		{
+			RequestPtr request = std::move(requests[index]);
+			requests[index] = std::move(requests.back());
+			requests.pop_back();
+			return request;
+		}
+
+		RequestPtr Take(size_t index)
+		{
+			return Take(queue, index);
+		}
+
+		// --------------------------------------------------------
+		// Takes the most urgent request off the queue, along with
+		// every queued request it can share a read with.  Callers
+		// hold the lock.  Returns null if the queue is empty.
+		// --------------------------------------------------------
+		std::unique_ptr<Batch> NextBatch()
+		{
+			if (queue.empty())
+				return 0;
+
+			double now = Now();
+			size_t best = 0;
+			for (size_t i = 1; i < queue.size(); i++)
+			{
+				if (MoreUrgent(*queue[i], *queue[best], now))
+					best = i;
+			}
+
+			std::unique_ptr<Batch> batch = std::make_unique<Batch>();
+			batch->requests.push_back(Take(best));
+			const Vfs::FileLocation& first = batch->requests[0]->location;
+			batch->path = first.path;
+			batch->packFile = first.pack != 0;
+			batch->offset = first.offset;
+			batch->size = first.size;
+
+			// The same loose file twice is read once
+			if (first.size == Vfs::WholeFile)
+			{
+				for (size_t i = 0; i < queue.size(); )
+				{
+					const Vfs::FileLocation& other = queue[i]->location;
+					if (other.size == Vfs::WholeFile && SameFile(other.path, batch->path))
+						batch->requests.push_back(Take(i));
+					else
+						i++;
+				}
+				return batch;
+			}
+
+			// A loose file's size isn't known, so a range of one
+			// could run past the end and fail the others with it
+			if (!batch->packFile)
+				return batch;
+
+			// Ranges of the same pack that overlap or nearly touch
+			// grow the read, until nothing else fits
+			bool grew = true;
+			while (grew)
+			{
+				grew = false;
+				for (size_t i = 0; i < queue.size(); )
+				{
+					const Vfs::FileLocation& other = queue[i]->location;
+					uint64_t start = batch->offset < other.offset ? batch->offset : other.offset;
+					uint64_t end = batch->offset + batch->size > other.offset + other.size ?
+						batch->offset + batch->size : other.offset + other.size;
+					bool nearby = other.offset <= batch->offset + batch->size + MaxCoalescedGap &&
+						batch->offset <= other.offset + other.size + MaxCoalescedGap;
+
+					if (other.size != Vfs::WholeFile && other.pack && SameFile(other.path, batch->path) &&
+						nearby && end - start <= MaxCoalescedSize)
+					{
+						batch->offset = start;
+						batch->size = end - start;
+						batch->requests.push_back(Take(i));
+						grew = true;
+					}
+					else
+					{
+						i++;
+					}
+				}
+			}
+			return batch;
+		}
+
+		// --------------------------------------------------------
+		// Opens a batch's file and sizes its buffer.  Whole loose
+		// files' sizes are only known once they're open.
+		// --------------------------------------------------------
+		bool PrepareBatch(Batch& batch)
+		{
+			if (batch.packFile)
+			{
+				batch.file = OpenPackFile(batch.path);
+				if (batch.file == InvalidFile)
+					return false;
+			}
+			else
+			{
+				batch.file = OpenFile(batch.path);
+				batch.ownsFile = true;
+				if (batch.file == InvalidFile ||
+					(batch.size == Vfs::WholeFile && !FileSize(batch.file, batch.size)))
+					return false;
+			}
+
+			batch.buffer = std::make_shared<std::vector<unsigned char>>((size_t)batch.size);
+			return true;
+		}
+
+		// --------------------------------------------------------
+		// Hands a finished read's bytes to its requests and moves
+		// them to the ready list for the decode threads
+		// --------------------------------------------------------
+		void FinishBatch(std::unique_ptr<Batch> batch, bool succeeded)
+		{
+			if (batch->ownsFile && batch->file != InvalidFile)
+				CloseFile(batch->file);
+
+			for (RequestPtr& request : batch->requests)
+			{
+				request->succeeded = succeeded;
+				if (!succeeded)
+					continue;
+
+				// A read for one request that needs no decoding is just
+				// its data
+				if (batch->requests.size() == 1 && !request->decode)
+					request->data.swap(*batch->buffer);
+				else
+				{
+					request->buffer = batch->buffer;
+					request->bufferOffset = request->location.size == Vfs::WholeFile ? 0 : request->location.offset - batch->offset;
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			for (RequestPtr& request : batch->requests)
+				ready.push_back(std::move(request));
+			inFlight--;
+			wake.notify_all();
+			decodeWake.notify_all();
+		}
+
+		// --------------------------------------------------------
+		// Decompresses a read pack entry (or copies its bytes out
+		// of a shared buffer) and runs the completion
+		// --------------------------------------------------------
+		void Complete(Request& request)
+		{
+			if (request.succeeded && request.decode)
+			{
+				request.succeeded = request.location.pack->Decode(*request.location.entry,
+					request.buffer->data() + request.bufferOffset, request.data);
+				if (request.succeeded && request.rangeSize != Vfs::WholeFile)
+				{
+					request.data.erase(request.data.begin() + (size_t)(request.rangeOffset + request.rangeSize), request.data.end());
+					request.data.erase(request.data.begin(), request.data.begin() + (size_t)request.rangeOffset);
+				}
+			}
+			else if (request.succeeded && request.buffer)
+			{
+				const unsigned char* start = request.buffer->data() + request.bufferOffset;
+				size_t size = request.location.size == Vfs::WholeFile ? request.buffer->size() : (size_t)request.location.size;
+				request.data.assign(start, start + size);
+			}
+			request.buffer.reset();
+
+			if (request.done)
+				request.done(request.succeeded, request.data);
+		}
+
+		// --------------------------------------------------------
+		// Decode stage: each thread takes the most urgent ready
+		// request, completes it and frees its bytes, leaving
+		// Update() only a count to collect
+		// --------------------------------------------------------
+		void DecodeMain()
+		{
+			MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Loading);
+			while (true)
+			{
+				RequestPtr request;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					decodeWake.wait(lock, [&]() { return quitting || !ready.empty(); });
+					if (quitting)
+						return;
+
+					double now = Now();
+					size_t best = 0;
+					for (size_t i = 1; i < ready.size(); i++)
+					{
+						if (MoreUrgent(*ready[i], *ready[best], now))
+							best = i;
+					}
+					request = Take(ready, best);
+				}
+
+				Complete(*request);
+				request.reset();
+
+				std::lock_guard<std::mutex> lock(mutex);
+				finished++;
+			}
+		}
+
+		// --------------------------------------------------------
+		// Thread pool backend: each thread takes a batch, reads
+		// it with blocking calls and finishes it
+		// --------------------------------------------------------
+		void ThreadMain()
+		{
+			MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Loading);
+			while (true)
+			{
+				std::unique_ptr<Batch> batch;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					wake.wait(lock, [&]() { return quitting || !queue.empty(); });
+					if (quitting)
+						return;
+
+					batch = NextBatch();
+					inFlight++;
+				}
+
+				bool succeeded = PrepareBatch(*batch) &&
+					ReadAt(batch->file, batch->offset, batch->buffer->data(), batch->size);
+				FinishBatch(std::move(batch), succeeded);
+			}
+		}
+
+#if defined(__linux__)
+		// --------------------------------------------------------
+		// io_uring backend: one thread keeps up to inFlightLimit
+		// reads submitted to the kernel and reaps completions.
+		// Read() wakes it with a no-op when there's new work.
+		// --------------------------------------------------------
+		struct Ring
+		{
+			int fd = -1;
+			unsigned int entries = 0;
+
+			void* sqMemory = 0;
+			size_t sqMemorySize = 0;
+			void* cqMemory = 0;
+			size_t cqMemorySize = 0;
+			io_uring_sqe* sqes = 0;
+			size_t sqesSize = 0;
+
+			unsigned int* sqHead = 0;
+			unsigned int* sqTail = 0;
+			unsigned int* sqMask = 0;
+			unsigned int* sqArray = 0;
+			unsigned int* cqHead = 0;
+			unsigned int* cqTail = 0;
+			unsigned int* cqMask = 0;
+			io_uring_cqe* cqes = 0;
+		};
+
+		Ring ring;
+		std::mutex submitMutex;			// Guards the submission queue
+		std::atomic<bool> wakeQueued = false;
+
+		// user_data of the no-op that wakes the ring thread
+		const uint64_t WakeTag = 0;
+
+		int RingEnter(unsigned int submit, unsigned int wait)
+		{
+			return (int)syscall(__NR_io_uring_enter, ring.fd, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, 0, 0);
+		}
+
+		void RingClose()
+		{
+			if (ring.sqes)
+				munmap(ring.sqes, ring.sqesSize);
+			if (ring.cqMemory && ring.cqMemory != ring.sqMemory)
+				munmap(ring.cqMemory, ring.cqMemorySize);
+			if (ring.sqMemory)
+				munmap(ring.sqMemory, ring.sqMemorySize);
+			if (ring.fd >= 0)
+				close(ring.fd);
+			ring = Ring();
+		}
+
+		// Sets up the rings, returning false if the kernel
+		// doesn't have io_uring (or doesn't allow it)
+		bool RingOpen(unsigned int entries)
+		{
+			io_uring_params params = {};
+			ring.fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+			if (ring.fd < 0)
+				return false;
+
+			ring.entries = params.sq_entries;
+			ring.sqMemorySize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+			ring.cqMemorySize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+			if (single && ring.cqMemorySize > ring.sqMemorySize)
+				ring.sqMemorySize = ring.cqMemorySize;
+
+			void* sq = mmap(0, ring.sqMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+			if (sq == MAP_FAILED)
+			{
+				RingClose();
+				return false;
+			}
+			ring.sqMemory = sq;
+
+			void* cq = single ? sq : mmap(0, ring.cqMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+			if (cq == MAP_FAILED)
+			{
+				RingClose();
+				return false;
+			}
+			ring.cqMemory = cq;
+
+			ring.sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+			void* sqes = mmap(0, ring.sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+			if (sqes == MAP_FAILED)
+			{
+				RingClose();
+				return false;
+			}
+			ring.sqes = (io_uring_sqe*)sqes;
+
+			unsigned char* sqBytes = (unsigned char*)sq;
+			ring.sqHead = (unsigned int*)(sqBytes + params.sq_off.head);
+			ring.sqTail = (unsigned int*)(sqBytes + params.sq_off.tail);
+			ring.sqMask = (unsigned int*)(sqBytes + params.sq_off.ring_mask);
+			ring.sqArray = (unsigned int*)(sqBytes + params.sq_off.array);
+
+			unsigned char* cqBytes = (unsigned char*)cq;
+			ring.cqHead = (unsigned int*)(cqBytes + params.cq_off.head);
+			ring.cqTail = (unsigned int*)(cqBytes + params.cq_off.tail);
+			ring.cqMask = (unsigned int*)(cqBytes + params.cq_off.ring_mask);
+			ring.cqes = (io_uring_cqe*)(cqBytes + params.cq_off.cqes);
+			return true;
+		}
+
+		// --------------------------------------------------------
+		// Queues one operation and submits it.  The submission
+		// queue has room for every read in flight plus wake-ups.
+		// --------------------------------------------------------
+		bool RingSubmit(unsigned char opcode, int fd, void* data, unsigned int size, uint64_t offset, uint64_t tag)
+		{
+			std::lock_guard<std::mutex> lock(submitMutex);
+			unsigned int tail = *ring.sqTail;
+			unsigned int head = __atomic_load_n(ring.sqHead, __ATOMIC_ACQUIRE);
+			if (tail - head >= ring.entries)
+				return false;
+
+			unsigned int index = tail & *ring.sqMask;
+			io_uring_sqe& sqe = ring.sqes[index];
+			memset(&sqe, 0, sizeof(sqe));
+			sqe.opcode = opcode;
+			sqe.fd = fd;
+			sqe.addr = (uint64_t)(uintptr_t)data;
+			sqe.len = size;
+			sqe.off = offset;
+			sqe.user_data = tag;
+			ring.sqArray[index] = index;
+			__atomic_store_n(ring.sqTail, tail + 1, __ATOMIC_RELEASE);
+
+			return RingEnter(1, 0) == 1;
+		}
+
+		// Submits (the rest of) a batch's read
+		bool SubmitRead(Batch& batch)
+		{
+			uint64_t remaining = batch.size - batch.read;
+			return RingSubmit(IORING_OP_READ, batch.file, batch.buffer->data() + batch.read,
+				(unsigned int)(remaining < MaxReadSize ? remaining : MaxReadSize),
+				batch.offset + batch.read, (uint64_t)(uintptr_t)&batch);
+		}
+
+		void RingMain()
+		{
+			MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Loading);
+			while (true)
+			{
+				// Start queued reads, as far as the bound allows
+				while (true)
+				{
+					std::unique_ptr<Batch> batch;
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						if (quitting || inFlight >= inFlightLimit)
+							break;
+						batch = NextBatch();
+						if (!batch)
+							break;
+						inFlight++;
+					}
+
+					// Empty files need no read at all
+					if (!PrepareBatch(*batch))
+						FinishBatch(std::move(batch), false);
+					else if (batch->size == 0)
+						FinishBatch(std::move(batch), true);
+					else if (!SubmitRead(*batch))
+						FinishBatch(std::move(batch), false);
+					else
+						batch.release();	// Owned by the kernel until it completes
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (quitting && inFlight == 0)
+						return;
+				}
+
+				// Sleep until a read finishes or Read() wakes us
+				RingEnter(0, 1);
+
+				unsigned int head = *ring.cqHead;
+				unsigned int tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+				for (; head != tail; head++)
+				{
+					io_uring_cqe cqe = ring.cqes[head & *ring.cqMask];
+					__atomic_store_n(ring.cqHead, head + 1, __ATOMIC_RELEASE);
+					if (cqe.user_data == WakeTag)
+					{
+						wakeQueued = false;
+						continue;
+					}
+
+					// Short reads carry on where they stopped
+					std::unique_ptr<Batch> batch((Batch*)(uintptr_t)cqe.user_data);
+					if (cqe.res <= 0)
+					{
+						FinishBatch(std::move(batch), false);
+						continue;
+					}
+
+					batch->read += (uint64_t)cqe.res;
+					if (batch->read >= batch->size)
+						FinishBatch(std::move(batch), true);
+					else if (!SubmitRead(*batch))
+						FinishBatch(std::move(batch), false);
+					else
+						batch.release();
+				}
+			}
+		}
+
+		void WakeRing()
+		{
+			if (!wakeQueued.exchange(true))
+				RingSubmit(IORING_OP_NOP, -1, 0, 0, 0, WakeTag);
+		}
+#endif
+
+		// --------------------------------------------------------
+		// Reads a request right away, for when nothing's running
+		// --------------------------------------------------------
+		void ReadNow(Request& request)
+		{
+			const Vfs::FileLocation& location = request.location;
+			Batch batch;
+			batch.path = location.path;
+			batch.packFile = location.pack != 0;
+			batch.offset = location.offset;
+			batch.size = location.size;
+			request.succeeded = PrepareBatch(batch) &&
+				ReadAt(batch.file, batch.offset, batch.buffer->data(), batch.size);
+			if (batch.ownsFile && batch.file != InvalidFile)
+				CloseFile(batch.file);
+
+			if (request.decode)
+				request.buffer = batch.buffer;
+			else if (request.succeeded)
+				request.data.swap(*batch.buffer);
+		}
+
+		RequestPtr NewRequest(Priority priority, double deadline, CompletionFunction done)
+		{
+			RequestPtr request = std::make_unique<Request>();
+			request->priority = priority;
+			request->deadline = deadline > 0.0 ? Now() + deadline : std::numeric_limits<double>::infinity();
+			request->done = std::move(done);
+			pending++;
+			return request;
+		}
+
+		// --------------------------------------------------------
+		// Queues a located request's read.  Memory files and
+		// missing files don't need reading, so they go straight
+		// to the ready list.
+		// --------------------------------------------------------
+		uint64_t Submit(RequestPtr request, bool found)
+		{
+			const Vfs::FileLocation& location = request->location;
+			if (found && !location.path)
+			{
+				request->data.assign(location.data + location.offset, location.data + location.offset + location.size);
+				request->succeeded = true;
+			}
+			else if (found && mode == Mode::Inline)
+			{
+				ReadNow(*request);
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			uint64_t ticket = nextTicket++;
+			request->ticket = ticket;
+			if (!found || !location.path || mode == Mode::Inline)
+			{
+				ready.push_back(std::move(request));
+				decodeWake.notify_one();
+				return ticket;
+			}
+
+			queue.push_back(std::move(request));
+			if (mode == Mode::Threads)
+				wake.notify_one();
+#if defined(__linux__)
+			else
+				WakeRing();
+#endif
+			return ticket;
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Starts the backend: io_uring if the kernel has it, or a
+// thread per read in flight otherwise - and the decode
+// threads either way
+//
+// maxInFlight - Reads (after coalescing) in flight at once
+// --------------------------------------------------------
+void IoScheduler::Initialize(unsigned int maxInFlight)
+{
+	if (maxInFlight == 0)
+		return;
+
+	inFlightLimit = maxInFlight;
+	quitting = false;
+
+#if defined(__linux__)
+	if (RingOpen(maxInFlight + 2))
+	{
+		mode = Mode::Ring;
+		threads.emplace_back(RingMain);
+	}
+	else
+#endif
+	{
+		mode = Mode::Threads;
+		for (unsigned int i = 0; i < maxInFlight; i++)
+			threads.emplace_back(ThreadMain);
+	}
+
+	// Started last, since completions can queue more reads
+	for (unsigned int i = 0; i < DecodeThreadCount; i++)
+		decodeThreads.emplace_back(DecodeMain);
+}
+
+void IoScheduler::ShutDown()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quitting = true;
+		queue.clear();
+	}
+	wake.notify_all();
+	decodeWake.notify_all();
+#if defined(__linux__)
+	if (mode == Mode::Ring)
+	{
+		wakeQueued = false;
+		WakeRing();
+	}
+#endif
+
+	for (std::thread& t : threads)
+		t.join();
+	threads.clear();
+	for (std::thread& t : decodeThreads)
+		t.join();
+	decodeThreads.clear();
+
+#if defined(__linux__)
+	if (mode == Mode::Ring)
+		RingClose();
+#endif
+
+	for (const OpenPack& pack : openPacks)
+		CloseFile(pack.file);
+	openPacks.clear();
+
+	// Completions still running may have queued more
+	queue.clear();
+	ready.clear();
+	finished = 0;
+	inFlight = 0;
+	pending = 0;
+	mode = Mode::Inline;
+}
+
+
+const char* IoScheduler::Backend()
+{
+	switch (mode)
+	{
+	case Mode::Ring: return "io_uring";
+	case Mode::Threads: return "threads";
+	default: return "inline";
+	}
+}
+
+
+// --------------------------------------------------------
+// Finds the file in the Vfs and queues its read
+// --------------------------------------------------------
+uint64_t IoScheduler::Read(const char* name, Priority priority, double deadline, CompletionFunction done)
+{
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Loading);
+
+	RequestPtr request = NewRequest(priority, deadline, std::move(done));
+	bool found = Vfs::Locate(name, request->location);
+	request->decode = request->location.pack != 0;
+	return Submit(std::move(request), found);
+}
+
+
+// --------------------------------------------------------
+// Narrows the file's location down to the range, so only
+// those bytes are read - except from compressed pack
+// entries, which are decoded whole and cut down after.
+// Ranges past the end of the file fail.
+// --------------------------------------------------------
+uint64_t IoScheduler::ReadRange(const char* name, uint64_t offset, uint64_t size, Priority priority, double deadline, CompletionFunction done)
+{
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Loading);
+
+	RequestPtr request = NewRequest(priority, deadline, std::move(done));
+	Vfs::FileLocation& location = request->location;
+	bool found = Vfs::Locate(name, location);
+	if (found && location.pack && (location.entry->flags & AssetPackFlags::Compressed))
+	{
+		found = offset <= location.entry->size && size <= location.entry->size - offset;
+		request->decode = true;
+		request->rangeOffset = offset;
+		request->rangeSize = size;
+	}
+	else if (found && location.size == Vfs::WholeFile)
+	{
+		// Loose files' reads just come up short
+		location.offset = offset;
+		location.size = size;
+	}
+	else if (found)
+	{
+		found = offset <= location.size && size <= location.size - offset;
+		location.offset += offset;
+		location.size = size;
+	}
+	return Submit(std::move(request), found);
+}
+
+
+bool IoScheduler::Cancel(uint64_t ticket)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (size_t i = 0; i < queue.size(); i++)
+	{
+		if (queue[i]->ticket == ticket)
+		{
+			Take(i);
+			pending--;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+// --------------------------------------------------------
+// Collects the count the decode threads left.  Without
+// them (before Initialize()), reads are completed here.
+// --------------------------------------------------------
+size_t IoScheduler::Update()
+{
+	std::vector<RequestPtr> reads;
+	size_t count = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		count = finished;
+		finished = 0;
+		if (decodeThreads.empty())
+			reads.swap(ready);
+	}
+
+	for (RequestPtr& request : reads)
+		Complete(*request);
+
+	count += reads.size();
+	pending -= count;
+	return count;
+}
+
+
+size_t IoScheduler::Pending()
+{
+	return pending;
+}
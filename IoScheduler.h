@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// --------------------------------------------------------
+// Asynchronous file reads, scheduled by priority and
+// deadline
+//
+// Reads are of files in the Vfs.  Queued reads start most
+// urgent first - overdue ones, then by priority, then by
+// earliest deadline - and only so many are in flight at
+// once, so a burst of streaming requests can't bury the
+// reads the next frame is waiting on.  Queued reads of
+// nearby ranges of one file (entries next to each other in
+// a pack, or the same file twice) become a single read.
+// Reads can be queued from any thread, completions included.
+//
+// On Linux reads go through io_uring; anywhere it isn't
+// available, a small pool of threads does blocking reads.
+//
+// A couple of decode threads take finished reads, most
+// urgent first, decompress pack entries and run the
+// completions, so the main thread never waits on either.
+// Completion functions run in parallel with each other and
+// with the main thread, and hand their results over through
+// their own locks.  Update() only counts what finished.
+//
+// Before Initialize() (or after ShutDown()) reads happen
+// right inside Read(), and complete in Update().
+//
+// Usage:
+//
+//   IoScheduler::Read("Sunflower.mesh", IoScheduler::Priority::High, 0.1,
+//       [](bool succeeded, std::vector<unsigned char>& data) { ... });
+//   ...
+//   IoScheduler::Update();	// Once per frame
+// --------------------------------------------------------
+namespace IoScheduler
+{
+	enum class Priority
+	{
+		Critical,
+		High,
+		Normal,
+		Low
+	};
+
+	// Runs on a decode thread with the (decompressed) bytes -
+	// or in Update(), when the scheduler isn't running
+	typedef std::function<void(bool succeeded, std::vector<unsigned char>& data)> CompletionFunction;
+
+	// maxInFlight - Reads (after coalescing) in flight at once
+	void Initialize(unsigned int maxInFlight);
+
+	// Drops queued reads, waits for those in flight and the
+	// completions already running, and drops the rest
+	void ShutDown();
+
+	// "io_uring", "threads", or "inline" when not running
+	const char* Backend();
+
+	// --------------------------------------------------------
+	// Queues a read, returning a ticket for Cancel()
+	//
+	// name     - File in the Vfs
+	// priority - Higher priorities start first
+	// deadline - Seconds from now the bytes are wanted by, or
+	//            0 for whenever.  Overdue reads go first.
+	// done     - Gets the bytes once they're read
+	// --------------------------------------------------------
+	uint64_t Read(const char* name, Priority priority, double deadline, CompletionFunction done);
+
+	// --------------------------------------------------------
+	// Queues a read of part of a file, like Read().  Only the
+	// range is read from loose files and stored pack entries;
+	// compressed entries still have to be read and decoded in
+	// full.  Reads past the end of the file fail.
+	//
+	// offset - First byte wanted, from the start of the file
+	// size   - Bytes wanted
+	// --------------------------------------------------------
+	uint64_t ReadRange(const char* name, uint64_t offset, uint64_t size, Priority priority, double deadline, CompletionFunction done);
+
+	// Drops a read that hasn't started yet, returning whether
+	// it was still queued.  Its completion never runs.
+	bool Cancel(uint64_t ticket);
+
+	// Returns how many completions ran since the last call
+	// (running them itself if the scheduler isn't).  Only
+	// call from one thread.
+	size_t Update();
+
+	// Reads not yet completed
+	size_t Pending();
+}
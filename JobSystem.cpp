@@ -0,0 +1,164 @@
+#include "JobSystem.h"
+#include "MemoryTracker.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace JobSystem
+{
+	// Annonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		std::vector<std::thread> workers;
+
+		// The loop currently being worked on
+		BatchFunction jobFunction = 0;
+		void* jobContext = 0;
+		unsigned int jobCount = 0;
+		unsigned int jobBatchSize = 1;
+		std::atomic<unsigned int> nextIndex = 0;
+		std::atomic<unsigned int> batchesRemaining = 0;
+
+		// Workers currently inside RunBatches(), which may still
+		// be reading the job after its last batch has finished
+		std::atomic<unsigned int> activeWorkers = 0;
+
+		// Workers sleep until the job generation changes
+		std::mutex wakeMutex;
+		std::condition_variable wakeCondition;
+		unsigned long long jobGeneration = 0;
+		bool quitting = false;
+
+		// --------------------------------------------------------
+		// Grabs and runs batches until the loop is exhausted
+		// --------------------------------------------------------
+		void RunBatches()
+		{
+			while (true)
+			{
+				unsigned int begin = nextIndex.fetch_add(jobBatchSize);
+				if (begin >= jobCount)
+					return;
+
+				unsigned int end = jobCount - begin < jobBatchSize ? jobCount : begin + jobBatchSize;
+				jobFunction(jobContext, begin, end);
+				batchesRemaining.fetch_sub(1, std::memory_order_release);
+			}
+		}
+
+		void WorkerMain()
+		{
+			unsigned long long seenGeneration = 0;
+			while (true)
+			{
+				{
+					std::unique_lock<std::mutex> lock(wakeMutex);
+					wakeCondition.wait(lock, [&]() { return quitting || jobGeneration != seenGeneration; });
+					if (quitting)
+						return;
+					seenGeneration = jobGeneration;
+					activeWorkers++;
+				}
+
+				RunBatches();
+				activeWorkers.fetch_sub(1, std::memory_order_release);
+			}
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Starts the worker threads
+//
+// workerCount - Extra threads to start, or 0 for one
+//               less than the number of hardware threads
+// --------------------------------------------------------
+void JobSystem::Initialize(unsigned int workerCount)
+{
+	if (!workers.empty())
+		return;
+
+	if (workerCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Jobs);
+	quitting = false;
+	workers.reserve(workerCount);
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers.emplace_back(WorkerMain);
+}
+
+
+// --------------------------------------------------------
+// Stops and joins every worker
+// --------------------------------------------------------
+void JobSystem::ShutDown()
+{
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		quitting = true;
+	}
+	wakeCondition.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+	workers.clear();
+}
+
+unsigned int JobSystem::ThreadCount() { return (unsigned int)workers.size() + 1; }
+
+
+// --------------------------------------------------------
+// Runs function over [0, count) in batches on every thread
+// and waits for all of them to finish
+//
+// count     - Number of items
+// batchSize - Items per call to function
+// function  - Called with (context, begin, end) per batch
+// context   - Passed through to function
+// --------------------------------------------------------
+void JobSystem::ParallelFor(unsigned int count, unsigned int batchSize, BatchFunction function, void* context)
+{
+	if (count == 0)
+		return;
+	if (batchSize == 0)
+		batchSize = 1;
+
+	// Not worth waking anyone for a single batch
+	if (workers.empty() || count <= batchSize)
+	{
+		function(context, 0, count);
+		return;
+	}
+
+	{
+		// Holding the lock keeps new workers out, so once the
+		// stragglers from the last loop leave it's safe to
+		// overwrite the job
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		while (activeWorkers.load(std::memory_order_acquire) > 0)
+			std::this_thread::yield();
+
+		jobFunction = function;
+		jobContext = context;
+		jobCount = count;
+		jobBatchSize = batchSize;
+		nextIndex = 0;
+		batchesRemaining = (count + batchSize - 1) / batchSize;
+		jobGeneration++;
+	}
+	wakeCondition.notify_all();
+
+	// Help out, then wait for stragglers
+	RunBatches();
+	while (batchesRemaining.load(std::memory_order_acquire) > 0)
+		std::this_thread::yield();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+// --------------------------------------------------------
+// Minimal worker thread pool for data-parallel loops
+//
+// ParallelFor() splits [0, count) into batches and runs
+// them across the workers and the calling thread, returning
+// once every batch is done.  The body is passed by pointer
+// (no std::function), so a parallel loop never allocates.
+//
+// Usage:
+//
+//   JobSystem::ParallelFor(count, 1024,
+//       [&](unsigned int begin, unsigned int end) { ... });
+//
+// Only one thread should issue ParallelFor() calls at a
+// time, and bodies must not call ParallelFor() themselves.
+// --------------------------------------------------------
+namespace JobSystem
+{
+	// workerCount - Extra threads to start, or 0 for one
+	//               less than the number of hardware threads
+	void Initialize(unsigned int workerCount);
+	void ShutDown();
+
+	// Worker threads plus the calling thread
+	unsigned int ThreadCount();
+
+	// Type-erased batch callback: context, begin, end
+	typedef void (*BatchFunction)(void*, unsigned int, unsigned int);
+	void ParallelFor(unsigned int count, unsigned int batchSize, BatchFunction function, void* context);
+
+	// Convenience wrapper for lambdas and other callables
+	template<typename Body>
+	void ParallelFor(unsigned int count, unsigned int batchSize, const Body& body)
+	{
+		ParallelFor(count, batchSize,
+			[](void* context, unsigned int begin, unsigned int end) { (*(const Body*)context)(begin, end); },
+			(void*)&body);
+	}
+}
@@ -0,0 +1,219 @@
+#include "LzCodec.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace LzCodec
+{
+	// Annonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		const size_t MinMatch = 4;
+		const size_t MaxOffset = 65535;
+		const unsigned int HashBits = 14;
+
+		uint32_t Read32(const unsigned char* p)
+		{
+			uint32_t value;
+			memcpy(&value, p, sizeof(value));
+			return value;
+		}
+
+		uint32_t Hash(uint32_t value)
+		{
+			return (value * 2654435761u) >> (32 - HashBits);
+		}
+
+		// Writes the extra bytes of a length that didn't fit in
+		// its nibble, returning false if there's no room
+		bool WriteLength(size_t length, unsigned char*& out, const unsigned char* end)
+		{
+			for (; length >= 255; length -= 255)
+			{
+				if (out >= end)
+					return false;
+				*out++ = 255;
+			}
+			if (out >= end)
+				return false;
+			*out++ = (unsigned char)length;
+			return true;
+		}
+
+		// Reads the extra bytes of a length, returning false if
+		// the input runs out first
+		bool ReadLength(size_t& length, const unsigned char*& in, const unsigned char* end)
+		{
+			unsigned char byte;
+			do
+			{
+				if (in >= end)
+					return false;
+				byte = *in++;
+				length += byte;
+			} while (byte == 255);
+			return true;
+		}
+
+		// --------------------------------------------------------
+		// Writes one sequence.  A match length of zero means it's
+		// the final, literals only sequence.
+		// --------------------------------------------------------
+		bool WriteSequence(
+			const unsigned char* literals, size_t literalCount,
+			size_t offset, size_t matchLength,
+			unsigned char*& out, const unsigned char* end)
+		{
+			if (out >= end)
+				return false;
+
+			unsigned char* token = out++;
+			*token = (unsigned char)((literalCount >= 15 ? 15 : literalCount) << 4);
+			if (literalCount >= 15 && !WriteLength(literalCount - 15, out, end))
+				return false;
+
+			if ((size_t)(end - out) < literalCount)
+				return false;
+			memcpy(out, literals, literalCount);
+			out += literalCount;
+
+			if (matchLength == 0)
+				return true;
+
+			if (end - out < 2)
+				return false;
+			*out++ = (unsigned char)(offset & 0xFF);
+			*out++ = (unsigned char)(offset >> 8);
+
+			size_t length = matchLength - MinMatch;
+			*token |= (unsigned char)(length >= 15 ? 15 : length);
+			return length < 15 || WriteLength(length - 15, out, end);
+		}
+	}
+}
+
+
+size_t LzCodec::MaxCompressedSize(size_t size)
+{
+	// One token plus length bytes around all-literal data
+	return size + size / 255 + 16;
+}
+
+
+// --------------------------------------------------------
+// Greedy compression with a single-entry hash table: each
+// position looks up the last position whose next four
+// bytes hashed the same, and takes the match if it's real
+//
+// source      - Data to compress
+// size        - Bytes of data
+// destination - Receives the compressed data
+// capacity    - Size of the destination
+// --------------------------------------------------------
+size_t LzCodec::Compress(const unsigned char* source, size_t size, unsigned char* destination, size_t capacity)
+{
+	unsigned char* out = destination;
+	const unsigned char* end = destination + capacity;
+
+	// Positions + 1, so zero means empty
+	std::vector<uint32_t> table((size_t)1 << HashBits, 0);
+
+	size_t literalStart = 0;
+	size_t i = 0;
+	while (i + MinMatch <= size)
+	{
+		uint32_t value = Read32(source + i);
+		uint32_t& entry = table[Hash(value)];
+		size_t candidate = entry;
+		entry = (uint32_t)(i + 1);
+
+		if (candidate == 0 || i - (candidate - 1) > MaxOffset || Read32(source + candidate - 1) != value)
+		{
+			i++;
+			continue;
+		}
+
+		size_t match = candidate - 1;
+		size_t length = MinMatch;
+		while (i + length < size && source[match + length] == source[i + length])
+			length++;
+
+		if (!WriteSequence(source + literalStart, i - literalStart, i - match, length, out, end))
+			return 0;
+
+		// Remember a position inside the match too, which helps
+		// on repetitive data without hashing every byte
+		if (i + length + MinMatch <= size && length > 2)
+			table[Hash(Read32(source + i + length - 2))] = (uint32_t)(i + length - 2 + 1);
+
+		i += length;
+		literalStart = i;
+	}
+
+	if (!WriteSequence(source + literalStart, size - literalStart, 0, 0, out, end))
+		return 0;
+	return out - destination;
+}
+
+
+// --------------------------------------------------------
+// Decompresses a block, checking every length and offset
+// against both buffers
+// --------------------------------------------------------
+bool LzCodec::Decompress(const unsigned char* source, size_t compressedSize, unsigned char* destination, size_t size)
+{
+	const unsigned char* in = source;
+	const unsigned char* inEnd = source + compressedSize;
+	unsigned char* out = destination;
+	unsigned char* outEnd = destination + size;
+
+	while (in < inEnd)
+	{
+		unsigned char token = *in++;
+
+		size_t literalCount = token >> 4;
+		if (literalCount == 15 && !ReadLength(literalCount, in, inEnd))
+			return false;
+		if ((size_t)(inEnd - in) < literalCount || (size_t)(outEnd - out) < literalCount)
+			return false;
+		memcpy(out, in, literalCount);
+		in += literalCount;
+		out += literalCount;
+
+		// The final sequence has no match
+		if (in == inEnd)
+			break;
+
+		if (inEnd - in < 2)
+			return false;
+		size_t offset = in[0] | (size_t)in[1] << 8;
+		in += 2;
+		if (offset == 0 || offset > (size_t)(out - destination))
+			return false;
+
+		size_t length = token & 15;
+		if (length == 15 && !ReadLength(length, in, inEnd))
+			return false;
+		length += MinMatch;
+		if ((size_t)(outEnd - out) < length)
+			return false;
+
+		// Overlapping matches repeat what they just wrote, so
+		// they have to go a byte at a time
+		const unsigned char* match = out - offset;
+		if (offset >= length)
+		{
+			memcpy(out, match, length);
+			out += length;
+		}
+		else
+		{
+			for (size_t i = 0; i < length; i++)
+				*out++ = match[i];
+		}
+	}
+
+	return out == outEnd;
+}
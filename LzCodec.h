@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+
+// --------------------------------------------------------
+// Small, self-contained LZ77 byte codec (LZ4-style)
+//
+// Compressed data is a list of sequences:
+//
+//   token       High nibble: literal count, low nibble:
+//               match length - 4 (15 = more in extra bytes,
+//               each adding up to 255)
+//   literals    Copied as is
+//   offset      2 bytes, little-endian, how far back the
+//               match starts (1..65535)
+//
+// The last sequence is literals only.  Matches may overlap
+// their own output, which is how runs are encoded.
+//
+// Meant for blocks of up to 64 KB that are decompressed
+// on their own; decompression never reads or writes
+// outside the buffers it's given, even for corrupt data.
+// --------------------------------------------------------
+namespace LzCodec
+{
+	// Worst case size of compressed data (incompressible input)
+	size_t MaxCompressedSize(size_t size);
+
+	// --------------------------------------------------------
+	// Compresses a block, returning the compressed size, or 0
+	// if it doesn't fit in the destination
+	// --------------------------------------------------------
+	size_t Compress(const unsigned char* source, size_t size, unsigned char* destination, size_t capacity);
+
+	// --------------------------------------------------------
+	// Decompresses a block, returning false if the data is
+	// corrupt or doesn't decompress to exactly size bytes
+	// --------------------------------------------------------
+	bool Decompress(const unsigned char* source, size_t compressedSize, unsigned char* destination, size_t size);
+}
@@ -2,10 +2,30 @@
 #include <Windows.h>
 #include <crtdbg.h>
 
+#include "AssetLoader.h"
+#include "AssetPack.h"
 #include "Window.h"
 #include "Graphics.h"
 #include "Game.h"
+#include "GpuUpload.h"
 #include "Input.h"
+#include "IoScheduler.h"
+#include "JobSystem.h"
+#include "Benchmark.h"
+#include "FlightRecorder.h"
+#include "FrameArena.h"
+#include "MemoryTracker.h"
+#include "MeshConverter.h"
+#include "MeshStreaming.h"
+#include "PathHelpers.h"
+#include "PipelineCache.h"
+#include "Resources.h"
+#include "ShaderHotReload.h"
+#include "ShaderPermutations.h"
+#include "Vfs.h"
+
+#include <string>
+#include <thread>
 
 // Annonymous namespace to hold variables
 // only accessible in this file
@@ -40,6 +60,11 @@ int WINAPI WinMain(
 	_In_ LPSTR lpCmdLine,				// Command line params
 	_In_ int nCmdShow)					// How the window should be shown (we ignore this)
 {
+	// Everything up to the first Present() counts towards
+	// the time to first frame
+	__int64 launchTime = 0;
+	QueryPerformanceCounter((LARGE_INTEGER*)&launchTime);
+
 #if defined(DEBUG) | defined(_DEBUG)
 	// Enable memory leak detection as a quick and dirty
 	// way of determining if we forgot to clean something up
@@ -50,6 +75,19 @@ int WINAPI WinMain(
 	printf("Console window created successfully.  Feel free to printf() here.\n");
 #endif
 
+	// Run the headless benchmark suite instead of the game?
+	std::string commandLine = lpCmdLine;
+	if (commandLine.find("-benchmark") != std::string::npos)
+		return Benchmark::Run(commandLine);
+
+	// Or convert a mesh to the binary format?
+	if (commandLine.find("-convert") != std::string::npos)
+		return MeshConverter::Run(commandLine);
+
+	// Or build an asset pack?
+	if (commandLine.find("-pack") != std::string::npos)
+		return AssetPacks::RunPacker(commandLine);
+
 	// Set up app initialization details
 	unsigned int windowWidth = 1280;
 	unsigned int windowHeight = 720;
@@ -80,12 +118,66 @@ int WINAPI WinMain(
 	if (FAILED(graphicsResult))
 		return graphicsResult;
 
+	// Mesh data is staged through a ring of 4 x 8 MB, so meshes
+	// can be created on any thread without waiting on the driver
+	GpuUpload::Initialize(8 * 1024 * 1024, 4);
+
 	// Initalize the input system, which requires the window handle
 	Input::Initialize(Window::Handle());
 
+	// Per-frame scratch memory for every thread
+	FrameArena::Initialize(4 * 1024 * 1024, true);
+
+	// Worker threads for parallel engine systems
+	JobSystem::Initialize(0);
+
+	// Streaming reads, a few at a time, decoded and completed
+	// on their own threads
+	IoScheduler::Initialize(8);
+
+	// Streamed meshes' LODs share this much video memory
+	MeshStreaming::Initialize(256ull * 1024 * 1024);
+
+	// Startup assets load in parallel: a couple of threads just
+	// for file reads, plus workers for decoding and compiling.
+	// "-serialload" keeps everything on this thread instead,
+	// to compare time to first frame.
+	bool serialLoad = commandLine.find("-serialload") != std::string::npos;
+	if (!serialLoad)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		AssetLoader::Initialize(2, hardwareThreads > 2 ? hardwareThreads - 1 : 2);
+	}
+
+	// Assets are found through the Vfs: the pack next to the
+	// .exe, if there is one, before loose files next to it
+	Vfs::MountDirectory("", GetExePath());
+	Vfs::MountArchive("", FixPath("assets.pack"));
+
+	// Shader permutations are compiled from the .hlsl sources
+	// (the current directory when running through VS) and
+	// cached next to the .exe
+	ShaderPermutations::Initialize(".", FixPath("ShaderCache"));
+
+	// Recreate every pipeline the last run used, so none
+	// have to be created on demand once the game is running
+	PipelineCache::Prewarm(FixPath(L"pipeline_cache.bin"));
+
 	// Now the game itself can be initialzied
 	game->Initialize();
 
+	// Watch the shaders the game registered, recompiling them
+	// in the background when they change.  Running through VS,
+	// the current directory is the project folder with the .hlsl
+	ShaderHotReload::Start(".");
+
+	// Keep the last few seconds of frame data around, dumping
+	// them next to the .exe whenever a frame takes too long
+	{
+		MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Profiling);
+		FlightRecorder::Initialize(1 << 16, 50.0f, 30, FixPath("").c_str());
+	}
+
 	// Time tracking
 	LARGE_INTEGER perfFreq{};
 	double perfSeconds = 0;
@@ -103,6 +195,7 @@ int WINAPI WinMain(
 	previousTime = startTime;
 
 	// Windows message loop (and our game loop)
+	bool firstFrame = true;
 	MSG msg = {};
 	while (msg.message != WM_QUIT)
 	{
@@ -122,6 +215,21 @@ int WINAPI WinMain(
 			float totalTime = (float)((currentTime - startTime) * perfSeconds);
 			previousTime = currentTime;
 
+			FlightRecorder::BeginFrame();
+			MemoryTracker::BeginFrame();
+
+			// Swap in shaders that finished compiling since last frame
+			if (ShaderHotReload::ApplyPending() > 0)
+				game->OnShadersReloaded();
+
+			// Create anything that finished loading since last frame
+			AssetLoader::Update();
+			IoScheduler::Update();
+			MeshStreaming::Update();
+
+			// Copy every staged upload into its buffer before drawing
+			GpuUpload::Flush();
+
 			// Calculate basic fps
 			Window::UpdateStats(totalTime);
 
@@ -132,18 +240,56 @@ int WINAPI WinMain(
 			game->Update(deltaTime, totalTime);
 			game->Draw(deltaTime, totalTime);
 
+			if (firstFrame)
+			{
+				__int64 firstFrameTime = 0;
+				QueryPerformanceCounter((LARGE_INTEGER*)&firstFrameTime);
+				double milliseconds = (firstFrameTime - launchTime) * perfSeconds * 1000.0;
+				printf("Time to first frame: %.2f ms (%s loading, %zu assets still loading)\n",
+					milliseconds, serialLoad ? "serial" : "parallel", AssetLoader::Pending());
+				FlightRecorder::RecordValue("Time to first frame (ms)", milliseconds);
+				firstFrame = false;
+			}
+
 			// Notify Input system about end of frame
 			Input::EndOfFrame();
 
+			// Everything allocated from the frame arenas is now dead
+			FrameArena::Reset();
+
+			// Destroy any resources the GPU is finished with
+			Resources::EndFrame();
+
 #if defined(DEBUG) || defined(_DEBUG)
 			// Print any graphics debug messages that occurred this frame
-			Graphics::PrintDebugMessages();
+			{
+				FLIGHT_ZONE("Graphics::PrintDebugMessages");
+				Graphics::PrintDebugMessages();
+			}
 #endif
+
+			// Count this frame's heap usage
+			MemoryTracker::EndFrame();
+			FlightRecorder::RecordValue("Frame allocations", (double)MemoryTracker::LastFrame().allocations);
+
+			FlightRecorder::EndFrame();
 		}
 	}
 
 	// Clean up
+	AssetLoader::ShutDown();
+	ShaderHotReload::ShutDown();
+	FlightRecorder::ShutDown();
 	delete game;
+	IoScheduler::ShutDown();
+	MeshStreaming::ShutDown();
+	PipelineCache::Save(FixPath(L"pipeline_cache.bin"));
+	PipelineCache::ShutDown();
+	Resources::ShutDown();
+	GpuUpload::ShutDown();
+	Vfs::UnmountAll();
+	JobSystem::ShutDown();
+	FrameArena::ShutDown();
 	Input::ShutDown();
 	Graphics::ShutDown();
 	return (HRESULT)msg.wParam;
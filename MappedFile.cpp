@@ -0,0 +1,105 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include "PathHelpers.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+
+// --------------------------------------------------------
+// Maps a file, replacing any file already mapped.  Empty
+// files fail to open, since there's nothing to map.
+//
+// path - Full or relative path of the file
+// --------------------------------------------------------
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+#if defined(_WIN32)
+	HANDLE fileHandle = CreateFileW(
+		NarrowToWide(path).c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		0,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		0);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	HANDLE mappingHandle = CreateFileMappingW(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+	void* view = mappingHandle ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : 0;
+	if (!view)
+	{
+		if (mappingHandle)
+			CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	file = fileHandle;
+	mapping = mappingHandle;
+	data = (const unsigned char*)view;
+	size = (size_t)fileSize.QuadPart;
+#else
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size <= 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	// The mapping holds its own reference to the file
+	void* view = mmap(0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED)
+		return false;
+
+	data = (const unsigned char*)view;
+	size = (size_t)info.st_size;
+#endif
+
+	return true;
+}
+
+
+void MappedFile::Close()
+{
+	if (!data)
+		return;
+
+#if defined(_WIN32)
+	UnmapViewOfFile(data);
+	CloseHandle(mapping);
+	CloseHandle(file);
+	mapping = 0;
+	file = 0;
+#else
+	munmap((void*)data, size);
+#endif
+
+	data = 0;
+	size = 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// --------------------------------------------------------
+// A whole file mapped read-only into memory
+//
+// Pages are read in by the OS as they're first touched, so
+// opening is cheap no matter how big the file is, and the
+// data can be handed to anything that wants a pointer
+// (like D3D11 initial buffer data) without copying it.
+// The mapping, and every pointer into it, is only valid
+// until Close() or destruction.
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	bool IsOpen() const { return data != 0; }
+	const unsigned char* Data() const { return data; }
+	size_t Size() const { return size; }
+
+private:
+	const unsigned char* data = 0;
+	size_t size = 0;
+
+#if defined(_WIN32)
+	void* file = 0;		// HANDLEs
+	void* mapping = 0;
+#endif
+};
@@ -0,0 +1,245 @@
+#include "MemoryTracker.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace MemoryTracker
+{
+	// Annonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		// Stored just before every tracked allocation so
+		// frees know how big the block was and who owns it
+		struct Header
+		{
+			void* raw;		// What malloc() actually returned
+			size_t size;	// What the caller asked for
+			Tag tag;
+		};
+
+		// Everything here must be constant-initialized, since
+		// operator new can run before any other static init
+		thread_local Tag currentTag = Tag::Untagged;
+
+		std::atomic<unsigned long long> totalAllocations[TagCount] = {};
+		std::atomic<unsigned long long> totalBytes[TagCount] = {};
+		std::atomic<long long> liveBytes[TagCount] = {};
+
+		std::atomic<unsigned long long> frameAllocations[TagCount] = {};
+		std::atomic<unsigned long long> frameBytes[TagCount] = {};
+
+		Counts lastFrame = {};
+		bool assertNoAllocations = false;
+		unsigned long long framesWithAllocations = 0;
+
+		const char* tagNames[TagCount] =
+		{
+			"Untagged",
+			"Geometry",
+			"Shaders",
+			"Graphics",
+			"UI",
+			"Window",
+			"Profiling",
+			"Benchmark",
+			"FrameArena",
+			"Strings",
+			"Jobs",
+			"Transforms",
+			"Entities",
+			"Loading",
+		};
+	}
+}
+
+
+// --------------------------------------------------------
+// Global operator new/delete replacements.  Every variant
+// funnels into Allocate() and Free(), so blocks from any
+// form of new can be released by any form of delete.
+// --------------------------------------------------------
+void* operator new(size_t size)
+{
+	void* memory = MemoryTracker::Allocate(size, 0, MemoryTracker::CurrentTag());
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	void* memory = MemoryTracker::Allocate(size, 0, MemoryTracker::CurrentTag());
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	void* memory = MemoryTracker::Allocate(size, (size_t)alignment, MemoryTracker::CurrentTag());
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	void* memory = MemoryTracker::Allocate(size, (size_t)alignment, MemoryTracker::CurrentTag());
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return MemoryTracker::Allocate(size, 0, MemoryTracker::CurrentTag()); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return MemoryTracker::Allocate(size, 0, MemoryTracker::CurrentTag()); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return MemoryTracker::Allocate(size, (size_t)alignment, MemoryTracker::CurrentTag()); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return MemoryTracker::Allocate(size, (size_t)alignment, MemoryTracker::CurrentTag()); }
+
+void operator delete(void* memory) noexcept { MemoryTracker::Free(memory); }
+void operator delete[](void* memory) noexcept { MemoryTracker::Free(memory); }
+void operator delete(void* memory, size_t) noexcept { MemoryTracker::Free(memory); }
+void operator delete[](void* memory, size_t) noexcept { MemoryTracker::Free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { MemoryTracker::Free(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { MemoryTracker::Free(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { MemoryTracker::Free(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { MemoryTracker::Free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { MemoryTracker::Free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { MemoryTracker::Free(memory); }
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept { MemoryTracker::Free(memory); }
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept { MemoryTracker::Free(memory); }
+
+
+// --------------------------------------------------------
+// Scoped tags - restores the previous tag on destruction
+// so tagged scopes can nest
+// --------------------------------------------------------
+MemoryTracker::ScopedTag::ScopedTag(Tag tag) : previous(currentTag) { currentTag = tag; }
+MemoryTracker::ScopedTag::~ScopedTag() { currentTag = previous; }
+
+const char* MemoryTracker::TagName(Tag tag) { return tagNames[(unsigned int)tag]; }
+MemoryTracker::Tag MemoryTracker::CurrentTag() { return currentTag; }
+
+
+// --------------------------------------------------------
+// Allocates and counts a block of memory
+//
+// size      - Bytes requested
+// alignment - Required alignment, or zero for the default
+// tag       - Subsystem to charge the allocation to
+// --------------------------------------------------------
+void* MemoryTracker::Allocate(size_t size, size_t alignment, Tag tag)
+{
+	if (alignment < alignof(std::max_align_t))
+		alignment = alignof(std::max_align_t);
+
+	// Room for the header plus enough slack to align the
+	// user's pointer, which always lands after the header
+	void* raw = malloc(size + sizeof(Header) + alignment);
+	if (!raw)
+		return 0;
+
+	uintptr_t address = (uintptr_t)raw + sizeof(Header);
+	address = (address + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+	Header* header = (Header*)address - 1;
+	header->raw = raw;
+	header->size = size;
+	header->tag = tag;
+
+	unsigned int t = (unsigned int)tag;
+	totalAllocations[t].fetch_add(1, std::memory_order_relaxed);
+	totalBytes[t].fetch_add(size, std::memory_order_relaxed);
+	liveBytes[t].fetch_add((long long)size, std::memory_order_relaxed);
+	frameAllocations[t].fetch_add(1, std::memory_order_relaxed);
+	frameBytes[t].fetch_add(size, std::memory_order_relaxed);
+
+	return (void*)address;
+}
+
+
+// --------------------------------------------------------
+// Releases a block from Allocate()
+// --------------------------------------------------------
+void MemoryTracker::Free(void* memory)
+{
+	if (!memory)
+		return;
+
+	Header* header = (Header*)memory - 1;
+	liveBytes[(unsigned int)header->tag].fetch_sub((long long)header->size, std::memory_order_relaxed);
+	free(header->raw);
+}
+
+
+// --------------------------------------------------------
+// Starts counting a new frame
+// --------------------------------------------------------
+void MemoryTracker::BeginFrame()
+{
+	for (unsigned int t = 0; t < TagCount; t++)
+	{
+		frameAllocations[t].store(0, std::memory_order_relaxed);
+		frameBytes[t].store(0, std::memory_order_relaxed);
+	}
+}
+
+
+// --------------------------------------------------------
+// Saves this frame's counts (see LastFrame()) and checks
+// them against the zero-allocation assertion
+// --------------------------------------------------------
+bool MemoryTracker::EndFrame()
+{
+	lastFrame = {};
+	for (unsigned int t = 0; t < TagCount; t++)
+	{
+		lastFrame.tagAllocations[t] = frameAllocations[t].exchange(0, std::memory_order_relaxed);
+		lastFrame.tagBytes[t] = frameBytes[t].exchange(0, std::memory_order_relaxed);
+		lastFrame.allocations += lastFrame.tagAllocations[t];
+		lastFrame.bytes += lastFrame.tagBytes[t];
+	}
+
+	if (assertNoAllocations && lastFrame.allocations > 0)
+	{
+		framesWithAllocations++;
+		return false;
+	}
+
+	return true;
+}
+
+const MemoryTracker::Counts& MemoryTracker::LastFrame() { return lastFrame; }
+
+
+// --------------------------------------------------------
+// Totals since the program started
+// --------------------------------------------------------
+MemoryTracker::Counts MemoryTracker::Totals()
+{
+	Counts totals = {};
+	for (unsigned int t = 0; t < TagCount; t++)
+	{
+		totals.tagAllocations[t] = totalAllocations[t].load(std::memory_order_relaxed);
+		totals.tagBytes[t] = totalBytes[t].load(std::memory_order_relaxed);
+		totals.allocations += totals.tagAllocations[t];
+		totals.bytes += totals.tagBytes[t];
+	}
+	return totals;
+}
+
+unsigned long long MemoryTracker::LiveBytes(Tag tag)
+{
+	long long bytes = liveBytes[(unsigned int)tag].load(std::memory_order_relaxed);
+	return bytes > 0 ? (unsigned long long)bytes : 0;
+}
+
+
+// --------------------------------------------------------
+// Zero-allocation assertions
+// --------------------------------------------------------
+void MemoryTracker::SetAssertNoAllocations(bool enabled) { assertNoAllocations = enabled; }
+bool MemoryTracker::GetAssertNoAllocations() { return assertNoAllocations; }
+unsigned long long MemoryTracker::FramesWithAllocations() { return framesWithAllocations; }
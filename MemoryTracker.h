@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+
+// --------------------------------------------------------
+// Global allocation tracking
+//
+// Every operator new/delete in the program goes through
+// this system (see the replacements in MemoryTracker.cpp),
+// and ImGui can be pointed at it too.  Allocations are
+// charged to whichever subsystem tag is active on the
+// calling thread, and counted both in total and per frame.
+//
+// Tagging a scope:
+//
+//   MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Geometry);
+//
+// Zero-allocation checks: with SetAssertNoAllocations(true),
+// EndFrame() returns false for any frame that allocated, so
+// steady-state frames can be verified to never hit the heap.
+// --------------------------------------------------------
+namespace MemoryTracker
+{
+	enum class Tag : unsigned char
+	{
+		Untagged,
+		Geometry,
+		Shaders,
+		Graphics,
+		UI,
+		Window,
+		Profiling,
+		Benchmark,
+		FrameArena,
+		Strings,
+		Jobs,
+		Transforms,
+		Entities,
+		Loading,
+
+		Count
+	};
+
+	const unsigned int TagCount = (unsigned int)Tag::Count;
+
+	// Allocation totals for one frame (or since startup)
+	struct Counts
+	{
+		unsigned long long allocations;
+		unsigned long long bytes;
+		unsigned long long tagAllocations[TagCount];
+		unsigned long long tagBytes[TagCount];
+	};
+
+	// Sets the calling thread's tag until it goes out of scope
+	class ScopedTag
+	{
+	public:
+		ScopedTag(Tag tag);
+		~ScopedTag();
+		ScopedTag(const ScopedTag&) = delete;
+		ScopedTag& operator=(const ScopedTag&) = delete;
+
+	private:
+		Tag previous;
+	};
+
+	const char* TagName(Tag tag);
+	Tag CurrentTag();
+
+	// Raw tracked allocation, for libraries with their own
+	// allocator hooks (ImGui, etc.)
+	void* Allocate(size_t size, size_t alignment, Tag tag);
+	void Free(void* memory);
+
+	// Frame boundaries, called once each per frame.  EndFrame()
+	// returns false if allocation assertions are on and the
+	// frame allocated anything.
+	void BeginFrame();
+	bool EndFrame();
+	const Counts& LastFrame();
+
+	// Running totals since startup
+	Counts Totals();
+	unsigned long long LiveBytes(Tag tag);
+
+	// Zero-allocation assertion mode
+	void SetAssertNoAllocations(bool enabled);
+	bool GetAssertNoAllocations();
+	unsigned long long FramesWithAllocations();
+}
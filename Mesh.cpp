@@ -1,11 +1,31 @@
 #include "Mesh.h"
+#include "GpuUpload.h"
 #include "Graphics.h"
+#include "MeshFile.h"
+
+#include <cmath>
 
 
 Mesh::Mesh(const char* name, Vertex* vertexArr, size_t vertexNum, unsigned int* indexArr, size_t indexNum) : 
-	name(name)
+	name(StringId::Intern(name))
+{
+	CreateBuffers(vertexArr, sizeof(Vertex), vertexNum, indexArr, indexNum);
+	CalculateBounds(vertexArr, vertexNum);
+}
+
+// The buffers are created right from the mapped pages, and
+// the bounds come from the file's header.  Every LOD's
+// indices are uploaded, but only LOD 0 is drawn.
+Mesh::Mesh(const char* name, const MeshFile& file) :
+	name(StringId::Intern(name))
 {
-	CreateBuffers(vertexArr, vertexNum, indexArr, indexNum);
+	const MeshFileHeader& header = file.Header();
+	CreateBuffers(file.Vertices(), header.vertexStride, header.vertexCount, file.Indices(), header.indexCount);
+	if (header.lodCount > 0)
+		indexNum = (int)file.Lods()[0].indexCount;
+
+	boundsCenter = header.sphereCenter;
+	boundsRadius = header.sphereRadius;
 }
 
 Mesh::~Mesh()
@@ -15,23 +35,29 @@ Mesh::~Mesh()
 
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer() { return vertexBuff; }
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer() { return indexBuff; }
-const char* Mesh::GetName() { return name; }
+const char* Mesh::GetName() { return name.GetString(); }
+StringId Mesh::GetNameId() { return name; }
+Math::Float3 Mesh::GetBoundsCenter() { return boundsCenter; }
+float Mesh::GetBoundsRadius() { return boundsRadius; }
 int Mesh::GetIndexCount() { return indexNum; }
 int Mesh::GetVertexCount() { return vertexNum; }
 
-void Mesh::CreateBuffers(Vertex* vertexArr, size_t vertexNum, unsigned int* indexArr, size_t indexNum)
+// The data is staged through the upload ring (when there's
+// room), so this doesn't wait on the driver and can run on
+// any thread.  The buffers get their contents in the next
+// GpuUpload::Flush(), and the mesh isn't drawn until then.
+void Mesh::CreateBuffers(const void* vertexData, unsigned int stride, size_t vertexNum, const unsigned int* indexArr, size_t indexNum)
 {
 	// Create the vertex buffer
 	D3D11_BUFFER_DESC vbd = {};
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * (UINT)vertexNum; // Number of vertices
+	vbd.ByteWidth = stride * (UINT)vertexNum; // Number of vertices
 	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	vbd.CPUAccessFlags = 0;
 	vbd.MiscFlags = 0;
 	vbd.StructureByteStride = 0;
-	D3D11_SUBRESOURCE_DATA initialVertexData = {};
-	initialVertexData.pSysMem = vertexArr;
-	Graphics::Device->CreateBuffer(&vbd, &initialVertexData, vertexBuff.GetAddressOf());
+	uint64_t vertexTicket = 0;
+	GpuUpload::CreateBuffer(vbd, vertexData, vertexBuff.GetAddressOf(), vertexTicket);
 
 	// Create the index buffer
 	D3D11_BUFFER_DESC ibd = {};
@@ -41,18 +67,41 @@ void Mesh::CreateBuffers(Vertex* vertexArr, size_t vertexNum, unsigned int* inde
 	ibd.CPUAccessFlags = 0;
 	ibd.MiscFlags = 0;
 	ibd.StructureByteStride = 0;
-	D3D11_SUBRESOURCE_DATA initialIndexData = {};
-	initialIndexData.pSysMem = indexArr;
-	Graphics::Device->CreateBuffer(&ibd, &initialIndexData, indexBuff.GetAddressOf());
+	uint64_t indexTicket = 0;
+	GpuUpload::CreateBuffer(ibd, indexArr, indexBuff.GetAddressOf(), indexTicket);
+	uploadTicket = vertexTicket > indexTicket ? vertexTicket : indexTicket;
 
 	// Save the counts
 	this->indexNum = (unsigned int)indexNum;
 	this->vertexNum = (unsigned int)vertexNum;
+	this->vertexStride = stride;
+}
+
+// Sphere around the center of the vertices' bounding box
+void Mesh::CalculateBounds(Vertex* vertexArr, size_t vertexNum)
+{
+	boundsCenter = Math::Float3(0, 0, 0);
+	boundsRadius = 0.0f;
+	if (vertexNum == 0)
+		return;
+
+	Math::AABB box = Math::AABBFromPoints(&vertexArr[0].Position, vertexNum, sizeof(Vertex));
+	boundsCenter = Math::Center(box);
+
+	Math::Vector center = Math::Load(boundsCenter);
+	Math::Vector radius = Math::Zero();
+	for (size_t i = 0; i < vertexNum; i++)
+		radius = Math::Max(radius, Math::Length3(Math::Subtract(Math::Load(vertexArr[i].Position), center)));
+	boundsRadius = Math::GetX(radius);
 }
 
 void Mesh::DrawBuff()
 {
-	UINT stride = sizeof(Vertex);
+	// Buffers still waiting for their upload are empty
+	if (!GpuUpload::IsSubmitted(uploadTicket))
+		return;
+
+	UINT stride = vertexStride;
 	UINT offset = 0;
 
 	Graphics::Context->IASetVertexBuffers(0, 1, vertexBuff.GetAddressOf(), &stride, &offset);
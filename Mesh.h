@@ -1,11 +1,17 @@
 #pragma once
 #include <d3d11.h>
 #include <wrl/client.h>
+#include <cstdint>
 #include "Vertex.h"
+#include "StringId.h"
+
+class MeshFile;
+
 class Mesh
 {
 public:
 	Mesh(const char* name, Vertex* vertexArr, size_t vertexNum, unsigned int* indexArr, size_t indexNum);
+	Mesh(const char* name, const MeshFile& file); // Straight from the mapped file - no parsing or copying
 	~Mesh();
 
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer(); // Returns the vertex buffer ComPtr
@@ -15,14 +21,24 @@ public:
 	void DrawBuff(); // Sets the buffersand draws using the correct number of indices
 		// Refer to Game::Draw() to see the code necessary for setting buffersand drawing
 
-	const char* GetName();
+	const char* GetName(); // For display - compare names with GetNameId()
+	StringId GetNameId();
+
+	// Local space bounding sphere around every vertex
+	Math::Float3 GetBoundsCenter();
+	float GetBoundsRadius();
 
 private:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuff;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuff;
 	int indexNum;
 	int vertexNum;
-	void CreateBuffers(Vertex* vertxArr, size_t vertexNum, unsigned int* indexArr, size_t indexNum);
-	const char* name;
+	unsigned int vertexStride;
+	uint64_t uploadTicket; // See GpuUpload
+	void CreateBuffers(const void* vertexData, unsigned int stride, size_t vertexNum, const unsigned int* indexArr, size_t indexNum);
+	StringId name;
+	Math::Float3 boundsCenter;
+	float boundsRadius;
+	void CalculateBounds(Vertex* vertexArr, size_t vertexNum);
 };
 
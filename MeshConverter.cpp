@@ -0,0 +1,240 @@
+#include "MeshConverter.h"
+#include "JobSystem.h"
+#include "MeshImporter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+// For the engine math library
+using namespace Math;
+
+namespace MeshConverter
+{
+	// Annonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		// Coarsest to finest clustering grids tried for LODs,
+		// in cells along the mesh's longest side
+		const unsigned int FinestLodGrid = 256;
+		const unsigned int CoarsestLodGrid = 4;
+		const unsigned int MaxLods = 8;
+
+		// A LOD is only kept if it's at most this fraction
+		// of the previous one's triangles
+		const float LodReduction = 0.75f;
+
+		float Distance(const Float3& a, const Float3& b)
+		{
+			float x = a.x - b.x, y = a.y - b.y, z = a.z - b.z;
+			return sqrtf(x * x + y * y + z * z);
+		}
+
+		// --------------------------------------------------------
+		// Simplifies by vertex clustering: every vertex in a grid
+		// cell is replaced by the first one found in it, and the
+		// triangles that collapse are dropped.  The vertex data
+		// stays shared, so a LOD is only a new index list.
+		//
+		// grid  - Cells along the longest side of the bounds
+		// error - Receives the largest distance a vertex moved
+		// --------------------------------------------------------
+		std::vector<unsigned int> Cluster(
+			const std::vector<Vertex>& vertices,
+			const std::vector<unsigned int>& indices,
+			const AABB& bounds,
+			unsigned int grid,
+			float& error)
+		{
+			float extent = std::max({
+				bounds.maximum.x - bounds.minimum.x,
+				bounds.maximum.y - bounds.minimum.y,
+				bounds.maximum.z - bounds.minimum.z });
+			float cellSize = extent > 0.0f ? extent / grid : 1.0f;
+
+			auto Cell = [&](float value, float minimum) {
+				return (uint64_t)std::min((unsigned int)((value - minimum) / cellSize), grid - 1);
+			};
+
+			std::unordered_map<uint64_t, unsigned int> representatives;
+			std::vector<unsigned int> remap(vertices.size());
+			error = 0.0f;
+			for (size_t i = 0; i < vertices.size(); i++)
+			{
+				const Float3& p = vertices[i].Position;
+				uint64_t key =
+					Cell(p.x, bounds.minimum.x) |
+					Cell(p.y, bounds.minimum.y) << 21 |
+					Cell(p.z, bounds.minimum.z) << 42;
+
+				unsigned int representative = representatives.emplace(key, (unsigned int)i).first->second;
+				remap[i] = representative;
+				error = std::max(error, Distance(p, vertices[representative].Position));
+			}
+
+			std::vector<unsigned int> simplified;
+			for (size_t i = 0; i + 2 < indices.size(); i += 3)
+			{
+				unsigned int a = remap[indices[i]];
+				unsigned int b = remap[indices[i + 1]];
+				unsigned int c = remap[indices[i + 2]];
+				if (a != b && b != c && a != c)
+					simplified.insert(simplified.end(), { a, b, c });
+			}
+			return simplified;
+		}
+
+		// --------------------------------------------------------
+		// Splits LOD 0 into runs of consecutive triangles, each
+		// with a bounding sphere.  Importers emit triangles in
+		// roughly spatial order, so consecutive runs make usable
+		// clusters without any reordering.
+		// --------------------------------------------------------
+		void BuildMeshlets(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, uint32_t indexCount, std::vector<Meshlet>& meshlets)
+		{
+			meshlets.clear();
+			uint32_t triangleCount = indexCount / 3;
+			for (uint32_t first = 0; first < triangleCount; first += MaxMeshletTriangles)
+			{
+				Meshlet meshlet = {};
+				meshlet.indexOffset = first * 3;
+				meshlet.triangleCount = std::min(MaxMeshletTriangles, triangleCount - first);
+
+				const unsigned int* tri = &indices[meshlet.indexOffset];
+				uint32_t count = meshlet.triangleCount * 3;
+
+				Float3 minimum = vertices[tri[0]].Position;
+				Float3 maximum = minimum;
+				for (uint32_t i = 1; i < count; i++)
+				{
+					const Float3& p = vertices[tri[i]].Position;
+					minimum = Float3(std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z));
+					maximum = Float3(std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z));
+				}
+
+				meshlet.center = Center(AABB{ minimum, maximum });
+				for (uint32_t i = 0; i < count; i++)
+					meshlet.radius = std::max(meshlet.radius, Distance(vertices[tri[i]].Position, meshlet.center));
+
+				meshlets.push_back(meshlet);
+			}
+		}
+	}
+}
+
+
+bool MeshConverter::WriteObj(const std::string& path, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	char line[192];
+	for (const Vertex& v : vertices)
+	{
+		snprintf(line, sizeof(line), "v %.9g %.9g %.9g %.9g %.9g %.9g\n",
+			v.Position.x, v.Position.y, v.Position.z, v.Color.x, v.Color.y, v.Color.z);
+		file << line;
+	}
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		file << "f " << indices[i] + 1 << " " << indices[i + 1] + 1 << " " << indices[i + 2] + 1 << "\n";
+
+	return (bool)file;
+}
+
+
+// --------------------------------------------------------
+// Computes bounds, LODs and meshlets for a mesh
+//
+// vertices - Vertex data, which must outlive contents
+// indices  - Triangle list of the full detail mesh
+// contents - Receives everything to write
+// --------------------------------------------------------
+void MeshConverter::Build(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, MeshFileContents& contents)
+{
+	contents.SetVertexFormat(VertexLayout);
+	contents.vertices = vertices.data();
+	contents.vertexCount = (uint32_t)vertices.size();
+	contents.indices = indices;
+	contents.lods.clear();
+	contents.meshlets.clear();
+
+	// Same bounds Mesh would have calculated itself
+	contents.bounds = AABB{ Float3(0, 0, 0), Float3(0, 0, 0) };
+	contents.sphereCenter = Float3(0, 0, 0);
+	contents.sphereRadius = 0.0f;
+	if (!vertices.empty())
+	{
+		contents.bounds = AABBFromPoints(&vertices[0].Position, vertices.size(), sizeof(Vertex));
+		contents.sphereCenter = Center(contents.bounds);
+		for (const Vertex& v : vertices)
+			contents.sphereRadius = std::max(contents.sphereRadius, Distance(v.Position, contents.sphereCenter));
+	}
+
+	contents.lods.push_back({ 0, (uint32_t)indices.size(), 0.0f, 0 });
+	uint32_t previousCount = (uint32_t)indices.size();
+	for (unsigned int grid = FinestLodGrid; grid >= CoarsestLodGrid && contents.lods.size() < MaxLods; grid /= 2)
+	{
+		float error = 0.0f;
+		std::vector<unsigned int> lod = Cluster(vertices, indices, contents.bounds, grid, error);
+		if (lod.empty() || lod.size() > previousCount * LodReduction)
+			continue;
+
+		contents.lods.push_back({ (uint32_t)contents.indices.size(), (uint32_t)lod.size(), error, 0 });
+		contents.indices.insert(contents.indices.end(), lod.begin(), lod.end());
+		previousCount = (uint32_t)lod.size();
+	}
+
+	BuildMeshlets(vertices, contents.indices, (uint32_t)indices.size(), contents.meshlets);
+}
+
+
+bool MeshConverter::Convert(const std::string& sourcePath, const std::string& meshPath)
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	if (!MeshImporter::Import(sourcePath, vertices, indices))
+		return false;
+
+	MeshFileContents contents;
+	Build(vertices, indices, contents);
+	if (!WriteMeshFile(meshPath, contents))
+		return false;
+
+	printf("Converted %s: %zu vertices, %zu triangles, %zu LODs, %zu meshlets\n",
+		sourcePath.c_str(), vertices.size(), indices.size() / 3, contents.lods.size(), contents.meshlets.size());
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Converts the file named on the command line
+//
+// commandLine - The full command line given to the app
+// --------------------------------------------------------
+int MeshConverter::Run(const std::string& commandLine)
+{
+	std::istringstream args(commandLine);
+	std::string arg, input, output;
+	while (args >> arg)
+	{
+		if (arg == "-convert")
+			args >> input >> output;
+	}
+
+	if (input.empty() || output.empty())
+	{
+		printf("Usage: -convert <in.obj|in.ply> <out.mesh>\n");
+		return 1;
+	}
+
+	// The importer parses on the job system
+	JobSystem::Initialize(0);
+	bool converted = Convert(input, output);
+	JobSystem::ShutDown();
+	return converted ? 0 : 1;
+}
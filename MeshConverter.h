@@ -0,0 +1,38 @@
+#pragma once
+
+#include "MeshFile.h"
+#include "Vertex.h"
+
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Offline conversion of source meshes into .mesh files
+//
+// Imports an OBJ or PLY (see MeshImporter), generates the
+// LOD chain and meshlets, and writes everything in the
+// layout MeshFile maps directly.  Launch the executable
+// with "-convert" to run it instead of the game, e.g.:
+//
+//   D3D11Starter.exe -convert Sunflower.obj Sunflower.mesh
+//   D3D11Starter.exe -convert Scan.ply Scan.mesh
+// --------------------------------------------------------
+namespace MeshConverter
+{
+	// Writes vertices (with colors) and triangles as OBJ text
+	bool WriteObj(const std::string& path, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+
+	// --------------------------------------------------------
+	// Fills in everything a .mesh file holds: the vertex
+	// format, bounds, LOD chain (indices of every LOD, back
+	// to back) and meshlets of LOD 0.  The vertex data is
+	// pointed to, not copied.
+	// --------------------------------------------------------
+	void Build(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, MeshFileContents& contents);
+
+	// Imports an OBJ or PLY and writes it out as a .mesh file
+	bool Convert(const std::string& sourcePath, const std::string& meshPath);
+
+	// Runs "-convert <in.obj|in.ply> <out.mesh>", returning zero on success
+	int Run(const std::string& commandLine);
+}
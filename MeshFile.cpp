@@ -0,0 +1,183 @@
+#include "MeshFile.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	uint64_t AlignUp(uint64_t value)
+	{
+		return (value + MeshFileAlignment - 1) & ~(uint64_t)(MeshFileAlignment - 1);
+	}
+
+	// Whether a table is aligned and lies entirely inside the file
+	bool TableFits(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize)
+	{
+		return offset % MeshFileAlignment == 0 &&
+			offset <= fileSize &&
+			count * elementSize <= fileSize - offset;
+	}
+}
+
+
+// --------------------------------------------------------
+// Maps a .mesh file and checks that it can be used in place
+//
+// path - Full or relative path of the file
+// --------------------------------------------------------
+bool MeshFile::Open(const std::string& path)
+{
+	Close();
+
+	if (!file.Open(path))
+	{
+		printf("Mesh file: unable to open %s\n", path.c_str());
+		return false;
+	}
+
+	if (!Use(file.Data(), file.Size()))
+	{
+		printf("Mesh file: %s is not a valid version %u mesh file\n", path.c_str(), MeshFileVersion);
+		file.Close();
+		return false;
+	}
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Uses a .mesh file that's already in memory
+//
+// data - Start of the file, 8 byte aligned or better
+// size - Size of the whole file
+// --------------------------------------------------------
+bool MeshFile::Open(const unsigned char* data, size_t size)
+{
+	Close();
+	return Use(data, size);
+}
+
+
+// --------------------------------------------------------
+// Checks that a .mesh file's tables can be used in place.
+// Index values aren't checked against the vertex count -
+// that'd mean touching every page of the file, and D3D11
+// already reads out-of-range vertices as zero.
+// --------------------------------------------------------
+bool MeshFile::Use(const unsigned char* data, size_t size)
+{
+	const MeshFileHeader* h = (const MeshFileHeader*)data;
+	if (size < sizeof(MeshFileHeader) ||
+		h->magic != MeshFileMagic ||
+		h->version != MeshFileVersion)
+		return false;
+
+	bool valid = h->fileSize == size &&
+		h->vertexStride > 0 &&
+		TableFits(h->elementsOffset, h->elementCount, sizeof(MeshFileElement), size) &&
+		TableFits(h->verticesOffset, h->vertexCount, h->vertexStride, size) &&
+		TableFits(h->indicesOffset, h->indexCount, sizeof(uint32_t), size) &&
+		TableFits(h->lodsOffset, h->lodCount, sizeof(MeshLod), size) &&
+		TableFits(h->meshletsOffset, h->meshletCount, sizeof(Meshlet), size);
+
+	// The small tables are cheap to check entry by entry
+	if (valid)
+	{
+		const MeshLod* lods = (const MeshLod*)(data + h->lodsOffset);
+		for (uint32_t i = 0; i < h->lodCount && valid; i++)
+			valid = (uint64_t)lods[i].indexOffset + lods[i].indexCount <= h->indexCount;
+
+		const Meshlet* meshlets = (const Meshlet*)(data + h->meshletsOffset);
+		for (uint32_t i = 0; i < h->meshletCount && valid; i++)
+			valid = (uint64_t)meshlets[i].indexOffset + meshlets[i].triangleCount * 3ull <= h->indexCount;
+	}
+	if (!valid)
+		return false;
+
+	this->data = data;
+	header = h;
+	return true;
+}
+
+void MeshFile::Close()
+{
+	header = 0;
+	data = 0;
+	file.Close();
+}
+
+
+// --------------------------------------------------------
+// Lays the contents out as a .mesh file.  Written under a
+// temporary name first, so a half-written file is never
+// mapped by something else.
+//
+// path     - File to write
+// contents - Data to write; a missing LOD table gets a
+//            single LOD covering every index
+// --------------------------------------------------------
+bool WriteMeshFile(const std::string& path, const MeshFileContents& contents)
+{
+	std::vector<MeshLod> lods = contents.lods;
+	if (lods.empty())
+		lods.push_back({ 0, (uint32_t)contents.indices.size(), 0.0f, 0 });
+
+	MeshFileHeader header = {};
+	header.magic = MeshFileMagic;
+	header.version = MeshFileVersion;
+	header.vertexCount = contents.vertexCount;
+	header.vertexStride = contents.vertexStride;
+	header.indexCount = (uint32_t)contents.indices.size();
+	header.elementCount = (uint32_t)contents.elements.size();
+	header.lodCount = (uint32_t)lods.size();
+	header.meshletCount = (uint32_t)contents.meshlets.size();
+	header.bounds = contents.bounds;
+	header.sphereCenter = contents.sphereCenter;
+	header.sphereRadius = contents.sphereRadius;
+
+	uint64_t offset = AlignUp(sizeof(MeshFileHeader));
+	header.elementsOffset = offset;
+	offset = AlignUp(offset + contents.elements.size() * sizeof(MeshFileElement));
+	header.verticesOffset = offset;
+	offset = AlignUp(offset + (uint64_t)contents.vertexCount * contents.vertexStride);
+	header.indicesOffset = offset;
+	offset = AlignUp(offset + contents.indices.size() * sizeof(uint32_t));
+	header.lodsOffset = offset;
+	offset = AlignUp(offset + lods.size() * sizeof(MeshLod));
+	header.meshletsOffset = offset;
+	header.fileSize = offset + contents.meshlets.size() * sizeof(Meshlet);
+
+	// Build the whole file in memory, padding included
+	std::vector<char> data((size_t)header.fileSize, 0);
+	memcpy(data.data(), &header, sizeof(header));
+	if (!contents.elements.empty())
+		memcpy(&data[header.elementsOffset], contents.elements.data(), contents.elements.size() * sizeof(MeshFileElement));
+	if (contents.vertexCount > 0)
+		memcpy(&data[header.verticesOffset], contents.vertices, (size_t)contents.vertexCount * contents.vertexStride);
+	if (!contents.indices.empty())
+		memcpy(&data[header.indicesOffset], contents.indices.data(), contents.indices.size() * sizeof(uint32_t));
+	memcpy(&data[header.lodsOffset], lods.data(), lods.size() * sizeof(MeshLod));
+	if (!contents.meshlets.empty())
+		memcpy(&data[header.meshletsOffset], contents.meshlets.data(), contents.meshlets.size() * sizeof(Meshlet));
+
+	std::string temp = path + ".tmp";
+	{
+		std::ofstream file(temp, std::ios::binary);
+		if (!file.write(data.data(), data.size()))
+		{
+			printf("Mesh file: unable to write %s\n", path.c_str());
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temp, path, error);
+	if (error)
+	{
+		printf("Mesh file: unable to write %s\n", path.c_str());
+		std::filesystem::remove(temp, error);
+		return false;
+	}
+	return true;
+}
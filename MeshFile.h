@@ -0,0 +1,189 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "SimdMath.h"
+#include "VertexFormat.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Binary mesh container (.mesh), built to be used straight
+// out of a memory mapping
+//
+// Layout, every table starting on a MeshFileAlignment
+// boundary so it can be used in place:
+//
+//   MeshFileHeader
+//   MeshFileElement[elementCount]	Vertex format
+//   vertex data [vertexCount * vertexStride]
+//   uint32_t indices[indexCount]	Every LOD's indices, back to back
+//   MeshLod[lodCount]				Index range per LOD, finest first
+//   Meshlet[meshletCount]			Triangle clusters of LOD 0
+//
+// All values are little-endian.  Opening only checks the
+// header and that every table lies inside the file - the
+// data itself is never parsed or copied.
+//
+// Usage:
+//
+//   MeshFile file;
+//   if (file.Open("Sunflower.mesh") && file.Matches(VertexLayout))
+//       Mesh mesh("Sunflower", file);
+// --------------------------------------------------------
+
+const uint32_t MeshFileMagic = 0x4853454D;	// "MESH"
+const uint32_t MeshFileVersion = 1;
+const uint32_t MeshFileAlignment = 64;
+
+struct MeshFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t fileSize;
+
+	uint32_t vertexCount;
+	uint32_t vertexStride;
+	uint32_t indexCount;
+	uint32_t elementCount;
+	uint32_t lodCount;
+	uint32_t meshletCount;
+
+	// Local space bounds around every vertex
+	Math::AABB bounds;
+	Math::Float3 sphereCenter;
+	float sphereRadius;
+
+	// Byte offsets of each table from the start of the file
+	uint64_t elementsOffset;
+	uint64_t verticesOffset;
+	uint64_t indicesOffset;
+	uint64_t lodsOffset;
+	uint64_t meshletsOffset;
+};
+
+struct MeshFileElement
+{
+	char semantic[16];		// Null terminated
+	uint32_t semanticIndex;
+	uint32_t type;			// VertexAttributeType
+	uint32_t offset;
+	uint32_t reserved;
+};
+
+// A level of detail: a range of the index table drawn with
+// the shared vertex data
+struct MeshLod
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	float error;			// Largest distance a vertex moved
+	uint32_t reserved;
+};
+
+// A run of up to MaxMeshletTriangles triangles of LOD 0,
+// with a bounding sphere for culling
+struct Meshlet
+{
+	uint32_t indexOffset;
+	uint32_t triangleCount;
+	Math::Float3 center;
+	float radius;
+};
+
+const uint32_t MaxMeshletTriangles = 124;
+
+static_assert(sizeof(MeshFileHeader) == 120, "Mesh file header layout changed");
+static_assert(sizeof(MeshFileElement) == 32, "Mesh file element layout changed");
+static_assert(sizeof(MeshLod) == 16, "Mesh LOD layout changed");
+static_assert(sizeof(Meshlet) == 24, "Meshlet layout changed");
+
+
+// --------------------------------------------------------
+// Read-only view of a memory mapped .mesh file.  Every
+// pointer it returns points into the mapping.
+// --------------------------------------------------------
+class MeshFile
+{
+public:
+	bool Open(const std::string& path);
+
+	// Uses a .mesh file that's already in memory (like a stored
+	// asset pack entry), which must outlive this
+	bool Open(const unsigned char* data, size_t size);
+	void Close();
+	bool IsOpen() const { return header != 0; }
+
+	const MeshFileHeader& Header() const { return *header; }
+	const MeshFileElement* Elements() const { return (const MeshFileElement*)(data + header->elementsOffset); }
+	const void* Vertices() const { return data + header->verticesOffset; }
+	const uint32_t* Indices() const { return (const uint32_t*)(data + header->indicesOffset); }
+	const MeshLod* Lods() const { return (const MeshLod*)(data + header->lodsOffset); }
+	const Meshlet* Meshlets() const { return (const Meshlet*)(data + header->meshletsOffset); }
+
+	// Whether the vertex data can be used with a format as is
+	template<size_t N>
+	bool Matches(const VertexFormat<N>& format) const
+	{
+		if (!header || header->elementCount != N || header->vertexStride != format.strides[0])
+			return false;
+
+		const MeshFileElement* elements = Elements();
+		for (size_t i = 0; i < N; i++)
+		{
+			const VertexElement& e = format.elements[i];
+			if (e.stream != 0 || e.perInstance ||
+				strncmp(elements[i].semantic, e.semantic, sizeof(elements[i].semantic)) != 0 ||
+				elements[i].semanticIndex != e.semanticIndex ||
+				elements[i].type != (uint32_t)e.type ||
+				elements[i].offset != e.offset)
+				return false;
+		}
+		return true;
+	}
+
+private:
+	bool Use(const unsigned char* data, size_t size);
+
+	MappedFile file;
+	const unsigned char* data = 0;
+	const MeshFileHeader* header = 0;
+};
+
+
+// --------------------------------------------------------
+// Everything that goes into a .mesh file, as plain arrays
+// --------------------------------------------------------
+struct MeshFileContents
+{
+	const void* vertices;
+	uint32_t vertexCount;
+	uint32_t vertexStride;
+	std::vector<MeshFileElement> elements;
+	std::vector<uint32_t> indices;
+	std::vector<MeshLod> lods;
+	std::vector<Meshlet> meshlets;
+	Math::AABB bounds;
+	Math::Float3 sphereCenter;
+	float sphereRadius;
+
+	template<size_t N>
+	void SetVertexFormat(const VertexFormat<N>& format)
+	{
+		elements.clear();
+		vertexStride = format.strides[0];
+		for (const VertexElement& e : format.elements)
+		{
+			MeshFileElement element = {};
+			strncpy(element.semantic, e.semantic, sizeof(element.semantic) - 1);
+			element.semanticIndex = e.semanticIndex;
+			element.type = (uint32_t)e.type;
+			element.offset = e.offset;
+			elements.push_back(element);
+		}
+	}
+};
+
+bool WriteMeshFile(const std::string& path, const MeshFileContents& contents);
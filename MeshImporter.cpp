@@ -0,0 +1,915 @@
+#include "MeshImporter.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// For the engine math library
+using namespace Math;
+
+namespace MeshImporter
+{
+	// Annonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		// Text is split into chunks of about this many bytes
+		const size_t ChunkSize = 1024 * 1024;
+
+		// Welding splits vertices into this many hash shards
+		const unsigned int WeldShards = 64;
+
+		// --------------------------------------------------------
+		// Runs body(begin, end) over [0, count) chunks, spread
+		// across the JobSystem or all on this thread
+		// --------------------------------------------------------
+		template<typename Body>
+		void ForEachChunk(unsigned int count, bool parallel, const Body& body)
+		{
+			if (parallel)
+				JobSystem::ParallelFor(count, 1, body);
+			else
+				body(0, count);
+		}
+
+		// --------------------------------------------------------
+		// Cuts text into pieces of roughly ChunkSize bytes, each
+		// ending just after a newline (or at the end)
+		// --------------------------------------------------------
+		std::vector<const char*> SplitLines(const char* text, size_t size)
+		{
+			std::vector<const char*> bounds = { text };
+			const char* end = text + size;
+			while (end - bounds.back() > (ptrdiff_t)ChunkSize)
+			{
+				const char* split = bounds.back() + ChunkSize;
+				const char* newline = (const char*)memchr(split, '\n', end - split);
+				if (!newline)
+					break;
+				bounds.push_back(newline + 1);
+			}
+			bounds.push_back(end);
+			return bounds;
+		}
+
+		const char* LineEnd(const char* p, const char* end)
+		{
+			const char* newline = (const char*)memchr(p, '\n', end - p);
+			return newline ? newline : end;
+		}
+
+		const char* SkipSpaces(const char* p, const char* end)
+		{
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+				p++;
+			return p;
+		}
+
+		bool IsDigit(char c)
+		{
+			return (unsigned char)(c - '0') < 10;
+		}
+
+		// --------------------------------------------------------
+		// Eight ASCII digits at once, packed little-endian in a
+		// 64 bit register (first character in the lowest byte)
+		// --------------------------------------------------------
+		bool IsEightDigits(uint64_t chunk)
+		{
+			return (((chunk & 0xF0F0F0F0F0F0F0F0ull) |
+				(((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ==
+				0x3333333333333333ull);
+		}
+
+		uint32_t ParseEightDigits(uint64_t chunk)
+		{
+			chunk = (chunk & 0x0F0F0F0F0F0F0F0Full) * 2561 >> 8;
+			chunk = (chunk & 0x00FF00FF00FF00FFull) * 6553601 >> 16;
+			return (uint32_t)((chunk & 0x0000FFFF0000FFFFull) * 42949672960001ull >> 32);
+		}
+
+		// Accumulates a run of digits, returning how many there were
+		size_t ParseDigits(const char*& p, const char* end, uint64_t& value)
+		{
+			const char* start = p;
+			while (end - p >= 8)
+			{
+				uint64_t chunk;
+				memcpy(&chunk, p, sizeof(chunk));
+				if (!IsEightDigits(chunk))
+					break;
+				value = value * 100000000 + ParseEightDigits(chunk);
+				p += 8;
+			}
+			while (p < end && IsDigit(*p))
+				value = value * 10 + (*p++ - '0');
+			return p - start;
+		}
+
+		// --------------------------------------------------------
+		// Parses an integer after any spaces.  Returns the
+		// position after it, or the original position if there's
+		// no number there.
+		// --------------------------------------------------------
+		const char* ParseInt(const char* p, const char* end, int64_t& value)
+		{
+			const char* start = p;
+			p = SkipSpaces(p, end);
+
+			bool negative = p < end && *p == '-';
+			if (p < end && (*p == '-' || *p == '+'))
+				p++;
+
+			uint64_t magnitude = 0;
+			if (ParseDigits(p, end, magnitude) == 0 || magnitude > INT64_MAX)
+				return start;
+
+			value = negative ? -(int64_t)magnitude : (int64_t)magnitude;
+			return p;
+		}
+
+		// --------------------------------------------------------
+		// Parses a decimal float after any spaces.  Values with up
+		// to 19 significant digits and a small exponent are
+		// computed exactly in double precision (then rounded to
+		// float); anything else goes through strtod().  Returns
+		// the position after the number, or the original position
+		// if there's no number there.
+		// --------------------------------------------------------
+		const char* ParseFloat(const char* p, const char* end, float& value)
+		{
+			static const double powersOf10[] = {
+				1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+				1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+			const char* start = p;
+			p = SkipSpaces(p, end);
+			const char* number = p;
+
+			bool negative = p < end && *p == '-';
+			if (p < end && (*p == '-' || *p == '+'))
+				p++;
+
+			uint64_t mantissa = 0;
+			size_t digits = ParseDigits(p, end, mantissa);
+			int64_t exponent = 0;
+			if (p < end && *p == '.')
+			{
+				p++;
+				size_t fraction = ParseDigits(p, end, mantissa);
+				digits += fraction;
+				exponent -= (int64_t)fraction;
+			}
+			if (digits == 0)
+				return start;
+
+			// Only take the 'e' if digits follow it
+			if (p < end && (*p == 'e' || *p == 'E'))
+			{
+				int64_t power = 0;
+				const char* after = ParseInt(p + 1, end, power);
+				if (after != p + 1 && !isspace((unsigned char)p[1]))
+				{
+					exponent += power;
+					p = after;
+				}
+			}
+
+			if (digits <= 19 && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+			{
+				double result = (double)mantissa;
+				result = exponent < 0 ? result / powersOf10[-exponent] : result * powersOf10[exponent];
+				value = (float)(negative ? -result : result);
+				return p;
+			}
+
+			// Too many digits to be exact - let the library do it
+			std::string token(number, p);
+			value = (float)strtod(token.c_str(), 0);
+			return p;
+		}
+
+		// FNV-1a over every byte of a vertex
+		uint64_t HashVertex(const Vertex& v)
+		{
+			uint64_t value = 14695981039346656037ull;
+			const unsigned char* bytes = (const unsigned char*)&v;
+			for (size_t i = 0; i < sizeof(Vertex); i++)
+			{
+				value ^= bytes[i];
+				value *= 1099511628211ull;
+			}
+			return value;
+		}
+
+		// One corner of an OBJ face, before it's known how many
+		// vertices came before its chunk
+		struct ObjCorner
+		{
+			int32_t index;		// 0-based, from the chunk's start if relative
+			uint32_t relative;
+		};
+
+		struct ObjChunk
+		{
+			std::vector<Vertex> vertices;
+			std::vector<ObjCorner> corners;	// Triangles
+			bool failed = false;
+		};
+
+		// --------------------------------------------------------
+		// Parses one chunk of an OBJ.  Negative indices count back
+		// from the chunk's own vertices so far, and are made
+		// absolute once every chunk's vertex count is known.
+		// --------------------------------------------------------
+		void ParseObjChunk(const char* p, const char* end, ObjChunk& chunk)
+		{
+			std::vector<ObjCorner> face;
+			while (p < end)
+			{
+				const char* lineEnd = LineEnd(p, end);
+				p = SkipSpaces(p, lineEnd);
+
+				if (lineEnd - p > 1 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+				{
+					Vertex v = { Float3(0, 0, 0), Float4(1, 1, 1, 1) };
+					p = ParseFloat(p + 1, lineEnd, v.Position.x);
+					p = ParseFloat(p, lineEnd, v.Position.y);
+					p = ParseFloat(p, lineEnd, v.Position.z);
+
+					// Optional "r g b" after the position
+					const char* color = ParseFloat(p, lineEnd, v.Color.x);
+					if (color != p)
+					{
+						color = ParseFloat(color, lineEnd, v.Color.y);
+						ParseFloat(color, lineEnd, v.Color.z);
+					}
+					chunk.vertices.push_back(v);
+				}
+				else if (lineEnd - p > 1 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+				{
+					face.clear();
+					p++;
+					while (true)
+					{
+						int64_t index = 0;
+						const char* after = ParseInt(p, lineEnd, index);
+						if (after == p)
+							break;
+
+						if (index > 0 && index <= INT32_MAX)
+							face.push_back({ (int32_t)(index - 1), 0 });
+						else if (index < 0 && index >= INT32_MIN)
+							face.push_back({ (int32_t)((int64_t)chunk.vertices.size() + index), 1 });
+						else
+							chunk.failed = true;
+
+						// Skip "/vt/vn"
+						p = after;
+						while (p < lineEnd && *p != ' ' && *p != '\t' && *p != '\r')
+							p++;
+					}
+
+					for (size_t i = 2; i < face.size(); i++)
+						chunk.corners.insert(chunk.corners.end(), { face[0], face[i - 1], face[i] });
+				}
+
+				p = lineEnd + 1;
+			}
+		}
+
+
+		// --------------------------------------------------------
+		// PLY
+		// --------------------------------------------------------
+		enum class PlyType { None, Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+		enum class PlyFormat { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+		struct PlyProperty
+		{
+			std::string name;
+			PlyType type;
+			PlyType countType;	// None unless it's a list
+		};
+
+		struct PlyElement
+		{
+			std::string name;
+			size_t count;
+			std::vector<PlyProperty> properties;
+		};
+
+		// Where the vertex properties we use are, -1 if missing
+		struct PlyVertexLayout
+		{
+			int position[3] = { -1, -1, -1 };
+			int color[4] = { -1, -1, -1, -1 };
+		};
+
+		PlyType ParsePlyType(const std::string& name)
+		{
+			if (name == "char" || name == "int8") return PlyType::Int8;
+			if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+			if (name == "short" || name == "int16") return PlyType::Int16;
+			if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+			if (name == "int" || name == "int32") return PlyType::Int32;
+			if (name == "uint" || name == "uint32") return PlyType::UInt32;
+			if (name == "float" || name == "float32") return PlyType::Float32;
+			if (name == "double" || name == "float64") return PlyType::Float64;
+			return PlyType::None;
+		}
+
+		size_t PlyTypeSize(PlyType type)
+		{
+			switch (type)
+			{
+			case PlyType::Int8: case PlyType::UInt8: return 1;
+			case PlyType::Int16: case PlyType::UInt16: return 2;
+			case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+			case PlyType::Float64: return 8;
+			default: return 0;
+			}
+		}
+
+		// Colors stored as integers are 0..255
+		float PlyColorScale(PlyType type)
+		{
+			return type == PlyType::Float32 || type == PlyType::Float64 ? 1.0f : 1.0f / 255.0f;
+		}
+
+		// Reads one binary value, byte swapping if needed
+		double ReadPlyValue(const unsigned char* p, PlyType type, bool swap)
+		{
+			unsigned char bytes[8];
+			size_t size = PlyTypeSize(type);
+			for (size_t i = 0; i < size; i++)
+				bytes[i] = swap ? p[size - 1 - i] : p[i];
+
+			switch (type)
+			{
+			case PlyType::Int8: { int8_t v; memcpy(&v, bytes, 1); return v; }
+			case PlyType::UInt8: return bytes[0];
+			case PlyType::Int16: { int16_t v; memcpy(&v, bytes, 2); return v; }
+			case PlyType::UInt16: { uint16_t v; memcpy(&v, bytes, 2); return v; }
+			case PlyType::Int32: { int32_t v; memcpy(&v, bytes, 4); return v; }
+			case PlyType::UInt32: { uint32_t v; memcpy(&v, bytes, 4); return v; }
+			case PlyType::Float32: { float v; memcpy(&v, bytes, 4); return v; }
+			case PlyType::Float64: { double v; memcpy(&v, bytes, 8); return v; }
+			default: return 0.0;
+			}
+		}
+
+		// --------------------------------------------------------
+		// Reads the header, returning the offset of the body or
+		// zero if the header isn't one we understand
+		// --------------------------------------------------------
+		size_t ParsePlyHeader(const char* text, size_t size, PlyFormat& format, std::vector<PlyElement>& elements)
+		{
+			const char* end = text + size;
+			const char* p = text;
+			bool formatFound = false;
+			bool first = true;
+			while (p < end)
+			{
+				const char* lineEnd = LineEnd(p, end);
+				std::string line(p, lineEnd);
+				if (!line.empty() && line.back() == '\r')
+					line.pop_back();
+				p = lineEnd + 1;
+
+				char word[64] = {}, a[64] = {}, b[64] = {}, c[64] = {};
+				int words = sscanf(line.c_str(), "%63s %63s %63s %63s", word, a, b, c);
+				if (first)
+				{
+					if (words != 1 || strcmp(word, "ply") != 0)
+						return 0;
+					first = false;
+				}
+				else if (words < 1 || strcmp(word, "comment") == 0 || strcmp(word, "obj_info") == 0)
+				{
+					continue;
+				}
+				else if (strcmp(word, "format") == 0 && words >= 2)
+				{
+					formatFound = true;
+					if (strcmp(a, "ascii") == 0) format = PlyFormat::Ascii;
+					else if (strcmp(a, "binary_little_endian") == 0) format = PlyFormat::BinaryLittleEndian;
+					else if (strcmp(a, "binary_big_endian") == 0) format = PlyFormat::BinaryBigEndian;
+					else return 0;
+				}
+				else if (strcmp(word, "element") == 0 && words == 3)
+				{
+					elements.push_back({ a, (size_t)strtoull(b, 0, 10), {} });
+				}
+				else if (strcmp(word, "property") == 0 && !elements.empty())
+				{
+					PlyProperty property;
+					if (strcmp(a, "list") == 0 && words == 4)
+					{
+						// "property list <count type> <value type> <name>"
+						char name[64] = {};
+						if (sscanf(line.c_str(), "%*s %*s %*s %*s %63s", name) != 1)
+							return 0;
+						property = { name, ParsePlyType(c), ParsePlyType(b) };
+						if (property.countType == PlyType::None)
+							return 0;
+					}
+					else if (words == 3)
+						property = { b, ParsePlyType(a), PlyType::None };
+					else
+						return 0;
+
+					if (property.type == PlyType::None)
+						return 0;
+					elements.back().properties.push_back(property);
+				}
+				else if (strcmp(word, "end_header") == 0)
+				{
+					return formatFound ? p - text : 0;
+				}
+			}
+			return 0;
+		}
+
+		PlyVertexLayout FindPlyVertexLayout(const PlyElement& element)
+		{
+			static const char* positionNames[] = { "x", "y", "z" };
+			static const char* colorNames[] = { "red", "green", "blue", "alpha" };
+
+			PlyVertexLayout layout;
+			for (size_t i = 0; i < element.properties.size(); i++)
+			{
+				const PlyProperty& property = element.properties[i];
+				if (property.countType != PlyType::None)
+					continue;
+				for (int c = 0; c < 3; c++)
+					if (property.name == positionNames[c])
+						layout.position[c] = (int)i;
+				for (int c = 0; c < 4; c++)
+					if (property.name == colorNames[c])
+						layout.color[c] = (int)i;
+			}
+			return layout;
+		}
+
+		// Index of a face element's index list, -1 if it has none
+		int FindPlyIndexList(const PlyElement& element)
+		{
+			for (size_t i = 0; i < element.properties.size(); i++)
+			{
+				const PlyProperty& property = element.properties[i];
+				if (property.countType != PlyType::None &&
+					(property.name == "vertex_indices" || property.name == "vertex_index"))
+					return (int)i;
+			}
+			return -1;
+		}
+
+		// Fills a vertex from its properties' values
+		void SetPlyVertex(Vertex& v, const double* values, const PlyElement& element, const PlyVertexLayout& layout)
+		{
+			v = { Float3(0, 0, 0), Float4(1, 1, 1, 1) };
+			float* position = &v.Position.x;
+			float* color = &v.Color.x;
+			for (int c = 0; c < 3; c++)
+				if (layout.position[c] >= 0)
+					position[c] = (float)values[layout.position[c]];
+			for (int c = 0; c < 4; c++)
+				if (layout.color[c] >= 0)
+					color[c] = (float)values[layout.color[c]] * PlyColorScale(element.properties[layout.color[c]].type);
+		}
+
+		// Fan triangulates a polygon onto a triangle list
+		void AddPolygon(const std::vector<int64_t>& polygon, std::vector<int64_t>& triangles)
+		{
+			for (size_t i = 2; i < polygon.size(); i++)
+				triangles.insert(triangles.end(), { polygon[0], polygon[i - 1], polygon[i] });
+		}
+
+		// --------------------------------------------------------
+		// ASCII PLY: chunks count their lines first, so each one
+		// knows which element its lines belong to, then parse
+		// --------------------------------------------------------
+		bool ImportAsciiPly(
+			const char* body, size_t size,
+			const std::vector<PlyElement>& elements,
+			std::vector<Vertex>& vertices,
+			std::vector<int64_t>& triangles,
+			bool parallel)
+		{
+			std::vector<const char*> bounds = SplitLines(body, size);
+			unsigned int chunkCount = (unsigned int)bounds.size() - 1;
+
+			std::vector<size_t> firstLines(chunkCount + 1, 0);
+			ForEachChunk(chunkCount, parallel, [&](unsigned int begin, unsigned int end) {
+				for (unsigned int c = begin; c < end; c++)
+				{
+					size_t lines = 0;
+					for (const char* p = bounds[c]; p < bounds[c + 1]; p = LineEnd(p, bounds[c + 1]) + 1)
+						lines++;
+					firstLines[c + 1] = lines;
+				}
+			});
+			for (unsigned int c = 0; c < chunkCount; c++)
+				firstLines[c + 1] += firstLines[c];
+
+			// Line ranges of every element
+			std::vector<size_t> elementLines = { 0 };
+			for (const PlyElement& element : elements)
+				elementLines.push_back(elementLines.back() + element.count);
+			if (firstLines.back() < elementLines.back())
+				return false;
+
+			struct Chunk
+			{
+				std::vector<int64_t> triangles;
+				bool failed = false;
+			};
+			std::vector<Chunk> chunks(chunkCount);
+
+			std::vector<PlyVertexLayout> layouts;
+			std::vector<int> indexLists;
+			for (const PlyElement& e : elements)
+			{
+				layouts.push_back(FindPlyVertexLayout(e));
+				indexLists.push_back(e.name == "face" ? FindPlyIndexList(e) : -1);
+			}
+
+			ForEachChunk(chunkCount, parallel, [&](unsigned int begin, unsigned int end) {
+				std::vector<double> values;
+				std::vector<int64_t> polygon;
+				for (unsigned int c = begin; c < end; c++)
+				{
+					size_t line = firstLines[c];
+					size_t element = std::upper_bound(elementLines.begin(), elementLines.end(), line) - elementLines.begin() - 1;
+					for (const char* p = bounds[c]; p < bounds[c + 1] && element < elements.size(); line++)
+					{
+						const char* lineEnd = LineEnd(p, bounds[c + 1]);
+						while (element < elements.size() && line >= elementLines[element + 1])
+							element++;
+						if (element >= elements.size())
+							break;
+
+						const PlyElement& e = elements[element];
+						int indexList = indexLists[element];
+						values.assign(e.properties.size(), 0.0);
+						for (size_t i = 0; i < e.properties.size() && !chunks[c].failed; i++)
+						{
+							const PlyProperty& property = e.properties[i];
+							if (property.countType == PlyType::None)
+							{
+								float value = 0.0f;
+								const char* after = ParseFloat(p, lineEnd, value);
+								chunks[c].failed = after == p;
+								values[i] = value;
+								p = after;
+								continue;
+							}
+
+							int64_t count = 0;
+							const char* after = ParseInt(p, lineEnd, count);
+							chunks[c].failed = after == p || count < 0;
+							p = after;
+
+							polygon.clear();
+							for (int64_t n = 0; n < count && !chunks[c].failed; n++)
+							{
+								int64_t index = 0;
+								after = ParseInt(p, lineEnd, index);
+								chunks[c].failed = after == p;
+								polygon.push_back(index);
+								p = after;
+							}
+							if ((int)i == indexList)
+								AddPolygon(polygon, chunks[c].triangles);
+						}
+
+						if (e.name == "vertex")
+							SetPlyVertex(vertices[line - elementLines[element]], values.data(), e, layouts[element]);
+						p = lineEnd + 1;
+					}
+				}
+			});
+
+			for (Chunk& chunk : chunks)
+			{
+				if (chunk.failed)
+					return false;
+				triangles.insert(triangles.end(), chunk.triangles.begin(), chunk.triangles.end());
+			}
+			return true;
+		}
+
+		// --------------------------------------------------------
+		// Binary PLY: fixed-size vertices are decoded in parallel
+		// straight from their offsets.  Elements containing lists
+		// have to be walked, so they're read on this thread.
+		// --------------------------------------------------------
+		bool ImportBinaryPly(
+			const unsigned char* body, size_t size,
+			const std::vector<PlyElement>& elements,
+			bool swap,
+			std::vector<Vertex>& vertices,
+			std::vector<int64_t>& triangles,
+			bool parallel)
+		{
+			const unsigned char* p = body;
+			const unsigned char* end = body + size;
+			std::vector<double> values;
+			std::vector<int64_t> polygon;
+
+			for (const PlyElement& e : elements)
+			{
+				bool fixedSize = true;
+				size_t stride = 0;
+				for (const PlyProperty& property : e.properties)
+				{
+					fixedSize = fixedSize && property.countType == PlyType::None;
+					stride += PlyTypeSize(property.type);
+				}
+
+				if (fixedSize)
+				{
+					if (stride != 0 && e.count > (size_t)(end - p) / stride)
+						return false;
+
+					if (e.name == "vertex")
+					{
+						PlyVertexLayout layout = FindPlyVertexLayout(e);
+						std::vector<size_t> offsets;
+						for (size_t i = 0, offset = 0; i < e.properties.size(); offset += PlyTypeSize(e.properties[i].type), i++)
+							offsets.push_back(offset);
+
+						const unsigned char* first = p;
+						const unsigned int batch = 65536;
+						unsigned int batches = (unsigned int)((e.count + batch - 1) / batch);
+						ForEachChunk(batches, parallel, [&](unsigned int begin, unsigned int end) {
+							std::vector<double> vertexValues(e.properties.size());
+							for (size_t v = (size_t)begin * batch; v < std::min(e.count, (size_t)end * batch); v++)
+							{
+								const unsigned char* data = first + v * stride;
+								for (size_t i = 0; i < e.properties.size(); i++)
+									vertexValues[i] = ReadPlyValue(data + offsets[i], e.properties[i].type, swap);
+								SetPlyVertex(vertices[v], vertexValues.data(), e, layout);
+							}
+						});
+					}
+
+					p += e.count * stride;
+					continue;
+				}
+
+				int indexList = e.name == "face" ? FindPlyIndexList(e) : -1;
+				for (size_t n = 0; n < e.count; n++)
+				{
+					for (size_t i = 0; i < e.properties.size(); i++)
+					{
+						const PlyProperty& property = e.properties[i];
+						size_t valueSize = PlyTypeSize(property.type);
+						if (property.countType == PlyType::None)
+						{
+							if ((size_t)(end - p) < valueSize)
+								return false;
+							p += valueSize;
+							continue;
+						}
+
+						size_t countSize = PlyTypeSize(property.countType);
+						if ((size_t)(end - p) < countSize)
+							return false;
+						double count = ReadPlyValue(p, property.countType, swap);
+						p += countSize;
+						if (count < 0 || (size_t)count > (size_t)(end - p) / valueSize)
+							return false;
+
+						if ((int)i != indexList)
+						{
+							p += (size_t)count * valueSize;
+							continue;
+						}
+
+						polygon.clear();
+						for (size_t v = 0; v < (size_t)count; v++, p += valueSize)
+							polygon.push_back((int64_t)ReadPlyValue(p, property.type, swap));
+						AddPolygon(polygon, triangles);
+					}
+				}
+			}
+			return true;
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Maps a file and imports it based on its extension
+//
+// path     - An .obj or .ply file
+// vertices - Receives the (welded) vertices
+// indices  - Receives a triangle list
+// options  - Threading and welding
+// --------------------------------------------------------
+bool MeshImporter::Import(const std::string& path, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, const Options& options)
+{
+	std::string extension = path.substr(std::min(path.size(), path.find_last_of('.')));
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+	if (extension != ".obj" && extension != ".ply")
+	{
+		printf("Mesh importer: %s is not an .obj or .ply file\n", path.c_str());
+		return false;
+	}
+
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		printf("Mesh importer: unable to open %s\n", path.c_str());
+		return false;
+	}
+
+	bool imported = extension == ".obj" ?
+		ImportObj((const char*)file.Data(), file.Size(), vertices, indices, options) :
+		ImportPly(file.Data(), file.Size(), vertices, indices, options);
+	if (!imported)
+		printf("Mesh importer: %s is malformed or has out of range indices\n", path.c_str());
+	return imported;
+}
+
+
+bool MeshImporter::ImportObj(const char* text, size_t size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, const Options& options)
+{
+	vertices.clear();
+	indices.clear();
+
+	std::vector<const char*> bounds = SplitLines(text, size);
+	unsigned int chunkCount = (unsigned int)bounds.size() - 1;
+	std::vector<ObjChunk> chunks(chunkCount);
+	ForEachChunk(chunkCount, options.parallel, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int c = begin; c < end; c++)
+			ParseObjChunk(bounds[c], bounds[c + 1], chunks[c]);
+	});
+
+	// Where each chunk's vertices start
+	std::vector<size_t> vertexStarts(chunkCount + 1, 0);
+	std::vector<size_t> indexStarts(chunkCount + 1, 0);
+	for (unsigned int c = 0; c < chunkCount; c++)
+	{
+		if (chunks[c].failed)
+			return false;
+		vertexStarts[c + 1] = vertexStarts[c] + chunks[c].vertices.size();
+		indexStarts[c + 1] = indexStarts[c] + chunks[c].corners.size();
+	}
+	if (vertexStarts.back() == 0 || vertexStarts.back() > UINT32_MAX)
+		return false;
+
+	vertices.resize(vertexStarts.back());
+	indices.resize(indexStarts.back());
+	std::vector<char> failed(chunkCount, 0);
+	ForEachChunk(chunkCount, options.parallel, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int c = begin; c < end; c++)
+		{
+			std::copy(chunks[c].vertices.begin(), chunks[c].vertices.end(), vertices.begin() + vertexStarts[c]);
+
+			for (size_t i = 0; i < chunks[c].corners.size(); i++)
+			{
+				const ObjCorner& corner = chunks[c].corners[i];
+				int64_t index = corner.relative ? (int64_t)vertexStarts[c] + corner.index : corner.index;
+				failed[c] |= index < 0 || index >= (int64_t)vertices.size();
+				indices[indexStarts[c] + i] = (unsigned int)index;
+			}
+		}
+	});
+	if (std::find(failed.begin(), failed.end(), 1) != failed.end())
+		return false;
+
+	if (options.weld)
+		Weld(vertices, indices, options.parallel);
+	return true;
+}
+
+
+bool MeshImporter::ImportPly(const unsigned char* data, size_t size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, const Options& options)
+{
+	vertices.clear();
+	indices.clear();
+
+	PlyFormat format = PlyFormat::Ascii;
+	std::vector<PlyElement> elements;
+	size_t bodyOffset = ParsePlyHeader((const char*)data, size, format, elements);
+	if (bodyOffset == 0)
+		return false;
+
+	size_t vertexCount = 0;
+	for (const PlyElement& e : elements)
+		if (e.name == "vertex")
+			vertexCount = e.count;
+	if (vertexCount == 0 || vertexCount > UINT32_MAX || vertexCount > size)
+		return false;
+
+	vertices.resize(vertexCount);
+	std::vector<int64_t> triangles;
+	bool parsed = format == PlyFormat::Ascii ?
+		ImportAsciiPly((const char*)data + bodyOffset, size - bodyOffset, elements, vertices, triangles, options.parallel) :
+		ImportBinaryPly(data + bodyOffset, size - bodyOffset, elements, format == PlyFormat::BinaryBigEndian, vertices, triangles, options.parallel);
+	if (!parsed)
+		return false;
+
+	indices.resize(triangles.size());
+	for (size_t i = 0; i < triangles.size(); i++)
+	{
+		if (triangles[i] < 0 || triangles[i] >= (int64_t)vertexCount)
+			return false;
+		indices[i] = (unsigned int)triangles[i];
+	}
+
+	if (options.weld)
+		Weld(vertices, indices, options.parallel);
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Merges identical vertices
+//
+// vertices - Vertices to weld, compacted in place
+// indices  - Rewritten to point at the welded vertices
+// parallel - Process the hash shards on the JobSystem
+// --------------------------------------------------------
+void MeshImporter::Weld(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, bool parallel)
+{
+	unsigned int count = (unsigned int)vertices.size();
+	std::vector<uint64_t> hashes(count);
+	ForEachChunk((count + 65535) / 65536, parallel, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin * 65536; i < std::min(count, end * 65536); i++)
+			hashes[i] = HashVertex(vertices[i]);
+	});
+
+	// Vertices only ever match others in the same shard (the
+	// top 6 bits of the hash), and each shard's list stays in
+	// vertex order
+	std::vector<std::vector<unsigned int>> shards(WeldShards);
+	for (unsigned int i = 0; i < count; i++)
+		shards[hashes[i] >> 58].push_back(i);
+
+	// Every vertex points at the first one identical to it
+	std::vector<unsigned int> firsts(count);
+	ForEachChunk(WeldShards, parallel, [&](unsigned int begin, unsigned int end) {
+		std::vector<unsigned int> table;
+		for (unsigned int s = begin; s < end; s++)
+		{
+			// Open addressing, at most half full
+			size_t capacity = 16;
+			while (capacity < shards[s].size() * 2)
+				capacity *= 2;
+			table.assign(capacity, UINT32_MAX);
+
+			for (unsigned int i : shards[s])
+			{
+				size_t slot = hashes[i] & (capacity - 1);
+				while (true)
+				{
+					unsigned int other = table[slot];
+					if (other == UINT32_MAX)
+					{
+						table[slot] = i;
+						firsts[i] = i;
+						break;
+					}
+					if (hashes[other] == hashes[i] && memcmp(&vertices[other], &vertices[i], sizeof(Vertex)) == 0)
+					{
+						firsts[i] = other;
+						break;
+					}
+					slot = (slot + 1) & (capacity - 1);
+				}
+			}
+		}
+	});
+
+	// Compact, keeping the first of each in order
+	std::vector<unsigned int> remap(count);
+	unsigned int welded = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (firsts[i] == i)
+		{
+			vertices[welded] = vertices[i];
+			remap[i] = welded++;
+		}
+		else
+		{
+			remap[i] = remap[firsts[i]];
+		}
+	}
+	vertices.resize(welded);
+
+	unsigned int indexCount = (unsigned int)indices.size();
+	ForEachChunk((indexCount + 65535) / 65536, parallel, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin * 65536; i < std::min(indexCount, end * 65536); i++)
+			indices[i] = remap[indices[i]];
+	});
+}
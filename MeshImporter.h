@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Imports OBJ and PLY meshes into Vertex/index arrays that
+// can be handed straight to Mesh
+//
+// The file is memory mapped and cut into chunks at line
+// boundaries, and the chunks are parsed in parallel on the
+// JobSystem.  Numbers are parsed eight digits at a time
+// (SWAR) instead of through strtof(), which only handles
+// the rare long or huge-exponent values.  Afterwards,
+// vertices with identical position and color are welded
+// into one, so meshes that repeat vertices per face (like
+// most scans) come out properly indexed.
+//
+// Supported:
+//   OBJ - "v x y z [r g b]" and "f" lines (fan triangulated,
+//         negative and "v/vt/vn" indices).  Everything else
+//         is skipped.
+//   PLY - ascii, binary_little_endian and binary_big_endian;
+//         vertex x/y/z and red/green/blue/alpha of any scalar
+//         type, and face vertex_indices lists.
+//
+// Like every ParallelFor() user, call it from one thread at
+// a time - the converter, or the main thread while loading.
+//
+// Usage:
+//
+//   std::vector<Vertex> vertices;
+//   std::vector<unsigned int> indices;
+//   if (MeshImporter::Import("Scan.ply", vertices, indices))
+//       Mesh mesh("Scan", vertices.data(), vertices.size(), indices.data(), indices.size());
+// --------------------------------------------------------
+namespace MeshImporter
+{
+	struct Options
+	{
+		bool parallel = true;	// Parse chunks on the JobSystem
+		bool weld = true;		// Merge identical vertices
+	};
+
+	// Imports by file extension (.obj or .ply)
+	bool Import(const std::string& path, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, const Options& options = Options());
+
+	// Imports from data already in memory
+	bool ImportObj(const char* text, size_t size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, const Options& options = Options());
+	bool ImportPly(const unsigned char* data, size_t size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, const Options& options = Options());
+
+	// --------------------------------------------------------
+	// Merges vertices that are bit-for-bit identical, keeping
+	// the first of each in its original order and rewriting
+	// the indices to match
+	// --------------------------------------------------------
+	void Weld(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, bool parallel = true);
+}
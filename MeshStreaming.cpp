@@ -0,0 +1,604 @@
+#include "MeshStreaming.h"
+#include "IoScheduler.h"
+#include "MemoryTracker.h"
+#include "MeshFile.h"
+#include "Vertex.h"
+#include "Vfs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Annonymous namespace to hold variables
+// only accessible in this file
+namespace
+{
+	// LODs are tracked with a bit each per read
+	const unsigned int MaxLods = 64;
+
+	struct Lod
+	{
+		MeshLod range;
+		uint64_t bytes;			// Estimated until it's resident
+		MeshHandle mesh;		// Null unless resident
+		uint64_t lastUsed;		// Frame it was last drawn
+		bool loading;
+		bool failed;			// Never asked for again
+	};
+
+	struct StreamedMesh
+	{
+		std::string name;
+		std::string path;
+		uint32_t vertexCount;
+		uint64_t verticesOffset;	// Of the tables in the file
+		uint64_t indicesOffset;
+		Math::Float3 boundsCenter;
+		float boundsRadius;
+		std::vector<Lod> lods;	// Finest first
+
+		uint64_t lastUsed;		// Frame Use() was last called
+		unsigned int wantedLod;	// Finest any Use() wanted that frame
+		unsigned int reads;		// LODs still loading
+	};
+
+	// A LOD's mesh, built on an IoScheduler decode thread (its
+	// buffers staged through GpuUpload), waiting for Update()
+	// to add it to Resources
+	struct BuiltLod
+	{
+		uint64_t session;
+		StreamedMeshId id;
+		unsigned int lod;
+		std::unique_ptr<Mesh> mesh;		// Null if it failed
+	};
+
+	struct EvictionCandidate
+	{
+		uint64_t lastUsed;
+		StreamedMeshId id;
+		unsigned int lod;
+	};
+
+	std::vector<StreamedMesh> meshes;	// Indexed by id - 1
+	std::vector<StreamedMeshId> used;	// Meshes Use()d this frame
+	std::vector<EvictionCandidate> candidates;
+
+	uint64_t budget = 0;
+	uint64_t residentBytes = 0;
+	uint64_t loadingBytes = 0;
+	uint64_t frame = 1;
+
+	// Resident LODs drawn (or just loaded) this frame, which
+	// can't be evicted
+	uint64_t protectedBytes = 0;
+
+	// Reads still in flight across a ShutDown() finish into
+	// an old session, and are dropped without building
+	std::atomic<uint64_t> session = 1;
+
+	std::mutex builtMutex;
+	std::vector<BuiltLod> built;
+	std::vector<BuiltLod> finishing;
+
+	StreamedMesh* Find(StreamedMeshId id)
+	{
+		return id > 0 && id <= meshes.size() ? &meshes[id - 1] : 0;
+	}
+
+	// A LOD can't use more vertices than it has indices
+	uint64_t EstimateBytes(const MeshLod& range, uint32_t vertexCount)
+	{
+		uint64_t vertices = range.indexCount < vertexCount ? range.indexCount : vertexCount;
+		return vertices * sizeof(Vertex) + range.indexCount * (uint64_t)sizeof(unsigned int);
+	}
+
+
+	// --------------------------------------------------------
+	// Copies just the vertices a LOD's indices use, renumbering
+	// the indices to match, so a coarse LOD doesn't keep every
+	// vertex of the finest one in video memory
+	//
+	// lodIndices  - The LOD's range of the index table
+	// source      - The vertices from firstVertex on, as many
+	//               as vertexSpan
+	// --------------------------------------------------------
+	bool CompactLod(const uint32_t* lodIndices, uint32_t indexCount, const Vertex* source, uint32_t firstVertex, uint32_t vertexSpan,
+		std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		std::vector<uint32_t> remap(vertexSpan, UINT32_MAX);
+		indices.resize(indexCount);
+		for (uint32_t i = 0; i < indexCount; i++)
+		{
+			uint32_t index = lodIndices[i] - firstVertex;
+			if (lodIndices[i] < firstVertex || index >= vertexSpan)
+				return false;
+
+			if (remap[index] == UINT32_MAX)
+			{
+				remap[index] = (uint32_t)vertices.size();
+				vertices.push_back(source[index]);
+			}
+			indices[i] = remap[index];
+		}
+		return true;
+	}
+
+
+	// --------------------------------------------------------
+	// Releases resident LODs that weren't drawn last frame,
+	// least recently drawn first, until the given bytes fit
+	// in the budget
+	//
+	// bytes   - About to be loaded
+	// partial - Evict what can be evicted even if it won't be
+	//           enough.  Otherwise nothing is evicted unless
+	//           the bytes will fit afterwards.
+	//
+	// Returns whether the bytes fit now
+	// --------------------------------------------------------
+	bool MakeRoom(uint64_t bytes, bool partial)
+	{
+		uint64_t committed = residentBytes + loadingBytes + bytes;
+		if (committed <= budget)
+			return true;
+		uint64_t needed = committed - budget;
+		if (residentBytes - protectedBytes < needed && !partial)
+			return false;
+
+		// Only happens when eviction will help, so scanning every
+		// LOD is fine
+		candidates.clear();
+		for (size_t m = 0; m < meshes.size(); m++)
+		{
+			for (size_t l = 0; l < meshes[m].lods.size(); l++)
+			{
+				const Lod& lod = meshes[m].lods[l];
+				if (lod.mesh.IsNull() || lod.lastUsed >= frame)
+					continue;
+
+				candidates.push_back({ lod.lastUsed, (StreamedMeshId)(m + 1), (unsigned int)l });
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(),
+			[](const EvictionCandidate& a, const EvictionCandidate& b) { return a.lastUsed < b.lastUsed; });
+
+		for (size_t i = 0; i < candidates.size() && needed > 0; i++)
+		{
+			Lod& lod = meshes[candidates[i].id - 1].lods[candidates[i].lod];
+			Resources::Meshes().Release(lod.mesh);
+			lod.mesh = {};
+			residentBytes -= lod.bytes;
+			needed -= lod.bytes < needed ? lod.bytes : needed;
+		}
+		return needed == 0;
+	}
+
+
+	// Leaves a LOD (or its failure) for Update()
+	void AddBuilt(uint64_t readSession, StreamedMeshId id, unsigned int lod, std::unique_ptr<Mesh> mesh)
+	{
+		std::lock_guard<std::mutex> lock(builtMutex);
+		built.push_back({ readSession, id, lod, std::move(mesh) });
+	}
+
+
+	// --------------------------------------------------------
+	// Loads a LOD with two ranged reads, not the whole file:
+	// its part of the index table, and then the span of the
+	// vertex table those indices use.  The second read's
+	// completion compacts and builds the LOD's mesh on the
+	// decode thread it runs on, so all that's left for
+	// Update() is adding the mesh to Resources.
+	// --------------------------------------------------------
+	void ReadLod(StreamedMeshId id, unsigned int l, IoScheduler::Priority priority, double deadline)
+	{
+		const StreamedMesh& mesh = meshes[id - 1];
+		MeshLod range = mesh.lods[l].range;
+		uint64_t readSession = session;
+		std::string name = mesh.name + " LOD " + std::to_string(l);
+		std::string path = mesh.path;
+		uint64_t verticesOffset = mesh.verticesOffset;
+		uint32_t vertexCount = mesh.vertexCount;
+
+		IoScheduler::ReadRange(path.c_str(),
+			mesh.indicesOffset + range.indexOffset * (uint64_t)sizeof(uint32_t),
+			range.indexCount * (uint64_t)sizeof(uint32_t),
+			priority, deadline,
+			[readSession, id, l, range, name, path, verticesOffset, vertexCount, priority, deadline](bool succeeded, std::vector<unsigned char>& indexData)
+			{
+				if (!succeeded || readSession != session || range.indexCount == 0)
+				{
+					AddBuilt(readSession, id, l, 0);
+					return;
+				}
+
+				const uint32_t* indices = (const uint32_t*)indexData.data();
+				uint32_t first = UINT32_MAX;
+				uint32_t last = 0;
+				for (uint32_t i = 0; i < range.indexCount; i++)
+				{
+					first = indices[i] < first ? indices[i] : first;
+					last = indices[i] > last ? indices[i] : last;
+				}
+				if (last >= vertexCount)
+				{
+					AddBuilt(readSession, id, l, 0);
+					return;
+				}
+
+				// Completions are copied, so the indices are shared
+				std::shared_ptr<std::vector<unsigned char>> lodIndices =
+					std::make_shared<std::vector<unsigned char>>(std::move(indexData));
+				uint32_t span = last - first + 1;
+				IoScheduler::ReadRange(path.c_str(),
+					verticesOffset + first * (uint64_t)sizeof(Vertex),
+					span * (uint64_t)sizeof(Vertex),
+					priority, deadline,
+					[readSession, id, l, range, name, lodIndices, first, span](bool read, std::vector<unsigned char>& vertexData)
+					{
+						MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Geometry);
+
+						std::unique_ptr<Mesh> lodMesh;
+						std::vector<Vertex> vertices;
+						std::vector<unsigned int> compacted;
+						if (read && readSession == session &&
+							CompactLod((const uint32_t*)lodIndices->data(), range.indexCount,
+								(const Vertex*)vertexData.data(), first, span, vertices, compacted))
+						{
+							lodMesh = std::make_unique<Mesh>(name.c_str(),
+								vertices.data(), vertices.size(),
+								compacted.data(), compacted.size());
+						}
+						AddBuilt(readSession, id, l, std::move(lodMesh));
+					});
+			});
+	}
+
+
+	// --------------------------------------------------------
+	// Starts loading any number of a mesh's LODs, each with
+	// reads of its own
+	// --------------------------------------------------------
+	void StartRead(StreamedMeshId id, uint64_t lodMask, IoScheduler::Priority priority, double deadline)
+	{
+		StreamedMesh& mesh = meshes[id - 1];
+		for (unsigned int l = 0; l < mesh.lods.size(); l++)
+		{
+			if (lodMask & (1ull << l))
+			{
+				mesh.lods[l].loading = true;
+				loadingBytes += mesh.lods[l].bytes;
+				mesh.reads++;
+				ReadLod(id, l, priority, deadline);
+			}
+		}
+	}
+
+
+	// --------------------------------------------------------
+	// Starts loading whatever a mesh drawn last frame is
+	// missing, if it fits in the budget
+	//
+	// fallbacks - Only handle meshes with nothing resident
+	//             (true), or only those being refined (false)
+	// --------------------------------------------------------
+	void RequestLods(StreamedMeshId id, bool fallbacks)
+	{
+		StreamedMesh& mesh = meshes[id - 1];
+		if (mesh.reads > 0)
+			return;
+
+		bool anyResident = false;
+		for (const Lod& lod : mesh.lods)
+			anyResident |= !lod.mesh.IsNull();
+		if (fallbacks == anyResident)
+			return;
+
+		// Refining: the wanted LOD, or if that won't fit, the
+		// finest one that does and still beats what's drawn now
+		unsigned int coarsest = (unsigned int)mesh.lods.size() - 1;
+		if (anyResident)
+		{
+			unsigned int drawn = mesh.wantedLod;
+			while (drawn <= coarsest && mesh.lods[drawn].mesh.IsNull())
+				drawn++;
+
+			// Drawing something finer already looks right
+			unsigned int last = drawn > coarsest ? mesh.wantedLod + 1 : drawn;
+			for (unsigned int l = mesh.wantedLod; l < last; l++)
+			{
+				if (!mesh.lods[l].failed && !mesh.lods[l].loading && MakeRoom(mesh.lods[l].bytes, false))
+				{
+					StartRead(id, 1ull << l, IoScheduler::Priority::Normal, 0.5);
+					return;
+				}
+			}
+			return;
+		}
+
+		// Nothing to draw yet: the coarsest LOD comes first, since
+		// it's the smallest and can stand in for the rest
+		uint64_t lodMask = 0;
+		uint64_t bytes = 0;
+		if (!mesh.lods[coarsest].failed)
+		{
+			lodMask |= 1ull << coarsest;
+			bytes += mesh.lods[coarsest].bytes;
+		}
+
+		Lod& wanted = mesh.lods[mesh.wantedLod];
+		if (!wanted.failed && mesh.wantedLod != coarsest)
+		{
+			lodMask |= 1ull << mesh.wantedLod;
+			bytes += wanted.bytes;
+		}
+		if (lodMask == 0)
+			return;
+
+		// If both won't fit, the fallback alone still helps.
+		// Something on screen has nothing to draw until it shows
+		// up, so it's wanted within a few frames.
+		if (!MakeRoom(bytes, false))
+		{
+			if (!(lodMask & (1ull << coarsest)))
+				return;
+			lodMask = 1ull << coarsest;
+			if (!MakeRoom(mesh.lods[coarsest].bytes, false))
+				return;
+		}
+		StartRead(id, lodMask, IoScheduler::Priority::High, 0.05);
+	}
+
+
+	// --------------------------------------------------------
+	// Adds a built LOD's mesh to Resources
+	// --------------------------------------------------------
+	void FinishLod(BuiltLod& result)
+	{
+		StreamedMesh* mesh = Find(result.id);
+		if (result.session != session || !mesh || result.lod >= mesh->lods.size())
+			return;
+
+		Lod& lod = mesh->lods[result.lod];
+		if (lod.loading)
+		{
+			lod.loading = false;
+			loadingBytes -= lod.bytes;
+			mesh->reads--;
+		}
+		if (!lod.mesh.IsNull())
+			return;
+
+		if (result.mesh)
+		{
+			MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Geometry);
+			lod.mesh = Resources::Meshes().Create(*result.mesh);
+		}
+		Mesh* created = Resources::Meshes().Get(lod.mesh);
+		if (!created)
+		{
+			printf("MeshStreaming: Couldn't load LOD %u of %s\n", result.lod, mesh->path.c_str());
+			lod.mesh = {};
+			lod.failed = true;
+			return;
+		}
+
+		// Now the exact size, and not evicted before it's drawn
+		lod.bytes = created->GetVertexCount() * (uint64_t)sizeof(Vertex) + created->GetIndexCount() * (uint64_t)sizeof(unsigned int);
+		lod.lastUsed = frame;
+		residentBytes += lod.bytes;
+		protectedBytes += lod.bytes;
+	}
+}
+
+
+void MeshStreaming::Initialize(uint64_t budgetBytes)
+{
+	budget = budgetBytes;
+}
+
+void MeshStreaming::ShutDown()
+{
+	for (StreamedMesh& mesh : meshes)
+	{
+		for (Lod& lod : mesh.lods)
+		{
+			if (!lod.mesh.IsNull())
+				Resources::Meshes().Release(lod.mesh);
+		}
+	}
+
+	meshes.clear();
+	used.clear();
+	residentBytes = 0;
+	loadingBytes = 0;
+	protectedBytes = 0;
+	session++;
+
+	std::lock_guard<std::mutex> lock(builtMutex);
+	built.clear();
+}
+
+void MeshStreaming::SetBudget(uint64_t budgetBytes)
+{
+	budget = budgetBytes;
+}
+
+uint64_t MeshStreaming::Budget()
+{
+	return budget;
+}
+
+uint64_t MeshStreaming::ResidentBytes()
+{
+	return residentBytes;
+}
+
+uint64_t MeshStreaming::LoadingBytes()
+{
+	return loadingBytes;
+}
+
+
+// --------------------------------------------------------
+// Opens the file just long enough to copy out its LOD
+// table and where the vertex and index tables are.  Loose
+// files and stored pack entries are mapped, so only the
+// pages with the header and tables are read; a compressed
+// pack entry has to be read in full.
+// --------------------------------------------------------
+StreamedMeshId MeshStreaming::Register(const char* name, const char* path)
+{
+	MeshFile file;
+	std::vector<unsigned char> unpacked;
+	size_t mappedSize = 0;
+	const unsigned char* mapped = Vfs::Map(path, mappedSize);
+	const char* realPath = mapped ? 0 : Vfs::RealPath(path);
+	bool opened =
+		mapped ? file.Open(mapped, mappedSize) :
+		realPath ? file.Open(std::string(realPath)) :
+		Vfs::Read(path, unpacked) && file.Open(unpacked.data(), unpacked.size());
+	if (!opened)
+	{
+		printf("MeshStreaming: Couldn't open %s\n", path);
+		return 0;
+	}
+	if (!file.Matches(VertexLayout))
+	{
+		printf("MeshStreaming: %s doesn't use the Vertex format\n", path);
+		return 0;
+	}
+
+	const MeshFileHeader& header = file.Header();
+	StreamedMesh mesh = {};
+	mesh.name = name;
+	mesh.path = path;
+	mesh.vertexCount = header.vertexCount;
+	mesh.verticesOffset = header.verticesOffset;
+	mesh.indicesOffset = header.indicesOffset;
+	mesh.boundsCenter = header.sphereCenter;
+	mesh.boundsRadius = header.sphereRadius;
+
+	// Files without LODs are one LOD of every index.  Past
+	// MaxLods, the coarsest ones are left out.
+	unsigned int lodCount = header.lodCount > 0 ? header.lodCount : 1;
+	if (lodCount > MaxLods)
+		lodCount = MaxLods;
+	for (unsigned int l = 0; l < lodCount; l++)
+	{
+		Lod lod = {};
+		lod.range = header.lodCount > 0 ? file.Lods()[l] : MeshLod{ 0, header.indexCount, 0.0f, 0 };
+		lod.bytes = EstimateBytes(lod.range, header.vertexCount);
+		mesh.lods.push_back(lod);
+	}
+
+	meshes.push_back(std::move(mesh));
+	return (StreamedMeshId)meshes.size();
+}
+
+unsigned int MeshStreaming::LodCount(StreamedMeshId id)
+{
+	StreamedMesh* mesh = Find(id);
+	return mesh ? (unsigned int)mesh->lods.size() : 0;
+}
+
+Math::Float3 MeshStreaming::GetBoundsCenter(StreamedMeshId id)
+{
+	StreamedMesh* mesh = Find(id);
+	return mesh ? mesh->boundsCenter : Math::Float3(0, 0, 0);
+}
+
+float MeshStreaming::GetBoundsRadius(StreamedMeshId id)
+{
+	StreamedMesh* mesh = Find(id);
+	return mesh ? mesh->boundsRadius : 0.0f;
+}
+
+
+// --------------------------------------------------------
+// LODs are finest first with growing error, so the wanted
+// one is the last whose error is still small enough.  The
+// finest LOD any object wants this frame is what gets
+// loaded in Update().
+// --------------------------------------------------------
+MeshHandle MeshStreaming::Use(StreamedMeshId id, float maxError)
+{
+	StreamedMesh* mesh = Find(id);
+	if (!mesh)
+		return {};
+
+	unsigned int wanted = 0;
+	while (wanted + 1 < mesh->lods.size() && mesh->lods[wanted + 1].range.error <= maxError)
+		wanted++;
+
+	if (mesh->lastUsed != frame)
+	{
+		mesh->lastUsed = frame;
+		mesh->wantedLod = wanted;
+		used.push_back(id);
+	}
+	else if (wanted < mesh->wantedLod)
+	{
+		mesh->wantedLod = wanted;
+	}
+
+	// The wanted LOD, else the closest coarser one, else
+	// the closest finer one
+	Lod* draw = 0;
+	for (size_t l = wanted; l < mesh->lods.size() && !draw; l++)
+	{
+		if (!mesh->lods[l].mesh.IsNull())
+			draw = &mesh->lods[l];
+	}
+	for (size_t l = wanted; l-- > 0 && !draw;)
+	{
+		if (!mesh->lods[l].mesh.IsNull())
+			draw = &mesh->lods[l];
+	}
+	if (!draw)
+		return {};
+
+	if (draw->lastUsed != frame)
+	{
+		draw->lastUsed = frame;
+		protectedBytes += draw->bytes;
+	}
+	return draw->mesh;
+}
+
+
+// --------------------------------------------------------
+// Meshes nobody drew last frame aren't looked at at all,
+// unless something has to be evicted
+// --------------------------------------------------------
+void MeshStreaming::Update()
+{
+	{
+		std::lock_guard<std::mutex> lock(builtMutex);
+		finishing.swap(built);
+	}
+	for (BuiltLod& result : finishing)
+		FinishLod(result);
+	finishing.clear();
+
+	// Meshes with nothing to draw get their fallbacks before
+	// anything else gets more detail
+	for (StreamedMeshId id : used)
+		RequestLods(id, true);
+	for (StreamedMeshId id : used)
+		RequestLods(id, false);
+
+	// Catch up with a budget that shrank
+	MakeRoom(0, true);
+
+	used.clear();
+	protectedBytes = 0;
+	frame++;
+}
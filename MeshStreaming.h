@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Resources.h"
+#include "SimdMath.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Identifies a registered streamed mesh, or 0 for none
+typedef uint32_t StreamedMeshId;
+
+// --------------------------------------------------------
+// Streams .mesh files' LODs in and out of video memory
+// under a byte budget
+//
+// Registering a mesh only reads its header and LOD table.
+// Each frame, Use() picks the LOD an object wants (the
+// coarsest whose error is small enough) and returns the
+// closest one that's actually resident - coarser first, so
+// detail only ever pops in - while the wanted one loads.
+// Loads are ranged IoScheduler reads of just a LOD's part
+// of the index table and the vertices it uses.  Their
+// completions compact the vertices and build the LOD's mesh
+// (staged through GpuUpload) on the scheduler's decode
+// threads, so Update() only adds finished meshes to
+// Resources.
+//
+// Every resident LOD counts its vertex and index buffer
+// bytes against the budget.  Loading something that
+// doesn't fit first evicts the least recently drawn LODs,
+// never one drawn in the last frame.  A mesh with nothing
+// resident gets its coarsest LOD first, at a higher
+// priority than refining meshes that can already be drawn.
+//
+// Everything here is main thread only, except Bounds*() and
+// LodCount(), which only read what Register() stored.
+//
+// Usage:
+//
+//   MeshStreaming::Initialize(256 * 1024 * 1024);
+//   StreamedMeshId id = MeshStreaming::Register("Sunflower", "Sunflower.mesh");
+//   ...
+//   MeshStreaming::Update();	// Once per frame, after IoScheduler::Update()
+//   MeshHandle lod = MeshStreaming::Use(id, maxError);
+// --------------------------------------------------------
+namespace MeshStreaming
+{
+	// budgetBytes - Video memory all resident LODs may use
+	void Initialize(uint64_t budgetBytes);
+
+	// Releases every resident LOD and forgets every mesh
+	void ShutDown();
+
+	// A smaller budget evicts down to it over the next frames
+	void SetBudget(uint64_t budgetBytes);
+	uint64_t Budget();
+
+	// Bytes of the resident LODs, and of those still loading
+	uint64_t ResidentBytes();
+	uint64_t LoadingBytes();
+
+	// --------------------------------------------------------
+	// Reads a .mesh file's header and LOD table, returning an
+	// id for Use(), or 0 if the file is missing, corrupt or
+	// not in the Vertex format.  Nothing is loaded yet.
+	//
+	// name - Given to every LOD's mesh (with the LOD number)
+	// path - File in the Vfs
+	// --------------------------------------------------------
+	StreamedMeshId Register(const char* name, const char* path);
+
+	unsigned int LodCount(StreamedMeshId id);
+
+	// Local space bounding sphere around every vertex
+	Math::Float3 GetBoundsCenter(StreamedMeshId id);
+	float GetBoundsRadius(StreamedMeshId id);
+
+	// --------------------------------------------------------
+	// Picks the LOD to draw a mesh with this frame, returning
+	// a null handle if nothing is resident yet
+	//
+	// id       - From Register()
+	// maxError - Largest vertex error (in the mesh's local
+	//            units) that won't be noticed
+	// --------------------------------------------------------
+	MeshHandle Use(StreamedMeshId id, float maxError);
+
+	// --------------------------------------------------------
+	// Once per frame, after IoScheduler::Update(): creates the
+	// LODs that finished loading, then starts loading what
+	// last frame's Use() calls asked for, evicting to fit
+	// --------------------------------------------------------
+	void Update();
+}
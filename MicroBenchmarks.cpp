@@ -0,0 +1,809 @@
+#include "AssetPack.h"
+#include "Benchmark.h"
+#include "BufferStructs.h"
+#include "Components.h"
+#include "EntityWorld.h"
+#include "FrameArena.h"
+#include "Game.h"
+#include "GpuUpload.h"
+#include "Graphics.h"
+#include "IoScheduler.h"
+#include "JobSystem.h"
+#include "TransformKernels.h"
+#include "TransformSystem.h"
+#include "Mesh.h"
+#include "MeshConverter.h"
+#include "MeshFile.h"
+#include "MeshImporter.h"
+#include "PathHelpers.h"
+#include "Resources.h"
+#include "SimdMath.h"
+#include "Vertex.h"
+#include "Vfs.h"
+
+#include <d3dcompiler.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+// For the engine math library
+using namespace Math;
+
+// Annonymous namespace to hold variables
+// only accessible in this file
+namespace
+{
+	// Everything we measured for one microbenchmark
+	struct MicroResult
+	{
+		std::string name;
+		unsigned int opsPerSample;
+		unsigned int samples;
+		Benchmark::Stats nsPerOp;
+		double allocationsPerOp;
+		double baselineMedian;	// Zero if there was nothing to compare against
+		double flopsPerOp;		// Zero for non-arithmetic benchmarks
+		bool regressed;
+		bool hasCounters;
+		PerfCounters::Sample counters;	// Totals over all measured samples
+	};
+
+	// Capture hardware counters around each sample?
+	bool useCounters = false;
+
+	// --------------------------------------------------------
+	// Times a single operation
+	//
+	// name          - Identifier used in the report and baseline
+	// warmupSamples - Samples run (and thrown away) first
+	// samples       - Samples to actually record
+	// opsPerSample  - How many times body() runs per sample, so
+	//                 very short operations are still measurable
+	// body          - The operation being measured
+	// afterSample   - Untimed work between samples (flushes, etc.)
+	// --------------------------------------------------------
+	template<typename Body, typename AfterSample>
+	MicroResult Measure(
+		const std::string& name,
+		unsigned int warmupSamples,
+		unsigned int samples,
+		unsigned int opsPerSample,
+		Body body,
+		AfterSample afterSample)
+	{
+		double perfSeconds = Benchmark::SecondsPerTick();
+
+		std::vector<double> nsPerOp;
+		nsPerOp.reserve(samples);
+		unsigned long long allocations = 0;
+		PerfCounters::Sample counterTotals = {};
+
+		for (unsigned int s = 0; s < warmupSamples + samples; s++)
+		{
+			bool measured = s >= warmupSamples;
+			if (useCounters && measured)
+				PerfCounters::Begin();
+
+			unsigned long long allocsBefore = Benchmark::AllocationCount();
+			__int64 startTime = Benchmark::Now();
+
+			for (unsigned int op = 0; op < opsPerSample; op++)
+				body();
+
+			__int64 endTime = Benchmark::Now();
+			unsigned long long allocsAfter = Benchmark::AllocationCount();
+
+			if (useCounters && measured)
+			{
+				PerfCounters::Sample counters = PerfCounters::End();
+				if (s == warmupSamples)
+					counterTotals = counters;
+				else
+					counterTotals.Add(counters);
+			}
+
+			afterSample();
+
+			if (!measured)
+				continue;
+
+			nsPerOp.push_back((endTime - startTime) * perfSeconds * 1e9 / opsPerSample);
+			allocations += allocsAfter - allocsBefore;
+		}
+
+		MicroResult result = {};
+		result.name = name;
+		result.opsPerSample = opsPerSample;
+		result.samples = samples;
+		result.nsPerOp = Benchmark::ComputeStats(nsPerOp);
+		result.allocationsPerOp = samples > 0 ? (double)allocations / ((double)samples * opsPerSample) : 0.0;
+		result.hasCounters = useCounters;
+		result.counters = counterTotals;
+		return result;
+	}
+
+	// Floating point work per item, counting a multiply-add as two
+	const double flopsPerMatrixMultiply = 64 + 48;
+	const double flopsPerPointTransform = 9 + 9;
+
+	// Median throughput, if the benchmark does arithmetic
+	double GigaFlops(const MicroResult& r)
+	{
+		return r.nsPerOp.median > 0.0 ? r.flopsPerOp / r.nsPerOp.median : 0.0;
+	}
+
+	// Roughly what a frame's draw list looks like
+	struct DrawPacket
+	{
+		Float4x4 world;
+		unsigned int meshIndex;
+		float sortKey;
+	};
+
+	// The same per-object data as the entity components, laid
+	// out the usual object-oriented way, plus the kind of
+	// extra fields a game object tends to pick up
+	struct GameObjectAoS
+	{
+		MeshHandle mesh;
+		Float4 tint;
+		TransformId transform;
+		BoundsComponent bounds;
+		char name[32];
+		Float4x4 cachedWorld;
+	};
+
+	// --------------------------------------------------------
+	// A typical frame's worth of transient work: a growing
+	// draw list, a visible index list and a handful of small
+	// scratch buffers, all with the given allocator
+	//
+	// packetCount - Draws to build this "frame"
+	// allocate    - Used for the scratch buffers
+	// release     - Frees a scratch buffer (may do nothing)
+	// --------------------------------------------------------
+	template<template<typename> class Alloc, typename AllocateFn, typename ReleaseFn>
+	float TransientFrameWork(unsigned int packetCount, AllocateFn allocate, ReleaseFn release)
+	{
+		std::vector<DrawPacket, Alloc<DrawPacket>> packets;
+		std::vector<unsigned int, Alloc<unsigned int>> visible;
+		for (unsigned int i = 0; i < packetCount; i++)
+		{
+			DrawPacket packet = {};
+			packet.meshIndex = i;
+			packet.sortKey = (float)(i * 7 % 13);
+			packets.push_back(packet);
+			if (i % 3 != 0)
+				visible.push_back(i);
+		}
+
+		// Small, short-lived buffers (strings, culling results)
+		float total = 0.0f;
+		for (unsigned int i = 0; i < 32; i++)
+		{
+			float* scratch = (float*)allocate(64 + i * 16);
+			scratch[0] = packets[visible[i % visible.size()]].sortKey;
+			total += scratch[0];
+			release(scratch);
+		}
+		return total;
+	}
+
+	// --------------------------------------------------------
+	// Builds vertex and index data for a flat grid with
+	// (at least) the requested number of triangles
+	// --------------------------------------------------------
+	void CreateGridData(unsigned int triangleCount, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		unsigned int cells = (triangleCount + 1) / 2;
+		unsigned int side = 1;
+		while (side * side < cells)
+			side++;
+
+		Float4 white(1.0f, 1.0f, 1.0f, 1.0f);
+		for (unsigned int y = 0; y <= side; y++)
+			for (unsigned int x = 0; x <= side; x++)
+				vertices.push_back({ Float3((float)x / side - 0.5f, (float)y / side - 0.5f, 0.0f), white });
+
+		for (unsigned int y = 0; y < side; y++)
+		{
+			for (unsigned int x = 0; x < side; x++)
+			{
+				unsigned int i = y * (side + 1) + x;
+				indices.insert(indices.end(), { i, i + side + 1, i + 1 });
+				indices.insert(indices.end(), { i + 1, i + side + 1, i + side + 2 });
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Reads median times from an earlier run's JSON output.
+	// Each benchmark is written on its own line, so a simple
+	// line scan is all we need.
+	// --------------------------------------------------------
+	std::map<std::string, double> LoadBaseline(const std::string& path)
+	{
+		std::map<std::string, double> medians;
+		std::ifstream file(path);
+		std::string line;
+		while (std::getline(file, line))
+		{
+			size_t nameStart = line.find("\"name\": \"");
+			size_t medianStart = line.find("\"median_ns\": ");
+			if (nameStart == std::string::npos || medianStart == std::string::npos)
+				continue;
+
+			nameStart += 9;
+			size_t nameEnd = line.find('"', nameStart);
+			medians[line.substr(nameStart, nameEnd - nameStart)] = atof(line.c_str() + medianStart + 13);
+		}
+		return medians;
+	}
+
+	// --------------------------------------------------------
+	// Writes all results as a single JSON document, one
+	// benchmark per line (see LoadBaseline())
+	// --------------------------------------------------------
+	bool WriteResults(const std::string& path, const std::vector<MicroResult>& results, double thresholdPercent, unsigned int regressions)
+	{
+		FILE* file = 0;
+		if (fopen_s(&file, path.c_str(), "w") != 0 || !file)
+			return false;
+
+		fprintf(file, "{\n");
+		fprintf(file, "  \"suite\": \"micro\",\n");
+		fprintf(file, "  \"api\": \"%s\",\n", WideToNarrow(Graphics::APIName()).c_str());
+		fprintf(file, "  \"threshold_pct\": %.1f,\n", thresholdPercent);
+		fprintf(file, "  \"regressions\": %u,\n", regressions);
+		fprintf(file, "  \"benchmarks\": [\n");
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const MicroResult& r = results[i];
+			fprintf(file, "    { \"name\": \"%s\", \"ops_per_sample\": %u, \"samples\": %u, "
+				"\"mean_ns\": %.2f, \"median_ns\": %.2f, \"min_ns\": %.2f, \"max_ns\": %.2f, \"stddev_ns\": %.2f, \"p95_ns\": %.2f, "
+				"\"allocations_per_op\": %.3f, \"gflops\": %.3f, \"baseline_median_ns\": %.2f, \"regressed\": %s%s%s }%s\n",
+				r.name.c_str(), r.opsPerSample, r.samples,
+				r.nsPerOp.mean, r.nsPerOp.median, r.nsPerOp.min, r.nsPerOp.max, r.nsPerOp.stdDev, r.nsPerOp.p95,
+				r.allocationsPerOp, GigaFlops(r), r.baselineMedian, r.regressed ? "true" : "false",
+				r.hasCounters ? ", " : "",
+				r.hasCounters ? Benchmark::CountersJson(r.counters, (double)r.samples * r.opsPerSample, "op").c_str() : "",
+				i + 1 < results.size() ? "," : "");
+		}
+		fprintf(file, "  ]\n");
+		fprintf(file, "}\n");
+
+		fclose(file);
+		return true;
+	}
+}
+
+
+// --------------------------------------------------------
+// Runs focused benchmarks of the engine's hot functions:
+//  - Mesh construction (and GPU buffer creation) by size,
+//    with initial data vs. staged through the upload ring
+//  - Mesh loading from OBJ text vs. a mapped .mesh file
+//  - OBJ importing on one thread vs. the job system
+//  - Shader reads from loose files vs. an asset pack vs.
+//    the Vfs (cached resolution of the loose file)
+//  - Many pack reads one at a time vs. on the IoScheduler
+//  - The per-draw constant buffer Map/memcpy/Unmap
+//  - Mesh::DrawBuff() bind + draw submission
+//  - Batched transform kernels per instruction set, in GFLOP/s
+//
+// Returns 2 if any median regressed past the threshold
+// compared to the baseline file, 1 on other failures
+//
+// commandLine - The full command line given to the app
+// --------------------------------------------------------
+int Benchmark::RunMicro(const std::string& commandLine)
+{
+	std::string outputPath = FixPath("microbenchmark_results.json");
+	std::string baselinePath;
+	double thresholdPercent = 10.0;
+	unsigned int warmupSamples = 5;
+	unsigned int samples = 50;
+
+	// Simple "-option value" parsing
+	std::istringstream args(commandLine);
+	std::string arg;
+	while (args >> arg)
+	{
+		if (arg == "-out") args >> outputPath;
+		else if (arg == "-baseline") args >> baselinePath;
+		else if (arg == "-threshold") args >> thresholdPercent;
+		else if (arg == "-warmup") args >> warmupSamples;
+		else if (arg == "-samples") args >> samples;
+	}
+
+	HRESULT hr = StartHeadless();
+	if (FAILED(hr))
+		return hr;
+
+	useCounters = CountersRequested(commandLine);
+	if (useCounters && !PerfCounters::Initialize())
+		printf("Hardware performance counters are unavailable on this system\n");
+
+	std::vector<MicroResult> results;
+	{
+		// A game sets up the same pipeline state (shaders,
+		// input layout, etc.) that real draws would use
+		std::unique_ptr<Game> game = std::make_unique<Game>();
+		game->Initialize();
+		auto flush = []() { Graphics::Context->Flush(); };
+		auto nothing = []() {};
+
+		// Mesh creation at various sizes
+		const unsigned int meshSizes[] = { 12, 1024, 65536 };
+		for (unsigned int tris : meshSizes)
+		{
+			std::vector<Vertex> vertices;
+			std::vector<unsigned int> indices;
+			CreateGridData(tris, vertices, indices);
+
+			results.push_back(Measure(
+				"mesh_create_" + std::to_string(tris) + "_tris",
+				warmupSamples, samples, tris > 4096 ? 2 : 32,
+				[&]() { Mesh mesh("Micro Mesh", vertices.data(), vertices.size(), indices.data(), indices.size()); },
+				nothing));
+		}
+
+		// The same meshes staged through the upload ring, flushed
+		// between samples like the render thread does each frame
+		GpuUpload::Initialize(8 * 1024 * 1024, 4);
+		for (unsigned int tris : meshSizes)
+		{
+			std::vector<Vertex> vertices;
+			std::vector<unsigned int> indices;
+			CreateGridData(tris, vertices, indices);
+
+			results.push_back(Measure(
+				"mesh_create_staged_" + std::to_string(tris) + "_tris",
+				warmupSamples, samples, tris > 4096 ? 2 : 32,
+				[&]() { Mesh mesh("Micro Mesh", vertices.data(), vertices.size(), indices.data(), indices.size()); },
+				[]() { GpuUpload::Flush(); Graphics::Context->Flush(); }));
+		}
+		GpuUpload::ShutDown();
+
+		// Loading a mesh from disk through to GPU buffers: parsing
+		// OBJ text vs. mapping the binary format.  Both files stay
+		// in the OS file cache, so this is the CPU side of loading.
+		{
+			std::vector<Vertex> vertices;
+			std::vector<unsigned int> indices;
+			CreateGridData(65536, vertices, indices);
+
+			MeshFileContents contents;
+			MeshConverter::Build(vertices, indices, contents);
+
+			std::string textPath = FixPath("micro_mesh.obj");
+			std::string binaryPath = FixPath("micro_mesh.mesh");
+			if (MeshConverter::WriteObj(textPath, vertices, indices) && WriteMeshFile(binaryPath, contents))
+			{
+				results.push_back(Measure(
+					"mesh_load_text_65536_tris", warmupSamples, samples, 1,
+					[&]() {
+						std::vector<Vertex> loadedVertices;
+						std::vector<unsigned int> loadedIndices;
+						MeshImporter::Import(textPath, loadedVertices, loadedIndices);
+						Mesh mesh("Micro Text Mesh", loadedVertices.data(), loadedVertices.size(), loadedIndices.data(), loadedIndices.size());
+					},
+					nothing));
+
+				results.push_back(Measure(
+					"mesh_load_binary_65536_tris", warmupSamples, samples, 1,
+					[&]() {
+						MeshFile file;
+						if (file.Open(binaryPath))
+							Mesh mesh("Micro Binary Mesh", file);
+					},
+					nothing));
+			}
+
+			std::remove(textPath.c_str());
+			std::remove(binaryPath.c_str());
+		}
+
+		// Importing alone, big enough to split into many chunks
+		{
+			std::vector<Vertex> vertices;
+			std::vector<unsigned int> indices;
+			CreateGridData(1048576, vertices, indices);
+
+			std::string textPath = FixPath("micro_import.obj");
+			if (MeshConverter::WriteObj(textPath, vertices, indices))
+			{
+				MeshImporter::Options serial;
+				serial.parallel = false;
+				results.push_back(Measure(
+					"mesh_import_obj_1M_tris", warmupSamples, samples, 1,
+					[&]() { MeshImporter::Import(textPath, vertices, indices, serial); },
+					nothing));
+
+				results.push_back(Measure(
+					"mesh_import_obj_1M_tris_parallel", warmupSamples, samples, 1,
+					[&]() { MeshImporter::Import(textPath, vertices, indices); },
+					nothing));
+			}
+
+			std::remove(textPath.c_str());
+		}
+
+		// Reading a compiled shader the way loose files are found
+		// (path fixing included) vs. out of a compressed pack vs.
+		// through the Vfs's directory mount
+		{
+			std::string packPath = FixPath("micro_assets.pack");
+			std::vector<AssetPackSource> sources = { { "VertexShader.cso", FixPath("VertexShader.cso"), true } };
+			AssetPack pack;
+			if (WriteAssetPack(packPath, sources) && pack.Open(packPath))
+			{
+				results.push_back(Measure(
+					"shader_read_loose", warmupSamples, samples, 100,
+					[&]() {
+						Microsoft::WRL::ComPtr<ID3DBlob> code;
+						D3DReadFileToBlob(FixPath(L"VertexShader.cso").c_str(), code.GetAddressOf());
+					},
+					nothing));
+
+				results.push_back(Measure(
+					"shader_read_pack", warmupSamples, samples, 100,
+					[&]() {
+						std::vector<unsigned char> code;
+						pack.Read("VertexShader.cso", code);
+					},
+					nothing));
+
+				results.push_back(Measure(
+					"shader_read_vfs", warmupSamples, samples, 100,
+					[&]() {
+						std::vector<unsigned char> code;
+						Vfs::Read("VertexShader.cso", code);
+					},
+					nothing));
+			}
+
+			pack.Close();
+			std::remove(packPath.c_str());
+		}
+
+		// Reading many small assets out of a pack one at a time
+		// vs. all queued on the IoScheduler, which reads nearby
+		// entries together and decompresses them in parallel
+		{
+			std::string packPath = FixPath("micro_stream.pack");
+			std::vector<AssetPackSource> sources;
+			for (int i = 0; i < 64; i++)
+				sources.push_back({ "micro/" + std::to_string(i) + ".cso", FixPath("VertexShader.cso"), true });
+
+			if (WriteAssetPack(packPath, sources) && Vfs::MountArchive("", packPath))
+			{
+				results.push_back(Measure(
+					"pack_read_64_serial", warmupSamples, samples, 1,
+					[&]() {
+						std::vector<unsigned char> code;
+						for (const AssetPackSource& source : sources)
+							Vfs::Read(source.name.c_str(), code);
+					},
+					nothing));
+
+				IoScheduler::Initialize(8);
+				results.push_back(Measure(
+					"pack_read_64_scheduled", warmupSamples, samples, 1,
+					[&]() {
+						for (const AssetPackSource& source : sources)
+							IoScheduler::Read(source.name.c_str(), IoScheduler::Priority::Normal, 0.0, nullptr);
+						while (IoScheduler::Pending() > 0)
+							IoScheduler::Update();
+					},
+					nothing));
+				IoScheduler::ShutDown();
+			}
+
+			// A mapped pack can't be deleted, so the Vfs goes back
+			// to how StartHeadless() set it up first
+			Vfs::UnmountAll();
+			Vfs::MountDirectory("", GetExePath());
+			std::remove(packPath.c_str());
+		}
+
+		// A constant buffer matching the one Game::Draw() fills
+		Microsoft::WRL::ComPtr<ID3D11Buffer> constantBuffer;
+		D3D11_BUFFER_DESC cbDesc = {};
+		cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		cbDesc.ByteWidth = ConstantBufferSize<VertexShaderData>();
+		cbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		cbDesc.Usage = D3D11_USAGE_DYNAMIC;
+		Graphics::Device->CreateBuffer(&cbDesc, 0, constantBuffer.GetAddressOf());
+		Graphics::Context->VSSetConstantBuffers(0, 1, constantBuffer.GetAddressOf());
+
+		VertexShaderData data = {};
+		data.colorTint = Float4(1.0f, 1.0f, 1.0f, 1.0f);
+
+		results.push_back(Measure(
+			"cb_map_memcpy_unmap", warmupSamples, samples, 1000,
+			[&]() { Graphics::FillDynamicBuffer(constantBuffer.Get(), &data, sizeof(data)); },
+			flush));
+
+		// Draw submission with a tiny mesh, so we measure
+		// binding and API overhead rather than the GPU
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		CreateGridData(2, vertices, indices);
+		Mesh quad("Micro Quad", vertices.data(), vertices.size(), indices.data(), indices.size());
+
+		results.push_back(Measure(
+			"mesh_drawbuff", warmupSamples, samples, 1000,
+			[&]() { quad.DrawBuff(); },
+			flush));
+
+		// Both together, exactly like each object in Game::Draw()
+		results.push_back(Measure(
+			"draw_loop_iteration", warmupSamples, samples, 1000,
+			[&]() {
+				Graphics::FillDynamicBuffer(constantBuffer.Get(), &data, sizeof(data));
+				quad.DrawBuff();
+			},
+			flush));
+
+		// Name lookups on the asset loading path: a literal
+		// hashed at compile time vs. a runtime string
+		MeshHandle namedQuad = Resources::CreateMesh("Micro Named Quad", vertices.data(), vertices.size(), indices.data(), indices.size());
+		volatile uint32_t found = 0;
+		results.push_back(Measure(
+			"mesh_find_by_name_constexpr", warmupSamples, samples, 1000,
+			[&]() {
+				constexpr StringId name("Micro Named Quad");
+				found = Resources::FindMesh(name).value;
+			},
+			nothing));
+
+		std::string runtimeName = "Micro Named Quad";
+		results.push_back(Measure(
+			"mesh_find_by_name_runtime", warmupSamples, samples, 1000,
+			[&]() { found = Resources::FindMesh(StringId(runtimeName.c_str())).value; },
+			nothing));
+		Resources::Meshes().Release(namedQuad);
+
+		// Transform updates at scale: everything moving, a
+		// tenth of the roots moving, and deep hierarchies
+		// where one moving root drags its whole subtree along
+		{
+			const unsigned int transformCount = 1 << 20;
+			TransformSystem flat;
+			flat.Reserve(transformCount);
+			for (unsigned int i = 0; i < transformCount; i++)
+				flat.Create();
+
+			unsigned int frame = 0;
+			results.push_back(Measure(
+				"transforms_1M_all_dirty", warmupSamples, samples, 1,
+				[&]() {
+					frame++;
+					for (unsigned int i = 0; i < transformCount; i++)
+						flat.SetPosition(i, Float3((float)frame, 0.0f, 0.0f));
+					flat.UpdateWorldMatrices();
+				},
+				nothing));
+
+			results.push_back(Measure(
+				"transforms_1M_10pct_dirty", warmupSamples, samples, 1,
+				[&]() {
+					frame++;
+					for (unsigned int i = 0; i < transformCount; i += 10)
+						flat.SetPosition(i, Float3((float)frame, 0.0f, 0.0f));
+					flat.UpdateWorldMatrices();
+				},
+				nothing));
+			flat.Clear();
+
+			// 1024 roots, each with a chain of 1023 descendants
+			const unsigned int roots = 1024;
+			TransformSystem hierarchy;
+			hierarchy.Reserve(transformCount);
+			for (unsigned int r = 0; r < roots; r++)
+			{
+				TransformId parent = hierarchy.Create();
+				for (unsigned int d = 1; d < transformCount / roots; d++)
+					parent = hierarchy.Create(parent);
+			}
+
+			results.push_back(Measure(
+				"transforms_1M_hierarchy_one_root_dirty", warmupSamples, samples, 1,
+				[&]() {
+					frame++;
+					hierarchy.SetPosition(0, Float3((float)frame, 0.0f, 0.0f));
+					hierarchy.UpdateWorldMatrices();
+				},
+				nothing));
+		}
+
+		// Batched transform kernels at every instruction set
+		// this machine supports, the scalar loops included
+		{
+			const unsigned int matrixCount = 4096;
+			const unsigned int pointCount = 65536;
+
+			std::vector<Float4x4> matrices(matrixCount);
+			std::vector<Float4x4> products(matrixCount);
+			for (unsigned int i = 0; i < matrixCount; i++)
+			{
+				Store(matrices[i], AffineTransformation(
+					Set(1.0f, 2.0f, 1.0f, 0.0f),
+					QuaternionRotationRollPitchYaw(0.001f * i, 0.002f * i, 0.0f),
+					Set((float)i, 0.0f, 1.0f, 0.0f)));
+			}
+
+			Float4x4 view;
+			Float4x4 projection;
+			Store(view, LookAtLH(Set(0.0f, 5.0f, -10.0f, 1.0f), Zero(), Set(0.0f, 1.0f, 0.0f, 0.0f)));
+			Store(projection, PerspectiveFovLH(PiDiv4, 16.0f / 9.0f, 0.1f, 1000.0f));
+
+			std::vector<Float3> points(pointCount);
+			std::vector<Float3> transformed(pointCount);
+			std::vector<float> xs(pointCount), ys(pointCount), zs(pointCount);
+			std::vector<float> outX(pointCount), outY(pointCount), outZ(pointCount);
+			for (unsigned int i = 0; i < pointCount; i++)
+			{
+				points[i] = Float3((float)(i % 256), (float)(i / 256), 0.5f);
+				xs[i] = points[i].x;
+				ys[i] = points[i].y;
+				zs[i] = points[i].z;
+			}
+
+			const TransformKernels::InstructionSet sets[] =
+			{
+				TransformKernels::InstructionSet::Scalar,
+				TransformKernels::InstructionSet::Simd128,
+				TransformKernels::InstructionSet::AVX2,
+				TransformKernels::InstructionSet::AVX512,
+			};
+
+			for (TransformKernels::InstructionSet set : sets)
+			{
+				if (!TransformKernels::IsSupported(set))
+					continue;
+
+				TransformKernels::SetActive(set);
+				std::string suffix = std::string("_") + TransformKernels::Name(set);
+
+				MicroResult r = Measure(
+					"kernel_matrix_multiply_4k" + suffix, warmupSamples, samples, 10,
+					[&]() { TransformKernels::MultiplyMatrices(matrices.data(), products.data(), products.data(), matrixCount); },
+					nothing);
+				r.flopsPerOp = flopsPerMatrixMultiply * matrixCount;
+				results.push_back(r);
+
+				r = Measure(
+					"kernel_wvp_4k" + suffix, warmupSamples, samples, 10,
+					[&]() { TransformKernels::WorldViewProjection(matrices.data(), view, projection, products.data(), matrixCount, true); },
+					nothing);
+				r.flopsPerOp = flopsPerMatrixMultiply * matrixCount;
+				results.push_back(r);
+
+				r = Measure(
+					"kernel_points_aos_64k" + suffix, warmupSamples, samples, 10,
+					[&]() { TransformKernels::TransformPoints(points.data(), transformed.data(), pointCount, matrices[1]); },
+					nothing);
+				r.flopsPerOp = flopsPerPointTransform * pointCount;
+				results.push_back(r);
+
+				r = Measure(
+					"kernel_points_soa_64k" + suffix, warmupSamples, samples, 10,
+					[&]() {
+						TransformKernels::TransformPointsSoA(
+							xs.data(), ys.data(), zs.data(),
+							outX.data(), outY.data(), outZ.data(), nullptr,
+							pointCount, matrices[1]);
+					},
+					nothing);
+				r.flopsPerOp = flopsPerPointTransform * pointCount;
+				results.push_back(r);
+			}
+
+			TransformKernels::SetActive(TransformKernels::Detected());
+		}
+
+		// Iterating two components over many objects: one
+		// array of fat structs vs. packed component arrays
+		{
+			const unsigned int objectCount = 1000000;
+			std::vector<GameObjectAoS> objects(objectCount);
+			EntityWorld entities;
+			for (unsigned int i = 0; i < objectCount; i++)
+			{
+				objects[i].tint = Float4(1.0f, 0.5f, 0.25f, 1.0f);
+				objects[i].bounds = { Float3(0, 0, 0), 1.0f };
+				entities.Create(
+					MeshComponent{},
+					TintComponent{ objects[i].tint },
+					TransformComponent{ i },
+					objects[i].bounds);
+			}
+
+			results.push_back(Measure(
+				"iterate_1M_aos", warmupSamples, samples, 1,
+				[&]() {
+					for (GameObjectAoS& o : objects)
+						o.bounds.center.x += o.tint.x * 0.001f;
+				},
+				nothing));
+
+			results.push_back(Measure(
+				"iterate_1M_ecs", warmupSamples, samples, 1,
+				[&]() {
+					entities.ForEach<TintComponent, BoundsComponent>(
+						[](Entity, TintComponent& tint, BoundsComponent& bounds) { bounds.center.x += tint.color.x * 0.001f; });
+				},
+				nothing));
+
+			results.push_back(Measure(
+				"iterate_1M_ecs_parallel", warmupSamples, samples, 1,
+				[&]() {
+					entities.ParallelForEach<TintComponent, BoundsComponent>(
+						[](Entity, TintComponent& tint, BoundsComponent& bounds) { bounds.center.x += tint.color.x * 0.001f; });
+				},
+				nothing));
+		}
+
+		// Per-frame transient allocations: general heap vs.
+		// the frame arena (including its per-frame reset)
+		volatile float sink = 0.0f;
+		results.push_back(Measure(
+			"transient_frame_heap", warmupSamples, samples, 100,
+			[&]() { sink = TransientFrameWork<std::allocator>(256, [](size_t size) { return malloc(size); }, [](void* p) { ::free(p); }); },
+			nothing));
+
+		results.push_back(Measure(
+			"transient_frame_arena", warmupSamples, samples, 100,
+			[&]() {
+				sink = TransientFrameWork<FrameArena::Allocator>(256, [](size_t size) { return FrameArena::Allocate(size); }, [](void*) {});
+				FrameArena::Reset();
+			},
+			nothing));
+	}
+
+	// Compare against an earlier run, if we have one
+	unsigned int regressions = 0;
+	if (!baselinePath.empty())
+	{
+		std::map<std::string, double> baseline = LoadBaseline(baselinePath);
+		for (MicroResult& r : results)
+		{
+			auto it = baseline.find(r.name);
+			if (it == baseline.end() || it->second <= 0.0)
+				continue;
+
+			r.baselineMedian = it->second;
+			r.regressed = r.nsPerOp.median > r.baselineMedian * (1.0 + thresholdPercent / 100.0);
+			if (r.regressed)
+				regressions++;
+		}
+	}
+
+	for (const MicroResult& r : results)
+	{
+		if (r.flopsPerOp > 0.0)
+		{
+			printf("%-28s %12.1f ns/op (median)  +/- %8.1f  %7.2f GFLOP/s  %s\n",
+				r.name.c_str(), r.nsPerOp.median, r.nsPerOp.stdDev, GigaFlops(r), r.regressed ? "REGRESSED" : "");
+			continue;
+		}
+
+		printf("%-28s %12.1f ns/op (median)  +/- %8.1f  %s\n",
+			r.name.c_str(), r.nsPerOp.median, r.nsPerOp.stdDev, r.regressed ? "REGRESSED" : "");
+	}
+
+	bool written = WriteResults(outputPath, results, thresholdPercent, regressions);
+	if (written)
+		printf("Microbenchmark results written to %s\n", outputPath.c_str());
+
+	StopHeadless();
+	if (!written)
+		return 1;
+	return regressions > 0 ? 2 : 0;
+}
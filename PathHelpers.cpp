@@ -1,10 +1,68 @@
 
+#if defined(_WIN32)
 #include <Windows.h>
-#include <codecvt>
-#include <locale>
+#else
+#include <unistd.h>
+#endif
 
 #include "PathHelpers.h"
 
+#include <cstring>
+
+// Annonymous namespace to hold variables
+// only accessible in this file
+namespace
+{
+#if defined(_WIN32)
+	const char Separator = '\\';
+	const wchar_t WideSeparator = L'\\';
+#else
+	const char Separator = '/';
+	const wchar_t WideSeparator = L'/';
+#endif
+
+	// Asks the OS where the executable is (see GetExePath())
+	std::string FindExePath()
+	{
+		// Assume the path is just the "current directory" for now
+		std::string path = ".";
+
+		// Get the real, full path to this executable
+		char currentDir[1024] = {};
+#if defined(_WIN32)
+		GetModuleFileNameA(0, currentDir, 1024);
+#else
+		ssize_t length = readlink("/proc/self/exe", currentDir, sizeof(currentDir) - 1);
+		if (length > 0)
+			currentDir[length] = 0;
+#endif
+
+		// Find the location of the last slash charaacter
+		char* lastSlash = strrchr(currentDir, Separator);
+		if (lastSlash)
+		{
+			// End the string at the last slash character, essentially
+			// chopping off the exe's file name.  Remember, c-strings
+			// are null-terminated, so putting a "zero" character in 
+			// there simply denotes the end of the string.
+			*lastSlash = 0;
+
+			// Set the remainder as the path
+			path = currentDir;
+		}
+
+		// Toss back whatever we've found
+		return path;
+	}
+
+	// The exe path, already converted for FixPath(std::wstring)
+	const std::wstring& GetExePathWide()
+	{
+		static const std::wstring path = NarrowToWide(GetExePath());
+		return path;
+	}
+}
+
 // --------------------------------------------------------------------------
 // Gets the actual path to this executable
 //
@@ -19,31 +77,14 @@
 //    that option is stored in a user file (.suo), which is ignored by most
 //    version control packages by default.  Meaning: the option must be
 //    changed on every PC.  Ugh.  So instead, here's a helper.
+//
+// - The executable can't move while it's running, so the
+//    OS is only asked once and every call after that just
+//    returns the same string.
 // --------------------------------------------------------------------------
-std::string GetExePath()
+const std::string& GetExePath()
 {
-	// Assume the path is just the "current directory" for now
-	std::string path = ".\\";
-
-	// Get the real, full path to this executable
-	char currentDir[1024] = {};
-	GetModuleFileNameA(0, currentDir, 1024);
-
-	// Find the location of the last slash charaacter
-	char* lastSlash = strrchr(currentDir, '\\');
-	if (lastSlash)
-	{
-		// End the string at the last slash character, essentially
-		// chopping off the exe's file name.  Remember, c-strings
-		// are null-terminated, so putting a "zero" character in 
-		// there simply denotes the end of the string.
-		*lastSlash = 0;
-
-		// Set the remainder as the path
-		path = currentDir;
-	}
-
-	// Toss back whatever we've found
+	static const std::string path = FindExePath();
 	return path;
 }
 
@@ -57,7 +98,14 @@ std::string GetExePath()
 // ----------------------------------------------------
 std::string FixPath(const std::string& relativeFilePath)
 {
-	return GetExePath() + "\\" + relativeFilePath;
+	// Sized up front so the result is the only allocation
+	const std::string& exePath = GetExePath();
+	std::string path;
+	path.reserve(exePath.size() + 1 + relativeFilePath.size());
+	path += exePath;
+	path += Separator;
+	path += relativeFilePath;
+	return path;
 }
 
 
@@ -74,7 +122,13 @@ std::string FixPath(const std::string& relativeFilePath)
 // ---------------------------------------------------- 
 std::wstring FixPath(const std::wstring& relativeFilePath)
 {
-	return NarrowToWide(GetExePath()) + L"\\" + relativeFilePath;
+	const std::wstring& exePath = GetExePathWide();
+	std::wstring path;
+	path.reserve(exePath.size() + 1 + relativeFilePath.size());
+	path += exePath;
+	path += WideSeparator;
+	path += relativeFilePath;
+	return path;
 }
 
 
@@ -84,10 +138,41 @@ std::wstring FixPath(const std::wstring& relativeFilePath)
 // ----------------------------------------------------
 std::string WideToNarrow(const std::wstring& str)
 {
+#if defined(_WIN32)
 	int size = WideCharToMultiByte(CP_UTF8, 0, str.c_str(), (int)str.length(), 0, 0, 0, 0);
 	std::string result(size, 0);
 	WideCharToMultiByte(CP_UTF8, 0, str.c_str(), -1, &result[0], size, 0, 0);
 	return result;
+#else
+	// wchar_t is UTF-32 here, so it's encoded by hand
+	std::string result;
+	result.reserve(str.size());
+	for (wchar_t w : str)
+	{
+		unsigned long c = (unsigned long)w;
+		if (c < 0x80)
+			result += (char)c;
+		else if (c < 0x800)
+		{
+			result += (char)(0xC0 | (c >> 6));
+			result += (char)(0x80 | (c & 0x3F));
+		}
+		else if (c < 0x10000)
+		{
+			result += (char)(0xE0 | (c >> 12));
+			result += (char)(0x80 | ((c >> 6) & 0x3F));
+			result += (char)(0x80 | (c & 0x3F));
+		}
+		else
+		{
+			result += (char)(0xF0 | (c >> 18));
+			result += (char)(0x80 | ((c >> 12) & 0x3F));
+			result += (char)(0x80 | ((c >> 6) & 0x3F));
+			result += (char)(0x80 | (c & 0x3F));
+		}
+	}
+	return result;
+#endif
 }
 
 
@@ -97,8 +182,32 @@ std::string WideToNarrow(const std::wstring& str)
 // ----------------------------------------------------
 std::wstring NarrowToWide(const std::string& str)
 {
+#if defined(_WIN32)
 	int size = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), (int)str.length(), 0, 0);
 	std::wstring result(size, 0);
 	MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, &result[0], size);
 	return result;
+#else
+	// Decodes UTF-8 by hand, passing stray bytes through as is
+	std::wstring result;
+	result.reserve(str.size());
+	for (size_t i = 0; i < str.size(); )
+	{
+		unsigned char lead = (unsigned char)str[i];
+		size_t extra = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+		if (extra == 0 || i + extra >= str.size())
+		{
+			result += (wchar_t)lead;
+			i++;
+			continue;
+		}
+
+		unsigned long c = lead & (0x3F >> extra);
+		for (size_t k = 1; k <= extra; k++)
+			c = (c << 6) | ((unsigned char)str[i + k] & 0x3F);
+		result += (wchar_t)c;
+		i += extra + 1;
+	}
+	return result;
+#endif
 }
\ No newline at end of file
@@ -1,10 +1,10 @@
 #pragma once
 
 #include <string>
-#include <d3d11.h>
 
-// Helpers for determining the actual path to the executable
-std::string GetExePath();
+// Helpers for determining the actual path to the executable.
+// The path is only looked up once, so these are cheap to call.
+const std::string& GetExePath();
 std::string FixPath(const std::string& relativeFilePath);
 std::wstring FixPath(const std::wstring& relativeFilePath);
 std::string WideToNarrow(const std::wstring& str);
@@ -0,0 +1,189 @@
+#include "PerfCounters.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+namespace PerfCounters
+{
+	// Annonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		bool initialized = false;
+
+		// One file descriptor per counter, or -1 if unavailable
+		int counterFiles[CounterCount] = { -1, -1, -1, -1, -1 };
+
+		const char* counterNames[CounterCount] =
+		{
+			"cycles",
+			"instructions",
+			"cache_misses",
+			"branch_misses",
+			"tlb_misses",
+		};
+
+#if defined(__linux__)
+		// --------------------------------------------------------
+		// Opens a single user-mode counter for this thread
+		// --------------------------------------------------------
+		int OpenCounter(unsigned int type, unsigned long long config)
+		{
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = type;
+			attr.config = config;
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+
+			// Counters are opened individually (not as a group) so a
+			// missing one doesn't take the rest down with it, which
+			// means the kernel may multiplex them - ask for timing
+			// info so we can scale the results back up
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+			return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		}
+#endif
+	}
+}
+
+
+// --------------------------------------------------------
+// Instructions per cycle, or zero if either is missing
+// --------------------------------------------------------
+double PerfCounters::Sample::IPC() const
+{
+	if (!valid[Cycles] || !valid[Instructions] || values[Cycles] == 0)
+		return 0.0;
+
+	return (double)values[Instructions] / (double)values[Cycles];
+}
+
+
+// --------------------------------------------------------
+// Sums another sample into this one (a counter stays valid
+// only if it was valid in both)
+// --------------------------------------------------------
+void PerfCounters::Sample::Add(const Sample& other)
+{
+	for (int i = 0; i < CounterCount; i++)
+	{
+		values[i] += other.values[i];
+		valid[i] = valid[i] && other.valid[i];
+	}
+}
+
+
+// --------------------------------------------------------
+// Opens the counters.  Safe to call more than once.
+// --------------------------------------------------------
+bool PerfCounters::Initialize()
+{
+	if (initialized)
+		return Available();
+
+#if defined(__linux__)
+	counterFiles[Cycles] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	counterFiles[Instructions] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	counterFiles[CacheMisses] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+	counterFiles[BranchMisses] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+	counterFiles[TLBMisses] = OpenCounter(PERF_TYPE_HW_CACHE,
+		PERF_COUNT_HW_CACHE_DTLB |
+		(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		(PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#endif
+
+	initialized = true;
+	return Available();
+}
+
+
+// --------------------------------------------------------
+// Closes any counters that were opened
+// --------------------------------------------------------
+void PerfCounters::ShutDown()
+{
+	for (int i = 0; i < CounterCount; i++)
+	{
+#if defined(__linux__)
+		if (counterFiles[i] >= 0)
+			close(counterFiles[i]);
+#endif
+		counterFiles[i] = -1;
+	}
+
+	initialized = false;
+}
+
+
+// --------------------------------------------------------
+// Is at least one counter open?
+// --------------------------------------------------------
+bool PerfCounters::Available()
+{
+	for (int i = 0; i < CounterCount; i++)
+		if (counterFiles[i] >= 0)
+			return true;
+
+	return false;
+}
+
+const char* PerfCounters::Name(Counter counter) { return counterNames[counter]; }
+
+
+// --------------------------------------------------------
+// Zeroes and starts every open counter
+// --------------------------------------------------------
+void PerfCounters::Begin()
+{
+#if defined(__linux__)
+	for (int i = 0; i < CounterCount; i++)
+	{
+		if (counterFiles[i] < 0)
+			continue;
+
+		ioctl(counterFiles[i], PERF_EVENT_IOC_RESET, 0);
+		ioctl(counterFiles[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+
+// --------------------------------------------------------
+// Stops every open counter and reads its value, scaled up
+// if the kernel had to multiplex it with other counters
+// --------------------------------------------------------
+PerfCounters::Sample PerfCounters::End()
+{
+	Sample sample = {};
+
+#if defined(__linux__)
+	for (int i = 0; i < CounterCount; i++)
+	{
+		if (counterFiles[i] < 0)
+			continue;
+
+		ioctl(counterFiles[i], PERF_EVENT_IOC_DISABLE, 0);
+
+		// Value, time enabled, time running
+		unsigned long long data[3] = {};
+		if (read(counterFiles[i], data, sizeof(data)) != (ssize_t)sizeof(data) || data[2] == 0)
+			continue;
+
+		double scale = (double)data[1] / (double)data[2];
+		sample.values[i] = (unsigned long long)(data[0] * scale);
+		sample.valid[i] = true;
+	}
+#endif
+
+	return sample;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+// --------------------------------------------------------
+// Hardware performance counters for the benchmark harness
+//
+// On Linux these are read through perf_event_open() and
+// count user-mode events on the calling thread only.  On
+// other platforms (or when the kernel refuses access, see
+// /proc/sys/kernel/perf_event_paranoid) Initialize() fails
+// and every counter reads as unavailable.
+//
+// Usage:
+//
+//   PerfCounters::Initialize();
+//   PerfCounters::Begin();
+//   ...work...
+//   PerfCounters::Sample s = PerfCounters::End();
+// --------------------------------------------------------
+namespace PerfCounters
+{
+	enum Counter
+	{
+		Cycles,
+		Instructions,
+		CacheMisses,
+		BranchMisses,
+		TLBMisses,
+
+		CounterCount
+	};
+
+	// Counter values between one Begin()/End() pair
+	struct Sample
+	{
+		unsigned long long values[CounterCount];
+		bool valid[CounterCount];
+
+		double IPC() const;
+		void Add(const Sample& other);
+	};
+
+	// Opens whichever counters the OS will give us, returning
+	// true if at least one is available
+	bool Initialize();
+	void ShutDown();
+	bool Available();
+	const char* Name(Counter counter);
+
+	// Reset and enable, then disable and read
+	void Begin();
+	Sample End();
+}
@@ -0,0 +1,563 @@
+#include "PipelineCache.h"
+#include "Graphics.h"
+#include "MemoryTracker.h"
+#include "PathHelpers.h"
+#include "StringId.h"
+#include "Vfs.h"
+
+#include <d3dcompiler.h>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#pragma comment(lib, "d3dcompiler.lib")
+
+using Microsoft::WRL::ComPtr;
+
+PipelineDesc::PipelineDesc() :
+	features(0),
+	topology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST),
+	rasterizer(CD3D11_RASTERIZER_DESC(CD3D11_DEFAULT())),
+	blend(CD3D11_BLEND_DESC(CD3D11_DEFAULT())),
+	depthStencil(CD3D11_DEPTH_STENCIL_DESC(CD3D11_DEFAULT()))
+{
+}
+
+void PipelineState::Bind(ID3D11DeviceContext* context) const
+{
+	context->IASetPrimitiveTopology(topology);
+	context->IASetInputLayout(inputLayout.Get());
+	context->VSSetShader(vertexShader.Get(), 0, 0);
+	context->PSSetShader(pixelShader.Get(), 0, 0);
+	context->RSSetState(rasterizerState.Get());
+	context->OMSetBlendState(blendState.Get(), 0, 0xFFFFFFFF);
+	context->OMSetDepthStencilState(depthStencilState.Get(), 0);
+}
+
+
+namespace PipelineCache
+{
+	// Annonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		const uint32_t fileMagic = 0x434F5350;	// "PSOC"
+		const uint32_t fileVersion = 3;
+
+		struct ShaderFile
+		{
+			ComPtr<ID3DBlob> code;
+			uint64_t hash;
+		};
+
+		struct Entry
+		{
+			PipelineDesc desc;
+			PipelineState state;
+		};
+
+		std::mutex mutex;
+
+		// Byte code by file name and features (see ShaderKey()),
+		// so files are only read or compiled once
+		std::unordered_map<std::wstring, ShaderFile> shaderFiles;
+
+		// Shared objects, keyed by content hashes
+		std::unordered_map<uint64_t, ComPtr<ID3D11VertexShader>> vertexShaders;
+		std::unordered_map<uint64_t, ComPtr<ID3D11PixelShader>> pixelShaders;
+		std::unordered_map<uint64_t, ComPtr<ID3D11InputLayout>> inputLayouts;
+
+		// Map nodes don't move, so PipelineState pointers stay valid
+		std::unordered_map<uint64_t, Entry> pipelines;
+
+		size_t hits = 0;
+		size_t misses = 0;
+		bool createdSinceLoad = false;
+
+		// 64-bit FNV-1a, fed one field at a time so struct
+		// padding never ends up in the hash
+		struct Hasher
+		{
+			uint64_t value = 14695981039346656037ull;
+
+			void Bytes(const void* data, size_t size)
+			{
+				const unsigned char* bytes = (const unsigned char*)data;
+				for (size_t i = 0; i < size; i++)
+				{
+					value ^= bytes[i];
+					value *= 1099511628211ull;
+				}
+			}
+
+			template<typename T>
+			void Add(const T& field) { Bytes(&field, sizeof(T)); }
+
+			void Add(const char* str) { Bytes(str, strlen(str) + 1); }
+		};
+
+		bool IsSource(const std::wstring& file)
+		{
+			return file.size() >= 5 && file.compare(file.size() - 5, 5, L".hlsl") == 0;
+		}
+
+		// Precompiled .cso files are the same whatever the features
+		std::wstring ShaderKey(const std::wstring& file, ShaderFeatures features)
+		{
+			return IsSource(file) ? file + L"|" + std::to_wstring(features) : file;
+		}
+
+		// --------------------------------------------------------
+		// Reads a .cso file through the Vfs (a mounted pack, or
+		// loose next to the .exe), or gets a permutation of a
+		// .hlsl file (compiled or from the disk cache) from
+		// ShaderPermutations
+		// --------------------------------------------------------
+		const ShaderFile* LoadShader(const std::wstring& file, const char* target, ShaderFeatures features)
+		{
+			std::wstring key = ShaderKey(file, features);
+			auto it = shaderFiles.find(key);
+			if (it != shaderFiles.end())
+				return &it->second;
+
+			ShaderFile shader = {};
+			std::vector<unsigned char> code;
+			std::string name = WideToNarrow(file);
+			if (IsSource(file))
+			{
+				if (!ShaderPermutations::Load(name, target, features, code))
+					return 0;
+			}
+			else if (!Vfs::Read(name.c_str(), code))
+			{
+				printf("Pipeline cache: unable to read %s\n", name.c_str());
+				return 0;
+			}
+
+			if (FAILED(D3DCreateBlob(code.size(), shader.code.GetAddressOf())))
+				return 0;
+			memcpy(shader.code->GetBufferPointer(), code.data(), code.size());
+
+			Hasher hasher;
+			hasher.Bytes(shader.code->GetBufferPointer(), shader.code->GetBufferSize());
+			shader.hash = hasher.value;
+			return &(shaderFiles[key] = shader);
+		}
+
+		uint64_t HashVertexFormat(const std::vector<VertexElement>& elements)
+		{
+			Hasher hasher;
+			for (const VertexElement& e : elements)
+			{
+				hasher.Add(e.semantic);
+				hasher.Add(e.semanticIndex);
+				hasher.Add(e.type);
+				hasher.Add(e.offset);
+				hasher.Add(e.stream);
+				hasher.Add(e.perInstance);
+			}
+			return hasher.value;
+		}
+
+		void HashStates(Hasher& hasher, const PipelineDesc& desc)
+		{
+			hasher.Add(desc.topology);
+
+			// All 4-byte fields, no padding
+			hasher.Add(desc.rasterizer);
+
+			const D3D11_BLEND_DESC& blend = desc.blend;
+			hasher.Add(blend.AlphaToCoverageEnable);
+			hasher.Add(blend.IndependentBlendEnable);
+			for (const D3D11_RENDER_TARGET_BLEND_DESC& target : blend.RenderTarget)
+			{
+				hasher.Add(target.BlendEnable);
+				hasher.Add(target.SrcBlend);
+				hasher.Add(target.DestBlend);
+				hasher.Add(target.BlendOp);
+				hasher.Add(target.SrcBlendAlpha);
+				hasher.Add(target.DestBlendAlpha);
+				hasher.Add(target.BlendOpAlpha);
+				hasher.Add(target.RenderTargetWriteMask);
+			}
+
+			const D3D11_DEPTH_STENCIL_DESC& depth = desc.depthStencil;
+			hasher.Add(depth.DepthEnable);
+			hasher.Add(depth.DepthWriteMask);
+			hasher.Add(depth.DepthFunc);
+			hasher.Add(depth.StencilEnable);
+			hasher.Add(depth.StencilReadMask);
+			hasher.Add(depth.StencilWriteMask);
+			for (const D3D11_DEPTH_STENCILOP_DESC* face : { &depth.FrontFace, &depth.BackFace })
+			{
+				hasher.Add(face->StencilFailOp);
+				hasher.Add(face->StencilDepthFailOp);
+				hasher.Add(face->StencilPassOp);
+				hasher.Add(face->StencilFunc);
+			}
+		}
+
+		uint64_t HashPipeline(const PipelineDesc& desc, const ShaderFile& vs, const ShaderFile& ps, uint64_t formatHash)
+		{
+			Hasher hasher;
+			hasher.Add(vs.hash);
+			hasher.Add(ps.hash);
+			hasher.Add(formatHash);
+			HashStates(hasher, desc);
+			return hasher.value;
+		}
+
+		// --------------------------------------------------------
+		// Creates (or reuses) every object a pipeline needs
+		// --------------------------------------------------------
+		bool CreateState(const PipelineDesc& desc, const ShaderFile& vs, const ShaderFile& ps, uint64_t formatHash, PipelineState& state)
+		{
+			ID3D11Device* device = Graphics::Device.Get();
+			state.topology = desc.topology;
+
+			ComPtr<ID3D11VertexShader>& vertexShader = vertexShaders[vs.hash];
+			if (!vertexShader)
+				device->CreateVertexShader(vs.code->GetBufferPointer(), vs.code->GetBufferSize(), 0, vertexShader.GetAddressOf());
+
+			ComPtr<ID3D11PixelShader>& pixelShader = pixelShaders[ps.hash];
+			if (!pixelShader)
+				device->CreatePixelShader(ps.code->GetBufferPointer(), ps.code->GetBufferSize(), 0, pixelShader.GetAddressOf());
+
+			// Layouts depend only on the vertex shader's input signature and format
+			Hasher layoutHasher;
+			layoutHasher.Add(vs.hash);
+			layoutHasher.Add(formatHash);
+			ComPtr<ID3D11InputLayout>& inputLayout = inputLayouts[layoutHasher.value];
+			if (!inputLayout && !desc.vertexFormat.empty())
+			{
+				ValidateVertexFormat(desc.vertexFormat.data(), desc.vertexFormat.size(), vs.code->GetBufferPointer(), vs.code->GetBufferSize());
+
+				std::vector<D3D11_INPUT_ELEMENT_DESC> elements;
+				for (const VertexElement& e : desc.vertexFormat)
+					elements.push_back(InputElement(e));
+
+				device->CreateInputLayout(
+					elements.data(),
+					(UINT)elements.size(),
+					vs.code->GetBufferPointer(),
+					vs.code->GetBufferSize(),
+					inputLayout.GetAddressOf());
+			}
+
+			// The runtime already hands back the same state object for
+			// identical descriptions, so these don't need their own maps
+			device->CreateRasterizerState(&desc.rasterizer, state.rasterizerState.GetAddressOf());
+			device->CreateBlendState(&desc.blend, state.blendState.GetAddressOf());
+			device->CreateDepthStencilState(&desc.depthStencil, state.depthStencilState.GetAddressOf());
+
+			state.vertexShader = vertexShader;
+			state.pixelShader = pixelShader;
+			state.inputLayout = inputLayout;
+			state.vertexShaderCode = vs.code;
+			state.pixelShaderCode = ps.code;
+
+			return
+				state.vertexShader && state.pixelShader &&
+				(state.inputLayout || desc.vertexFormat.empty()) &&
+				state.rasterizerState && state.blendState && state.depthStencilState;
+		}
+
+
+		// --------------------------------------------------------
+		// Cache file reading and writing
+		// --------------------------------------------------------
+		template<typename T>
+		void Write(FILE* file, const T& value) { fwrite(&value, sizeof(T), 1, file); }
+
+		template<typename T>
+		bool Read(FILE* file, T& value) { return fread(&value, sizeof(T), 1, file) == 1; }
+
+		void WriteString(FILE* file, const std::wstring& str)
+		{
+			Write(file, (uint32_t)str.size());
+			fwrite(str.data(), sizeof(wchar_t), str.size(), file);
+		}
+
+		void WriteString(FILE* file, const char* str)
+		{
+			uint32_t length = (uint32_t)strlen(str);
+			Write(file, length);
+			fwrite(str, 1, length, file);
+		}
+
+		template<typename Char>
+		bool ReadString(FILE* file, std::basic_string<Char>& str)
+		{
+			uint32_t length = 0;
+			if (!Read(file, length) || length > 4096)
+				return false;
+
+			str.resize(length);
+			return fread(str.data(), sizeof(Char), length, file) == length;
+		}
+
+		bool ReadDesc(FILE* file, PipelineDesc& desc)
+		{
+			uint32_t elementCount = 0;
+			if (!ReadString(file, desc.vertexShader) ||
+				!ReadString(file, desc.pixelShader) ||
+				!Read(file, desc.features) ||
+				!Read(file, desc.topology) ||
+				!Read(file, desc.rasterizer) ||
+				!Read(file, desc.blend) ||
+				!Read(file, desc.depthStencil) ||
+				!Read(file, elementCount) ||
+				elementCount > D3D11_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT)
+				return false;
+
+			desc.vertexFormat.resize(elementCount);
+			for (VertexElement& e : desc.vertexFormat)
+			{
+				std::string semantic;
+				if (!ReadString(file, semantic) ||
+					!Read(file, e.semanticIndex) ||
+					!Read(file, e.type) ||
+					!Read(file, e.offset) ||
+					!Read(file, e.stream) ||
+					!Read(file, e.perInstance))
+					return false;
+
+				// Interned text lives for the rest of the program
+				e.semantic = StringId::Intern(semantic.c_str()).GetString();
+			}
+			return true;
+		}
+
+		void WriteDesc(FILE* file, const PipelineDesc& desc)
+		{
+			WriteString(file, desc.vertexShader);
+			WriteString(file, desc.pixelShader);
+			Write(file, desc.features);
+			Write(file, desc.topology);
+			Write(file, desc.rasterizer);
+			Write(file, desc.blend);
+			Write(file, desc.depthStencil);
+			Write(file, (uint32_t)desc.vertexFormat.size());
+			for (const VertexElement& e : desc.vertexFormat)
+			{
+				WriteString(file, e.semantic);
+				Write(file, e.semanticIndex);
+				Write(file, e.type);
+				Write(file, e.offset);
+				Write(file, e.stream);
+				Write(file, e.perInstance);
+			}
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Returns the pipeline for a description, creating it the
+// first time that exact combination is requested
+// --------------------------------------------------------
+const PipelineState* PipelineCache::Get(const PipelineDesc& desc)
+{
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Graphics);
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const ShaderFile* vs = LoadShader(desc.vertexShader, "vs_5_0", desc.features);
+	const ShaderFile* ps = LoadShader(desc.pixelShader, "ps_5_0", desc.features);
+	if (!vs || !ps)
+		return 0;
+
+	uint64_t formatHash = HashVertexFormat(desc.vertexFormat);
+
+	uint64_t hash = HashPipeline(desc, *vs, *ps, formatHash);
+
+	auto it = pipelines.find(hash);
+	if (it != pipelines.end())
+	{
+		hits++;
+		return &it->second.state;
+	}
+
+	misses++;
+	Entry entry;
+	entry.desc = desc;
+	entry.state.hash = hash;
+	if (!CreateState(desc, *vs, *ps, formatHash, entry.state))
+	{
+		printf("Pipeline cache: unable to create pipeline for %s / %s\n",
+			WideToNarrow(desc.vertexShader).c_str(), WideToNarrow(desc.pixelShader).c_str());
+		return 0;
+	}
+
+	createdSinceLoad = true;
+	return &pipelines.emplace(hash, std::move(entry)).first->second.state;
+}
+
+
+// --------------------------------------------------------
+// Swaps new byte code in for a shader file and rebuilds
+// every pipeline that uses it.  All of them are rebuilt
+// before any are replaced, so either every pipeline moves
+// to the new shader or (if one fails) none do.
+//
+// file     - .cso or .hlsl name the shader was loaded by
+// features - Permutation (ignored for .cso files)
+// code     - New byte code
+// size     - Size of the byte code
+// --------------------------------------------------------
+size_t PipelineCache::ReplaceShader(const std::wstring& file, ShaderFeatures features, const void* code, size_t size)
+{
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Graphics);
+	std::lock_guard<std::mutex> lock(mutex);
+
+	ShaderFile shader = {};
+	if (FAILED(D3DCreateBlob(size, shader.code.GetAddressOf())))
+		return 0;
+	memcpy(shader.code->GetBufferPointer(), code, size);
+
+	Hasher hasher;
+	hasher.Bytes(code, size);
+	shader.hash = hasher.value;
+
+	std::wstring key = ShaderKey(file, features);
+	auto previous = shaderFiles.find(key);
+	if (previous == shaderFiles.end() || previous->second.hash == shader.hash)
+		return 0;
+
+	ShaderFile old = previous->second;
+	previous->second = shader;
+
+	struct Rebuilt
+	{
+		uint64_t oldHash;
+		PipelineState state;
+	};
+	std::vector<Rebuilt> rebuilt;
+	for (auto& [hash, entry] : pipelines)
+	{
+		const PipelineDesc& desc = entry.desc;
+		std::wstring vsKey = ShaderKey(desc.vertexShader, desc.features);
+		std::wstring psKey = ShaderKey(desc.pixelShader, desc.features);
+		if (vsKey != key && psKey != key)
+			continue;
+
+		const ShaderFile& vs = shaderFiles[vsKey];
+		const ShaderFile& ps = shaderFiles[psKey];
+		uint64_t formatHash = HashVertexFormat(desc.vertexFormat);
+
+		Rebuilt r;
+		r.oldHash = hash;
+		r.state.hash = HashPipeline(desc, vs, ps, formatHash);
+		if (pipelines.count(r.state.hash) || !CreateState(desc, vs, ps, formatHash, r.state))
+		{
+			printf("Pipeline cache: %s doesn't work with %s / %s, keeping the old shader\n",
+				WideToNarrow(file).c_str(), WideToNarrow(desc.vertexShader).c_str(), WideToNarrow(desc.pixelShader).c_str());
+			previous->second = old;
+			return 0;
+		}
+		rebuilt.push_back(std::move(r));
+	}
+
+	// Re-keying through extract() keeps each node where it is,
+	// so PipelineState pointers handed out earlier stay valid
+	for (Rebuilt& r : rebuilt)
+	{
+		auto node = pipelines.extract(r.oldHash);
+		node.key() = r.state.hash;
+		node.mapped().state = std::move(r.state);
+		pipelines.insert(std::move(node));
+	}
+
+	return rebuilt.size();
+}
+
+
+// --------------------------------------------------------
+// Creates every pipeline listed in a file from Save()
+//
+// path - Full path of the cache file
+// --------------------------------------------------------
+size_t PipelineCache::Prewarm(const std::wstring& path)
+{
+	FILE* file = 0;
+	if (_wfopen_s(&file, path.c_str(), L"rb") != 0 || !file)
+		return 0;
+
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	uint32_t count = 0;
+	if (!Read(file, magic) || !Read(file, version) || !Read(file, count) ||
+		magic != fileMagic || version != fileVersion)
+	{
+		fclose(file);
+		return 0;
+	}
+
+	size_t created = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		PipelineDesc desc;
+		if (!ReadDesc(file, desc))
+			break;
+
+		size_t before = Count();
+		if (Get(desc) && Count() > before)
+			created++;
+	}
+	fclose(file);
+
+	// Only things created after this point make the file stale
+	std::lock_guard<std::mutex> lock(mutex);
+	createdSinceLoad = false;
+	return created;
+}
+
+
+// --------------------------------------------------------
+// Writes the description of every pipeline created so far
+//
+// path - Full path of the cache file
+// --------------------------------------------------------
+bool PipelineCache::Save(const std::wstring& path)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!createdSinceLoad)
+		return true;
+
+	FILE* file = 0;
+	if (_wfopen_s(&file, path.c_str(), L"wb") != 0 || !file)
+		return false;
+
+	Write(file, fileMagic);
+	Write(file, fileVersion);
+	Write(file, (uint32_t)pipelines.size());
+	for (const auto& [hash, entry] : pipelines)
+		WriteDesc(file, entry.desc);
+
+	bool written = ferror(file) == 0;
+	fclose(file);
+	createdSinceLoad = !written;
+	return written;
+}
+
+void PipelineCache::ShutDown()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	pipelines.clear();
+	inputLayouts.clear();
+	pixelShaders.clear();
+	vertexShaders.clear();
+	shaderFiles.clear();
+	hits = 0;
+	misses = 0;
+	createdSinceLoad = false;
+}
+
+size_t PipelineCache::Count()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pipelines.size();
+}
+
+size_t PipelineCache::Hits() { return hits; }
+size_t PipelineCache::Misses() { return misses; }
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ShaderPermutations.h"
+#include "VertexFormat.h"
+
+// --------------------------------------------------------
+// Everything needed to set up the pipeline for a draw:
+// shaders, vertex format, primitive topology and
+// fixed-function states.  Defaults match D3D11's own
+// defaults.
+//
+// Shaders are either precompiled .cso files (relative to
+// the .exe) or .hlsl uber-shaders, in which case features
+// picks the permutation (see ShaderPermutations).
+// --------------------------------------------------------
+struct PipelineDesc
+{
+	std::wstring vertexShader;
+	std::wstring pixelShader;
+	ShaderFeatures features;
+	std::vector<VertexElement> vertexFormat;
+	D3D11_PRIMITIVE_TOPOLOGY topology;
+	D3D11_RASTERIZER_DESC rasterizer;
+	D3D11_BLEND_DESC blend;
+	D3D11_DEPTH_STENCIL_DESC depthStencil;
+
+	PipelineDesc();
+
+	template<size_t N>
+	void SetVertexFormat(const VertexFormat<N>& format)
+	{
+		vertexFormat.assign(format.elements.begin(), format.elements.end());
+	}
+};
+
+// --------------------------------------------------------
+// Immutable bundle of created pipeline objects - D3D11's
+// closest equivalent to a pipeline state object
+// --------------------------------------------------------
+struct PipelineState
+{
+	uint64_t hash;
+	D3D11_PRIMITIVE_TOPOLOGY topology;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> vertexShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> pixelShader;
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizerState;
+	Microsoft::WRL::ComPtr<ID3D11BlendState> blendState;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthStencilState;
+
+	// Byte code, kept for reflection (constant buffer layouts)
+	Microsoft::WRL::ComPtr<ID3DBlob> vertexShaderCode;
+	Microsoft::WRL::ComPtr<ID3DBlob> pixelShaderCode;
+
+	// Sets every part of the pipeline this state covers
+	void Bind(ID3D11DeviceContext* context) const;
+};
+
+// --------------------------------------------------------
+// Creates each distinct pipeline once
+//
+// Descriptions are hashed as a whole - shader byte code
+// (not file names), vertex format and states - and equal
+// hashes return the same PipelineState.  Shaders and input
+// layouts are shared between pipelines that use them.
+//
+// D3D11 objects can't be saved, but their descriptions can:
+// Save() writes every pipeline created this run and
+// Prewarm() recreates them all at startup, so nothing is
+// created on demand later on.
+//
+// Usage:
+//
+//   PipelineDesc desc;
+//   desc.vertexShader = L"VertexShader.cso";
+//   desc.pixelShader = L"PixelShader.cso";
+//   desc.SetVertexFormat(VertexLayout);
+//   const PipelineState* pipeline = PipelineCache::Get(desc);
+//   pipeline->Bind(Graphics::Context.Get());
+// --------------------------------------------------------
+namespace PipelineCache
+{
+	// Null if a shader is missing or creation failed
+	const PipelineState* Get(const PipelineDesc& desc);
+
+	// Returns how many pipelines were created from the file
+	size_t Prewarm(const std::wstring& path);
+
+	// --------------------------------------------------------
+	// Rebuilds every pipeline using a shader file with new
+	// byte code (hot reloading).  Existing PipelineState
+	// pointers stay valid but their contents change, so call
+	// this between frames and rebind afterwards.  Returns how
+	// many pipelines were rebuilt.
+	// --------------------------------------------------------
+	size_t ReplaceShader(const std::wstring& file, ShaderFeatures features, const void* code, size_t size);
+
+	// Only writes if something new was created since Prewarm()
+	bool Save(const std::wstring& path);
+
+	void ShutDown();
+
+	size_t Count();
+	size_t Hits();
+	size_t Misses();
+}
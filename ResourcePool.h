@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// --------------------------------------------------------
+// 32-bit generational handle to an object in a ResourcePool
+//
+// The low bits index a slot in the pool and the high bits
+// hold the slot's generation when the handle was made.
+// Destroying an object bumps its slot's generation, so any
+// old handles to it stop resolving instead of dangling.
+// A value of zero is never a valid handle.
+// --------------------------------------------------------
+template<typename T>
+struct Handle
+{
+	static const unsigned int IndexBits = 20;
+	static const unsigned int GenerationBits = 32 - IndexBits;
+	static const uint32_t IndexMask = (1u << IndexBits) - 1;
+	static const uint32_t GenerationMask = (1u << GenerationBits) - 1;
+
+	uint32_t value = 0;
+
+	uint32_t Index() const { return value & IndexMask; }
+	uint32_t Generation() const { return value >> IndexBits; }
+	bool IsNull() const { return value == 0; }
+
+	bool operator==(const Handle& other) const { return value == other.value; }
+	bool operator!=(const Handle& other) const { return value != other.value; }
+};
+
+
+// --------------------------------------------------------
+// Dense pool of objects addressed by generational handles
+//
+// Live objects are packed into one contiguous array (swap
+// and pop on removal), and a separate slot table maps each
+// handle to its object's current position, so lookups are
+// O(1) and iterating every object touches no gaps.
+//
+// Release() is deferred: the handle goes stale right away,
+// but the object itself is kept alive until AdvanceFrame()
+// has been called framesInFlight times, so the GPU can
+// finish any work that still references it.
+//
+// Usage:
+//
+//   Handle<Mesh> h = pool.Create("Quad", verts, 4, indices, 6);
+//   if (Mesh* mesh = pool.Get(h))
+//       mesh->DrawBuff();
+//   pool.Release(h);
+// --------------------------------------------------------
+template<typename T>
+class ResourcePool
+{
+public:
+	ResourcePool() = default;
+	ResourcePool(const ResourcePool&) = delete;
+	ResourcePool& operator=(const ResourcePool&) = delete;
+
+	// Constructs a new object in the pool, or returns
+	// a null handle if every slot is in use
+	template<typename... Args>
+	Handle<T> Create(Args&&... args)
+	{
+		uint32_t slot = 0;
+		if (!freeSlots.empty())
+		{
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else
+		{
+			// Slot zero is never handed out, so a
+			// zero handle can't resolve to anything
+			if (slots.empty())
+				slots.push_back({ 0, 0 });
+			if (slots.size() > Handle<T>::IndexMask)
+				return {};
+
+			slot = (uint32_t)slots.size();
+			slots.push_back({ 0, 1 });
+		}
+
+		slots[slot].dense = (uint32_t)objects.size();
+		objects.emplace_back(std::forward<Args>(args)...);
+		denseToSlot.push_back(slot);
+
+		Handle<T> handle;
+		handle.value = (slots[slot].generation << Handle<T>::IndexBits) | slot;
+		return handle;
+	}
+
+	// Returns the object, or null if the handle is stale
+	T* Get(Handle<T> handle)
+	{
+		uint32_t slot = handle.Index();
+		if (handle.IsNull() || slot >= slots.size() || slots[slot].generation != handle.Generation())
+			return 0;
+
+		return &objects[slots[slot].dense];
+	}
+
+	bool IsValid(Handle<T> handle) const
+	{
+		uint32_t slot = handle.Index();
+		return !handle.IsNull() && slot < slots.size() && slots[slot].generation == handle.Generation();
+	}
+
+	// Invalidates the handle now and destroys the
+	// object once the GPU can no longer be using it
+	void Release(Handle<T> handle)
+	{
+		if (!IsValid(handle))
+			return;
+
+		uint32_t slot = handle.Index();
+		uint32_t dense = slots[slot].dense;
+
+		// Park the object until it's safe to destroy
+		pending.push_back({ std::move(objects[dense]), frame });
+
+		// Keep the array dense by moving the last object into the hole
+		uint32_t last = (uint32_t)objects.size() - 1;
+		if (dense != last)
+		{
+			objects[dense] = std::move(objects[last]);
+			denseToSlot[dense] = denseToSlot[last];
+			slots[denseToSlot[dense]].dense = dense;
+		}
+		objects.pop_back();
+		denseToSlot.pop_back();
+
+		// Stale out old handles (skipping zero so a
+		// recycled slot never produces a null handle)
+		uint32_t generation = (slots[slot].generation + 1) & Handle<T>::GenerationMask;
+		slots[slot].generation = generation == 0 ? 1 : generation;
+		freeSlots.push_back(slot);
+	}
+
+	// Moves to the next frame, destroying anything released
+	// at least framesInFlight frames ago
+	void AdvanceFrame(unsigned int framesInFlight)
+	{
+		frame++;
+
+		size_t expired = 0;
+		while (expired < pending.size() && pending[expired].frame + framesInFlight <= frame)
+			expired++;
+
+		if (expired > 0)
+			pending.erase(pending.begin(), pending.begin() + expired);
+	}
+
+	// Destroys every object immediately, including pending ones
+	void Clear()
+	{
+		for (uint32_t slot : denseToSlot)
+		{
+			uint32_t generation = (slots[slot].generation + 1) & Handle<T>::GenerationMask;
+			slots[slot].generation = generation == 0 ? 1 : generation;
+			freeSlots.push_back(slot);
+		}
+
+		objects.clear();
+		denseToSlot.clear();
+		pending.clear();
+	}
+
+	// Dense iteration over live objects (order isn't stable)
+	T* begin() { return objects.data(); }
+	T* end() { return objects.data() + objects.size(); }
+	size_t Count() const { return objects.size(); }
+	size_t PendingCount() const { return pending.size(); }
+
+private:
+	struct Slot
+	{
+		uint32_t dense;			// Position in objects
+		uint32_t generation;
+	};
+
+	struct PendingObject
+	{
+		T object;
+		unsigned long long frame;	// When it was released
+	};
+
+	std::vector<T> objects;
+	std::vector<uint32_t> denseToSlot;
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeSlots;
+	std::vector<PendingObject> pending;
+	unsigned long long frame = 0;
+};
@@ -0,0 +1,95 @@
+#include "Resources.h"
+#include "MeshFile.h"
+#include "Vfs.h"
+
+#include <cstdio>
+
+#include <unordered_map>
+
+namespace Resources
+{
+	// Annonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		ResourcePool<Mesh> meshes;
+		std::unordered_map<StringId, MeshHandle, StringIdHasher> meshesByName;
+	}
+}
+
+ResourcePool<Mesh>& Resources::Meshes() { return meshes; }
+
+
+// --------------------------------------------------------
+// Creates a mesh in the pool and records it by name
+// --------------------------------------------------------
+MeshHandle Resources::CreateMesh(const char* name, Vertex* vertices, size_t vertexCount, unsigned int* indices, size_t indexCount)
+{
+	MeshHandle handle = meshes.Create(name, vertices, vertexCount, indices, indexCount);
+	if (Mesh* mesh = meshes.Get(handle))
+		meshesByName[mesh->GetNameId()] = handle;
+	return handle;
+}
+
+
+// --------------------------------------------------------
+// Maps a .mesh file just long enough to create the mesh's
+// buffers from it.  The path goes through the Vfs first:
+// meshes stored in a mounted pack (or memory) are used
+// right where they are, and loose ones are found through
+// their directory mount.
+// --------------------------------------------------------
+MeshHandle Resources::LoadMesh(const char* name, const std::string& path)
+{
+	MeshFile file;
+	size_t mappedSize = 0;
+	const unsigned char* mapped = Vfs::Map(path.c_str(), mappedSize);
+	const char* realPath = mapped ? 0 : Vfs::RealPath(path.c_str());
+	if (mapped ? !file.Open(mapped, mappedSize) : !file.Open(realPath ? realPath : path))
+		return {};
+
+	if (!file.Matches(VertexLayout))
+	{
+		printf("Resources: %s doesn't use the Vertex format\n", path.c_str());
+		return {};
+	}
+
+	MeshHandle handle = meshes.Create(name, file);
+	if (Mesh* mesh = meshes.Get(handle))
+		meshesByName[mesh->GetNameId()] = handle;
+	return handle;
+}
+
+
+// --------------------------------------------------------
+// Looks up a mesh by name, returning a null handle if
+// there isn't one (or it has since been released)
+// --------------------------------------------------------
+MeshHandle Resources::FindMesh(StringId name)
+{
+	auto it = meshesByName.find(name);
+	if (it == meshesByName.end() || !meshes.IsValid(it->second))
+		return {};
+
+	return it->second;
+}
+
+
+// --------------------------------------------------------
+// Advances every pool, destroying resources that were
+// released long enough ago that the GPU is done with them
+// --------------------------------------------------------
+void Resources::EndFrame()
+{
+	meshes.AdvanceFrame(FramesInFlight);
+}
+
+
+// --------------------------------------------------------
+// Destroys every resource, whether or not it was released
+// --------------------------------------------------------
+void Resources::ShutDown()
+{
+	meshes.Clear();
+	meshesByName.clear();
+}
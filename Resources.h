@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Mesh.h"
+#include "ResourcePool.h"
+#include "StringId.h"
+
+#include <string>
+
+using MeshHandle = Handle<Mesh>;
+
+// --------------------------------------------------------
+// Owns every GPU-backed resource in the engine, each kind
+// in its own ResourcePool.  Code holds handles rather than
+// pointers, and looks objects up when it needs them.
+//
+// Released resources are destroyed FramesInFlight frames
+// later, once EndFrame() has been called that many times.
+// --------------------------------------------------------
+namespace Resources
+{
+	// How many frames the GPU may still be working on
+	const unsigned int FramesInFlight = 3;
+
+	ResourcePool<Mesh>& Meshes();
+
+	// Creates a mesh that can also be found by name later.
+	// If names repeat, FindMesh() returns the newest one.
+	MeshHandle CreateMesh(const char* name, Vertex* vertices, size_t vertexCount, unsigned int* indices, size_t indexCount);
+	MeshHandle FindMesh(StringId name);
+
+	// Creates a mesh from a .mesh file, mapped and handed
+	// straight to the GPU.  Returns a null handle if the file
+	// is missing, corrupt or not in the Vertex format.
+	MeshHandle LoadMesh(const char* name, const std::string& path);
+
+	// Once per frame, after the frame's work is submitted
+	void EndFrame();
+
+	// Destroys everything right away (GPU must be idle)
+	void ShutDown();
+}
@@ -0,0 +1,244 @@
+#include "ShaderHotReload.h"
+#include "FileWatcher.h"
+#include "MemoryTracker.h"
+#include "ShaderPermutations.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include "PathHelpers.h"
+#include "PipelineCache.h"
+#endif
+
+namespace ShaderHotReload
+{
+	// Annonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		struct WatchedShader
+		{
+			std::string compiledFile;
+			std::string sourceFile;
+			std::string target;
+		};
+
+		// file is the name the pipeline cache knows it by: the
+		// .cso, or the .hlsl plus features for a permutation
+		struct CompiledShader
+		{
+			std::string file;
+			ShaderFeatures features;
+			std::vector<unsigned char> code;
+		};
+
+		// Only changed before Start(), so the thread can read it freely
+		std::vector<WatchedShader> shaders;
+
+		// Only touched by the background thread while it runs
+		FileWatcher sourceWatcher;
+		FileWatcher compiledWatcher;
+		std::string sourceDirectory;
+		std::string compiledDirectory;
+
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable wakeCondition;
+		bool quitting = false;
+
+		// Shaders waiting for ApplyPending(), guarded by mutex
+		std::vector<CompiledShader> finished;
+		std::atomic<bool> anyFinished = false;
+
+		size_t reloads = 0;
+
+		// How often the thread checks for changed files
+		const std::chrono::milliseconds pollInterval(100);
+
+		bool ReadFile(const std::string& path, std::vector<unsigned char>& code)
+		{
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			if (!file)
+				return false;
+
+			std::streamoff size = file.tellg();
+			file.seekg(0);
+			code.resize(size > 0 ? (size_t)size : 0);
+			return size > 0 && file.read((char*)code.data(), size);
+		}
+
+		// --------------------------------------------------------
+		// Compiles or re-reads whatever shader a changed file
+		// belongs to
+		// --------------------------------------------------------
+		void HandleChange(const std::string& file, const std::string& directory, std::vector<CompiledShader>& results)
+		{
+			for (const WatchedShader& shader : shaders)
+			{
+				// Every permutation in use is rebuilt.  The source's
+				// hash changed, so these miss the disk cache and compile.
+				if (directory == sourceDirectory && file == shader.sourceFile)
+				{
+					for (const ShaderPermutations::Permutation& p : ShaderPermutations::Loaded(shader.sourceFile))
+					{
+						CompiledShader compiled = { shader.sourceFile, p.features, {} };
+						if (p.target == shader.target &&
+							ShaderPermutations::Load(shader.sourceFile, p.target.c_str(), p.features, compiled.code))
+							results.push_back(std::move(compiled));
+					}
+				}
+
+				if (directory == compiledDirectory && file == shader.compiledFile)
+				{
+					CompiledShader compiled = { shader.compiledFile, 0, {} };
+					if (ReadFile(compiledDirectory + "/" + shader.compiledFile, compiled.code))
+						results.push_back(std::move(compiled));
+				}
+			}
+		}
+
+		void ThreadMain()
+		{
+			MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Shaders);
+
+			std::vector<std::string> changed;
+			std::vector<CompiledShader> results;
+
+			std::unique_lock<std::mutex> lock(mutex);
+			while (!wakeCondition.wait_for(lock, pollInterval, []() { return quitting; }))
+			{
+				// Compiling can take a while, and ApplyPending()
+				// must never wait for it
+				lock.unlock();
+
+				changed.clear();
+				sourceWatcher.Poll(changed);
+				for (const std::string& file : changed)
+					HandleChange(file, sourceDirectory, results);
+
+				changed.clear();
+				compiledWatcher.Poll(changed);
+				for (const std::string& file : changed)
+					HandleChange(file, compiledDirectory, results);
+
+				lock.lock();
+				if (!results.empty())
+				{
+					for (CompiledShader& compiled : results)
+						finished.push_back(std::move(compiled));
+					results.clear();
+					anyFinished = true;
+				}
+			}
+		}
+	}
+}
+
+
+void ShaderHotReload::Watch(const std::string& compiledFile, const std::string& sourceFile, const char* target)
+{
+	for (const WatchedShader& shader : shaders)
+	{
+		if (shader.compiledFile == compiledFile)
+			return;
+	}
+
+	shaders.push_back({ compiledFile, sourceFile, target });
+}
+
+
+// --------------------------------------------------------
+// Starts watching and the background compile thread
+//
+// sourceDirectory - Where the .hlsl files live
+// --------------------------------------------------------
+bool ShaderHotReload::Start(const std::string& directory)
+{
+	if (thread.joinable())
+		return true;
+
+	sourceDirectory = directory;
+#if defined(_WIN32)
+	compiledDirectory = GetExePath();
+#else
+	compiledDirectory = directory;
+#endif
+
+	// One watcher is enough if both live in the same place
+	bool watching = sourceWatcher.Start(sourceDirectory);
+	if (compiledDirectory != sourceDirectory)
+		watching = compiledWatcher.Start(compiledDirectory) || watching;
+	if (!watching)
+		return false;
+
+	quitting = false;
+	thread = std::thread(ThreadMain);
+	return true;
+}
+
+
+void ShaderHotReload::ShutDown()
+{
+	if (thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quitting = true;
+		}
+		wakeCondition.notify_all();
+		thread.join();
+	}
+
+	sourceWatcher.Stop();
+	compiledWatcher.Stop();
+	shaders.clear();
+	finished.clear();
+	anyFinished = false;
+}
+
+
+// --------------------------------------------------------
+// Swaps every shader finished since the last call into the
+// pipeline cache.  Call between frames - any pipeline may
+// change, so everything bound needs binding again after.
+// --------------------------------------------------------
+size_t ShaderHotReload::ApplyPending()
+{
+	// Nearly every frame has nothing to do, so skip the lock
+	if (!anyFinished.load(std::memory_order_acquire))
+		return 0;
+
+	std::vector<CompiledShader> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		ready.swap(finished);
+		anyFinished = false;
+	}
+
+	size_t rebuilt = 0;
+#if defined(_WIN32)
+	for (const CompiledShader& compiled : ready)
+	{
+		size_t pipelines = PipelineCache::ReplaceShader(NarrowToWide(compiled.file), compiled.features, compiled.code.data(), compiled.code.size());
+		if (pipelines > 0)
+		{
+			printf("Shader hot reload: %s swapped into %zu pipeline(s)\n", compiled.file.c_str(), pipelines);
+			reloads++;
+		}
+		rebuilt += pipelines;
+	}
+#endif
+	return rebuilt;
+}
+
+size_t ShaderHotReload::ReloadCount()
+{
+	return reloads;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+
+// --------------------------------------------------------
+// Recompiles shaders when their files change and swaps
+// them into the pipeline cache between frames
+//
+// A background thread watches the source directory for
+// .hlsl edits and the .exe's directory for rebuilt .cso
+// files.  When a source changes, every permutation of it
+// in use is recompiled on that thread (see
+// ShaderPermutations), so the render loop never waits on
+// the compiler.  The main thread calls ApplyPending()
+// between frames, which swaps every finished shader into
+// the PipelineCache at once.
+//
+// Compile errors are printed and the old shader is kept.
+//
+// Usage:
+//
+//   ShaderHotReload::Watch("PixelShader.cso", "PixelShader.hlsl", "ps_5_0");
+//   ShaderHotReload::Start(".");
+//   ...
+//   if (ShaderHotReload::ApplyPending() > 0)
+//       // Rebind pipelines, re-reflect constant buffers
+// --------------------------------------------------------
+namespace ShaderHotReload
+{
+	// --------------------------------------------------------
+	// Registers a shader to reload
+	//
+	// compiledFile - Precompiled .cso version of the shader
+	// sourceFile   - .hlsl it's compiled from
+	// target       - Shader profile, like "vs_5_0"
+	// --------------------------------------------------------
+	void Watch(const std::string& compiledFile, const std::string& sourceFile, const char* target);
+
+	// sourceDirectory - Where the .hlsl files live
+	bool Start(const std::string& sourceDirectory);
+	void ShutDown();
+
+	// Returns how many pipelines were rebuilt
+	size_t ApplyPending();
+
+	// Shaders successfully swapped in so far
+	size_t ReloadCount();
+}
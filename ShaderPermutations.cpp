@@ -0,0 +1,294 @@
+#include "ShaderPermutations.h"
+#include "MemoryTracker.h"
+#include "Vfs.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#if defined(_WIN32)
+#include <d3dcompiler.h>
+#include <wrl/client.h>
+
+#pragma comment(lib, "d3dcompiler.lib")
+#endif
+
+namespace ShaderPermutations
+{
+	// Annonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		const char* featureDefines[ShaderFeature::Count] =
+		{
+			"USE_INSTANCING",
+			"VERTEX_COLOR",
+			"USE_TINT",
+		};
+
+#if defined(_WIN32)
+#if defined(DEBUG) || defined(_DEBUG)
+		const UINT compileFlags = D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+		const UINT compileFlags = D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_OPTIMIZATION_LEVEL3;
+#endif
+#else
+		const unsigned int compileFlags = 0;
+#endif
+
+		std::string sourceDirectory = ".";
+		std::string cacheDirectory;
+
+		// Guards everything below
+		std::mutex mutex;
+
+		struct LoadedPermutation
+		{
+			std::string sourceFile;
+			Permutation permutation;
+		};
+		std::vector<LoadedPermutation> loaded;
+
+		std::atomic<size_t> cacheHits = 0;
+		std::atomic<size_t> compiles = 0;
+
+		// 64-bit FNV-1a
+		struct Hasher
+		{
+			uint64_t value = 14695981039346656037ull;
+
+			void Bytes(const void* data, size_t size)
+			{
+				const unsigned char* bytes = (const unsigned char*)data;
+				for (size_t i = 0; i < size; i++)
+				{
+					value ^= bytes[i];
+					value *= 1099511628211ull;
+				}
+			}
+
+			void Add(const char* str) { Bytes(str, strlen(str) + 1); }
+		};
+
+		bool ReadFile(const std::string& path, std::vector<unsigned char>& data)
+		{
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			if (!file)
+				return false;
+
+			std::streamoff size = file.tellg();
+			file.seekg(0);
+			data.resize(size > 0 ? (size_t)size : 0);
+			return size > 0 && file.read((char*)data.data(), size);
+		}
+
+		// --------------------------------------------------------
+		// Writes a cache file under a temporary name first, so
+		// other threads (or a crash) never see half a file
+		// --------------------------------------------------------
+		void WriteCacheFile(const std::string& path, const std::vector<unsigned char>& data)
+		{
+			std::ostringstream temp;
+			temp << path << "." << std::this_thread::get_id() << ".tmp";
+			{
+				std::ofstream file(temp.str(), std::ios::binary);
+				if (!file.write((const char*)data.data(), data.size()))
+					return;
+			}
+
+			std::error_code error;
+			std::filesystem::rename(temp.str(), path, error);
+			if (error)
+				std::filesystem::remove(temp.str(), error);
+		}
+
+		// Whether the source ever refers to a feature's define
+		bool MentionsDefine(const std::vector<unsigned char>& source, const char* define)
+		{
+			size_t length = strlen(define);
+			const char* text = (const char*)source.data();
+			for (size_t i = 0; i + length <= source.size(); i++)
+			{
+				if (memcmp(text + i, define, length) == 0)
+					return true;
+			}
+			return false;
+		}
+
+		// --------------------------------------------------------
+		// Compiles one permutation from source text in memory,
+		// so what's compiled is exactly what was hashed
+		// --------------------------------------------------------
+		bool Compile(const std::string& path, const std::vector<unsigned char>& source, const char* target, ShaderFeatures features, std::vector<unsigned char>& code)
+		{
+#if defined(_WIN32)
+			D3D_SHADER_MACRO macros[ShaderFeature::Count + 1] = {};
+			for (unsigned int i = 0; i < ShaderFeature::Count; i++)
+			{
+				macros[i].Name = featureDefines[i];
+				macros[i].Definition = (features & (1 << i)) ? "1" : "0";
+			}
+
+			Microsoft::WRL::ComPtr<ID3DBlob> blob;
+			Microsoft::WRL::ComPtr<ID3DBlob> errors;
+			HRESULT result = D3DCompile(
+				source.data(),
+				source.size(),
+				path.c_str(),
+				macros,
+				D3D_COMPILE_STANDARD_FILE_INCLUDE,
+				"main",
+				target,
+				compileFlags,
+				0,
+				blob.GetAddressOf(),
+				errors.GetAddressOf());
+
+			// Warnings show up here even when compiling succeeds
+			if (errors)
+				printf("%s", (const char*)errors->GetBufferPointer());
+			if (FAILED(result))
+			{
+				printf("Shader permutations: %s (%s, features %x) failed to compile\n", path.c_str(), target, features);
+				return false;
+			}
+
+			const unsigned char* bytes = (const unsigned char*)blob->GetBufferPointer();
+			code.assign(bytes, bytes + blob->GetBufferSize());
+			return true;
+#else
+			// No HLSL compiler here, so this is a stand-in: only
+			// permutations already in the disk cache can be loaded
+			printf("Shader permutations: no compiler for %s (%s, features %x)\n", path.c_str(), target, features);
+			(void)source;
+			(void)code;
+			return false;
+#endif
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Sets where sources and compiled permutations live
+//
+// sourceDirectory - Where the .hlsl files live
+// cacheDirectory  - Where compiled permutations are kept,
+//                   or empty to always compile
+// --------------------------------------------------------
+void ShaderPermutations::Initialize(const std::string& sources, const std::string& cache)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	sourceDirectory = sources;
+	cacheDirectory = cache;
+
+	std::error_code error;
+	if (!cacheDirectory.empty())
+		std::filesystem::create_directories(cacheDirectory, error);
+}
+
+
+// --------------------------------------------------------
+// Gets the byte code for one permutation, from the disk
+// cache if it's there and compiling it (and caching the
+// result) if not
+//
+// sourceFile - .hlsl file, relative to the source directory
+// target     - Shader profile, like "vs_5_0"
+// features   - ShaderFeature bits
+// code       - Receives the byte code
+// --------------------------------------------------------
+bool ShaderPermutations::Load(const std::string& sourceFile, const char* target, ShaderFeatures features, std::vector<unsigned char>& code)
+{
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Shaders);
+
+	std::string sources;
+	std::string cache;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		sources = sourceDirectory;
+		cache = cacheDirectory;
+	}
+
+	// The loose source comes first, since that's the file hot
+	// reload sees being edited.  Without one, the Vfs (a
+	// mounted pack, say) can hold the sources too.
+	std::string path = sources + "/" + sourceFile;
+	std::vector<unsigned char> source;
+	if (!ReadFile(path, source) && !Vfs::Read(sourceFile.c_str(), source))
+	{
+		printf("Shader permutations: unable to read %s\n", path.c_str());
+		return false;
+	}
+
+	// Irrelevant features would only make duplicate permutations
+	ShaderFeatures relevant = 0;
+	for (unsigned int i = 0; i < ShaderFeature::Count; i++)
+	{
+		if ((features & (1 << i)) && MentionsDefine(source, featureDefines[i]))
+			relevant |= 1 << i;
+	}
+
+	// Content address: everything that affects the output
+	Hasher hasher;
+	hasher.Bytes(source.data(), source.size());
+	hasher.Add(target);
+	hasher.Bytes(&relevant, sizeof(relevant));
+	hasher.Bytes(&compileFlags, sizeof(compileFlags));
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.cso", (unsigned long long)hasher.value);
+	std::string cachePath = cache.empty() ? std::string() : cache + "/" + name;
+
+	// Packs can ship prebuilt permutations as "ShaderCache/<hash>.cso"
+	if (Vfs::Read(("ShaderCache/" + std::string(name)).c_str(), code) ||
+		(!cachePath.empty() && ReadFile(cachePath, code)))
+	{
+		cacheHits++;
+	}
+	else
+	{
+		if (!Compile(path, source, target, relevant, code))
+			return false;
+
+		compiles++;
+		if (!cachePath.empty())
+			WriteCacheFile(cachePath, code);
+	}
+
+	// Remember the permutation (as requested) for reloading
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const LoadedPermutation& l : loaded)
+	{
+		if (l.sourceFile == sourceFile && l.permutation.target == target && l.permutation.features == features)
+			return true;
+	}
+	loaded.push_back({ sourceFile, { target, features } });
+	return true;
+}
+
+
+std::vector<ShaderPermutations::Permutation> ShaderPermutations::Loaded(const std::string& sourceFile)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<Permutation> result;
+	for (const LoadedPermutation& l : loaded)
+	{
+		if (l.sourceFile == sourceFile)
+			result.push_back(l.permutation);
+	}
+	return result;
+}
+
+const char* ShaderPermutations::FeatureDefine(unsigned int index)
+{
+	return index < ShaderFeature::Count ? featureDefines[index] : "";
+}
+
+size_t ShaderPermutations::CacheHits() { return cacheHits; }
+size_t ShaderPermutations::Compiles() { return compiles; }
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Feature bits for the uber-shaders
+//
+// Each bit turns into a define (see FeatureDefine()) that
+// is always passed as 0 or 1, so shaders can use #if.
+// Default is what the precompiled .cso files are built
+// with, since those get no defines at all.
+// --------------------------------------------------------
+typedef uint32_t ShaderFeatures;
+
+namespace ShaderFeature
+{
+	const ShaderFeatures Instancing		= 1 << 0;	// USE_INSTANCING: world matrix per instance
+	const ShaderFeatures VertexColor	= 1 << 1;	// VERTEX_COLOR: read COLOR from the vertex
+	const ShaderFeatures Tint			= 1 << 2;	// USE_TINT: multiply by colorTint
+
+	const unsigned int Count = 3;
+	const ShaderFeatures Default = VertexColor | Tint;
+}
+
+// --------------------------------------------------------
+// Compiles uber-shader permutations on demand and keeps
+// the byte code in a content-addressed cache on disk
+//
+// A permutation is a source file, target profile and set
+// of features.  Its cache file is named by a hash of the
+// source text, target, defines and compile flags - so an
+// edited source simply misses the cache, and nothing ever
+// has to be invalidated.  Only permutations something asks
+// for get loaded (or compiled), so startup time and memory
+// don't grow with the number of possible variants.
+//
+// Features a source never mentions are dropped before
+// hashing, so a shader that ignores a feature has a single
+// permutation for both settings.  Files pulled in with
+// #include aren't part of the hash.
+//
+// Usage:
+//
+//   ShaderPermutations::Initialize(".", FixPath("ShaderCache"));
+//   std::vector<unsigned char> code;
+//   ShaderPermutations::Load("VertexShader.hlsl", "vs_5_0",
+//       ShaderFeature::VertexColor | ShaderFeature::Instancing, code);
+//
+// Load() can be called from any thread.
+// --------------------------------------------------------
+namespace ShaderPermutations
+{
+	struct Permutation
+	{
+		std::string target;
+		ShaderFeatures features;
+	};
+
+	// --------------------------------------------------------
+	// sourceDirectory - Where the .hlsl files live.  They're
+	//                   read from the Vfs only if missing here.
+	// cacheDirectory  - Where compiled permutations are kept,
+	//                   or empty to always compile
+	// --------------------------------------------------------
+	void Initialize(const std::string& sourceDirectory, const std::string& cacheDirectory);
+
+	// False if the source is missing or doesn't compile
+	bool Load(const std::string& sourceFile, const char* target, ShaderFeatures features, std::vector<unsigned char>& code);
+
+	// Every permutation of a source loaded so far (for reloading)
+	std::vector<Permutation> Loaded(const std::string& sourceFile);
+
+	// Define name for a feature bit index, like "USE_TINT"
+	const char* FeatureDefine(unsigned int index);
+
+	// Loads served from the disk cache vs. compiled from source
+	size_t CacheHits();
+	size_t Compiles();
+}
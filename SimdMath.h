@@ -0,0 +1,712 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+// --------------------------------------------------------
+// Engine math library
+//
+// Storage types (Float2/3/4, Float4x4) are plain structs with
+// the same layout as DirectXMath's XMFLOAT types, so they can
+// go straight into vertex and constant buffers.  Math is done
+// on Vector (one 4-wide SIMD register) and Matrix (four rows),
+// loaded from and stored back to those storage types:
+//
+//   Math::Vector p = Math::Load(position);
+//   p = Math::TransformPoint(p, Math::Load(world));
+//   Math::Store(position, p);
+//
+// Conventions match DirectXMath: row vectors multiplied on
+// the left (v * M), left-handed view/projection helpers.
+//
+// The backend is chosen at compile time:
+//   AVX2 + FMA   - __AVX2__ (fused multiply-add where possible)
+//   SSE4.1       - __SSE4_1__ or __AVX__ (dot product instructions)
+//   SSE2         - any x86-64 build
+//   NEON         - AArch64
+//   Scalar       - everything else, or MATH_FORCE_SCALAR
+// --------------------------------------------------------
+
+#if defined(MATH_FORCE_SCALAR)
+#define MATH_SCALAR 1
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATH_SSE 1
+#if defined(__SSE4_1__) || defined(__AVX__)
+#define MATH_SSE4 1
+#endif
+#if defined(__AVX2__)
+#define MATH_AVX2 1
+#endif
+#if defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define MATH_FMA 1
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define MATH_NEON 1
+#else
+#define MATH_SCALAR 1
+#endif
+
+#if defined(MATH_SSE)
+#include <immintrin.h>
+#elif defined(MATH_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace Math
+{
+	constexpr float Pi = 3.141592654f;
+	constexpr float TwoPi = 6.283185307f;
+	constexpr float PiDiv2 = 1.570796327f;
+	constexpr float PiDiv4 = 0.785398163f;
+
+	// --------------------------------------------------------
+	// Storage types
+	// --------------------------------------------------------
+	struct Float2
+	{
+		float x, y;
+
+		Float2() = default;
+		constexpr Float2(float x, float y) : x(x), y(y) {}
+	};
+
+	struct Float3
+	{
+		float x, y, z;
+
+		Float3() = default;
+		constexpr Float3(float x, float y, float z) : x(x), y(y), z(z) {}
+	};
+
+	struct Float4
+	{
+		float x, y, z, w;
+
+		Float4() = default;
+		constexpr Float4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+	};
+
+	// Row-major, like XMFLOAT4X4
+	struct Float4x4
+	{
+		float m[4][4];
+	};
+
+	// Axis-aligned bounding box
+	struct AABB
+	{
+		Float3 minimum;
+		Float3 maximum;
+	};
+
+	static_assert(sizeof(Float2) == 8, "Float2 must match XMFLOAT2");
+	static_assert(sizeof(Float3) == 12, "Float3 must match XMFLOAT3");
+	static_assert(sizeof(Float4) == 16, "Float4 must match XMFLOAT4");
+	static_assert(sizeof(Float4x4) == 64, "Float4x4 must match XMFLOAT4X4");
+
+
+	// --------------------------------------------------------
+	// Backend primitives - everything else is built on these
+	// --------------------------------------------------------
+#if defined(MATH_SSE)
+	typedef __m128 Vector;
+
+#if defined(MATH_AVX2)
+	inline const char* BackendName() { return "AVX2"; }
+#elif defined(MATH_SSE4)
+	inline const char* BackendName() { return "SSE4.1"; }
+#else
+	inline const char* BackendName() { return "SSE2"; }
+#endif
+
+	inline Vector Set(float x, float y, float z, float w) { return _mm_set_ps(w, z, y, x); }
+	inline Vector Splat(float value) { return _mm_set1_ps(value); }
+	inline Vector Zero() { return _mm_setzero_ps(); }
+
+	inline Vector Load(const Float4& f) { return _mm_loadu_ps(&f.x); }
+	inline Vector Load(const Float3& f)
+	{
+		__m128 xy = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)&f.x);
+		return _mm_movelh_ps(xy, _mm_load_ss(&f.z));
+	}
+	inline Vector Load(const Float2& f) { return _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)&f.x); }
+
+	inline void Store(Float4& f, Vector v) { _mm_storeu_ps(&f.x, v); }
+	inline void Store(Float3& f, Vector v)
+	{
+		_mm_storel_pi((__m64*)&f.x, v);
+		_mm_store_ss(&f.z, _mm_movehl_ps(v, v));
+	}
+	inline void Store(Float2& f, Vector v) { _mm_storel_pi((__m64*)&f.x, v); }
+
+	template<int X, int Y, int Z, int W>
+	inline Vector Swizzle(Vector v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(W, Z, Y, X)); }
+
+	inline float GetX(Vector v) { return _mm_cvtss_f32(v); }
+
+	inline Vector Add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+	inline Vector Subtract(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+	inline Vector Multiply(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+	inline Vector Divide(Vector a, Vector b) { return _mm_div_ps(a, b); }
+	inline Vector Min(Vector a, Vector b) { return _mm_min_ps(a, b); }
+	inline Vector Max(Vector a, Vector b) { return _mm_max_ps(a, b); }
+	inline Vector Sqrt(Vector v) { return _mm_sqrt_ps(v); }
+	inline Vector Abs(Vector v) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), v); }
+
+	// a * b + c
+	inline Vector MultiplyAdd(Vector a, Vector b, Vector c)
+	{
+#if defined(MATH_FMA)
+		return _mm_fmadd_ps(a, b, c);
+#else
+		return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+	}
+
+	// Results are splatted to all four lanes
+	inline Vector Dot4(Vector a, Vector b)
+	{
+#if defined(MATH_SSE4)
+		return _mm_dp_ps(a, b, 0xFF);
+#else
+		__m128 product = _mm_mul_ps(a, b);
+		__m128 sum = _mm_add_ps(product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+#endif
+	}
+
+	inline Vector Dot3(Vector a, Vector b)
+	{
+#if defined(MATH_SSE4)
+		return _mm_dp_ps(a, b, 0x7F);
+#else
+		__m128 product = _mm_mul_ps(a, b);
+		__m128 x = _mm_shuffle_ps(product, product, _MM_SHUFFLE(0, 0, 0, 0));
+		__m128 y = _mm_shuffle_ps(product, product, _MM_SHUFFLE(1, 1, 1, 1));
+		__m128 z = _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 2, 2, 2));
+		return _mm_add_ps(_mm_add_ps(x, y), z);
+#endif
+	}
+
+#elif defined(MATH_NEON)
+	typedef float32x4_t Vector;
+
+	inline const char* BackendName() { return "NEON"; }
+
+	inline Vector Set(float x, float y, float z, float w)
+	{
+		float values[4] = { x, y, z, w };
+		return vld1q_f32(values);
+	}
+	inline Vector Splat(float value) { return vdupq_n_f32(value); }
+	inline Vector Zero() { return vdupq_n_f32(0.0f); }
+
+	inline Vector Load(const Float4& f) { return vld1q_f32(&f.x); }
+	inline Vector Load(const Float3& f) { return vcombine_f32(vld1_f32(&f.x), vld1_lane_f32(&f.z, vdup_n_f32(0.0f), 0)); }
+	inline Vector Load(const Float2& f) { return vcombine_f32(vld1_f32(&f.x), vdup_n_f32(0.0f)); }
+
+	inline void Store(Float4& f, Vector v) { vst1q_f32(&f.x, v); }
+	inline void Store(Float3& f, Vector v)
+	{
+		vst1_f32(&f.x, vget_low_f32(v));
+		vst1q_lane_f32(&f.z, v, 2);
+	}
+	inline void Store(Float2& f, Vector v) { vst1_f32(&f.x, vget_low_f32(v)); }
+
+	template<int X, int Y, int Z, int W>
+	inline Vector Swizzle(Vector v)
+	{
+		Vector result = vdupq_n_f32(vgetq_lane_f32(v, X));
+		result = vsetq_lane_f32(vgetq_lane_f32(v, Y), result, 1);
+		result = vsetq_lane_f32(vgetq_lane_f32(v, Z), result, 2);
+		return vsetq_lane_f32(vgetq_lane_f32(v, W), result, 3);
+	}
+
+	inline float GetX(Vector v) { return vgetq_lane_f32(v, 0); }
+
+	inline Vector Add(Vector a, Vector b) { return vaddq_f32(a, b); }
+	inline Vector Subtract(Vector a, Vector b) { return vsubq_f32(a, b); }
+	inline Vector Multiply(Vector a, Vector b) { return vmulq_f32(a, b); }
+	inline Vector Divide(Vector a, Vector b) { return vdivq_f32(a, b); }
+	inline Vector Min(Vector a, Vector b) { return vminq_f32(a, b); }
+	inline Vector Max(Vector a, Vector b) { return vmaxq_f32(a, b); }
+	inline Vector Sqrt(Vector v) { return vsqrtq_f32(v); }
+	inline Vector Abs(Vector v) { return vabsq_f32(v); }
+	inline Vector MultiplyAdd(Vector a, Vector b, Vector c) { return vfmaq_f32(c, a, b); }
+
+	inline Vector Dot4(Vector a, Vector b) { return vdupq_n_f32(vaddvq_f32(vmulq_f32(a, b))); }
+	inline Vector Dot3(Vector a, Vector b) { return vdupq_n_f32(vaddvq_f32(vsetq_lane_f32(0.0f, vmulq_f32(a, b), 3))); }
+
+#else
+	struct Vector
+	{
+		float v[4];
+	};
+
+	inline const char* BackendName() { return "Scalar"; }
+
+	inline Vector Set(float x, float y, float z, float w) { return { { x, y, z, w } }; }
+	inline Vector Splat(float value) { return { { value, value, value, value } }; }
+	inline Vector Zero() { return { { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+
+	inline Vector Load(const Float4& f) { return { { f.x, f.y, f.z, f.w } }; }
+	inline Vector Load(const Float3& f) { return { { f.x, f.y, f.z, 0.0f } }; }
+	inline Vector Load(const Float2& f) { return { { f.x, f.y, 0.0f, 0.0f } }; }
+
+	inline void Store(Float4& f, Vector v) { f = Float4(v.v[0], v.v[1], v.v[2], v.v[3]); }
+	inline void Store(Float3& f, Vector v) { f = Float3(v.v[0], v.v[1], v.v[2]); }
+	inline void Store(Float2& f, Vector v) { f = Float2(v.v[0], v.v[1]); }
+
+	template<int X, int Y, int Z, int W>
+	inline Vector Swizzle(Vector v) { return { { v.v[X], v.v[Y], v.v[Z], v.v[W] } }; }
+
+	inline float GetX(Vector v) { return v.v[0]; }
+
+	inline Vector Add(Vector a, Vector b) { return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+	inline Vector Subtract(Vector a, Vector b) { return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+	inline Vector Multiply(Vector a, Vector b) { return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+	inline Vector Divide(Vector a, Vector b) { return { { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } }; }
+	inline Vector Min(Vector a, Vector b) { return { { fminf(a.v[0], b.v[0]), fminf(a.v[1], b.v[1]), fminf(a.v[2], b.v[2]), fminf(a.v[3], b.v[3]) } }; }
+	inline Vector Max(Vector a, Vector b) { return { { fmaxf(a.v[0], b.v[0]), fmaxf(a.v[1], b.v[1]), fmaxf(a.v[2], b.v[2]), fmaxf(a.v[3], b.v[3]) } }; }
+	inline Vector Sqrt(Vector v) { return { { sqrtf(v.v[0]), sqrtf(v.v[1]), sqrtf(v.v[2]), sqrtf(v.v[3]) } }; }
+	inline Vector Abs(Vector v) { return { { fabsf(v.v[0]), fabsf(v.v[1]), fabsf(v.v[2]), fabsf(v.v[3]) } }; }
+	inline Vector MultiplyAdd(Vector a, Vector b, Vector c) { return Add(Multiply(a, b), c); }
+
+	inline Vector Dot4(Vector a, Vector b) { return Splat(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2] + a.v[3] * b.v[3]); }
+	inline Vector Dot3(Vector a, Vector b) { return Splat(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2]); }
+#endif
+
+
+	// --------------------------------------------------------
+	// Vectors
+	// --------------------------------------------------------
+	inline Vector SplatX(Vector v) { return Swizzle<0, 0, 0, 0>(v); }
+	inline Vector SplatY(Vector v) { return Swizzle<1, 1, 1, 1>(v); }
+	inline Vector SplatZ(Vector v) { return Swizzle<2, 2, 2, 2>(v); }
+	inline Vector SplatW(Vector v) { return Swizzle<3, 3, 3, 3>(v); }
+
+	inline float GetY(Vector v) { return GetX(SplatY(v)); }
+	inline float GetZ(Vector v) { return GetX(SplatZ(v)); }
+	inline float GetW(Vector v) { return GetX(SplatW(v)); }
+
+	// Loads with an explicit w (1 for points, 0 for directions)
+	inline Vector Load(const Float3& f, float w) { return Set(f.x, f.y, f.z, w); }
+
+	inline Vector Negate(Vector v) { return Subtract(Zero(), v); }
+	inline Vector Scale(Vector v, float s) { return Multiply(v, Splat(s)); }
+	inline Vector Lerp(Vector a, Vector b, float t) { return MultiplyAdd(Subtract(b, a), Splat(t), a); }
+
+	inline Vector Cross3(Vector a, Vector b)
+	{
+		Vector a1 = Swizzle<1, 2, 0, 3>(a);
+		Vector b1 = Swizzle<2, 0, 1, 3>(b);
+		Vector a2 = Swizzle<2, 0, 1, 3>(a);
+		Vector b2 = Swizzle<1, 2, 0, 3>(b);
+		return Subtract(Multiply(a1, b1), Multiply(a2, b2));
+	}
+
+	inline Vector Length3(Vector v) { return Sqrt(Dot3(v, v)); }
+	inline Vector Length4(Vector v) { return Sqrt(Dot4(v, v)); }
+	inline Vector Normalize3(Vector v) { return Divide(v, Length3(v)); }
+	inline Vector Normalize4(Vector v) { return Divide(v, Length4(v)); }
+
+
+	// --------------------------------------------------------
+	// Matrices (rows, for row vector * matrix)
+	// --------------------------------------------------------
+	struct Matrix
+	{
+		Vector r[4];
+	};
+
+	inline Matrix Load(const Float4x4& f)
+	{
+		const Float4* rows = (const Float4*)&f.m[0][0];
+		return { { Load(rows[0]), Load(rows[1]), Load(rows[2]), Load(rows[3]) } };
+	}
+
+	inline void Store(Float4x4& f, const Matrix& m)
+	{
+		Float4* rows = (Float4*)&f.m[0][0];
+		Store(rows[0], m.r[0]);
+		Store(rows[1], m.r[1]);
+		Store(rows[2], m.r[2]);
+		Store(rows[3], m.r[3]);
+	}
+
+	inline Matrix Identity()
+	{
+		return { {
+			Set(1.0f, 0.0f, 0.0f, 0.0f),
+			Set(0.0f, 1.0f, 0.0f, 0.0f),
+			Set(0.0f, 0.0f, 1.0f, 0.0f),
+			Set(0.0f, 0.0f, 0.0f, 1.0f) } };
+	}
+
+	// Full 4-component transform: v * m
+	inline Vector Transform4(Vector v, const Matrix& m)
+	{
+		Vector result = Multiply(SplatX(v), m.r[0]);
+		result = MultiplyAdd(SplatY(v), m.r[1], result);
+		result = MultiplyAdd(SplatZ(v), m.r[2], result);
+		return MultiplyAdd(SplatW(v), m.r[3], result);
+	}
+
+	// Treats v as a point (w = 1)
+	inline Vector TransformPoint(Vector v, const Matrix& m)
+	{
+		Vector result = MultiplyAdd(SplatX(v), m.r[0], m.r[3]);
+		result = MultiplyAdd(SplatY(v), m.r[1], result);
+		return MultiplyAdd(SplatZ(v), m.r[2], result);
+	}
+
+	// Treats v as a direction (w = 0)
+	inline Vector TransformNormal(Vector v, const Matrix& m)
+	{
+		Vector result = Multiply(SplatX(v), m.r[0]);
+		result = MultiplyAdd(SplatY(v), m.r[1], result);
+		return MultiplyAdd(SplatZ(v), m.r[2], result);
+	}
+
+	// a then b
+	inline Matrix Multiply(const Matrix& a, const Matrix& b)
+	{
+		return { {
+			Transform4(a.r[0], b),
+			Transform4(a.r[1], b),
+			Transform4(a.r[2], b),
+			Transform4(a.r[3], b) } };
+	}
+
+	inline Matrix Transpose(const Matrix& m)
+	{
+#if defined(MATH_SSE)
+		Matrix result = m;
+		_MM_TRANSPOSE4_PS(result.r[0], result.r[1], result.r[2], result.r[3]);
+		return result;
+#else
+		Float4x4 f;
+		Store(f, m);
+		Float4x4 t;
+		for (int row = 0; row < 4; row++)
+			for (int column = 0; column < 4; column++)
+				t.m[row][column] = f.m[column][row];
+		return Load(t);
+#endif
+	}
+
+	inline Matrix Translation(float x, float y, float z)
+	{
+		Matrix m = Identity();
+		m.r[3] = Set(x, y, z, 1.0f);
+		return m;
+	}
+
+	inline Matrix Scaling(float x, float y, float z)
+	{
+		return { {
+			Set(x, 0.0f, 0.0f, 0.0f),
+			Set(0.0f, y, 0.0f, 0.0f),
+			Set(0.0f, 0.0f, z, 0.0f),
+			Set(0.0f, 0.0f, 0.0f, 1.0f) } };
+	}
+
+	inline Matrix RotationX(float angle)
+	{
+		float s = sinf(angle);
+		float c = cosf(angle);
+		Matrix m = Identity();
+		m.r[1] = Set(0.0f, c, s, 0.0f);
+		m.r[2] = Set(0.0f, -s, c, 0.0f);
+		return m;
+	}
+
+	inline Matrix RotationY(float angle)
+	{
+		float s = sinf(angle);
+		float c = cosf(angle);
+		Matrix m = Identity();
+		m.r[0] = Set(c, 0.0f, -s, 0.0f);
+		m.r[2] = Set(s, 0.0f, c, 0.0f);
+		return m;
+	}
+
+	inline Matrix RotationZ(float angle)
+	{
+		float s = sinf(angle);
+		float c = cosf(angle);
+		Matrix m = Identity();
+		m.r[0] = Set(c, s, 0.0f, 0.0f);
+		m.r[1] = Set(-s, c, 0.0f, 0.0f);
+		return m;
+	}
+
+	// Rotation matrix from a unit quaternion
+	inline Matrix RotationQuaternion(Vector q)
+	{
+		Float4 f;
+		Store(f, q);
+		float xx = f.x * f.x, yy = f.y * f.y, zz = f.z * f.z;
+		float xy = f.x * f.y, xz = f.x * f.z, yz = f.y * f.z;
+		float wx = f.w * f.x, wy = f.w * f.y, wz = f.w * f.z;
+
+		return { {
+			Set(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f),
+			Set(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f),
+			Set(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f),
+			Set(0.0f, 0.0f, 0.0f, 1.0f) } };
+	}
+
+	// Scale, then rotate, then translate
+	inline Matrix AffineTransformation(Vector scale, Vector rotation, Vector translation)
+	{
+		Matrix m = RotationQuaternion(rotation);
+		m.r[0] = Multiply(m.r[0], SplatX(scale));
+		m.r[1] = Multiply(m.r[1], SplatY(scale));
+		m.r[2] = Multiply(m.r[2], SplatZ(scale));
+		m.r[3] = Add(Multiply(translation, Set(1.0f, 1.0f, 1.0f, 0.0f)), Set(0.0f, 0.0f, 0.0f, 1.0f));
+		return m;
+	}
+
+	// General inverse (returns identity if the matrix is singular)
+	inline Matrix Inverse(const Matrix& matrix)
+	{
+		Float4x4 f;
+		Store(f, matrix);
+		const float* m = &f.m[0][0];
+		float inv[16];
+
+		inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+		inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+		inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+		inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+		inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+		inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+		inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+		inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+		inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+		inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+		inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+		inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+		inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+		inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+		inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+		inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+		float determinant = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+		if (determinant == 0.0f)
+			return Identity();
+
+		Float4x4 result;
+		float* r = &result.m[0][0];
+		for (int i = 0; i < 16; i++)
+			r[i] = inv[i] / determinant;
+		return Load(result);
+	}
+
+	// Left-handed camera looking from eye towards target
+	inline Matrix LookAtLH(Vector eye, Vector target, Vector up)
+	{
+		Vector zAxis = Normalize3(Subtract(target, eye));
+		Vector xAxis = Normalize3(Cross3(up, zAxis));
+		Vector yAxis = Cross3(zAxis, xAxis);
+
+		Matrix m = { { xAxis, yAxis, zAxis, Set(0.0f, 0.0f, 0.0f, 1.0f) } };
+		m = Transpose(m);
+		m.r[3] = Set(
+			-GetX(Dot3(xAxis, eye)),
+			-GetX(Dot3(yAxis, eye)),
+			-GetX(Dot3(zAxis, eye)),
+			1.0f);
+		return m;
+	}
+
+	inline Matrix PerspectiveFovLH(float fovY, float aspectRatio, float nearZ, float farZ)
+	{
+		float yScale = 1.0f / tanf(fovY * 0.5f);
+		float xScale = yScale / aspectRatio;
+		float range = farZ / (farZ - nearZ);
+		return { {
+			Set(xScale, 0.0f, 0.0f, 0.0f),
+			Set(0.0f, yScale, 0.0f, 0.0f),
+			Set(0.0f, 0.0f, range, 1.0f),
+			Set(0.0f, 0.0f, -range * nearZ, 0.0f) } };
+	}
+
+	inline Matrix OrthographicLH(float width, float height, float nearZ, float farZ)
+	{
+		float range = 1.0f / (farZ - nearZ);
+		return { {
+			Set(2.0f / width, 0.0f, 0.0f, 0.0f),
+			Set(0.0f, 2.0f / height, 0.0f, 0.0f),
+			Set(0.0f, 0.0f, range, 0.0f),
+			Set(0.0f, 0.0f, -range * nearZ, 1.0f) } };
+	}
+
+
+	// --------------------------------------------------------
+	// Quaternions (x, y, z = axis * sin, w = cos)
+	// --------------------------------------------------------
+	inline Vector QuaternionIdentity() { return Set(0.0f, 0.0f, 0.0f, 1.0f); }
+
+	// Roll (z) first, then pitch (x), then yaw (y)
+	inline Vector QuaternionRotationRollPitchYaw(float pitch, float yaw, float roll)
+	{
+		float cp = cosf(pitch * 0.5f), sp = sinf(pitch * 0.5f);
+		float cy = cosf(yaw * 0.5f), sy = sinf(yaw * 0.5f);
+		float cr = cosf(roll * 0.5f), sr = sinf(roll * 0.5f);
+		return Set(
+			sp * cy * cr + cp * sy * sr,
+			cp * sy * cr - sp * cy * sr,
+			cp * cy * sr - sp * sy * cr,
+			cp * cy * cr + sp * sy * sr);
+	}
+
+	inline Vector QuaternionRotationAxis(Vector axis, float angle)
+	{
+		Vector n = Normalize3(axis);
+		float s = sinf(angle * 0.5f);
+		Float3 f;
+		Store(f, n);
+		return Set(f.x * s, f.y * s, f.z * s, cosf(angle * 0.5f));
+	}
+
+	// Rotation a followed by rotation b
+	inline Vector QuaternionMultiply(Vector a, Vector b)
+	{
+		Float4 q1, q2;
+		Store(q1, b);
+		Store(q2, a);
+		return Set(
+			q1.w * q2.x + q1.x * q2.w + q1.y * q2.z - q1.z * q2.y,
+			q1.w * q2.y - q1.x * q2.z + q1.y * q2.w + q1.z * q2.x,
+			q1.w * q2.z + q1.x * q2.y - q1.y * q2.x + q1.z * q2.w,
+			q1.w * q2.w - q1.x * q2.x - q1.y * q2.y - q1.z * q2.z);
+	}
+
+	inline Vector QuaternionConjugate(Vector q) { return Multiply(q, Set(-1.0f, -1.0f, -1.0f, 1.0f)); }
+	inline Vector QuaternionNormalize(Vector q) { return Normalize4(q); }
+
+	inline Vector QuaternionSlerp(Vector a, Vector b, float t)
+	{
+		float cosAngle = GetX(Dot4(a, b));
+
+		// Take the short way around
+		if (cosAngle < 0.0f)
+		{
+			b = Negate(b);
+			cosAngle = -cosAngle;
+		}
+
+		// Nearly identical - plain lerp avoids dividing by ~0
+		if (cosAngle > 0.9995f)
+			return Normalize4(Lerp(a, b, t));
+
+		float angle = acosf(cosAngle);
+		float sinAngle = sinf(angle);
+		float wa = sinf((1.0f - t) * angle) / sinAngle;
+		float wb = sinf(t * angle) / sinAngle;
+		return MultiplyAdd(a, Splat(wa), Multiply(b, Splat(wb)));
+	}
+
+
+	// --------------------------------------------------------
+	// Planes (x, y, z = normal, w = distance term)
+	// --------------------------------------------------------
+	inline Vector PlaneFromPointNormal(Vector point, Vector normal)
+	{
+		Vector n = Normalize3(normal);
+		float d = -GetX(Dot3(point, n));
+		Float3 f;
+		Store(f, n);
+		return Set(f.x, f.y, f.z, d);
+	}
+
+	inline Vector PlaneNormalize(Vector plane) { return Divide(plane, Length3(plane)); }
+
+	// Signed distance from a (normalized) plane to a point
+	inline float PlaneDotCoord(Vector plane, Vector point)
+	{
+		return GetX(Dot3(plane, point)) + GetW(plane);
+	}
+
+
+	// --------------------------------------------------------
+	// Axis-aligned bounding boxes
+	// --------------------------------------------------------
+	inline AABB AABBFromPoints(const Float3* points, size_t count, size_t stride = sizeof(Float3))
+	{
+		AABB box = { Float3(0, 0, 0), Float3(0, 0, 0) };
+		if (count == 0)
+			return box;
+
+		const unsigned char* bytes = (const unsigned char*)points;
+		Vector minimum = Load(*points);
+		Vector maximum = minimum;
+		for (size_t i = 1; i < count; i++)
+		{
+			Vector p = Load(*(const Float3*)(bytes + i * stride));
+			minimum = Min(minimum, p);
+			maximum = Max(maximum, p);
+		}
+
+		Store(box.minimum, minimum);
+		Store(box.maximum, maximum);
+		return box;
+	}
+
+	inline AABB Merge(const AABB& a, const AABB& b)
+	{
+		AABB box;
+		Store(box.minimum, Min(Load(a.minimum), Load(b.minimum)));
+		Store(box.maximum, Max(Load(a.maximum), Load(b.maximum)));
+		return box;
+	}
+
+	inline Float3 Center(const AABB& box)
+	{
+		Float3 center;
+		Store(center, Scale(Add(Load(box.minimum), Load(box.maximum)), 0.5f));
+		return center;
+	}
+
+	inline Float3 Extents(const AABB& box)
+	{
+		Float3 extents;
+		Store(extents, Scale(Subtract(Load(box.maximum), Load(box.minimum)), 0.5f));
+		return extents;
+	}
+
+	inline bool Contains(const AABB& box, const Float3& point)
+	{
+		return
+			point.x >= box.minimum.x && point.x <= box.maximum.x &&
+			point.y >= box.minimum.y && point.y <= box.maximum.y &&
+			point.z >= box.minimum.z && point.z <= box.maximum.z;
+	}
+
+	inline bool Intersects(const AABB& a, const AABB& b)
+	{
+		return
+			a.minimum.x <= b.maximum.x && a.maximum.x >= b.minimum.x &&
+			a.minimum.y <= b.maximum.y && a.maximum.y >= b.minimum.y &&
+			a.minimum.z <= b.maximum.z && a.maximum.z >= b.minimum.z;
+	}
+
+	// Box that encloses the transformed box
+	inline AABB Transform(const AABB& box, const Matrix& m)
+	{
+		Vector center = TransformPoint(Load(Center(box)), m);
+		Vector extents = Load(Extents(box));
+
+		// Each new extent is the abs-weighted sum of the old ones
+		Vector newExtents = Multiply(SplatX(extents), Abs(m.r[0]));
+		newExtents = MultiplyAdd(SplatY(extents), Abs(m.r[1]), newExtents);
+		newExtents = MultiplyAdd(SplatZ(extents), Abs(m.r[2]), newExtents);
+
+		AABB result;
+		Store(result.minimum, Subtract(center, newExtents));
+		Store(result.maximum, Add(center, newExtents));
+		return result;
+	}
+}
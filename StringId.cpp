@@ -0,0 +1,68 @@
+#include "StringId.h"
+#include "MemoryTracker.h"
+
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+// Annonymous namespace to hold variables
+// only accessible in this file
+namespace
+{
+	// Hash -> text.  Strings live in a deque so their
+	// addresses never change as the table grows.
+	std::shared_mutex tableMutex;
+	std::deque<std::string> strings;
+	std::unordered_map<uint64_t, const char*> table;
+}
+
+
+// --------------------------------------------------------
+// Hashes a string and records its text for reverse lookup.
+// Interning the same text again just returns the same id.
+//
+// str - The string to intern (copied, so it can be temporary)
+// --------------------------------------------------------
+StringId StringId::Intern(const char* str)
+{
+	StringId id(str);
+
+	// Most names are interned many times, so
+	// check for an existing entry first
+	{
+		std::shared_lock<std::shared_mutex> lock(tableMutex);
+		auto it = table.find(id.hash);
+		if (it != table.end())
+		{
+#if defined(DEBUG) || defined(_DEBUG)
+			if (strcmp(it->second, str) != 0)
+				printf("StringId collision: \"%s\" and \"%s\"\n", it->second, str);
+#endif
+			return id;
+		}
+	}
+
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Strings);
+	std::unique_lock<std::shared_mutex> lock(tableMutex);
+	if (table.find(id.hash) == table.end())
+	{
+		strings.emplace_back(str);
+		table[id.hash] = strings.back().c_str();
+	}
+	return id;
+}
+
+
+// --------------------------------------------------------
+// Reverse lookup, for display and debugging
+// --------------------------------------------------------
+const char* StringId::GetString() const
+{
+	std::shared_lock<std::shared_mutex> lock(tableMutex);
+	auto it = table.find(hash);
+	return it != table.end() ? it->second : "<unknown>";
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// --------------------------------------------------------
+// Interned string identifier
+//
+// Names are reduced to a 64-bit FNV-1a hash, so comparing,
+// hashing and looking things up by name are all integer
+// operations.  Literals can be hashed at compile time:
+//
+//   constexpr StringId triangle("Triangle");
+//
+// Runtime strings go through StringId::Intern(), which also
+// records the text so it can be shown again later (UI,
+// debug output) with GetString().  Compile-time ids only
+// have text once the same name has been interned somewhere.
+// --------------------------------------------------------
+class StringId
+{
+public:
+	constexpr StringId() : hash(0) {}
+	constexpr explicit StringId(const char* str) : hash(Hash(str)) {}
+
+	// Hashes and records a runtime string
+	static StringId Intern(const char* str);
+
+	// The original text, or "<unknown>" if it was never interned
+	const char* GetString() const;
+
+	constexpr uint64_t Value() const { return hash; }
+	constexpr bool IsNull() const { return hash == 0; }
+
+	constexpr bool operator==(const StringId& other) const { return hash == other.hash; }
+	constexpr bool operator!=(const StringId& other) const { return hash != other.hash; }
+	constexpr bool operator<(const StringId& other) const { return hash < other.hash; }
+
+	// 64-bit FNV-1a
+	static constexpr uint64_t Hash(const char* str)
+	{
+		uint64_t result = 14695981039346656037ull;
+		while (*str)
+		{
+			result ^= (unsigned char)*str++;
+			result *= 1099511628211ull;
+		}
+		return result;
+	}
+
+private:
+	uint64_t hash;
+};
+
+// For using StringIds as unordered_map keys
+struct StringIdHasher
+{
+	size_t operator()(const StringId& id) const { return (size_t)id.Value(); }
+};
@@ -0,0 +1,617 @@
+#include "TransformKernels.h"
+
+#if defined(MATH_SSE)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// Lets single functions use wider instructions than the rest
+// of the build (MSVC allows any intrinsic anywhere)
+#if defined(MATH_SSE) && !defined(_MSC_VER)
+#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define KERNEL_TARGET(isa)
+#endif
+
+using namespace Math;
+
+namespace TransformKernels
+{
+	// Annonymous namespace to hold variables
+	// only accessible in this file
+	namespace
+	{
+		InstructionSet DetectInstructionSet()
+		{
+#if defined(MATH_SCALAR)
+			return InstructionSet::Scalar;
+#elif defined(MATH_SSE)
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			int highestLeaf = info[0];
+
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool fma = (info[2] & (1 << 12)) != 0;
+			if (!osxsave || highestLeaf < 7)
+				return InstructionSet::Simd128;
+
+			// The OS has to save the wider registers on context switches
+			unsigned long long xcr0 = _xgetbv(0);
+			bool ymmState = (xcr0 & 0x6) == 0x6;
+			bool zmmState = (xcr0 & 0xE6) == 0xE6;
+
+			__cpuidex(info, 7, 0);
+			bool avx2 = (info[1] & (1 << 5)) != 0;
+			bool avx512 = (info[1] & (1 << 16)) != 0;
+
+			if (avx512 && zmmState)
+				return InstructionSet::AVX512;
+			if (avx2 && fma && ymmState)
+				return InstructionSet::AVX2;
+			return InstructionSet::Simd128;
+#else
+			// Checks the OS register state for us
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx512f"))
+				return InstructionSet::AVX512;
+			if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+				return InstructionSet::AVX2;
+			return InstructionSet::Simd128;
+#endif
+#else
+			return InstructionSet::Simd128;
+#endif
+		}
+
+		InstructionSet& ActiveSet()
+		{
+			static InstructionSet active = Detected();
+			return active;
+		}
+
+
+		// --------------------------------------------------------
+		// Scalar reference versions
+		// --------------------------------------------------------
+		void MultiplyOneScalar(const Float4x4& a, const Float4x4& b, Float4x4& out, bool transpose)
+		{
+			Float4x4 result;
+			for (int row = 0; row < 4; row++)
+			{
+				for (int column = 0; column < 4; column++)
+				{
+					float sum =
+						a.m[row][0] * b.m[0][column] +
+						a.m[row][1] * b.m[1][column] +
+						a.m[row][2] * b.m[2][column] +
+						a.m[row][3] * b.m[3][column];
+					if (transpose)
+						result.m[column][row] = sum;
+					else
+						result.m[row][column] = sum;
+				}
+			}
+			out = result;
+		}
+
+		void TransformPointsScalar(const Float3* in, Float3* out, size_t count, const Float4x4& m)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				Float3 p = in[i];
+				out[i] = Float3(
+					p.x * m.m[0][0] + p.y * m.m[1][0] + p.z * m.m[2][0] + m.m[3][0],
+					p.x * m.m[0][1] + p.y * m.m[1][1] + p.z * m.m[2][1] + m.m[3][1],
+					p.x * m.m[0][2] + p.y * m.m[1][2] + p.z * m.m[2][2] + m.m[3][2]);
+			}
+		}
+
+		void TransformPointsSoAScalar(
+			const float* x, const float* y, const float* z,
+			float* outX, float* outY, float* outZ, float* outW,
+			size_t begin, size_t end,
+			const Float4x4& m)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				float px = x[i], py = y[i], pz = z[i];
+				outX[i] = px * m.m[0][0] + py * m.m[1][0] + pz * m.m[2][0] + m.m[3][0];
+				outY[i] = px * m.m[0][1] + py * m.m[1][1] + pz * m.m[2][1] + m.m[3][1];
+				outZ[i] = px * m.m[0][2] + py * m.m[1][2] + pz * m.m[2][2] + m.m[3][2];
+				if (outW)
+					outW[i] = px * m.m[0][3] + py * m.m[1][3] + pz * m.m[2][3] + m.m[3][3];
+			}
+		}
+
+
+		// --------------------------------------------------------
+		// 128-bit versions, built on the SimdMath backend
+		// --------------------------------------------------------
+		void TransformPointsSimd128(const Float3* in, Float3* out, size_t count, const Float4x4& m)
+		{
+			Matrix matrix = Load(m);
+			for (size_t i = 0; i < count; i++)
+				Store(out[i], TransformPoint(Load(in[i]), matrix));
+		}
+
+		void TransformPointsSoASimd128(
+			const float* x, const float* y, const float* z,
+			float* outX, float* outY, float* outZ, float* outW,
+			size_t count,
+			const Float4x4& m)
+		{
+			// Columns of the matrix, splatted
+			Vector m00 = Splat(m.m[0][0]), m10 = Splat(m.m[1][0]), m20 = Splat(m.m[2][0]), m30 = Splat(m.m[3][0]);
+			Vector m01 = Splat(m.m[0][1]), m11 = Splat(m.m[1][1]), m21 = Splat(m.m[2][1]), m31 = Splat(m.m[3][1]);
+			Vector m02 = Splat(m.m[0][2]), m12 = Splat(m.m[1][2]), m22 = Splat(m.m[2][2]), m32 = Splat(m.m[3][2]);
+			Vector m03 = Splat(m.m[0][3]), m13 = Splat(m.m[1][3]), m23 = Splat(m.m[2][3]), m33 = Splat(m.m[3][3]);
+
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				Vector px = Load(*(const Float4*)(x + i));
+				Vector py = Load(*(const Float4*)(y + i));
+				Vector pz = Load(*(const Float4*)(z + i));
+
+				Vector ox = MultiplyAdd(px, m00, MultiplyAdd(py, m10, MultiplyAdd(pz, m20, m30)));
+				Vector oy = MultiplyAdd(px, m01, MultiplyAdd(py, m11, MultiplyAdd(pz, m21, m31)));
+				Vector oz = MultiplyAdd(px, m02, MultiplyAdd(py, m12, MultiplyAdd(pz, m22, m32)));
+				if (outW)
+					Store(*(Float4*)(outW + i), MultiplyAdd(px, m03, MultiplyAdd(py, m13, MultiplyAdd(pz, m23, m33))));
+
+				Store(*(Float4*)(outX + i), ox);
+				Store(*(Float4*)(outY + i), oy);
+				Store(*(Float4*)(outZ + i), oz);
+			}
+
+			TransformPointsSoAScalar(x, y, z, outX, outY, outZ, outW, i, count, m);
+		}
+
+
+#if defined(MATH_SSE)
+		// --------------------------------------------------------
+		// AVX2 versions - two matrix rows (or two points) per
+		// 256-bit register, with each 128-bit half working on
+		// its own row
+		// --------------------------------------------------------
+		KERNEL_TARGET("avx2,fma")
+		inline __m256 RowsTimesMatrixAVX2(__m256 rows, __m256 b0, __m256 b1, __m256 b2, __m256 b3)
+		{
+			__m256 result = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0x00), b0);
+			result = _mm256_fmadd_ps(_mm256_shuffle_ps(rows, rows, 0x55), b1, result);
+			result = _mm256_fmadd_ps(_mm256_shuffle_ps(rows, rows, 0xAA), b2, result);
+			return _mm256_fmadd_ps(_mm256_shuffle_ps(rows, rows, 0xFF), b3, result);
+		}
+
+		KERNEL_TARGET("avx2,fma")
+		inline void StoreRowsAVX2(Float4x4& out, __m256 rows01, __m256 rows23, bool transpose)
+		{
+			if (!transpose)
+			{
+				_mm256_storeu_ps(&out.m[0][0], rows01);
+				_mm256_storeu_ps(&out.m[2][0], rows23);
+				return;
+			}
+
+			__m128 r0 = _mm256_castps256_ps128(rows01);
+			__m128 r1 = _mm256_extractf128_ps(rows01, 1);
+			__m128 r2 = _mm256_castps256_ps128(rows23);
+			__m128 r3 = _mm256_extractf128_ps(rows23, 1);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_storeu_ps(out.m[0], r0);
+			_mm_storeu_ps(out.m[1], r1);
+			_mm_storeu_ps(out.m[2], r2);
+			_mm_storeu_ps(out.m[3], r3);
+		}
+
+		KERNEL_TARGET("avx2,fma")
+		void MultiplyPairsAVX2(const Float4x4* a, const Float4x4* b, Float4x4* out, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				__m256 b0 = _mm256_broadcast_ps((const __m128*)b[i].m[0]);
+				__m256 b1 = _mm256_broadcast_ps((const __m128*)b[i].m[1]);
+				__m256 b2 = _mm256_broadcast_ps((const __m128*)b[i].m[2]);
+				__m256 b3 = _mm256_broadcast_ps((const __m128*)b[i].m[3]);
+				__m256 rows01 = _mm256_loadu_ps(&a[i].m[0][0]);
+				__m256 rows23 = _mm256_loadu_ps(&a[i].m[2][0]);
+
+				StoreRowsAVX2(out[i],
+					RowsTimesMatrixAVX2(rows01, b0, b1, b2, b3),
+					RowsTimesMatrixAVX2(rows23, b0, b1, b2, b3),
+					false);
+			}
+			_mm256_zeroupper();
+		}
+
+		KERNEL_TARGET("avx2,fma")
+		void MultiplySharedAVX2(const Float4x4* a, const Float4x4& b, Float4x4* out, size_t count, bool transpose)
+		{
+			__m256 b0 = _mm256_broadcast_ps((const __m128*)b.m[0]);
+			__m256 b1 = _mm256_broadcast_ps((const __m128*)b.m[1]);
+			__m256 b2 = _mm256_broadcast_ps((const __m128*)b.m[2]);
+			__m256 b3 = _mm256_broadcast_ps((const __m128*)b.m[3]);
+
+			for (size_t i = 0; i < count; i++)
+			{
+				__m256 rows01 = _mm256_loadu_ps(&a[i].m[0][0]);
+				__m256 rows23 = _mm256_loadu_ps(&a[i].m[2][0]);
+
+				StoreRowsAVX2(out[i],
+					RowsTimesMatrixAVX2(rows01, b0, b1, b2, b3),
+					RowsTimesMatrixAVX2(rows23, b0, b1, b2, b3),
+					transpose);
+			}
+			_mm256_zeroupper();
+		}
+
+		KERNEL_TARGET("avx2,fma")
+		void TransformPointsAVX2(const Float3* in, Float3* out, size_t count, const Float4x4& m)
+		{
+			__m256 r0 = _mm256_broadcast_ps((const __m128*)m.m[0]);
+			__m256 r1 = _mm256_broadcast_ps((const __m128*)m.m[1]);
+			__m256 r2 = _mm256_broadcast_ps((const __m128*)m.m[2]);
+			__m256 r3 = _mm256_broadcast_ps((const __m128*)m.m[3]);
+
+			size_t i = 0;
+			for (; i + 2 <= count; i += 2)
+			{
+				__m256 points = _mm256_insertf128_ps(_mm256_castps128_ps256(Load(in[i])), Load(in[i + 1]), 1);
+
+				__m256 result = _mm256_fmadd_ps(_mm256_shuffle_ps(points, points, 0x00), r0, r3);
+				result = _mm256_fmadd_ps(_mm256_shuffle_ps(points, points, 0x55), r1, result);
+				result = _mm256_fmadd_ps(_mm256_shuffle_ps(points, points, 0xAA), r2, result);
+
+				Store(out[i], _mm256_castps256_ps128(result));
+				Store(out[i + 1], _mm256_extractf128_ps(result, 1));
+			}
+			_mm256_zeroupper();
+
+			TransformPointsSimd128(in + i, out + i, count - i, m);
+		}
+
+		KERNEL_TARGET("avx2,fma")
+		void TransformPointsSoAAVX2(
+			const float* x, const float* y, const float* z,
+			float* outX, float* outY, float* outZ, float* outW,
+			size_t count,
+			const Float4x4& m)
+		{
+			__m256 m00 = _mm256_set1_ps(m.m[0][0]), m10 = _mm256_set1_ps(m.m[1][0]), m20 = _mm256_set1_ps(m.m[2][0]), m30 = _mm256_set1_ps(m.m[3][0]);
+			__m256 m01 = _mm256_set1_ps(m.m[0][1]), m11 = _mm256_set1_ps(m.m[1][1]), m21 = _mm256_set1_ps(m.m[2][1]), m31 = _mm256_set1_ps(m.m[3][1]);
+			__m256 m02 = _mm256_set1_ps(m.m[0][2]), m12 = _mm256_set1_ps(m.m[1][2]), m22 = _mm256_set1_ps(m.m[2][2]), m32 = _mm256_set1_ps(m.m[3][2]);
+			__m256 m03 = _mm256_set1_ps(m.m[0][3]), m13 = _mm256_set1_ps(m.m[1][3]), m23 = _mm256_set1_ps(m.m[2][3]), m33 = _mm256_set1_ps(m.m[3][3]);
+
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256 px = _mm256_loadu_ps(x + i);
+				__m256 py = _mm256_loadu_ps(y + i);
+				__m256 pz = _mm256_loadu_ps(z + i);
+
+				__m256 ox = _mm256_fmadd_ps(px, m00, _mm256_fmadd_ps(py, m10, _mm256_fmadd_ps(pz, m20, m30)));
+				__m256 oy = _mm256_fmadd_ps(px, m01, _mm256_fmadd_ps(py, m11, _mm256_fmadd_ps(pz, m21, m31)));
+				__m256 oz = _mm256_fmadd_ps(px, m02, _mm256_fmadd_ps(py, m12, _mm256_fmadd_ps(pz, m22, m32)));
+				if (outW)
+					_mm256_storeu_ps(outW + i, _mm256_fmadd_ps(px, m03, _mm256_fmadd_ps(py, m13, _mm256_fmadd_ps(pz, m23, m33))));
+
+				_mm256_storeu_ps(outX + i, ox);
+				_mm256_storeu_ps(outY + i, oy);
+				_mm256_storeu_ps(outZ + i, oz);
+			}
+			_mm256_zeroupper();
+
+			TransformPointsSoAScalar(x, y, z, outX, outY, outZ, outW, i, count, m);
+		}
+
+
+		// GCC's AVX-512 headers trip this on their own placeholder values
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+		// --------------------------------------------------------
+		// AVX-512 versions - a whole matrix (or four points) per
+		// 512-bit register
+		// --------------------------------------------------------
+		KERNEL_TARGET("avx512f")
+		inline __m512 MatrixTimesMatrixAVX512(__m512 rows, __m512 b0, __m512 b1, __m512 b2, __m512 b3)
+		{
+			__m512 result = _mm512_mul_ps(_mm512_permute_ps(rows, 0x00), b0);
+			result = _mm512_fmadd_ps(_mm512_permute_ps(rows, 0x55), b1, result);
+			result = _mm512_fmadd_ps(_mm512_permute_ps(rows, 0xAA), b2, result);
+			return _mm512_fmadd_ps(_mm512_permute_ps(rows, 0xFF), b3, result);
+		}
+
+		KERNEL_TARGET("avx512f")
+		inline void StoreMatrixAVX512(Float4x4& out, __m512 rows, bool transpose)
+		{
+			if (!transpose)
+			{
+				_mm512_storeu_ps(&out.m[0][0], rows);
+				return;
+			}
+
+			// Gather element i of every row into row i
+			const __m512i order = _mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+			_mm512_storeu_ps(&out.m[0][0], _mm512_permutexvar_ps(order, rows));
+		}
+
+		KERNEL_TARGET("avx512f")
+		void MultiplyPairsAVX512(const Float4x4* a, const Float4x4* b, Float4x4* out, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				__m512 b0 = _mm512_broadcast_f32x4(_mm_loadu_ps(b[i].m[0]));
+				__m512 b1 = _mm512_broadcast_f32x4(_mm_loadu_ps(b[i].m[1]));
+				__m512 b2 = _mm512_broadcast_f32x4(_mm_loadu_ps(b[i].m[2]));
+				__m512 b3 = _mm512_broadcast_f32x4(_mm_loadu_ps(b[i].m[3]));
+				__m512 rows = _mm512_loadu_ps(&a[i].m[0][0]);
+				StoreMatrixAVX512(out[i], MatrixTimesMatrixAVX512(rows, b0, b1, b2, b3), false);
+			}
+			_mm256_zeroupper();
+		}
+
+		KERNEL_TARGET("avx512f")
+		void MultiplySharedAVX512(const Float4x4* a, const Float4x4& b, Float4x4* out, size_t count, bool transpose)
+		{
+			__m512 b0 = _mm512_broadcast_f32x4(_mm_loadu_ps(b.m[0]));
+			__m512 b1 = _mm512_broadcast_f32x4(_mm_loadu_ps(b.m[1]));
+			__m512 b2 = _mm512_broadcast_f32x4(_mm_loadu_ps(b.m[2]));
+			__m512 b3 = _mm512_broadcast_f32x4(_mm_loadu_ps(b.m[3]));
+
+			for (size_t i = 0; i < count; i++)
+			{
+				__m512 rows = _mm512_loadu_ps(&a[i].m[0][0]);
+				StoreMatrixAVX512(out[i], MatrixTimesMatrixAVX512(rows, b0, b1, b2, b3), transpose);
+			}
+			_mm256_zeroupper();
+		}
+
+		KERNEL_TARGET("avx512f")
+		void TransformPointsAVX512(const Float3* in, Float3* out, size_t count, const Float4x4& m)
+		{
+			__m512 r0 = _mm512_broadcast_f32x4(_mm_loadu_ps(m.m[0]));
+			__m512 r1 = _mm512_broadcast_f32x4(_mm_loadu_ps(m.m[1]));
+			__m512 r2 = _mm512_broadcast_f32x4(_mm_loadu_ps(m.m[2]));
+			__m512 r3 = _mm512_broadcast_f32x4(_mm_loadu_ps(m.m[3]));
+
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m512 points = _mm512_castps128_ps512(Load(in[i]));
+				points = _mm512_insertf32x4(points, Load(in[i + 1]), 1);
+				points = _mm512_insertf32x4(points, Load(in[i + 2]), 2);
+				points = _mm512_insertf32x4(points, Load(in[i + 3]), 3);
+
+				__m512 result = _mm512_fmadd_ps(_mm512_permute_ps(points, 0x00), r0, r3);
+				result = _mm512_fmadd_ps(_mm512_permute_ps(points, 0x55), r1, result);
+				result = _mm512_fmadd_ps(_mm512_permute_ps(points, 0xAA), r2, result);
+
+				Store(out[i], _mm512_castps512_ps128(result));
+				Store(out[i + 1], _mm512_extractf32x4_ps(result, 1));
+				Store(out[i + 2], _mm512_extractf32x4_ps(result, 2));
+				Store(out[i + 3], _mm512_extractf32x4_ps(result, 3));
+			}
+			_mm256_zeroupper();
+
+			TransformPointsSimd128(in + i, out + i, count - i, m);
+		}
+
+		KERNEL_TARGET("avx512f")
+		void TransformPointsSoAAVX512(
+			const float* x, const float* y, const float* z,
+			float* outX, float* outY, float* outZ, float* outW,
+			size_t count,
+			const Float4x4& m)
+		{
+			__m512 m00 = _mm512_set1_ps(m.m[0][0]), m10 = _mm512_set1_ps(m.m[1][0]), m20 = _mm512_set1_ps(m.m[2][0]), m30 = _mm512_set1_ps(m.m[3][0]);
+			__m512 m01 = _mm512_set1_ps(m.m[0][1]), m11 = _mm512_set1_ps(m.m[1][1]), m21 = _mm512_set1_ps(m.m[2][1]), m31 = _mm512_set1_ps(m.m[3][1]);
+			__m512 m02 = _mm512_set1_ps(m.m[0][2]), m12 = _mm512_set1_ps(m.m[1][2]), m22 = _mm512_set1_ps(m.m[2][2]), m32 = _mm512_set1_ps(m.m[3][2]);
+			__m512 m03 = _mm512_set1_ps(m.m[0][3]), m13 = _mm512_set1_ps(m.m[1][3]), m23 = _mm512_set1_ps(m.m[2][3]), m33 = _mm512_set1_ps(m.m[3][3]);
+
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16)
+			{
+				__m512 px = _mm512_loadu_ps(x + i);
+				__m512 py = _mm512_loadu_ps(y + i);
+				__m512 pz = _mm512_loadu_ps(z + i);
+
+				__m512 ox = _mm512_fmadd_ps(px, m00, _mm512_fmadd_ps(py, m10, _mm512_fmadd_ps(pz, m20, m30)));
+				__m512 oy = _mm512_fmadd_ps(px, m01, _mm512_fmadd_ps(py, m11, _mm512_fmadd_ps(pz, m21, m31)));
+				__m512 oz = _mm512_fmadd_ps(px, m02, _mm512_fmadd_ps(py, m12, _mm512_fmadd_ps(pz, m22, m32)));
+				if (outW)
+					_mm512_storeu_ps(outW + i, _mm512_fmadd_ps(px, m03, _mm512_fmadd_ps(py, m13, _mm512_fmadd_ps(pz, m23, m33))));
+
+				_mm512_storeu_ps(outX + i, ox);
+				_mm512_storeu_ps(outY + i, oy);
+				_mm512_storeu_ps(outZ + i, oz);
+			}
+			_mm256_zeroupper();
+
+			TransformPointsSoAScalar(x, y, z, outX, outY, outZ, outW, i, count, m);
+		}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+		// --------------------------------------------------------
+		// Shared-matrix multiply behind both public entry points
+		// --------------------------------------------------------
+		void MultiplyShared(const Float4x4* a, const Float4x4& b, Float4x4* out, size_t count, bool transpose)
+		{
+			// Copied in case out overlaps b
+			Float4x4 shared = b;
+
+			switch (Active())
+			{
+#if defined(MATH_SSE)
+			case InstructionSet::AVX512:
+				MultiplySharedAVX512(a, shared, out, count, transpose);
+				return;
+			case InstructionSet::AVX2:
+				MultiplySharedAVX2(a, shared, out, count, transpose);
+				return;
+#endif
+			case InstructionSet::Simd128:
+			{
+				Matrix matrix = Load(shared);
+				for (size_t i = 0; i < count; i++)
+				{
+					Matrix result = Multiply(Load(a[i]), matrix);
+					Store(out[i], transpose ? Transpose(result) : result);
+				}
+				return;
+			}
+			default:
+				for (size_t i = 0; i < count; i++)
+					MultiplyOneScalar(a[i], shared, out[i], transpose);
+				return;
+			}
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Instruction set selection
+// --------------------------------------------------------
+TransformKernels::InstructionSet TransformKernels::Detected()
+{
+	static InstructionSet detected = DetectInstructionSet();
+	return detected;
+}
+
+TransformKernels::InstructionSet TransformKernels::Active() { return ActiveSet(); }
+
+void TransformKernels::SetActive(InstructionSet set)
+{
+	ActiveSet() = IsSupported(set) ? set : Detected();
+}
+
+bool TransformKernels::IsSupported(InstructionSet set)
+{
+	return (int)set <= (int)Detected();
+}
+
+const char* TransformKernels::Name(InstructionSet set)
+{
+	switch (set)
+	{
+	case InstructionSet::Simd128: return "simd128";
+	case InstructionSet::AVX2: return "avx2";
+	case InstructionSet::AVX512: return "avx512";
+	default: return "scalar";
+	}
+}
+
+
+// --------------------------------------------------------
+// Multiplies matching pairs of matrices
+//
+// a, b  - Arrays of count matrices
+// out   - Receives a[i] * b[i]
+// --------------------------------------------------------
+void TransformKernels::MultiplyMatrices(const Float4x4* a, const Float4x4* b, Float4x4* out, size_t count)
+{
+	switch (Active())
+	{
+#if defined(MATH_SSE)
+	case InstructionSet::AVX512:
+		MultiplyPairsAVX512(a, b, out, count);
+		return;
+	case InstructionSet::AVX2:
+		MultiplyPairsAVX2(a, b, out, count);
+		return;
+#endif
+	case InstructionSet::Simd128:
+		for (size_t i = 0; i < count; i++)
+			Store(out[i], Multiply(Load(a[i]), Load(b[i])));
+		return;
+	default:
+		for (size_t i = 0; i < count; i++)
+			MultiplyOneScalar(a[i], b[i], out[i], false);
+		return;
+	}
+}
+
+void TransformKernels::MultiplyMatrices(const Float4x4* a, const Float4x4& b, Float4x4* out, size_t count)
+{
+	MultiplyShared(a, b, out, count, false);
+}
+
+
+// --------------------------------------------------------
+// Builds every object's world-view-projection matrix
+// --------------------------------------------------------
+void TransformKernels::WorldViewProjection(
+	const Float4x4* worlds,
+	const Float4x4& view,
+	const Float4x4& projection,
+	Float4x4* out,
+	size_t count,
+	bool transposeForShader)
+{
+	Float4x4 viewProjection;
+	Store(viewProjection, Multiply(Load(view), Load(projection)));
+	MultiplyShared(worlds, viewProjection, out, count, transposeForShader);
+}
+
+
+// --------------------------------------------------------
+// Transforms an array of positions by one matrix
+// --------------------------------------------------------
+void TransformKernels::TransformPoints(const Float3* in, Float3* out, size_t count, const Float4x4& m)
+{
+	switch (Active())
+	{
+#if defined(MATH_SSE)
+	case InstructionSet::AVX512:
+		TransformPointsAVX512(in, out, count, m);
+		return;
+	case InstructionSet::AVX2:
+		TransformPointsAVX2(in, out, count, m);
+		return;
+#endif
+	case InstructionSet::Simd128:
+		TransformPointsSimd128(in, out, count, m);
+		return;
+	default:
+		TransformPointsScalar(in, out, count, m);
+		return;
+	}
+}
+
+void TransformKernels::TransformPointsSoA(
+	const float* x, const float* y, const float* z,
+	float* outX, float* outY, float* outZ, float* outW,
+	size_t count,
+	const Float4x4& m)
+{
+	switch (Active())
+	{
+#if defined(MATH_SSE)
+	case InstructionSet::AVX512:
+		TransformPointsSoAAVX512(x, y, z, outX, outY, outZ, outW, count, m);
+		return;
+	case InstructionSet::AVX2:
+		TransformPointsSoAAVX2(x, y, z, outX, outY, outZ, outW, count, m);
+		return;
+#endif
+	case InstructionSet::Simd128:
+		TransformPointsSoASimd128(x, y, z, outX, outY, outZ, outW, count, m);
+		return;
+	default:
+		TransformPointsSoAScalar(x, y, z, outX, outY, outZ, outW, 0, count, m);
+		return;
+	}
+}
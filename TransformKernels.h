@@ -0,0 +1,77 @@
+#pragma once
+
+#include "SimdMath.h"
+
+#include <cstddef>
+
+// --------------------------------------------------------
+// Batched transform math for thousands of items per call
+//
+// Every kernel has a scalar version, a 128-bit version (the
+// SimdMath backend - SSE or NEON) and, on x86, AVX2 and
+// AVX-512 versions.  The widest one the CPU and OS support
+// is picked at runtime, so the build itself doesn't need
+// any special instruction set flags.
+//
+// Outputs may alias inputs (in-place updates are fine).
+//
+// Usage:
+//
+//   TransformKernels::WorldViewProjection(worlds, view, proj, wvps, count, true);
+//   TransformKernels::TransformPoints(positions, skinned, vertexCount, bone);
+// --------------------------------------------------------
+namespace TransformKernels
+{
+	enum class InstructionSet
+	{
+		Scalar,
+		Simd128,	// SSE on x86, NEON on ARM
+		AVX2,		// Includes FMA
+		AVX512
+	};
+
+	// Best set this machine supports
+	InstructionSet Detected();
+
+	// Set the kernels currently use.  SetActive() is clamped
+	// to what's supported - mostly useful for benchmarks.
+	InstructionSet Active();
+	void SetActive(InstructionSet set);
+	bool IsSupported(InstructionSet set);
+	const char* Name(InstructionSet set);
+
+	// out[i] = a[i] * b[i]
+	void MultiplyMatrices(const Math::Float4x4* a, const Math::Float4x4* b, Math::Float4x4* out, size_t count);
+
+	// out[i] = a[i] * b
+	void MultiplyMatrices(const Math::Float4x4* a, const Math::Float4x4& b, Math::Float4x4* out, size_t count);
+
+	// --------------------------------------------------------
+	// out[i] = worlds[i] * view * projection, with the
+	// view-projection product computed once
+	//
+	// transposeForShader - Store transposed, ready for HLSL's
+	//                      column-major constant buffers
+	// --------------------------------------------------------
+	void WorldViewProjection(
+		const Math::Float4x4* worlds,
+		const Math::Float4x4& view,
+		const Math::Float4x4& projection,
+		Math::Float4x4* out,
+		size_t count,
+		bool transposeForShader);
+
+	// out[i] = (in[i], 1) * m, keeping xyz (no perspective divide)
+	void TransformPoints(const Math::Float3* in, Math::Float3* out, size_t count, const Math::Float4x4& m);
+
+	// --------------------------------------------------------
+	// Same as TransformPoints(), on separate x/y/z arrays
+	//
+	// outW - Optional, receives w (clip space positions)
+	// --------------------------------------------------------
+	void TransformPointsSoA(
+		const float* x, const float* y, const float* z,
+		float* outX, float* outY, float* outZ, float* outW,
+		size_t count,
+		const Math::Float4x4& m);
+}
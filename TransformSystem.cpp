@@ -0,0 +1,217 @@
+#include "TransformSystem.h"
+#include "JobSystem.h"
+#include "MemoryTracker.h"
+#include "TransformKernels.h"
+
+#include <atomic>
+
+// For the engine math library
+using namespace Math;
+
+// Annonymous namespace to hold variables
+// only accessible in this file
+namespace
+{
+	// Transforms per job, big enough to amortize the
+	// hand-off but small enough to balance the threads
+	const unsigned int batchSize = 4096;
+
+	// Child transforms gathered on the stack per kernel call:
+	// enough to fill the widest kernels' lanes many times over
+	const unsigned int kernelBatchSize = 128;
+}
+
+
+// --------------------------------------------------------
+// Adds a transform at the origin with no rotation and
+// unit scale.  Children must be created after parents.
+//
+// parent - Existing transform to attach to, if any
+// --------------------------------------------------------
+TransformId TransformSystem::Create(TransformId parent)
+{
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Transforms);
+
+	TransformId id = (TransformId)positions.size();
+	positions.push_back(Float3(0, 0, 0));
+	rotations.push_back(Float4(0, 0, 0, 1));
+	scales.push_back(Float3(1, 1, 1));
+	worlds.emplace_back();
+	Store(worlds.back(), Identity());
+	parents.push_back(parent);
+	dirty.push_back(1);
+	changed.push_back(0);
+	anyDirty = true;
+
+	// One level deeper than the parent
+	uint32_t depth = parent == InvalidTransform ? 0 : depths[parent] + 1;
+	depths.push_back(depth);
+
+	if (levels.size() <= depth)
+		levels.resize(depth + 1);
+	levels[depth].push_back(id);
+
+	return id;
+}
+
+
+// --------------------------------------------------------
+// Pre-sizes storage for a known number of transforms
+// --------------------------------------------------------
+void TransformSystem::Reserve(size_t count)
+{
+	MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Transforms);
+
+	positions.reserve(count);
+	rotations.reserve(count);
+	scales.reserve(count);
+	worlds.reserve(count);
+	parents.reserve(count);
+	depths.reserve(count);
+	dirty.reserve(count);
+	changed.reserve(count);
+	if (levels.empty())
+		levels.resize(1);
+	levels[0].reserve(count);
+}
+
+void TransformSystem::Clear()
+{
+	positions.clear();
+	rotations.clear();
+	scales.clear();
+	worlds.clear();
+	parents.clear();
+	depths.clear();
+	dirty.clear();
+	changed.clear();
+	levels.clear();
+	lastUpdateCount = 0;
+	anyDirty = false;
+}
+
+
+// --------------------------------------------------------
+// Setters - just store the value and mark it dirty
+// --------------------------------------------------------
+void TransformSystem::SetPosition(TransformId id, const Float3& position)
+{
+	positions[id] = position;
+	dirty[id] = 1;
+	anyDirty = true;
+}
+
+void TransformSystem::SetRotation(TransformId id, const Float4& quaternion)
+{
+	rotations[id] = quaternion;
+	dirty[id] = 1;
+	anyDirty = true;
+}
+
+void TransformSystem::SetRotationRollPitchYaw(TransformId id, float pitch, float yaw, float roll)
+{
+	Store(rotations[id], QuaternionRotationRollPitchYaw(pitch, yaw, roll));
+	dirty[id] = 1;
+	anyDirty = true;
+}
+
+void TransformSystem::SetScale(TransformId id, const Float3& scale)
+{
+	scales[id] = scale;
+	dirty[id] = 1;
+	anyDirty = true;
+}
+
+
+// --------------------------------------------------------
+// Rebuilds world matrices for dirty transforms and their
+// descendants.  Each depth is finished before the next
+// starts, so children always see up to date parents.
+// --------------------------------------------------------
+void TransformSystem::UpdateWorldMatrices()
+{
+	lastUpdateCount = 0;
+	if (!anyDirty)
+		return;
+
+	for (size_t depth = 0; depth < levels.size(); depth++)
+		UpdateLevel(levels[depth], depth == 0);
+
+	anyDirty = false;
+}
+
+
+// --------------------------------------------------------
+// Updates one depth of the hierarchy in parallel batches
+//
+// Local matrices are built one by one, but below the roots
+// the multiply by the parent's world matrix is batched: the
+// local and parent matrices of the dirty transforms are
+// gathered into contiguous arrays and multiplied by
+// TransformKernels::MultiplyMatrices() (the widest ISA the
+// CPU has), then scattered back to the world matrices.
+//
+// level  - Transforms at this depth
+// isRoot - True for the top level (no parents to check)
+// --------------------------------------------------------
+void TransformSystem::UpdateLevel(const std::vector<TransformId>& level, bool isRoot)
+{
+	std::atomic<size_t> updated = 0;
+
+	JobSystem::ParallelFor((unsigned int)level.size(), batchSize,
+		[&](unsigned int begin, unsigned int end)
+		{
+			Float4x4 locals[kernelBatchSize];
+			Float4x4 parentWorlds[kernelBatchSize];
+			TransformId ids[kernelBatchSize];
+			unsigned int gathered = 0;
+
+			// In place: locals become the world matrices
+			auto multiplyGathered = [&]()
+			{
+				TransformKernels::MultiplyMatrices(locals, parentWorlds, locals, gathered);
+				for (unsigned int k = 0; k < gathered; k++)
+					worlds[ids[k]] = locals[k];
+				gathered = 0;
+			};
+
+			size_t batchUpdated = 0;
+			for (unsigned int i = begin; i < end; i++)
+			{
+				TransformId id = level[i];
+				TransformId parent = parents[id];
+
+				// Dirty if we changed, or anything above us did
+				bool needsUpdate = dirty[id] || (!isRoot && changed[parent]);
+				changed[id] = needsUpdate;
+				if (!needsUpdate)
+					continue;
+
+				dirty[id] = 0;
+				batchUpdated++;
+
+				Matrix local = AffineTransformation(
+					Load(scales[id]),
+					Load(rotations[id]),
+					Load(positions[id]));
+
+				if (isRoot)
+				{
+					Store(worlds[id], local);
+					continue;
+				}
+
+				Store(locals[gathered], local);
+				parentWorlds[gathered] = worlds[parent];
+				ids[gathered] = id;
+				if (++gathered == kernelBatchSize)
+					multiplyGathered();
+			}
+			if (gathered > 0)
+				multiplyGathered();
+
+			updated += batchUpdated;
+		});
+
+	lastUpdateCount += updated;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "SimdMath.h"
+#include <cstdint>
+#include <vector>
+
+typedef uint32_t TransformId;
+const TransformId InvalidTransform = 0xFFFFFFFF;
+
+// --------------------------------------------------------
+// Position/rotation/scale for many objects, with optional
+// parent-child hierarchies and cached world matrices
+//
+// Data is stored as parallel arrays (structure-of-arrays)
+// indexed by TransformId, so updates stream through memory.
+// Setters only mark a transform dirty; UpdateWorldMatrices()
+// then rebuilds world matrices for dirty transforms and
+// everything beneath them, one hierarchy depth at a time
+// (parents before children), spread across the job system.
+//
+// Usage:
+//
+//   TransformId root = transforms.Create();
+//   TransformId child = transforms.Create(root);
+//   transforms.SetPosition(root, Float3(1, 0, 0));
+//   transforms.UpdateWorldMatrices();
+//   Float4x4 world = transforms.GetWorldMatrix(child);
+// --------------------------------------------------------
+class TransformSystem
+{
+public:
+	// parent - Existing transform to attach to, if any
+	TransformId Create(TransformId parent = InvalidTransform);
+	void Reserve(size_t count);
+	void Clear();
+
+	void SetPosition(TransformId id, const Math::Float3& position);
+	void SetRotation(TransformId id, const Math::Float4& quaternion);
+	void SetRotationRollPitchYaw(TransformId id, float pitch, float yaw, float roll);
+	void SetScale(TransformId id, const Math::Float3& scale);
+
+	const Math::Float3& GetPosition(TransformId id) const { return positions[id]; }
+	const Math::Float4& GetRotation(TransformId id) const { return rotations[id]; }
+	const Math::Float3& GetScale(TransformId id) const { return scales[id]; }
+	TransformId GetParent(TransformId id) const { return parents[id]; }
+
+	// Only up to date after UpdateWorldMatrices()
+	const Math::Float4x4& GetWorldMatrix(TransformId id) const { return worlds[id]; }
+
+	// Rebuilds every dirty world matrix (and their children's)
+	void UpdateWorldMatrices();
+
+	// Whether the last UpdateWorldMatrices() rebuilt this one.
+	// Only meaningful if LastUpdateCount() is non-zero.
+	bool WasUpdated(TransformId id) const { return changed[id] != 0; }
+
+	size_t Count() const { return positions.size(); }
+	size_t LastUpdateCount() const { return lastUpdateCount; }
+
+private:
+	std::vector<Math::Float3> positions;
+	std::vector<Math::Float4> rotations;
+	std::vector<Math::Float3> scales;
+	std::vector<Math::Float4x4> worlds;
+	std::vector<TransformId> parents;
+	std::vector<uint32_t> depths;
+
+	// Set by the setters, cleared by UpdateWorldMatrices()
+	std::vector<uint8_t> dirty;
+
+	// Whether each world matrix changed in the last update,
+	// which is how dirtiness reaches children
+	std::vector<uint8_t> changed;
+
+	// Transforms grouped by hierarchy depth (roots first)
+	std::vector<std::vector<TransformId>> levels;
+
+	size_t lastUpdateCount = 0;
+	bool anyDirty = false;
+
+	void UpdateLevel(const std::vector<TransformId>& level, bool isRoot);
+};
@@ -1,6 +1,9 @@
 #pragma once
 
-#include <DirectXMath.h>
+#include "SimdMath.h"
+#include "VertexFormat.h"
+
+#include <cstddef>
 
 // --------------------------------------------------------
 // A custom vertex definition
@@ -9,6 +12,38 @@
 // --------------------------------------------------------
 struct Vertex
 {
-	DirectX::XMFLOAT3 Position;	    // The local position of the vertex
-	DirectX::XMFLOAT4 Color;        // The color of the vertex
-};
\ No newline at end of file
+	Math::Float3 Position;	    // The local position of the vertex
+	Math::Float4 Color;        // The color of the vertex
+};
+
+// Input layout for Vertex, generated from the struct itself
+constexpr auto VertexLayout = MakeVertexFormat<Vertex>(
+	Attribute<decltype(Vertex::Position)>("POSITION", offsetof(Vertex, Position)),
+	Attribute<decltype(Vertex::Color)>("COLOR", offsetof(Vertex, Color)));
+
+static_assert(VertexLayout.IsValid(), "Vertex layout has overlapping or out of range elements");
+
+
+// --------------------------------------------------------
+// Per-instance data for the Instancing shader feature,
+// read from a second vertex buffer.  Unlike the constant
+// buffer copy, the world matrix is NOT transposed - its
+// rows become the shader's rows directly, which is the
+// same matrix the constant buffer path ends up with, and
+// both are applied as mul(v, world).
+// --------------------------------------------------------
+struct InstanceData
+{
+	Math::Float4x4 World;
+};
+
+constexpr auto InstancedVertexLayout = MakeVertexFormat(
+	{ (unsigned int)sizeof(Vertex), (unsigned int)sizeof(InstanceData), 0, 0 },
+	Attribute<decltype(Vertex::Position)>("POSITION", offsetof(Vertex, Position)),
+	Attribute<decltype(Vertex::Color)>("COLOR", offsetof(Vertex, Color)),
+	InstanceAttribute<Math::Float4>("INSTANCE_WORLD", offsetof(InstanceData, World) + 0, 1, 0),
+	InstanceAttribute<Math::Float4>("INSTANCE_WORLD", offsetof(InstanceData, World) + 16, 1, 1),
+	InstanceAttribute<Math::Float4>("INSTANCE_WORLD", offsetof(InstanceData, World) + 32, 1, 2),
+	InstanceAttribute<Math::Float4>("INSTANCE_WORLD", offsetof(InstanceData, World) + 48, 1, 3));
+
+static_assert(InstancedVertexLayout.IsValid(), "Instanced vertex layout has overlapping or out of range elements");
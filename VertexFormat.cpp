@@ -0,0 +1,94 @@
+#include "VertexFormat.h"
+
+#include <d3dcompiler.h>
+#include <wrl/client.h>
+#include <cstdio>
+#include <cstring>
+
+#pragma comment(lib, "d3dcompiler.lib")
+
+// Annonymous namespace to hold variables
+// only accessible in this file
+namespace
+{
+	const VertexElement* FindElement(const VertexElement* elements, size_t count, const char* semantic, unsigned int semanticIndex)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			if (elements[i].semanticIndex == semanticIndex && _stricmp(elements[i].semantic, semantic) == 0)
+				return &elements[i];
+		}
+		return 0;
+	}
+
+	unsigned int MaskComponents(BYTE mask)
+	{
+		unsigned int components = 0;
+		for (; mask; mask >>= 1)
+			components += mask & 1;
+		return components;
+	}
+}
+
+
+// --------------------------------------------------------
+// Compares each shader input against the format
+//
+// elements   - The format's elements
+// count      - How many elements there are
+// shaderCode - Compiled vertex shader byte code
+// shaderSize - Size of the byte code
+// --------------------------------------------------------
+bool ValidateVertexFormat(const VertexElement* elements, size_t count, const void* shaderCode, size_t shaderSize)
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> reflection;
+	if (FAILED(D3DReflect(shaderCode, shaderSize, IID_PPV_ARGS(reflection.GetAddressOf()))))
+	{
+		printf("Vertex format: unable to reflect vertex shader\n");
+		return false;
+	}
+
+	D3D11_SHADER_DESC shaderDesc;
+	reflection->GetDesc(&shaderDesc);
+
+	bool valid = true;
+	for (UINT i = 0; i < shaderDesc.InputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC input;
+		reflection->GetInputParameterDesc(i, &input);
+
+		// SV_VertexID and friends come from the pipeline, not a buffer
+		if (input.SystemValueType != D3D_NAME_UNDEFINED)
+			continue;
+
+		const VertexElement* element = FindElement(elements, count, input.SemanticName, input.SemanticIndex);
+		if (!element)
+		{
+			printf("Vertex format: shader input %s%u has no matching element\n", input.SemanticName, input.SemanticIndex);
+			valid = false;
+			continue;
+		}
+
+		unsigned int shaderComponents = MaskComponents(input.Mask);
+		if (shaderComponents > AttributeComponents(element->type))
+		{
+			printf("Vertex format: %s%u has %u components, shader reads %u\n",
+				input.SemanticName, input.SemanticIndex, AttributeComponents(element->type), shaderComponents);
+			valid = false;
+		}
+
+		bool shaderInteger =
+			input.ComponentType == D3D_REGISTER_COMPONENT_UINT32 ||
+			input.ComponentType == D3D_REGISTER_COMPONENT_SINT32;
+		if (shaderInteger != AttributeIsInteger(element->type))
+		{
+			printf("Vertex format: %s%u is %s, shader reads %s\n",
+				input.SemanticName, input.SemanticIndex,
+				AttributeIsInteger(element->type) ? "integer" : "float",
+				shaderInteger ? "integer" : "float");
+			valid = false;
+		}
+	}
+
+	return valid;
+}
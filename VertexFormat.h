@@ -0,0 +1,276 @@
+#pragma once
+
+#include "SimdMath.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_WIN32)
+#include <d3d11.h>
+#endif
+
+// --------------------------------------------------------
+// Compile-time description of a vertex layout
+//
+// A format is a list of elements (semantic, type, byte
+// offset, stream) plus the stride of each stream.  It's
+// built with constexpr functions, checked with
+// static_assert, and turned into the D3D11 input element
+// array at compile time - so the C++ vertex struct is the
+// only thing that has to be kept in sync by hand.
+//
+// Usage:
+//
+//   constexpr auto format = MakeVertexFormat<Vertex>(
+//       Attribute<decltype(Vertex::Position)>("POSITION", offsetof(Vertex, Position)),
+//       Attribute<decltype(Vertex::Color)>("COLOR", offsetof(Vertex, Color)));
+//   static_assert(format.IsValid());
+//
+//   auto elements = format.InputElements();
+//   device->CreateInputLayout(elements.data(), (UINT)elements.size(), ...);
+// --------------------------------------------------------
+
+const unsigned int MaxVertexStreams = 4;
+
+// Compact 8-bit-per-channel color, read as float4 in shaders
+struct PackedColor
+{
+	uint8_t r, g, b, a;
+};
+
+// Quantized position, each component -32767..32767 mapped
+// to -1..1 (to be rescaled to the mesh's bounds)
+struct PackedPosition
+{
+	int16_t x, y, z, w;
+};
+
+enum class VertexAttributeType : unsigned char
+{
+	Float,
+	Float2,
+	Float3,
+	Float4,
+	UInt,
+	UNorm8x4,
+	SNorm16x4
+};
+
+// Which attribute type a C++ member type maps to
+template<typename T> struct VertexAttributeTypeOf;
+template<> struct VertexAttributeTypeOf<float> { static constexpr VertexAttributeType value = VertexAttributeType::Float; };
+template<> struct VertexAttributeTypeOf<Math::Float2> { static constexpr VertexAttributeType value = VertexAttributeType::Float2; };
+template<> struct VertexAttributeTypeOf<Math::Float3> { static constexpr VertexAttributeType value = VertexAttributeType::Float3; };
+template<> struct VertexAttributeTypeOf<Math::Float4> { static constexpr VertexAttributeType value = VertexAttributeType::Float4; };
+template<> struct VertexAttributeTypeOf<uint32_t> { static constexpr VertexAttributeType value = VertexAttributeType::UInt; };
+template<> struct VertexAttributeTypeOf<PackedColor> { static constexpr VertexAttributeType value = VertexAttributeType::UNorm8x4; };
+template<> struct VertexAttributeTypeOf<PackedPosition> { static constexpr VertexAttributeType value = VertexAttributeType::SNorm16x4; };
+
+constexpr unsigned int AttributeSize(VertexAttributeType type)
+{
+	switch (type)
+	{
+	case VertexAttributeType::Float: return 4;
+	case VertexAttributeType::Float2: return 8;
+	case VertexAttributeType::Float3: return 12;
+	case VertexAttributeType::Float4: return 16;
+	case VertexAttributeType::UInt: return 4;
+	case VertexAttributeType::UNorm8x4: return 4;
+	case VertexAttributeType::SNorm16x4: return 8;
+	}
+	return 0;
+}
+
+constexpr unsigned int AttributeComponents(VertexAttributeType type)
+{
+	switch (type)
+	{
+	case VertexAttributeType::Float: return 1;
+	case VertexAttributeType::Float2: return 2;
+	case VertexAttributeType::Float3: return 3;
+	case VertexAttributeType::Float4: return 4;
+	case VertexAttributeType::UInt: return 1;
+	case VertexAttributeType::UNorm8x4: return 4;
+	case VertexAttributeType::SNorm16x4: return 4;
+	}
+	return 0;
+}
+
+// Integer attributes show up as uint in shaders, everything else as float
+constexpr bool AttributeIsInteger(VertexAttributeType type)
+{
+	return type == VertexAttributeType::UInt;
+}
+
+struct VertexElement
+{
+	const char* semantic;
+	unsigned int semanticIndex;
+	VertexAttributeType type;
+	unsigned int offset;
+	unsigned int stream;
+	bool perInstance;
+};
+
+// --------------------------------------------------------
+// One per-vertex element
+//
+// T             - C++ type of the member (use decltype)
+// semantic      - Matching HLSL semantic, like "POSITION"
+// offset        - offsetof() the member in its struct
+// stream        - Vertex buffer slot the data comes from
+// semanticIndex - For repeated semantics (TEXCOORD1, ...)
+// --------------------------------------------------------
+template<typename T>
+constexpr VertexElement Attribute(const char* semantic, size_t offset, unsigned int stream = 0, unsigned int semanticIndex = 0)
+{
+	return { semantic, semanticIndex, VertexAttributeTypeOf<T>::value, (unsigned int)offset, stream, false };
+}
+
+// Same as Attribute(), but advances once per instance
+template<typename T>
+constexpr VertexElement InstanceAttribute(const char* semantic, size_t offset, unsigned int stream, unsigned int semanticIndex = 0)
+{
+	return { semantic, semanticIndex, VertexAttributeTypeOf<T>::value, (unsigned int)offset, stream, true };
+}
+
+#if defined(_WIN32)
+constexpr DXGI_FORMAT AttributeFormat(VertexAttributeType type)
+{
+	switch (type)
+	{
+	case VertexAttributeType::Float: return DXGI_FORMAT_R32_FLOAT;
+	case VertexAttributeType::Float2: return DXGI_FORMAT_R32G32_FLOAT;
+	case VertexAttributeType::Float3: return DXGI_FORMAT_R32G32B32_FLOAT;
+	case VertexAttributeType::Float4: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+	case VertexAttributeType::UInt: return DXGI_FORMAT_R32_UINT;
+	case VertexAttributeType::UNorm8x4: return DXGI_FORMAT_R8G8B8A8_UNORM;
+	case VertexAttributeType::SNorm16x4: return DXGI_FORMAT_R16G16B16A16_SNORM;
+	}
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+constexpr D3D11_INPUT_ELEMENT_DESC InputElement(const VertexElement& e)
+{
+	D3D11_INPUT_ELEMENT_DESC result = {};
+	result.SemanticName = e.semantic;
+	result.SemanticIndex = e.semanticIndex;
+	result.Format = AttributeFormat(e.type);
+	result.InputSlot = e.stream;
+	result.AlignedByteOffset = e.offset;
+	result.InputSlotClass = e.perInstance ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA;
+	result.InstanceDataStepRate = e.perInstance ? 1 : 0;
+	return result;
+}
+#endif
+
+
+template<size_t N>
+struct VertexFormat
+{
+	std::array<VertexElement, N> elements;
+	std::array<unsigned int, MaxVertexStreams> strides;
+
+	// Number of vertex buffers this format reads from
+	constexpr unsigned int StreamCount() const
+	{
+		unsigned int count = 0;
+		for (const VertexElement& e : elements)
+			count = e.stream + 1 > count ? e.stream + 1 : count;
+		return count;
+	}
+
+	// --------------------------------------------------------
+	// Checks what the input assembler requires: elements are
+	// 4-byte aligned, fit in their stream's stride and don't
+	// overlap, semantics are unique, and a stream is either
+	// all per-vertex or all per-instance
+	// --------------------------------------------------------
+	constexpr bool IsValid() const
+	{
+		for (size_t i = 0; i < N; i++)
+		{
+			const VertexElement& e = elements[i];
+			if (!e.semantic || e.stream >= MaxVertexStreams)
+				return false;
+			if (e.offset % 4 != 0 || e.offset + AttributeSize(e.type) > strides[e.stream])
+				return false;
+
+			for (size_t j = i + 1; j < N; j++)
+			{
+				const VertexElement& other = elements[j];
+				if (SameSemantic(e, other))
+					return false;
+				if (other.stream != e.stream)
+					continue;
+				if (other.perInstance != e.perInstance)
+					return false;
+				if (e.offset < other.offset + AttributeSize(other.type) && other.offset < e.offset + AttributeSize(e.type))
+					return false;
+			}
+		}
+		return true;
+	}
+
+#if defined(_WIN32)
+	// The equivalent D3D11 input element array
+	constexpr std::array<D3D11_INPUT_ELEMENT_DESC, N> InputElements() const
+	{
+		std::array<D3D11_INPUT_ELEMENT_DESC, N> result = {};
+		for (size_t i = 0; i < N; i++)
+			result[i] = InputElement(elements[i]);
+		return result;
+	}
+#endif
+
+private:
+	static constexpr bool SameSemantic(const VertexElement& a, const VertexElement& b)
+	{
+		if (a.semanticIndex != b.semanticIndex)
+			return false;
+
+		// Semantics are case-insensitive
+		const char* x = a.semantic;
+		const char* y = b.semantic;
+		for (; *x && *y; x++, y++)
+		{
+			char cx = *x >= 'a' && *x <= 'z' ? *x - 'a' + 'A' : *x;
+			char cy = *y >= 'a' && *y <= 'z' ? *y - 'a' + 'A' : *y;
+			if (cx != cy)
+				return false;
+		}
+		return *x == *y;
+	}
+};
+
+// Single stream format; the stride is the vertex struct's size
+template<typename VertexType, typename... Elements>
+constexpr VertexFormat<sizeof...(Elements)> MakeVertexFormat(const Elements&... elements)
+{
+	return { { elements... }, { (unsigned int)sizeof(VertexType), 0, 0, 0 } };
+}
+
+// Multiple streams, each with its own stride
+template<typename... Elements>
+constexpr VertexFormat<sizeof...(Elements)> MakeVertexFormat(std::array<unsigned int, MaxVertexStreams> strides, const Elements&... elements)
+{
+	return { { elements... }, strides };
+}
+
+
+#if defined(_WIN32)
+// --------------------------------------------------------
+// Checks a format against a compiled vertex shader's inputs
+// (via reflection), printing every mismatch.  Returns false
+// if the shader reads something the format doesn't supply,
+// or with a different component type or count.
+// --------------------------------------------------------
+bool ValidateVertexFormat(const VertexElement* elements, size_t count, const void* shaderCode, size_t shaderSize);
+
+template<size_t N>
+bool ValidateVertexFormat(const VertexFormat<N>& format, const void* shaderCode, size_t shaderSize)
+{
+	return ValidateVertexFormat(format.elements.data(), N, shaderCode, shaderSize);
+}
+#endif
@@ -1,5 +1,19 @@
+// Uber-shader feature switches
+// - Each permutation defines all of these as 0 or 1 (see ShaderPermutations.h)
+// - The defaults here are what the precompiled VertexShader.cso is built with
+#ifndef USE_INSTANCING
+#define USE_INSTANCING 0
+#endif
+#ifndef VERTEX_COLOR
+#define VERTEX_COLOR 1
+#endif
+#ifndef USE_TINT
+#define USE_TINT 1
+#endif
+
 cbuffer ExternalData : register(b0)
 {
+	float4x4 world;
 	float4 colorTint;
 	float3 offset;
 }
@@ -17,7 +31,15 @@ struct VertexShaderInput
 	//  |    |                |
 	//  v    v                v
 	float3 localPosition	: POSITION;     // XYZ position
+#if VERTEX_COLOR
 	float4 color			: COLOR;        // RGBA color
+#endif
+#if USE_INSTANCING
+	float4 instanceWorld0	: INSTANCE_WORLD0;	// Rows of this instance's world matrix
+	float4 instanceWorld1	: INSTANCE_WORLD1;
+	float4 instanceWorld2	: INSTANCE_WORLD2;
+	float4 instanceWorld3	: INSTANCE_WORLD3;
+#endif
 };
 
 // Struct representing the data we're sending down the pipeline
@@ -56,12 +78,28 @@ VertexToPixel main( VertexShaderInput input )
 	// - Each of these components is then automatically divided by the W component, 
 	//   which we're leaving at 1.0 for now (this is more useful when dealing with 
 	//   a perspective projection matrix, which we'll get to in the future).
-	output.screenPosition = float4(input.localPosition + offset, 1.0f);
+#if USE_INSTANCING
+	float4x4 objectWorld = float4x4(input.instanceWorld0, input.instanceWorld1, input.instanceWorld2, input.instanceWorld3);
+#else
+	float4x4 objectWorld = world;
+#endif
+
+	// Row vectors, like the C++ side: the matrix arrives as
+	// written there, since the transposed upload and HLSL's
+	// column-major packing cancel out
+	output.screenPosition = mul(float4(input.localPosition, 1.0f), objectWorld) + float4(offset, 0.0f);
 
 	// Pass the color through 
 	// - The values will be interpolated per-pixel by the rasterizer
 	// - We don't need to alter it here, but we do need to send it to the pixel shader
-	output.color = input.color * colorTint;
+#if VERTEX_COLOR
+	output.color = input.color;
+#else
+	output.color = float4(1.0f, 1.0f, 1.0f, 1.0f);
+#endif
+#if USE_TINT
+	output.color *= colorTint;
+#endif
 
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)
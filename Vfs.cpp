@@ -0,0 +1,486 @@
+#include "Vfs.h"
+#include "AssetPack.h"
+#include "MemoryTracker.h"
+
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include "PathHelpers.h"
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Annonymous namespace to hold variables
+// only accessible in this file
+namespace
+{
+	enum class MountType
+	{
+		Directory,
+		Archive,
+		Memory
+	};
+
+	struct Mount
+	{
+		MountType type;
+		std::string point;			// Normalized; the whole name for memory files
+		std::string path;			// The folder, or the .pack file
+		AssetPack pack;				// Archive mounts
+		const unsigned char* data = 0;	// Memory mounts
+		size_t size = 0;
+	};
+
+	// Where a name was found, worked out once
+	struct Resolved
+	{
+		std::string name;				// Normalized, to tell hash collisions apart
+		const Mount* mount;
+		const AssetPackEntry* entry;	// Archive mounts
+		std::string path;				// Directory mounts
+	};
+
+	// Newest mount last.  Resolved names live in a deque so
+	// their addresses never change as more are added.
+	std::shared_mutex mutex;
+	std::vector<std::unique_ptr<Mount>> mounts;
+	std::deque<Resolved> resolved;
+	std::unordered_multimap<uint64_t, const Resolved*> table;
+
+#if defined(_WIN32)
+	const char Separator = '\\';
+#else
+	const char Separator = '/';
+#endif
+
+	// Lower case, forward slashes
+	char NormalizeChar(char c)
+	{
+		if (c == '\\')
+			return '/';
+		if (c >= 'A' && c <= 'Z')
+			return c - 'A' + 'a';
+		return c;
+	}
+
+	// Skips any leading "./"
+	const char* SkipCurrentDirectory(const char* name)
+	{
+		while (name[0] == '.' && (name[1] == '/' || name[1] == '\\'))
+			name += 2;
+		return name;
+	}
+
+	// Same FNV-1a as StringId, over the normalized name
+	uint64_t HashName(const char* name)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (const char* c = name; *c; c++)
+		{
+			hash ^= (unsigned char)NormalizeChar(*c);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool NameEquals(const std::string& normalized, const char* name)
+	{
+		size_t i = 0;
+		for (; name[i]; i++)
+		{
+			if (i >= normalized.size() || NormalizeChar(name[i]) != normalized[i])
+				return false;
+		}
+		return i == normalized.size();
+	}
+
+	std::string NormalizeName(const std::string& name)
+	{
+		std::string normalized = SkipCurrentDirectory(name.c_str());
+		for (char& c : normalized)
+			c = NormalizeChar(c);
+		return normalized;
+	}
+
+	// Mount points are folders: "" or ending in '/'
+	std::string NormalizeMountPoint(const std::string& mountPoint)
+	{
+		std::string point = NormalizeName(mountPoint);
+		if (!point.empty() && point.back() != '/')
+			point += '/';
+		return point;
+	}
+
+	// --------------------------------------------------------
+	// The rest of a name after a mount point, or null if the
+	// name isn't under it
+	// --------------------------------------------------------
+	const char* UnderMountPoint(const char* name, const std::string& point)
+	{
+		for (char c : point)
+		{
+			if (NormalizeChar(*name) != c)
+				return 0;
+			name++;
+		}
+		return name;
+	}
+
+	// A loose file's real path, with the OS's separators
+	std::string JoinPath(const std::string& directory, const char* rest)
+	{
+		std::string path;
+		path.reserve(directory.size() + 1 + strlen(rest));
+		path += directory;
+		path += Separator;
+		for (const char* c = rest; *c; c++)
+			path += (*c == '/' || *c == '\\') ? Separator : *c;
+		return path;
+	}
+
+#if defined(_WIN32)
+	bool FileExists(const std::string& path, bool directory)
+	{
+		DWORD attributes = GetFileAttributesW(NarrowToWide(path).c_str());
+		return attributes != INVALID_FILE_ATTRIBUTES &&
+			((attributes & FILE_ATTRIBUTE_DIRECTORY) != 0) == directory;
+	}
+
+	bool ReadWholeFile(const std::string& path, std::vector<unsigned char>& data)
+	{
+		HANDLE file = CreateFileW(
+			NarrowToWide(path).c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ,
+			0,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+			0);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size = {};
+		bool read = GetFileSizeEx(file, &size) != 0;
+		if (read)
+			data.resize((size_t)size.QuadPart);
+
+		// ReadFile() takes at most a DWORD at a time
+		for (size_t done = 0; read && done < data.size(); )
+		{
+			size_t remaining = data.size() - done;
+			DWORD chunk = remaining > (1u << 30) ? (1u << 30) : (DWORD)remaining;
+			DWORD bytes = 0;
+			read = ReadFile(file, data.data() + done, chunk, &bytes, 0) && bytes > 0;
+			done += bytes;
+		}
+
+		CloseHandle(file);
+		return read;
+	}
+#else
+	bool FileExists(const std::string& path, bool directory)
+	{
+		struct stat info;
+		return stat(path.c_str(), &info) == 0 &&
+			(directory ? S_ISDIR(info.st_mode) : S_ISREG(info.st_mode));
+	}
+
+	bool ReadWholeFile(const std::string& path, std::vector<unsigned char>& data)
+	{
+		int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return false;
+
+		struct stat info;
+		bool read = fstat(fd, &info) == 0;
+		if (read)
+			data.resize((size_t)info.st_size);
+
+		// read() can come back short, so keep going
+		for (size_t done = 0; read && done < data.size(); )
+		{
+			ssize_t bytes = ::read(fd, data.data() + done, data.size() - done);
+			read = bytes > 0;
+			if (read)
+				done += (size_t)bytes;
+		}
+
+		close(fd);
+		return read;
+	}
+#endif
+
+	// --------------------------------------------------------
+	// Finds a name in the mounts, newest first.  Callers hold
+	// the lock.
+	//
+	// name   - Name to find, with any leading "./" skipped
+	// result - Receives where it was found
+	// --------------------------------------------------------
+	bool Resolve(const char* name, Resolved& result)
+	{
+		for (auto it = mounts.rbegin(); it != mounts.rend(); ++it)
+		{
+			const Mount& mount = **it;
+			const char* rest = UnderMountPoint(name, mount.point);
+			if (!rest)
+				continue;
+
+			result.mount = &mount;
+			result.entry = 0;
+			if (mount.type == MountType::Memory)
+			{
+				if (*rest == 0)
+					return true;
+			}
+			else if (mount.type == MountType::Archive)
+			{
+				result.entry = mount.pack.Find(rest);
+				if (result.entry)
+					return true;
+			}
+			else if (*rest != 0)
+			{
+				result.path = JoinPath(mount.path, rest);
+				if (FileExists(result.path, false))
+					return true;
+			}
+		}
+		return false;
+	}
+
+	// --------------------------------------------------------
+	// Looks a name up in the interned table, resolving and
+	// interning it the first time.  Returns null if no mount
+	// has it.
+	// --------------------------------------------------------
+	const Resolved* Lookup(const char* name)
+	{
+		name = SkipCurrentDirectory(name);
+		uint64_t hash = HashName(name);
+
+		Resolved found = {};
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			auto range = table.equal_range(hash);
+			for (auto it = range.first; it != range.second; ++it)
+			{
+				if (NameEquals(it->second->name, name))
+					return it->second;
+			}
+
+			if (!Resolve(name, found))
+				return 0;
+		}
+
+		MemoryTracker::ScopedTag tag(MemoryTracker::Tag::Loading);
+		std::unique_lock<std::shared_mutex> lock(mutex);
+
+		// Another thread may have resolved it in the meantime
+		auto range = table.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (NameEquals(it->second->name, name))
+				return it->second;
+		}
+
+		found.name = NormalizeName(name);
+		resolved.push_back(std::move(found));
+		table.emplace(hash, &resolved.back());
+		return &resolved.back();
+	}
+
+	// Mounts change what names resolve to
+	void AddMount(std::unique_ptr<Mount> mount)
+	{
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		mounts.push_back(std::move(mount));
+		table.clear();
+		resolved.clear();
+	}
+}
+
+
+// --------------------------------------------------------
+// Mounts the loose files under a real folder
+//
+// mountPoint - Where in the Vfs the folder shows up ("" for
+//              the root)
+// directory  - Full or relative path of the folder
+// --------------------------------------------------------
+bool Vfs::MountDirectory(const std::string& mountPoint, const std::string& directory)
+{
+	if (directory.empty() || !FileExists(directory, true))
+		return false;
+
+	std::unique_ptr<Mount> mount = std::make_unique<Mount>();
+	mount->type = MountType::Directory;
+	mount->point = NormalizeMountPoint(mountPoint);
+	mount->path = directory;
+	while (mount->path.size() > 1 && (mount->path.back() == '/' || mount->path.back() == '\\'))
+		mount->path.pop_back();
+	AddMount(std::move(mount));
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Mounts an asset pack, mapping it until it's unmounted
+//
+// mountPoint - Where in the Vfs the pack's files show up
+// packPath   - Full or relative path of the .pack file
+// --------------------------------------------------------
+bool Vfs::MountArchive(const std::string& mountPoint, const std::string& packPath)
+{
+	std::unique_ptr<Mount> mount = std::make_unique<Mount>();
+	if (!FileExists(packPath, false) || !mount->pack.Open(packPath))
+		return false;
+
+	printf("Mounted %s (%zu assets)\n", packPath.c_str(), mount->pack.EntryCount());
+	mount->type = MountType::Archive;
+	mount->point = NormalizeMountPoint(mountPoint);
+	mount->path = packPath;
+	AddMount(std::move(mount));
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Mounts one file that's already in memory
+//
+// name - The file's full name in the Vfs
+// data - The file's contents, left where they are
+// size - Size of the contents
+// --------------------------------------------------------
+bool Vfs::MountMemory(const std::string& name, const void* data, size_t size)
+{
+	std::unique_ptr<Mount> mount = std::make_unique<Mount>();
+	mount->type = MountType::Memory;
+	mount->point = NormalizeName(name);
+	mount->data = (const unsigned char*)data;
+	mount->size = size;
+	if (mount->point.empty() || mount->point.back() == '/')
+		return false;
+
+	AddMount(std::move(mount));
+	return true;
+}
+
+
+void Vfs::UnmountAll()
+{
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	table.clear();
+	resolved.clear();
+	mounts.clear();
+}
+
+
+bool Vfs::Exists(const char* name)
+{
+	return Lookup(name) != 0;
+}
+
+
+const char* Vfs::RealPath(const char* name)
+{
+	const Resolved* file = Lookup(name);
+	return file && file->mount->type == MountType::Directory ? file->path.c_str() : 0;
+}
+
+
+const unsigned char* Vfs::Map(const char* name, size_t& size)
+{
+	const Resolved* file = Lookup(name);
+	if (!file)
+		return 0;
+
+	const Mount& mount = *file->mount;
+	if (mount.type == MountType::Archive)
+		return mount.pack.Map(*file->entry, size);
+	if (mount.type == MountType::Memory)
+	{
+		size = mount.size;
+		return mount.data;
+	}
+	return 0;
+}
+
+
+// --------------------------------------------------------
+// Reads a whole file from wherever it was mounted
+//
+// name - Name of the file in the Vfs
+// data - Receives the (uncompressed) contents
+// --------------------------------------------------------
+bool Vfs::Read(const char* name, std::vector<unsigned char>& data)
+{
+	const Resolved* file = Lookup(name);
+	if (!file)
+		return false;
+
+	const Mount& mount = *file->mount;
+	if (mount.type == MountType::Archive)
+		return mount.pack.Read(*file->entry, data);
+	if (mount.type == MountType::Memory)
+	{
+		data.assign(mount.data, mount.data + mount.size);
+		return true;
+	}
+	return ReadWholeFile(file->path, data);
+}
+
+
+bool Vfs::Locate(const char* name, FileLocation& location)
+{
+	const Resolved* file = Lookup(name);
+	if (!file)
+		return false;
+
+	const Mount& mount = *file->mount;
+	location = {};
+	if (mount.type == MountType::Archive)
+	{
+		location.path = mount.path.c_str();
+		location.pack = &mount.pack;
+		location.entry = file->entry;
+		return mount.pack.Extent(*file->entry, location.offset, location.size);
+	}
+	if (mount.type == MountType::Memory)
+	{
+		location.data = mount.data;
+		location.size = mount.size;
+		return true;
+	}
+
+	location.path = file->path.c_str();
+	location.size = WholeFile;
+	return true;
+}
+
+
+// --------------------------------------------------------
+// Reads a file through the AssetLoader, whose I/O threads
+// read through the Vfs
+//
+// name     - Name of the file in the Vfs
+// priority - See AssetLoader::Priority
+// done     - Gets the bytes on the main thread
+// --------------------------------------------------------
+void Vfs::ReadAsync(const std::string& name, AssetLoader::Priority priority, ReadCallback done)
+{
+	// The bytes are handed from the worker to the main thread
+	std::shared_ptr<std::vector<unsigned char>> bytes = std::make_shared<std::vector<unsigned char>>();
+	AssetLoader::Load(name, priority,
+		[bytes](std::vector<unsigned char>& data) { bytes->swap(data); return true; },
+		[bytes, done]() { done(*bytes); });
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "AssetLoader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class AssetPack;
+struct AssetPackEntry;
+
+// --------------------------------------------------------
+// Virtual file system: one set of asset names over every
+// place assets can come from
+//
+//  - Directory mounts hold loose files under a real folder
+//  - Archive mounts are asset packs (.pack), mapped
+//  - Memory mounts are single files the caller keeps in
+//    memory (embedded data, generated files, tests)
+//
+// Each mount sits at a mount point - "" for the root, or a
+// folder like "shaders/" - and later mounts are searched
+// first, so a pack mounted after a folder overrides it.
+// Names are case-insensitive and normalized like pack names
+// ('/' or '\' separators, any leading "./" ignored), though
+// a loose file on a case-sensitive file system has to be
+// named as it is on disk the first time it's looked up.
+//
+// Every name that's found is resolved once and interned:
+// the mount it came from, its pack entry and (for loose
+// files) its real path are kept, keyed by the name's hash.
+// Looking it up again hashes the name in place, so Exists(),
+// Map() and RealPath() don't allocate.  Missing names aren't
+// remembered, since loose files can show up later.
+//
+// Mount at startup, before anything reads on other threads,
+// and unmount once nothing is reading anymore.  Everything
+// else can be called from any thread.
+//
+// Usage:
+//
+//   Vfs::MountDirectory("", GetExePath());
+//   Vfs::MountArchive("", FixPath("assets.pack"));
+//   std::vector<unsigned char> code;
+//   Vfs::Read("VertexShader.cso", code);
+// --------------------------------------------------------
+namespace Vfs
+{
+	// A FileLocation size for "all of a loose file"
+	const uint64_t WholeFile = ~0ull;
+
+	// Where a file's bytes are, for reading them yourself
+	struct FileLocation
+	{
+		const char* path;				// Real file holding them, or null for memory files
+		uint64_t offset;				// Where they start in that file
+		uint64_t size;					// How many there are, or WholeFile
+		const AssetPack* pack;			// Archive entries get decoded with
+		const AssetPackEntry* entry;	// AssetPack::Decode()
+		const unsigned char* data;		// Memory files
+	};
+
+	// Quietly returns false if there's no such folder or pack
+	bool MountDirectory(const std::string& mountPoint, const std::string& directory);
+	bool MountArchive(const std::string& mountPoint, const std::string& packPath);
+
+	// The data must stay put until everything is unmounted
+	bool MountMemory(const std::string& name, const void* data, size_t size);
+
+	void UnmountAll();
+
+	bool Exists(const char* name);
+
+	// --------------------------------------------------------
+	// The real path of a loose file, or null for anything not
+	// from a directory mount.  The string is interned, and
+	// stays valid until everything is unmounted.
+	// --------------------------------------------------------
+	const char* RealPath(const char* name);
+
+	// --------------------------------------------------------
+	// Points right at a file's data, for memory files and
+	// stored (uncompressed) pack entries.  Returns null for
+	// anything else, which has to be read instead.
+	// --------------------------------------------------------
+	const unsigned char* Map(const char* name, size_t& size);
+
+	// Copies (and decompresses, if needed) a whole file
+	bool Read(const char* name, std::vector<unsigned char>& data);
+
+	// --------------------------------------------------------
+	// Where a file's bytes are: a loose file, a range of a
+	// pack file, or memory.  Returns false if no mount has it.
+	// The pointers stay valid until everything is unmounted.
+	// --------------------------------------------------------
+	bool Locate(const char* name, FileLocation& location);
+
+	// Gets a file's bytes (empty if it couldn't be read)
+	typedef std::function<void(std::vector<unsigned char>& data)> ReadCallback;
+
+	// --------------------------------------------------------
+	// Reads on an AssetLoader I/O thread, then calls back on
+	// the main thread from AssetLoader::Update().  Before the
+	// loader starts, it reads and calls back right away.
+	// --------------------------------------------------------
+	void ReadAsync(const std::string& name, AssetLoader::Priority priority, ReadCallback done);
+}
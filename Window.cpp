@@ -2,8 +2,10 @@
 #include "Window.h"
 #include "Graphics.h"
 #include "Input.h"
+#include "FlightRecorder.h"
+#include "FrameArena.h"
 
-#include <sstream>
+#include <cstdio>
 
 // Include ImGui's Win32 backend and forward declare the window handler function
 // Note: This CANNOT be inside a namespace!
@@ -158,6 +160,34 @@ HRESULT Window::Create(
 }
 
 
+// --------------------------------------------------------
+// Sets up window details without creating an OS-level
+// window, for running headless (benchmarks, etc.)
+// 
+// Handle() will return null, which tells the graphics
+// API to render offscreen instead of to a swap chain
+// 
+// width  - Desired width of the offscreen render target
+// height - Desired height of the offscreen render target
+// --------------------------------------------------------
+HRESULT Window::CreateHeadless(unsigned int width, unsigned int height)
+{
+	// Verify
+	if (windowCreated)
+		return E_FAIL;
+
+	// Save data - no title bar, so no stats either
+	windowWidth = width;
+	windowHeight = height;
+	windowStats = false;
+	windowHandle = 0;
+	hasFocus = true;
+
+	windowCreated = true;
+	return S_OK;
+}
+
+
 // --------------------------------------------------------
 // Updates the window's title bar with several stats once
 // per second, including:
@@ -178,18 +208,21 @@ void Window::UpdateStats(float totalTime)
 	// How long did each frame take?  (Approx)
 	float mspf = 1000.0f / (float)fpsFrameCounter;
 
-	// Quick and dirty title bar text (mostly for debugging)
-	std::wostringstream output;
-	output.precision(6);
-	output << windowTitle <<
-		"    Width: " << windowWidth <<
-		"    Height: " << windowHeight <<
-		"    FPS: " << fpsFrameCounter <<
-		"    Frame Time: " << mspf << "ms" <<
-		"    Graphics: " << Graphics::APIName();
+	// Quick and dirty title bar text (mostly for debugging),
+	// built in frame scratch memory so it never hits the heap
+	const size_t maxLength = 512;
+	wchar_t* output = FrameArena::AllocateArray<wchar_t>(maxLength);
+	swprintf_s(output, maxLength,
+		L"%s    Width: %u    Height: %u    FPS: %lld    Frame Time: %.6gms    Graphics: %s",
+		windowTitle.c_str(),
+		windowWidth,
+		windowHeight,
+		fpsFrameCounter,
+		mspf,
+		Graphics::APIName().c_str());
 
 	// Actually update the title bar and reset fps data
-	SetWindowText(windowHandle, output.str().c_str());
+	SetWindowText(windowHandle, output);
 	fpsFrameCounter = 0;
 	fpsTimeElapsed += elapsed;
 }
@@ -299,6 +332,7 @@ LRESULT Window::ProcessMessage(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lPara
 		windowHeight = HIWORD(lParam);
 
 		// Let other systems know
+		FlightRecorder::RecordEvent("Window resized");
 		Graphics::ResizeBuffers(windowWidth, windowHeight);
 		if(onResize)
 			onResize();